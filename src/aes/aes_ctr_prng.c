@@ -0,0 +1,333 @@
+/*
+ *  aes_ctr_prng.c: AES-256 in counter mode as a pseudo random number generator.
+ *
+ *  The key is expanded once as in FIPS-197 and the blocks of a 128 bit counter
+ *  are encrypted with it. On x86-64 the AES-NI instructions are used when the
+ *  CPU has them, on ARMv8 the crypto extension is used when the compiler
+ *  targets it, otherwise a portable table driven implementation is used.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "aes_ctr_prng.h"
+#include <stdint.h>
+#include <string.h>
+
+// Define AES_CTR_PRNG_NO_AESNI to build the portable code only
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && !defined( AES_CTR_PRNG_NO_AESNI )
+#include <immintrin.h>
+#define AES_CTR_PRNG_X86 1
+#elif defined( __aarch64__ ) && ( defined( __ARM_FEATURE_CRYPTO ) || defined( __ARM_FEATURE_AES ) ) \
+    && !defined( AES_CTR_PRNG_NO_AESNI )
+#include <arm_neon.h>
+#define AES_CTR_PRNG_ARM 1
+#endif
+
+// Number of blocks that are encrypted together, to keep the pipeline of the AES unit full
+#define AES_CTR_PRNG_PARALLEL 8
+
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9,
+    0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f,
+    0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15, 0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07,
+    0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3,
+    0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58,
+    0xcf, 0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3,
+    0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec, 0x5f,
+    0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73, 0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac,
+    0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a,
+    0xae, 0x08, 0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a, 0x70,
+    0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
+    0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf, 0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42,
+    0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
+
+static inline uint32_t ror32( const uint32_t x, int k )
+{
+    return ( x >> k ) | ( x << ( 32 - k ) );
+}
+
+static inline uint32_t load_be32( const uint8_t* p )
+{
+    return ( (uint32_t) p[0] << 24 ) | ( (uint32_t) p[1] << 16 ) | ( (uint32_t) p[2] << 8 ) | (uint32_t) p[3];
+}
+
+static inline void store_be32( uint8_t* p, uint32_t v )
+{
+    p[0] = (uint8_t) ( v >> 24 );
+    p[1] = (uint8_t) ( v >> 16 );
+    p[2] = (uint8_t) ( v >> 8 );
+    p[3] = (uint8_t) v;
+}
+
+static inline uint32_t sub_word( uint32_t w )
+{
+    return ( (uint32_t) aes_sbox[w >> 24] << 24 ) | ( (uint32_t) aes_sbox[( w >> 16 ) & 0xff] << 16 )
+        | ( (uint32_t) aes_sbox[( w >> 8 ) & 0xff] << 8 ) | (uint32_t) aes_sbox[w & 0xff];
+}
+
+static inline uint8_t xtime( uint8_t b )
+{
+    return (uint8_t) ( ( b << 1 ) ^ ( ( b & 0x80 ) ? 0x1b : 0 ) );
+}
+
+void aes_ctr_prng_init( aes_ctr_prng_state_t* state, const unsigned char* seed, size_t seed_length )
+{
+    uint8_t key[AES_CTR_PRNG_KEY_SIZE];
+    uint8_t rcon = 1;
+    int i;
+
+    // Fold the whole seed into the key, a seed of exactly one key is used as is
+    memset( key, 0, sizeof( key ) );
+    for( size_t k = 0; k < seed_length; k++ )
+    {
+        key[k % AES_CTR_PRNG_KEY_SIZE] ^= seed[k];
+    }
+
+    // FIPS-197 key expansion, Nk = 8
+    for( i = 0; i < 8; i++ )
+    {
+        state->rk[i] = load_be32( key + 4 * i );
+    }
+    for( ; i < 4 * ( AES_CTR_PRNG_ROUNDS + 1 ); i++ )
+    {
+        uint32_t t = state->rk[i - 1];
+
+        if( i % 8 == 0 )
+        {
+            t = sub_word( ror32( t, 24 ) ) ^ ( (uint32_t) rcon << 24 );
+            rcon = xtime( rcon );
+        }
+        else if( i % 8 == 4 )
+        {
+            t = sub_word( t );
+        }
+        state->rk[i] = state->rk[i - 8] ^ t;
+    }
+    for( i = 0; i < 4 * ( AES_CTR_PRNG_ROUNDS + 1 ); i++ )
+    {
+        store_be32( state->rk_bytes + 4 * i, state->rk[i] );
+    }
+
+    // The S-box multiplied by the MixColumns column { 2, 1, 1, 3 }, the other columns are rotations of it
+    for( i = 0; i < 256; i++ )
+    {
+        uint8_t s = aes_sbox[i];
+        uint8_t s2 = xtime( s );
+
+        state->te[i] = ( (uint32_t) s2 << 24 ) | ( (uint32_t) s << 16 ) | ( (uint32_t) s << 8 ) | (uint32_t) ( s2 ^ s );
+    }
+
+    state->counter[0] = 0;
+    state->counter[1] = 0;
+
+    memset( key, 0, sizeof( key ) );
+}
+
+static inline void aes_ctr_prng_next( aes_ctr_prng_state_t* state, uint64_t* lo, uint64_t* hi )
+{
+    *lo = state->counter[0];
+    *hi = state->counter[1];
+    if( ++state->counter[0] == 0 )
+    {
+        state->counter[1]++;
+    }
+}
+
+static void aes_ctr_prng_genrand_portable( aes_ctr_prng_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    const uint32_t* te = state->te;
+    uint8_t in[AES_CTR_PRNG_BLOCK_SIZE];
+    uint64_t lo, hi;
+
+    while( blocks-- > 0 )
+    {
+        const uint32_t* rk = state->rk;
+        uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+
+        // The counter block is the counter as a little-endian 128 bit integer
+        aes_ctr_prng_next( state, &lo, &hi );
+        for( int i = 0; i < 8; i++ )
+        {
+            in[i] = (uint8_t) ( lo >> ( 8 * i ) );
+            in[8 + i] = (uint8_t) ( hi >> ( 8 * i ) );
+        }
+
+        s0 = load_be32( in ) ^ rk[0];
+        s1 = load_be32( in + 4 ) ^ rk[1];
+        s2 = load_be32( in + 8 ) ^ rk[2];
+        s3 = load_be32( in + 12 ) ^ rk[3];
+
+        for( int round = 1; round < AES_CTR_PRNG_ROUNDS; round++ )
+        {
+            rk += 4;
+            t0 = te[s0 >> 24] ^ ror32( te[( s1 >> 16 ) & 0xff], 8 ) ^ ror32( te[( s2 >> 8 ) & 0xff], 16 )
+                ^ ror32( te[s3 & 0xff], 24 ) ^ rk[0];
+            t1 = te[s1 >> 24] ^ ror32( te[( s2 >> 16 ) & 0xff], 8 ) ^ ror32( te[( s3 >> 8 ) & 0xff], 16 )
+                ^ ror32( te[s0 & 0xff], 24 ) ^ rk[1];
+            t2 = te[s2 >> 24] ^ ror32( te[( s3 >> 16 ) & 0xff], 8 ) ^ ror32( te[( s0 >> 8 ) & 0xff], 16 )
+                ^ ror32( te[s1 & 0xff], 24 ) ^ rk[2];
+            t3 = te[s3 >> 24] ^ ror32( te[( s0 >> 16 ) & 0xff], 8 ) ^ ror32( te[( s1 >> 8 ) & 0xff], 16 )
+                ^ ror32( te[s2 & 0xff], 24 ) ^ rk[3];
+            s0 = t0;
+            s1 = t1;
+            s2 = t2;
+            s3 = t3;
+        }
+
+        // The last round has no MixColumns
+        rk += 4;
+        store_be32( bufpos,
+                    sub_word( ( s0 & 0xff000000 ) | ( s1 & 0xff0000 ) | ( s2 & 0xff00 ) | ( s3 & 0xff ) ) ^ rk[0] );
+        store_be32( bufpos + 4,
+                    sub_word( ( s1 & 0xff000000 ) | ( s2 & 0xff0000 ) | ( s3 & 0xff00 ) | ( s0 & 0xff ) ) ^ rk[1] );
+        store_be32( bufpos + 8,
+                    sub_word( ( s2 & 0xff000000 ) | ( s3 & 0xff0000 ) | ( s0 & 0xff00 ) | ( s1 & 0xff ) ) ^ rk[2] );
+        store_be32( bufpos + 12,
+                    sub_word( ( s3 & 0xff000000 ) | ( s0 & 0xff0000 ) | ( s1 & 0xff00 ) | ( s2 & 0xff ) ) ^ rk[3] );
+        bufpos += AES_CTR_PRNG_BLOCK_SIZE;
+    }
+}
+
+#ifdef AES_CTR_PRNG_X86
+
+// The counter blocks are kept in eight registers, x86 is little-endian so the counter words are already in the
+// order of the stream
+#define AES_CTR_PRNG_AESNI_LOAD( x )                                             \
+    aes_ctr_prng_next( state, &lo, &hi );                                        \
+    x = _mm_xor_si128( _mm_set_epi64x( (long long) hi, (long long) lo ), rk[0] )
+
+#define AES_CTR_PRNG_AESNI_ROUND( op, k ) \
+    x0 = op( x0, k );                     \
+    x1 = op( x1, k );                     \
+    x2 = op( x2, k );                     \
+    x3 = op( x3, k );                     \
+    x4 = op( x4, k );                     \
+    x5 = op( x5, k );                     \
+    x6 = op( x6, k );                     \
+    x7 = op( x7, k )
+
+__attribute__( ( target( "aes,sse2" ) ) ) static void
+aes_ctr_prng_genrand_aesni( aes_ctr_prng_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    __m128i rk[AES_CTR_PRNG_ROUNDS + 1];
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7;
+    uint64_t lo, hi;
+    int round;
+
+    for( round = 0; round <= AES_CTR_PRNG_ROUNDS; round++ )
+    {
+        rk[round] = _mm_loadu_si128( (const __m128i*) ( state->rk_bytes + 16 * round ) );
+    }
+
+    for( ; blocks >= AES_CTR_PRNG_PARALLEL; blocks -= AES_CTR_PRNG_PARALLEL )
+    {
+        AES_CTR_PRNG_AESNI_LOAD( x0 );
+        AES_CTR_PRNG_AESNI_LOAD( x1 );
+        AES_CTR_PRNG_AESNI_LOAD( x2 );
+        AES_CTR_PRNG_AESNI_LOAD( x3 );
+        AES_CTR_PRNG_AESNI_LOAD( x4 );
+        AES_CTR_PRNG_AESNI_LOAD( x5 );
+        AES_CTR_PRNG_AESNI_LOAD( x6 );
+        AES_CTR_PRNG_AESNI_LOAD( x7 );
+        for( round = 1; round < AES_CTR_PRNG_ROUNDS; round++ )
+        {
+            AES_CTR_PRNG_AESNI_ROUND( _mm_aesenc_si128, rk[round] );
+        }
+        AES_CTR_PRNG_AESNI_ROUND( _mm_aesenclast_si128, rk[AES_CTR_PRNG_ROUNDS] );
+        _mm_storeu_si128( (__m128i*) bufpos, x0 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 16 ), x1 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 32 ), x2 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 48 ), x3 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 64 ), x4 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 80 ), x5 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 96 ), x6 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 112 ), x7 );
+        bufpos += AES_CTR_PRNG_PARALLEL * AES_CTR_PRNG_BLOCK_SIZE;
+    }
+
+    // The last few blocks one at a time
+    while( blocks-- > 0 )
+    {
+        AES_CTR_PRNG_AESNI_LOAD( x0 );
+        for( round = 1; round < AES_CTR_PRNG_ROUNDS; round++ )
+        {
+            x0 = _mm_aesenc_si128( x0, rk[round] );
+        }
+        _mm_storeu_si128( (__m128i*) bufpos, _mm_aesenclast_si128( x0, rk[AES_CTR_PRNG_ROUNDS] ) );
+        bufpos += AES_CTR_PRNG_BLOCK_SIZE;
+    }
+}
+
+#endif /* AES_CTR_PRNG_X86 */
+
+#ifdef AES_CTR_PRNG_ARM
+
+static void aes_ctr_prng_genrand_armv8( aes_ctr_prng_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    uint8x16_t rk[AES_CTR_PRNG_ROUNDS + 1];
+    uint8x16_t x[AES_CTR_PRNG_PARALLEL];
+    uint64_t lo, hi;
+    int i, round;
+
+    for( round = 0; round <= AES_CTR_PRNG_ROUNDS; round++ )
+    {
+        rk[round] = vld1q_u8( state->rk_bytes + 16 * round );
+    }
+
+    while( blocks > 0 )
+    {
+        int n = blocks < AES_CTR_PRNG_PARALLEL ? (int) blocks : AES_CTR_PRNG_PARALLEL;
+
+        for( i = 0; i < n; i++ )
+        {
+            aes_ctr_prng_next( state, &lo, &hi );
+            x[i] = vreinterpretq_u8_u64( vcombine_u64( vcreate_u64( lo ), vcreate_u64( hi ) ) );
+        }
+
+        // AESE does the AddRoundKey before SubBytes and ShiftRows, so the last key is added separately
+        for( round = 0; round < AES_CTR_PRNG_ROUNDS - 1; round++ )
+        {
+            for( i = 0; i < n; i++ )
+            {
+                x[i] = vaesmcq_u8( vaeseq_u8( x[i], rk[round] ) );
+            }
+        }
+        for( i = 0; i < n; i++ )
+        {
+            x[i] = veorq_u8( vaeseq_u8( x[i], rk[AES_CTR_PRNG_ROUNDS - 1] ), rk[AES_CTR_PRNG_ROUNDS] );
+            vst1q_u8( bufpos, x[i] );
+            bufpos += AES_CTR_PRNG_BLOCK_SIZE;
+        }
+        blocks -= (size_t) n;
+    }
+}
+
+#endif /* AES_CTR_PRNG_ARM */
+
+void aes_ctr_prng_genrand_to_buf( aes_ctr_prng_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+#if defined( AES_CTR_PRNG_X86 )
+    if( __builtin_cpu_supports( "aes" ) )
+    {
+        aes_ctr_prng_genrand_aesni( state, bufpos, blocks );
+        return;
+    }
+#elif defined( AES_CTR_PRNG_ARM )
+    aes_ctr_prng_genrand_armv8( state, bufpos, blocks );
+    return;
+#endif
+    aes_ctr_prng_genrand_portable( state, bufpos, blocks );
+}
@@ -0,0 +1,50 @@
+/*
+ *  aes_ctr_prng.h: AES-256 in counter mode as a pseudo random number generator.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AES_CTR_PRNG_H
+#define AES_CTR_PRNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size in bytes of the key, AES-256
+#define AES_CTR_PRNG_KEY_SIZE 32
+
+// Number of rounds for a 256 bit key
+#define AES_CTR_PRNG_ROUNDS 14
+
+// Size in bytes of one block of output
+#define AES_CTR_PRNG_BLOCK_SIZE 16
+
+typedef struct aes_ctr_prng_state_s
+{
+    uint32_t rk[4 * ( AES_CTR_PRNG_ROUNDS + 1 )];  // The expanded key as big-endian words, FIPS-197 order.
+    uint8_t rk_bytes[16 * ( AES_CTR_PRNG_ROUNDS + 1 )];  // The same round keys as bytes, for the AES instructions.
+    uint32_t te[256];  // The combined SubBytes and MixColumns table of the portable code.
+    uint64_t counter[2];  // The 128 bit block counter, low word first.
+} aes_ctr_prng_state_t;
+
+// Expands the key. Every byte of the seed is folded into the 256 bit key, and the counter starts at zero.
+void aes_ctr_prng_init( aes_ctr_prng_state_t* state, const unsigned char* seed, size_t seed_length );
+
+// Encrypts the next blocks of the counter into the output buffer. The counter block is the 128 bit counter
+// as a little-endian integer, so block n of the stream is always AES(key, n). The stream is the same
+// whether the AES instructions or the portable code are used.
+void aes_ctr_prng_genrand_to_buf( aes_ctr_prng_state_t* state, unsigned char* bufpos, size_t blocks );
+
+#endif  // AES_CTR_PRNG_H
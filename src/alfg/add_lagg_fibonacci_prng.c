@@ -25,9 +25,16 @@
  */
 
 #include "add_lagg_fibonacci_prng.h"
+#include <endian.h>
 #include <stdint.h>
 #include <string.h>
 
+// Define ADD_LAGG_FIBONACCI_NO_SIMD to build the portable code only
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && !defined( ADD_LAGG_FIBONACCI_NO_SIMD )
+#include <immintrin.h>
+#define ADD_LAGG_FIBONACCI_X86 1
+#endif
+
 #define STATE_SIZE 64  // Size of the state array, sufficient for a high period
 #define LAG_BIG 55  // Large lag, e.g., 55
 #define LAG_SMALL 24  // Small lag, e.g., 24
@@ -51,29 +58,133 @@ void add_lagg_fibonacci_init( add_lagg_fibonacci_state_t* state, uint64_t init_k
     state->index = 0;  // Initialize the index for the first generation
 }
 
-void add_lagg_fibonacci_genrand_uint256_to_buf( add_lagg_fibonacci_state_t* state, unsigned char* bufpos )
+// Generates one word of the sequence
+static inline uint64_t add_lagg_fibonacci_next( add_lagg_fibonacci_state_t* state )
 {
-    uint64_t* buf_as_uint64 = (uint64_t*) bufpos;  // Interprets bufpos as a uint64_t array for direct assignment
-    int64_t result;  // Use signed integer to handle potential negative results from subtraction
+    // Subtract the two previous numbers in the sequence
+    int64_t result = (int64_t) ( state->s[( state->index + LAG_BIG ) % STATE_SIZE]
+                                 - state->s[( state->index + LAG_SMALL ) % STATE_SIZE] );
+
+    // Handle borrow if result is negative
+    if( result < 0 )
+    {
+        result += MODULUS;
+    }
+
+    // Store the result (after adjustment) back into the state, ensuring it's positive and within range
+    state->s[state->index] = (uint64_t) result;
 
-    for (int i = 0; i < 4; i++) {
-        // Subtract the two previous numbers in the sequence
-        result = (int64_t)state->s[(state->index + LAG_BIG) % STATE_SIZE] - (int64_t)state->s[(state->index + LAG_SMALL) % STATE_SIZE];
+    // Update the index for the next round
+    state->index = ( state->index + 1 ) % STATE_SIZE;
 
-        // Handle borrow if result is negative
-        if (result < 0) {
-            result += MODULUS;
-            // Optionally set a borrow flag or adjust the next operation based on borrow logic
+    return (uint64_t) result;
+}
+
+static void add_lagg_fibonacci_genrand_scalar( add_lagg_fibonacci_state_t* state, unsigned char* bufpos, size_t words )
+{
+    uint64_t w;
+
+    while( words-- > 0 )
+    {
+        w = htole64( add_lagg_fibonacci_next( state ) );
+        memcpy( bufpos, &w, sizeof( w ) );
+        bufpos += sizeof( w );
+    }
+}
+
+#ifdef ADD_LAGG_FIBONACCI_X86
+
+/* The big lag reads the words 9 behind the index and the small lag the words 40 behind,
+ * so the four words of a block only depend on earlier blocks and can be computed together.
+ * The vector loads are only used where the lagged words don't wrap around the state. */
+#define ADD_LAGG_FIBONACCI_CONTIGUOUS( index )                                        \
+    ( ( index ) % 4 == 0 && ( ( index ) + LAG_BIG ) % STATE_SIZE + 4 <= STATE_SIZE \
+      && ( ( index ) + LAG_SMALL ) % STATE_SIZE + 4 <= STATE_SIZE )
+
+// SSE2 is part of x86-64, two words per register
+static void add_lagg_fibonacci_genrand_sse2( add_lagg_fibonacci_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    const __m128i modulus = _mm_set1_epi64x( (long long) MODULUS );
+    __m128i a, b, d, neg;
+    unsigned int i;
+    int h;
+
+    while( blocks-- > 0 )
+    {
+        i = state->index;
+
+        if( !ADD_LAGG_FIBONACCI_CONTIGUOUS( i ) )
+        {
+            add_lagg_fibonacci_genrand_scalar( state, bufpos, 4 );
+            bufpos += 32;
+            continue;
         }
 
-        // Store the result (after adjustment) back into the state, ensuring it's positive and within range
-        state->s[state->index] = (uint64_t)result;
+        for( h = 0; h < 4; h += 2 )
+        {
+            a = _mm_loadu_si128( (const __m128i*) &state->s[( i + LAG_BIG ) % STATE_SIZE + h] );
+            b = _mm_loadu_si128( (const __m128i*) &state->s[( i + LAG_SMALL ) % STATE_SIZE + h] );
+            d = _mm_sub_epi64( a, b );
 
-        // Write the result into buf_as_uint64
-        buf_as_uint64[i] = state->s[state->index];
+            // SSE2 has no 64-bit compare, so the sign of the high half is spread over the word
+            neg = _mm_shuffle_epi32( _mm_srai_epi32( d, 31 ), _MM_SHUFFLE( 3, 3, 1, 1 ) );
+            d = _mm_add_epi64( d, _mm_and_si128( neg, modulus ) );
 
-        // Update the index for the next round
-        state->index = (state->index + 1) % STATE_SIZE;
+            _mm_storeu_si128( (__m128i*) &state->s[i + h], d );
+            _mm_storeu_si128( (__m128i*) ( bufpos + h * 8 ), d );
+        }
+
+        state->index = ( i + 4 ) % STATE_SIZE;
+        bufpos += 32;
+    }
+}
+
+// AVX2, a whole block per register
+__attribute__( ( target( "avx2" ) ) ) static void
+add_lagg_fibonacci_genrand_avx2( add_lagg_fibonacci_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    const __m256i modulus = _mm256_set1_epi64x( (long long) MODULUS );
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i a, b, d;
+    unsigned int i;
+
+    while( blocks-- > 0 )
+    {
+        i = state->index;
+
+        if( !ADD_LAGG_FIBONACCI_CONTIGUOUS( i ) )
+        {
+            add_lagg_fibonacci_genrand_scalar( state, bufpos, 4 );
+            bufpos += 32;
+            continue;
+        }
+
+        a = _mm256_loadu_si256( (const __m256i*) &state->s[( i + LAG_BIG ) % STATE_SIZE] );
+        b = _mm256_loadu_si256( (const __m256i*) &state->s[( i + LAG_SMALL ) % STATE_SIZE] );
+        d = _mm256_sub_epi64( a, b );
+        d = _mm256_add_epi64( d, _mm256_and_si256( _mm256_cmpgt_epi64( zero, d ), modulus ) );
+
+        _mm256_storeu_si256( (__m256i*) &state->s[i], d );
+        _mm256_storeu_si256( (__m256i*) bufpos, d );
+
+        state->index = ( i + 4 ) % STATE_SIZE;
+        bufpos += 32;
     }
 }
 
+#endif /* ADD_LAGG_FIBONACCI_X86 */
+
+void add_lagg_fibonacci_genrand_to_buf( add_lagg_fibonacci_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+#ifdef ADD_LAGG_FIBONACCI_X86
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        add_lagg_fibonacci_genrand_avx2( state, bufpos, blocks );
+        return;
+    }
+
+    add_lagg_fibonacci_genrand_sse2( state, bufpos, blocks );
+#else
+    add_lagg_fibonacci_genrand_scalar( state, bufpos, blocks * 4 );
+#endif
+}
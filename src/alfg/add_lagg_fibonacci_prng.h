@@ -27,6 +27,7 @@
 #ifndef ADD_LAGG_FIBONACCI_PRNG_H
 #define ADD_LAGG_FIBONACCI_PRNG_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // State definition for the Additive Lagged Fibonacci Generator
@@ -38,6 +39,8 @@ typedef struct
 
 // Function prototypes
 void add_lagg_fibonacci_init( add_lagg_fibonacci_state_t* state, uint64_t init_key[], unsigned long key_length );
-void add_lagg_fibonacci_genrand_uint256_to_buf( add_lagg_fibonacci_state_t* state, unsigned char* bufpos );
+
+// Generates blocks of 256 bits into the output buffer as little-endian 64-bit words
+void add_lagg_fibonacci_genrand_to_buf( add_lagg_fibonacci_state_t* state, unsigned char* bufpos, size_t blocks );
 
 #endif  // ADD_LAGG_FIBONACCI_PRNG_H
@@ -0,0 +1,366 @@
+/*
+ *  badmap.c: The map of the regions of a device that failed to be wiped or verified.
+ *
+ *  The passes record every range of a device that could not be written, could
+ *  not be read back or did not match what was written. The map is summarised
+ *  at the end of the wipe and saved as a small text file, so that the failed
+ *  regions can be examined, or wiped and verified again, without repeating the
+ *  whole method.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <libgen.h>
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "miscellaneous.h"
+#include "badmap.h"
+
+/* The names of the kinds of region in the map file and the summary. */
+static const char* nwipe_badmap_kind_name[NWIPE_BADMAP_KINDS] = { "write", "read", "verify" };
+
+void nwipe_badmap_add( nwipe_context_t* c, u64 offset, u64 length, nwipe_badmap_kind_t kind )
+{
+    /**
+     * Inserts an extent in start order. It is merged with the extents of the same kind
+     * that it touches or overlaps, even with extents of other kinds in between, so a run
+     * of failed blocks, which the passes find in device order, is a single extent and no
+     * sector is counted twice.
+     */
+
+    nwipe_badmap_t* map = c->badmap;
+    nwipe_badmap_extent_t* e;
+    nwipe_badmap_extent_t* grown;
+
+    /* The end of the region. */
+    u64 end = offset + length;
+
+    /* The position of the extent in the map. */
+    int lo;
+    int hi;
+    int mid;
+    int i;
+    int j;
+
+    if( length == 0 )
+    {
+        return;
+    }
+
+    if( map == NULL )
+    {
+        map = calloc( 1, sizeof( nwipe_badmap_t ) );
+
+        if( !map )
+        {
+            nwipe_perror( errno, __FUNCTION__, "calloc" );
+            nwipe_log( NWIPE_LOG_ERROR, "Unable to record a failed region of '%s'.", c->device_name );
+            return;
+        }
+
+        c->badmap = map;
+    }
+
+    /* Find the first extent that starts after the region, the common case is the end of the map. */
+    lo = 0;
+    hi = map->count;
+
+    if( hi > 0 && map->extent[hi - 1].start <= offset )
+    {
+        lo = hi;
+    }
+
+    while( lo < hi )
+    {
+        mid = lo + ( hi - lo ) / 2;
+
+        if( map->extent[mid].start <= offset )
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    i = lo;
+
+    /* The extents of a kind don't overlap, so only the last one of the kind before the region can reach it. */
+    for( j = i - 1; j >= 0 && map->extent[j].kind != kind; j-- )
+        ;
+
+    if( j >= 0 && map->extent[j].end >= offset )
+    {
+        /* Extend that extent. */
+        i = j;
+        e = &map->extent[i];
+
+        if( e->end < end )
+        {
+            e->end = end;
+        }
+    }
+    else
+    {
+        if( map->count == map->size )
+        {
+            if( map->size >= NWIPE_KNOB_BADMAP_EXTENTS )
+            {
+                if( !map->overflow )
+                {
+                    map->overflow = 1;
+                    nwipe_log( NWIPE_LOG_WARNING,
+                               "The bad region map of '%s' is full, further regions are not recorded.",
+                               c->device_name );
+                }
+                return;
+            }
+
+            grown = realloc( map->extent, ( map->size ? map->size * 2 : 64 ) * sizeof( nwipe_badmap_extent_t ) );
+
+            if( !grown )
+            {
+                nwipe_perror( errno, __FUNCTION__, "realloc" );
+                nwipe_log( NWIPE_LOG_ERROR, "Unable to record a failed region of '%s'.", c->device_name );
+                return;
+            }
+
+            map->extent = grown;
+            map->size = map->size ? map->size * 2 : 64;
+        }
+
+        memmove( &map->extent[i + 1], &map->extent[i], ( map->count - i ) * sizeof( nwipe_badmap_extent_t ) );
+        map->count++;
+
+        e = &map->extent[i];
+        e->start = offset;
+        e->end = end;
+        e->kind = kind;
+    }
+
+    /* Absorb the following extents of the same kind that the extent now reaches, past those of other kinds. */
+    j = i + 1;
+
+    while( j < map->count && map->extent[j].start <= e->end )
+    {
+        if( map->extent[j].kind != kind )
+        {
+            j++;
+            continue;
+        }
+
+        if( e->end < map->extent[j].end )
+        {
+            e->end = map->extent[j].end;
+        }
+
+        memmove( &map->extent[j], &map->extent[j + 1], ( map->count - j - 1 ) * sizeof( nwipe_badmap_extent_t ) );
+        map->count--;
+    }
+
+} /* nwipe_badmap_add */
+
+void nwipe_badmap_merge( nwipe_context_t* c, nwipe_context_t* copy )
+{
+    nwipe_badmap_t* map = copy->badmap;
+    int i;
+
+    if( map == NULL )
+    {
+        return;
+    }
+
+    for( i = 0; i < map->count; i++ )
+    {
+        nwipe_badmap_add( c, map->extent[i].start, map->extent[i].end - map->extent[i].start, map->extent[i].kind );
+    }
+
+    if( map->overflow && c->badmap != NULL )
+    {
+        c->badmap->overflow = 1;
+    }
+
+    nwipe_badmap_free( copy );
+
+} /* nwipe_badmap_merge */
+
+void nwipe_badmap_free( nwipe_context_t* c )
+{
+    if( c->badmap != NULL )
+    {
+        free( c->badmap->extent );
+        free( c->badmap );
+        c->badmap = NULL;
+    }
+
+} /* nwipe_badmap_free */
+
+static u64 nwipe_badmap_sector_size( nwipe_context_t* c )
+{
+    /* Files and some virtual devices don't report a logical sector size. */
+    return c->device_sector_size > 0 ? (u64) c->device_sector_size : 512;
+}
+
+u64 nwipe_badmap_sectors( nwipe_context_t* c, nwipe_badmap_kind_t kind )
+{
+    u64 ss = nwipe_badmap_sector_size( c );
+    u64 sectors = 0;
+    int i;
+
+    if( c->badmap == NULL )
+    {
+        return 0;
+    }
+
+    for( i = 0; i < c->badmap->count; i++ )
+    {
+        if( c->badmap->extent[i].kind == kind )
+        {
+            sectors += ( c->badmap->extent[i].end + ss - 1 ) / ss - c->badmap->extent[i].start / ss;
+        }
+    }
+
+    return sectors;
+
+} /* nwipe_badmap_sectors */
+
+int nwipe_badmap_save( nwipe_context_t* c )
+{
+    nwipe_badmap_t* map = c->badmap;
+    nwipe_badmap_extent_t* e;
+    FILE* fp;
+
+    u64 ss = nwipe_badmap_sector_size( c );
+
+    /* The directory of the file, and a copy of the log file name for dirname(). */
+    char directory[FILENAME_MAX];
+    char logfile[FILENAME_MAX];
+
+    /* The parts of the file name. */
+    char end_time_text[50];
+    char model[NWIPE_DEVICE_LABEL_LENGTH];
+    char serial[sizeof( c->device_serial_no )];
+
+    time_t t;
+    struct tm* p;
+    int i;
+
+    if( map == NULL || map->count == 0 )
+    {
+        return 0;
+    }
+
+    if( nwipe_options.logfile[0] != 0 )
+    {
+        snprintf( logfile, sizeof( logfile ), "%s", nwipe_options.logfile );
+        snprintf( directory, sizeof( directory ), "%s", dirname( logfile ) );
+    }
+    else if( nwipe_options.PDF_enable )
+    {
+        snprintf( directory, sizeof( directory ), "%s", nwipe_options.PDFreportpath );
+    }
+    else
+    {
+        snprintf( directory, sizeof( directory ), "." );
+    }
+
+    /* The name matches the PDF report of the wipe. */
+    t = c->end_time != 0 ? c->end_time : time( NULL );
+    p = localtime( &t );
+    snprintf( end_time_text,
+              sizeof( end_time_text ),
+              "%i-%02i-%02i-%02i-%02i-%02i",
+              1900 + p->tm_year,
+              1 + p->tm_mon,
+              p->tm_mday,
+              p->tm_hour,
+              p->tm_min,
+              p->tm_sec );
+    snprintf( model, sizeof( model ), "%s", c->device_model != NULL ? c->device_model : "" );
+    snprintf( serial, sizeof( serial ), "%s", c->device_serial_no );
+    replace_non_alphanumeric( model, '_' );
+    replace_non_alphanumeric( serial, '_' );
+
+    if( snprintf( c->badmap_filename,
+                  sizeof( c->badmap_filename ),
+                  "%s/nwipe_badmap_%s_Model_%s_Serial_%s.txt",
+                  directory,
+                  end_time_text,
+                  model,
+                  serial )
+        >= (int) sizeof( c->badmap_filename ) )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "The path of the bad region map of '%s' is too long.", c->device_name );
+        c->badmap_filename[0] = 0;
+        return -1;
+    }
+
+    fp = fopen( c->badmap_filename, "w" );
+
+    if( fp == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fopen" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to save the bad region map of '%s'.", c->device_name );
+        c->badmap_filename[0] = 0;
+        return -1;
+    }
+
+    fprintf( fp, "# nwipe bad region map\n" );
+    fprintf( fp, "# Device: %s\n", c->device_name );
+    fprintf( fp, "# Model: %s\n", c->device_model != NULL ? c->device_model : "" );
+    fprintf( fp, "# Serial: %s\n", c->device_serial_no );
+    fprintf( fp, "# Size: %llu bytes, logical sector size %llu bytes\n", c->device_size, ss );
+    fprintf( fp,
+             "# Method: %s, PRNG: %s\n",
+             nwipe_method_label( nwipe_options.method ),
+             nwipe_options.prng->label );
+
+    if( map->overflow )
+    {
+        fprintf( fp, "# Incomplete, only the first %i regions were recorded\n", map->count );
+    }
+
+    fprintf( fp, "# First sector, number of sectors, write|read|verify\n" );
+
+    for( i = 0; i < map->count; i++ )
+    {
+        e = &map->extent[i];
+        fprintf( fp,
+                 "%llu %llu %s\n",
+                 e->start / ss,
+                 ( e->end + ss - 1 ) / ss - e->start / ss,
+                 nwipe_badmap_kind_name[e->kind] );
+    }
+
+    if( fclose( fp ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fclose" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to save the bad region map of '%s'.", c->device_name );
+        c->badmap_filename[0] = 0;
+        return -1;
+    }
+
+    return 0;
+
+} /* nwipe_badmap_save */
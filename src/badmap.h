@@ -0,0 +1,79 @@
+/*
+ *  badmap.h: The map of the regions of a device that failed to be wiped or verified.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BADMAP_H_
+#define BADMAP_H_
+
+typedef enum nwipe_badmap_kind_t_ {
+    NWIPE_BADMAP_WRITE = 0,  // The region could not be written.
+    NWIPE_BADMAP_READ,  // The region could not be read back.
+    NWIPE_BADMAP_VERIFY,  // The region was read back but differs from what was written.
+    NWIPE_BADMAP_KINDS  // The number of kinds.
+} nwipe_badmap_kind_t;
+
+/* A range of bytes of the device. */
+typedef struct nwipe_badmap_extent_t_
+{
+    u64 start;  // The offset of the first byte.
+    u64 end;  // The offset after the last byte.
+    nwipe_badmap_kind_t kind;  // How the region failed.
+} nwipe_badmap_extent_t;
+
+/* The extents of a device in the order of their start, overlapping or adjacent extents of the same kind are merged. */
+typedef struct nwipe_badmap_t_
+{
+    nwipe_badmap_extent_t* extent;  // The extents.
+    int count;  // The number of extents.
+    int size;  // The number of extents allocated.
+    int overflow;  // Set when extents were dropped because the map reached NWIPE_KNOB_BADMAP_EXTENTS.
+} nwipe_badmap_t;
+
+/**
+ * Records a region of the device that failed. The map of the device is created by the first region.
+ */
+void nwipe_badmap_add( nwipe_context_t* c, u64 offset, u64 length, nwipe_badmap_kind_t kind );
+
+/**
+ * Adds the regions recorded in a copy of the device context, e.g. by a thread that passed over part
+ * of the device, to the map of the device and frees the map of the copy.
+ */
+void nwipe_badmap_merge( nwipe_context_t* c, nwipe_context_t* copy );
+
+/**
+ * Frees the map of a device.
+ */
+void nwipe_badmap_free( nwipe_context_t* c );
+
+/**
+ * Adds up the logical sectors of the regions of one kind, a region that covers part of a sector
+ * counts the whole sector.
+ *
+ * @returns  The number of sectors.
+ */
+u64 nwipe_badmap_sectors( nwipe_context_t* c, nwipe_badmap_kind_t kind );
+
+/**
+ * Saves the map of a device as text, one extent of logical sectors per line, to a file in the
+ * directory of the log file, or of the PDF reports when logging to the console. The name of the
+ * file is kept in badmap_filename.
+ *
+ * @returns  0 on success or when the device has no map, -1 if the file could not be written.
+ */
+int nwipe_badmap_save( nwipe_context_t* c );
+
+#endif /* BADMAP_H_ */
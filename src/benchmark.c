@@ -0,0 +1,507 @@
+/*
+ *  benchmark.c: Measures the PRNGs and the passes without wiping a disk.
+ *
+ *  Every PRNG is timed generating into memory on one core, followed by the
+ *  copy and compare of a static pattern. Files and devices named on the
+ *  command line are then measured with the real pass routines, so the results
+ *  reflect --io-size, --io-engine, --io-depth, --direct and --prng-ahead.
+ *  Regular files and loop devices are written to, any other device is only
+ *  read from.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/sysmacros.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "pass.h"
+#include "logging.h"
+#include "device.h"
+#include "benchmark.h"
+#include "compare.h"
+#include "badmap.h"
+
+/* The major number of loop devices. */
+#define NWIPE_BENCHMARK_LOOP_MAJOR 7
+
+extern nwipe_prng_t nwipe_twister;
+extern nwipe_prng_t nwipe_isaac;
+extern nwipe_prng_t nwipe_isaac64;
+extern nwipe_prng_t nwipe_add_lagg_fibonacci_prng;
+extern nwipe_prng_t nwipe_xoroshiro256_prng;
+extern nwipe_prng_t nwipe_aes_ctr_prng;
+extern nwipe_prng_t nwipe_philox_prng;
+
+/* The PRNGs that are measured. */
+static nwipe_prng_t* nwipe_benchmark_prngs[] = { &nwipe_twister,
+                                                 &nwipe_isaac,
+                                                 &nwipe_isaac64,
+                                                 &nwipe_add_lagg_fibonacci_prng,
+                                                 &nwipe_xoroshiro256_prng,
+                                                 &nwipe_aes_ctr_prng,
+                                                 &nwipe_philox_prng,
+                                                 NULL };
+
+static double nwipe_benchmark_elapsed( const struct timespec* start )
+{
+    /**
+     * @returns  The number of seconds since start.
+     */
+
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return (double) ( now.tv_sec - start->tv_sec ) + (double) ( now.tv_nsec - start->tv_nsec ) / 1e9;
+
+} /* nwipe_benchmark_elapsed */
+
+static double nwipe_benchmark_gbps( u64 bytes, double seconds )
+{
+    return seconds > 0 ? (double) bytes / seconds / 1e9 : 0;
+
+} /* nwipe_benchmark_gbps */
+
+static int nwipe_benchmark_prng( nwipe_prng_t* prng, nwipe_entropy_t* seed, char* buffer )
+{
+    /**
+     * Times a PRNG filling a buffer of NWIPE_KNOB_IO_SIZE bytes over and over, on the
+     * calling thread only.
+     *
+     * @returns  0 on success, -1 if the PRNG could not be initialised.
+     */
+
+    void* state = NULL;
+    struct timespec start;
+    double seconds;
+    u64 bytes = 0;
+
+    if( prng->init( &state, seed ) != 0 || state == NULL )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "Benchmark: Unable to initialise the %s PRNG.", prng->label );
+        free( state );
+        return -1;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    do
+    {
+        prng->read( &state, buffer, NWIPE_KNOB_IO_SIZE );
+        bytes += NWIPE_KNOB_IO_SIZE;
+        seconds = nwipe_benchmark_elapsed( &start );
+    } while( seconds < NWIPE_KNOB_BENCHMARK_SECONDS );
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Benchmark: %-36s %7.2f GB/s per core",
+               prng->label,
+               nwipe_benchmark_gbps( bytes, seconds ) );
+
+    free( state );
+
+    return 0;
+
+} /* nwipe_benchmark_prng */
+
+static void nwipe_benchmark_pattern( char* buffer )
+{
+    /**
+     * Times the copy of a static pattern window into an I/O buffer, which static passes
+     * do with --direct when the window is not aligned, and the compares of a verification
+     * with a pattern buffer and with the byte of a uniform pattern.
+     */
+
+    /* The pattern buffer, a three byte pattern repeated as in the static passes. */
+    char* pattern;
+
+    struct timespec start;
+    double seconds;
+    u64 bytes;
+    u64 offset;
+    size_t i;
+
+    /* The compare result and window, volatile so that the compares are not optimised away. */
+    volatile size_t differ = 0;
+    volatile size_t window = 0;
+
+    pattern = malloc( NWIPE_KNOB_IO_SIZE + 6 );
+
+    if( !pattern )
+    {
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        return;
+    }
+
+    for( i = 0; i < NWIPE_KNOB_IO_SIZE + 6; i++ )
+    {
+        pattern[i] = "\x92\x49\x24"[i % 3];
+    }
+
+    bytes = 0;
+    offset = 0;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    do
+    {
+        memcpy( buffer, &pattern[offset % 3], NWIPE_KNOB_IO_SIZE );
+        bytes += NWIPE_KNOB_IO_SIZE;
+        offset += NWIPE_KNOB_IO_SIZE;
+        seconds = nwipe_benchmark_elapsed( &start );
+    } while( seconds < NWIPE_KNOB_BENCHMARK_SECONDS );
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Benchmark: %-36s %7.2f GB/s per core",
+               "Static pattern copy",
+               nwipe_benchmark_gbps( bytes, seconds ) );
+
+    /* The compare runs over the whole block because the data matches, as in a passed verification. */
+    memcpy( buffer, pattern, NWIPE_KNOB_IO_SIZE );
+
+    bytes = 0;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    do
+    {
+        differ += nwipe_compare_find( buffer, &pattern[window], NWIPE_KNOB_IO_SIZE );
+        bytes += NWIPE_KNOB_IO_SIZE;
+        seconds = nwipe_benchmark_elapsed( &start );
+    } while( seconds < NWIPE_KNOB_BENCHMARK_SECONDS );
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Benchmark: %-36s %7.2f GB/s per core",
+               "Static pattern compare",
+               nwipe_benchmark_gbps( bytes, seconds ) );
+
+    memset( buffer, 0, NWIPE_KNOB_IO_SIZE );
+
+    bytes = 0;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    do
+    {
+        differ += nwipe_compare_find_byte( buffer, (unsigned char) window, NWIPE_KNOB_IO_SIZE );
+        bytes += NWIPE_KNOB_IO_SIZE;
+        seconds = nwipe_benchmark_elapsed( &start );
+    } while( seconds < NWIPE_KNOB_BENCHMARK_SECONDS );
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Benchmark: %-36s %7.2f GB/s per core",
+               "One byte pattern compare",
+               nwipe_benchmark_gbps( bytes, seconds ) );
+
+    free( pattern );
+
+} /* nwipe_benchmark_pattern */
+
+static int nwipe_benchmark_open( nwipe_context_t* c, const char* name, int* writable )
+{
+    /**
+     * Opens a file or device to measure and fills in the parts of its context that the
+     * pass routines use. A file that does not exist is created with a size of
+     * NWIPE_KNOB_BENCHMARK_SIZE.
+     *
+     * @returns  0 on success, -1 on failure.
+     */
+
+    struct stat st;
+    int flags;
+    int sector_size = 0;
+    int phys_sector_size = 0;
+    off64_t size;
+
+    if( stat( name, &st ) != 0 )
+    {
+        if( errno != ENOENT )
+        {
+            nwipe_perror( errno, __FUNCTION__, "stat" );
+            return -1;
+        }
+
+        st.st_mode = S_IFREG;
+        st.st_size = 0;
+    }
+
+    /* Never write to anything but a file or a loop device. */
+    *writable = S_ISREG( st.st_mode ) || ( S_ISBLK( st.st_mode ) && major( st.st_rdev ) == NWIPE_BENCHMARK_LOOP_MAJOR );
+
+    flags = *writable ? O_RDWR | O_CREAT : O_RDONLY;
+
+    c->device_direct = 0;
+
+    if( nwipe_options.direct )
+    {
+        c->device_fd = open( name, flags | O_DIRECT, 0600 );
+
+        if( c->device_fd >= 0 )
+        {
+            c->device_direct = 1;
+        }
+        else if( errno == EINVAL )
+        {
+            nwipe_log( NWIPE_LOG_WARNING, "'%s' does not support O_DIRECT, using the page cache.", name );
+            c->device_fd = open( name, flags, 0600 );
+        }
+    }
+    else
+    {
+        c->device_fd = open( name, flags, 0600 );
+    }
+
+    if( c->device_fd < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "open" );
+        nwipe_log( NWIPE_LOG_ERROR, "Benchmark: Unable to open '%s'.", name );
+        return -1;
+    }
+
+    if( S_ISREG( st.st_mode ) && st.st_size < NWIPE_KNOB_BENCHMARK_SIZE )
+    {
+        /* Give the file enough room for a meaningful measurement. */
+        if( ftruncate( c->device_fd, NWIPE_KNOB_BENCHMARK_SIZE ) != 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "ftruncate" );
+            nwipe_log( NWIPE_LOG_ERROR, "Benchmark: Unable to size '%s'.", name );
+            return -1;
+        }
+    }
+
+    if( fstat( c->device_fd, &c->device_stat ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fstat" );
+        return -1;
+    }
+
+    if( S_ISBLK( c->device_stat.st_mode ) )
+    {
+        ioctl( c->device_fd, BLKSSZGET, &sector_size );
+        ioctl( c->device_fd, BLKPBSZGET, &phys_sector_size );
+    }
+
+    size = lseek64( c->device_fd, 0, SEEK_END );
+
+    if( size <= 0 || lseek64( c->device_fd, 0, SEEK_SET ) != 0 )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "Benchmark: Unable to determine the size of '%s'.", name );
+        return -1;
+    }
+
+    /* Only the start of a large device is measured. */
+    c->device_size = (u64) size < NWIPE_KNOB_BENCHMARK_SIZE ? (u64) size : NWIPE_KNOB_BENCHMARK_SIZE;
+
+    c->device_name = (char*) name;
+    strncpy( c->device_name_without_path, basename( (char*) name ), sizeof( c->device_name_without_path ) - 1 );
+    c->device_sector_size = sector_size;
+    c->device_phys_sector_size = phys_sector_size;
+    c->device_io_align = nwipe_device_io_align( c );
+    c->device_io_size = nwipe_device_io_size( c );
+
+    return 0;
+
+} /* nwipe_benchmark_open */
+
+static int nwipe_benchmark_pass( nwipe_context_t* c, const char* label, int verify, nwipe_pattern_t* pattern )
+{
+    /**
+     * Times one pass or verification over the measured part of a file or device.
+     *
+     * @returns  The result of the pass.
+     */
+
+    struct timespec start;
+    double seconds;
+    int r;
+
+    c->pass_errors = 0;
+    c->verify_errors = 0;
+    c->verify_mismatch_bytes = 0;
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    if( pattern != NULL )
+    {
+        r = verify ? nwipe_static_verify( c, pattern ) : nwipe_static_pass( c, pattern );
+    }
+    else
+    {
+        r = verify ? nwipe_random_verify( c ) : nwipe_random_pass( c );
+    }
+
+    seconds = nwipe_benchmark_elapsed( &start );
+
+    if( r != 0 )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "Benchmark: %s of '%s' failed.", label, c->device_name );
+        return r;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Benchmark: %-36s %7.2f GB/s, %llu bytes of '%s'",
+               label,
+               nwipe_benchmark_gbps( c->device_size, seconds ),
+               c->device_size,
+               c->device_name );
+
+    return 0;
+
+} /* nwipe_benchmark_pass */
+
+static int nwipe_benchmark_device( const char* name, nwipe_entropy_t* seed )
+{
+    /**
+     * Measures the passes on a file or loop device, or a read of any other device.
+     *
+     * @returns  0 on success, -1 on failure.
+     */
+
+    nwipe_context_t* c;
+    nwipe_pattern_t zeros = { 1, "\x00" };
+    int writable = 0;
+    int r;
+
+    c = calloc( 1, sizeof( nwipe_context_t ) );
+
+    if( !c )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        return -1;
+    }
+
+    c->device_fd = -1;
+    c->prng = nwipe_options.prng;
+    c->prng_seed = *seed;
+
+    r = nwipe_benchmark_open( c, name, &writable );
+
+    if( r == 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "Benchmark: '%s', I/O size %zu, %s%s",
+                   name,
+                   c->device_io_size,
+                   writable ? "write and read" : "read only",
+                   c->device_direct ? ", direct I/O" : "" );
+
+        if( writable )
+        {
+            r = nwipe_benchmark_pass( c, "Zero fill pass", 0, &zeros );
+
+            if( r == 0 )
+            {
+                r = nwipe_benchmark_pass( c, "Zero fill verification", 1, &zeros );
+            }
+
+            if( r == 0 )
+            {
+                r = nwipe_benchmark_pass( c, "PRNG stream pass", 0, NULL );
+            }
+
+            if( r == 0 )
+            {
+                r = nwipe_benchmark_pass( c, "PRNG stream verification", 1, NULL );
+            }
+        }
+        else
+        {
+            /* A verification reads the device without changing it, the errors are meaningless. */
+            c->verify_quiet = 1;
+            r = nwipe_benchmark_pass( c, "Read", 1, &zeros );
+        }
+    }
+
+    if( c->device_fd >= 0 )
+    {
+        close( c->device_fd );
+    }
+
+    nwipe_badmap_free( c );
+    free( c->prng_state );
+    free( c );
+
+    return r;
+
+} /* nwipe_benchmark_device */
+
+int nwipe_benchmark( int count, char** names )
+{
+    nwipe_entropy_t seed;
+    char* buffer;
+    int entropy_fd;
+    int r = 0;
+    int i;
+
+    /* Seed the PRNGs as a wipe would. */
+    seed.length = NWIPE_KNOB_PRNG_STATE_LENGTH;
+    seed.s = malloc( seed.length );
+    buffer = malloc( NWIPE_KNOB_IO_SIZE );
+
+    if( !seed.s || !buffer )
+    {
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        free( seed.s );
+        free( buffer );
+        return -1;
+    }
+
+    entropy_fd = open( NWIPE_KNOB_ENTROPY, O_RDONLY );
+
+    if( entropy_fd < 0 || read( entropy_fd, seed.s, seed.length ) != (ssize_t) seed.length )
+    {
+        nwipe_perror( errno, __FUNCTION__, "read" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to read from entropy source %s.", NWIPE_KNOB_ENTROPY );
+
+        if( entropy_fd >= 0 )
+        {
+            close( entropy_fd );
+        }
+        free( seed.s );
+        free( buffer );
+        return -1;
+    }
+
+    close( entropy_fd );
+
+    for( i = 0; nwipe_benchmark_prngs[i] != NULL; i++ )
+    {
+        if( nwipe_benchmark_prng( nwipe_benchmark_prngs[i], &seed, buffer ) != 0 )
+        {
+            r = -1;
+        }
+    }
+
+    nwipe_benchmark_pattern( buffer );
+
+    free( buffer );
+
+    for( i = 0; i < count; i++ )
+    {
+        if( nwipe_benchmark_device( names[i], &seed ) != 0 )
+        {
+            r = -1;
+        }
+    }
+
+    free( seed.s );
+
+    return r;
+
+} /* nwipe_benchmark */
@@ -0,0 +1,32 @@
+/*
+ *  benchmark.h: Measures the PRNGs and the passes without wiping a disk.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+/**
+ * Times every PRNG and the static pattern copy and compare in memory, then the
+ * passes on each of the given files or devices.
+ *
+ * @parameter count  The number of file or device names.
+ * @parameter names  The file or device names, may be empty.
+ * @returns          0 on success, -1 if any measurement failed.
+ */
+int nwipe_benchmark( int count, char** names );
+
+#endif /* BENCHMARK_H_ */
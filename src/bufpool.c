@@ -0,0 +1,340 @@
+/*
+ *  bufpool.c: The pool of the I/O buffers of the passes, within a memory budget.
+ *
+ *  Every pass of every device needs a buffer for each block in flight, plus the
+ *  blocks generated ahead by its PRNG thread. With large I/O sizes and deep
+ *  queues on a hundred drives that adds up to more memory than a live system
+ *  has. The buffers are mapped here rather than allocated with malloc(), kept
+ *  for the following passes instead of being freed, and reserved up front so
+ *  that all the passes together stay within --io-memory. A pass whose fair
+ *  share of the budget doesn't cover its queue depth runs with a shallower
+ *  queue, and waits for memory only when even a single block doesn't fit.
+ *
+ *  With --io-hugepages the buffers are backed by huge pages, from the pool
+ *  reserved in vm.nr_hugepages when there is one and transparent huge pages
+ *  otherwise, which saves TLB misses on large I/O sizes.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/mman.h>
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "options.h"
+#include "logging.h"
+#include "bufpool.h"
+
+/* A buffer kept in the pool, the header is written over the start of the buffer itself. */
+typedef struct nwipe_bufpool_entry_t_
+{
+    struct nwipe_bufpool_entry_t_* next;  // The next buffer in the pool.
+    size_t length;  // The length of the mapping.
+} nwipe_bufpool_entry_t;
+
+static pthread_mutex_t nwipe_bufpool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nwipe_bufpool_released = PTHREAD_COND_INITIALIZER;
+
+static int nwipe_bufpool_passes = 1;  // The number of passes that share the budget.
+static size_t nwipe_bufpool_page = 0;  // The size of the pages the buffers are mapped in.
+static size_t nwipe_bufpool_reserved = 0;  // The bytes reserved by the passes.
+static size_t nwipe_bufpool_kept = 0;  // The bytes of the buffers kept in the pool.
+static nwipe_bufpool_entry_t* nwipe_bufpool_list = NULL;  // The buffers kept in the pool.
+static int nwipe_bufpool_hugetlb = 1;  // Cleared once a mapping from the huge page pool fails.
+
+static size_t nwipe_bufpool_hugepage( void )
+{
+    /**
+     * Reads the default huge page size from /proc/meminfo.
+     *
+     * @returns  The size in bytes, 2M if it is not known.
+     */
+
+    char line[128];
+    size_t size = 2 * 1024 * 1024;
+    unsigned long kb;
+    FILE* fp;
+
+    fp = fopen( "/proc/meminfo", "r" );
+
+    if( fp == NULL )
+    {
+        return size;
+    }
+
+    while( fgets( line, sizeof( line ), fp ) != NULL )
+    {
+        if( sscanf( line, "Hugepagesize: %lu kB", &kb ) == 1 )
+        {
+            size = kb * 1024;
+            break;
+        }
+    }
+
+    fclose( fp );
+
+    return size;
+
+} /* nwipe_bufpool_hugepage */
+
+static size_t nwipe_bufpool_length( size_t size )
+{
+    /* The mapping of a buffer, whole pages. */
+    if( nwipe_bufpool_page == 0 )
+    {
+        nwipe_bufpool_page = nwipe_options.io_hugepages ? nwipe_bufpool_hugepage() : (size_t) sysconf( _SC_PAGESIZE );
+    }
+
+    return ( size + nwipe_bufpool_page - 1 ) / nwipe_bufpool_page * nwipe_bufpool_page;
+
+} /* nwipe_bufpool_length */
+
+void nwipe_bufpool_init( int passes )
+{
+    nwipe_bufpool_passes = passes > 0 ? passes : 1;
+    nwipe_bufpool_length( 0 );
+
+    if( nwipe_options.io_memory > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "The I/O buffers are limited to %zu MiB, %zu MiB for each of %i passes.",
+                   nwipe_options.io_memory >> 20,
+                   ( nwipe_options.io_memory / nwipe_bufpool_passes ) >> 20,
+                   nwipe_bufpool_passes );
+    }
+
+} /* nwipe_bufpool_init */
+
+static void nwipe_bufpool_unlock( void* ptr )
+{
+    pthread_mutex_unlock( (pthread_mutex_t*) ptr );
+}
+
+static void nwipe_bufpool_trim( size_t keep )
+{
+    /**
+     * Unmaps the buffers kept in the pool until the reservations and the pool fit within the
+     * budget, the buffers of other lengths first. Without --io-memory, the pool keeps no more
+     * than the passes have reserved, so that a station doesn't keep the buffers of every drive
+     * it has seen. The caller holds the mutex.
+     */
+
+    nwipe_bufpool_entry_t** link;
+    nwipe_bufpool_entry_t* entry;
+    size_t budget = nwipe_options.io_memory > 0 ? nwipe_options.io_memory : 2 * nwipe_bufpool_reserved;
+    int pass;
+
+    for( pass = 0; pass < 2; pass++ )
+    {
+        link = &nwipe_bufpool_list;
+
+        while( *link != NULL && nwipe_bufpool_reserved + nwipe_bufpool_kept > budget )
+        {
+            entry = *link;
+
+            if( pass == 0 && entry->length == keep )
+            {
+                link = &entry->next;
+                continue;
+            }
+
+            *link = entry->next;
+            nwipe_bufpool_kept -= entry->length;
+            munmap( entry, entry->length );
+        }
+    }
+
+} /* nwipe_bufpool_trim */
+
+int nwipe_bufpool_reserve( size_t size, int wanted, int needed )
+{
+    size_t length = nwipe_bufpool_length( size );
+
+    /* The number of buffers in the fair share of the pass, and that fit now. */
+    size_t share;
+    size_t fit;
+
+    if( nwipe_options.io_memory == 0 )
+    {
+        pthread_mutex_lock( &nwipe_bufpool_mutex );
+        nwipe_bufpool_reserved += wanted * length;
+        pthread_mutex_unlock( &nwipe_bufpool_mutex );
+        return wanted;
+    }
+
+    if( needed * length > nwipe_options.io_memory )
+    {
+        nwipe_log( NWIPE_LOG_ERROR,
+                   "The %i buffers of %zu bytes a pass needs don't fit in --io-memory.",
+                   needed,
+                   length );
+        return -1;
+    }
+
+    share = nwipe_options.io_memory / nwipe_bufpool_passes / length;
+
+    pthread_mutex_lock( &nwipe_bufpool_mutex );
+    pthread_cleanup_push( nwipe_bufpool_unlock, &nwipe_bufpool_mutex );
+
+    /* The buffers kept in the pool can be unmapped, the reservations of other passes can't. */
+    while( nwipe_bufpool_reserved + needed * length > nwipe_options.io_memory )
+    {
+        pthread_cond_wait( &nwipe_bufpool_released, &nwipe_bufpool_mutex );
+    }
+
+    fit = ( nwipe_options.io_memory - nwipe_bufpool_reserved ) / length;
+
+    if( share > fit )
+    {
+        share = fit;
+    }
+
+    if( share > (size_t) wanted )
+    {
+        share = wanted;
+    }
+
+    if( share < (size_t) needed )
+    {
+        share = needed;
+    }
+
+    nwipe_bufpool_reserved += share * length;
+    nwipe_bufpool_trim( length );
+
+    pthread_cleanup_pop( 1 );
+
+    return (int) share;
+
+} /* nwipe_bufpool_reserve */
+
+void nwipe_bufpool_release( size_t size, int count )
+{
+    size_t length = nwipe_bufpool_length( size );
+
+    pthread_mutex_lock( &nwipe_bufpool_mutex );
+    nwipe_bufpool_reserved -= count * length;
+    pthread_cond_broadcast( &nwipe_bufpool_released );
+    pthread_mutex_unlock( &nwipe_bufpool_mutex );
+
+} /* nwipe_bufpool_release */
+
+char* nwipe_bufpool_get( size_t size )
+{
+    size_t length = nwipe_bufpool_length( size );
+    nwipe_bufpool_entry_t** link;
+    nwipe_bufpool_entry_t* entry = NULL;
+    void* b;
+
+    pthread_mutex_lock( &nwipe_bufpool_mutex );
+
+    for( link = &nwipe_bufpool_list; *link != NULL; link = &( *link )->next )
+    {
+        if( ( *link )->length == length )
+        {
+            entry = *link;
+            *link = entry->next;
+            nwipe_bufpool_kept -= length;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &nwipe_bufpool_mutex );
+
+    if( entry != NULL )
+    {
+        /* Zeroed because we don't want memory leaks to disk in the event
+         * of some future undetected bug in a prng or its implementation. */
+        memset( entry, 0, length );
+        return (char*) entry;
+    }
+
+    /* New mappings are zeroed by the kernel. */
+    b = MAP_FAILED;
+
+    if( nwipe_options.io_hugepages && nwipe_bufpool_hugetlb )
+    {
+        b = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+
+        if( b == MAP_FAILED )
+        {
+            /* Usually because no huge pages are reserved, don't try again. */
+            nwipe_bufpool_hugetlb = 0;
+            nwipe_log( NWIPE_LOG_NOTICE, "No huge pages are reserved, using transparent huge pages." );
+        }
+    }
+
+    if( b == MAP_FAILED )
+    {
+        b = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+        if( b == MAP_FAILED )
+        {
+            nwipe_perror( errno, __FUNCTION__, "mmap" );
+            return NULL;
+        }
+
+        if( nwipe_options.io_hugepages )
+        {
+            madvise( b, length, MADV_HUGEPAGE );
+        }
+    }
+
+    return (char*) b;
+
+} /* nwipe_bufpool_get */
+
+void nwipe_bufpool_put( char* buffer, size_t size )
+{
+    nwipe_bufpool_entry_t* entry = (nwipe_bufpool_entry_t*) buffer;
+
+    if( buffer == NULL )
+    {
+        return;
+    }
+
+    entry->length = nwipe_bufpool_length( size );
+
+    pthread_mutex_lock( &nwipe_bufpool_mutex );
+    entry->next = nwipe_bufpool_list;
+    nwipe_bufpool_list = entry;
+    nwipe_bufpool_kept += entry->length;
+    nwipe_bufpool_trim( entry->length );
+    pthread_mutex_unlock( &nwipe_bufpool_mutex );
+
+} /* nwipe_bufpool_put */
+
+void nwipe_bufpool_free( void )
+{
+    nwipe_bufpool_entry_t* entry;
+
+    pthread_mutex_lock( &nwipe_bufpool_mutex );
+
+    while( nwipe_bufpool_list != NULL )
+    {
+        entry = nwipe_bufpool_list;
+        nwipe_bufpool_list = entry->next;
+        munmap( entry, entry->length );
+    }
+
+    nwipe_bufpool_kept = 0;
+
+    pthread_mutex_unlock( &nwipe_bufpool_mutex );
+
+} /* nwipe_bufpool_free */
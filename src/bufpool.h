@@ -0,0 +1,63 @@
+/*
+ *  bufpool.h: The pool of the I/O buffers of the passes, within a memory budget.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BUFPOOL_H_
+#define BUFPOOL_H_
+
+#include <stddef.h>
+
+/**
+ * Sets up the pool for the number of passes that may run at once, which share --io-memory
+ * fairly. It is called before the wipes start, the pool works without it as if one pass ran.
+ */
+void nwipe_bufpool_init( int passes );
+
+/**
+ * Reserves memory for the buffers of a pass, each of the given size. A pass gets the buffers it
+ * wants if they fit within its fair share of --io-memory, and at least the buffers it needs,
+ * waiting for other passes to release memory if necessary.
+ *
+ * @returns  The number of buffers reserved, between needed and wanted, or -1 if the needed
+ *           buffers are larger than --io-memory.
+ */
+int nwipe_bufpool_reserve( size_t size, int wanted, int needed );
+
+/**
+ * Releases the reservation of a number of buffers of the given size, once they have been put back.
+ */
+void nwipe_bufpool_release( size_t size, int count );
+
+/**
+ * Takes a zeroed buffer of the given size out of the pool, from a reservation. The buffer is
+ * page aligned, and backed by huge pages with --io-hugepages.
+ *
+ * @returns  The buffer, or NULL on failure.
+ */
+char* nwipe_bufpool_get( size_t size );
+
+/**
+ * Puts a buffer from nwipe_bufpool_get() back into the pool, NULL is ignored.
+ */
+void nwipe_bufpool_put( char* buffer, size_t size );
+
+/**
+ * Unmaps the buffers that are kept in the pool, once the wipe threads have stopped.
+ */
+void nwipe_bufpool_free( void );
+
+#endif /* BUFPOOL_H_ */
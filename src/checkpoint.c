@@ -0,0 +1,860 @@
+/*
+ *  checkpoint.c: Checkpoints of the progress of a wipe, so that it can be resumed.
+ *
+ *  Every wipe periodically records the round, pass and offset it has reached,
+ *  with the PRNG seed and the patterns of the method, in a small text file in
+ *  the state directory. After a power failure or an accidental interruption
+ *  --resume reads the file back and the wipe continues from the offset of the
+ *  pass it was in, instead of from the beginning of the method.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <ctype.h>
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "miscellaneous.h"
+#include "badmap.h"
+#include "checkpoint.h"
+
+/* The names of the steps in the checkpoint file and in the log. */
+static const char* nwipe_checkpoint_stage_name[NWIPE_CHECKPOINT_STAGES] = { "write",
+                                                                             "verify",
+                                                                             "final_write",
+                                                                             "final_verify" };
+static const char* nwipe_checkpoint_stage_label[NWIPE_CHECKPOINT_STAGES] = { "writing",
+                                                                              "verification",
+                                                                              "final pass",
+                                                                              "final verification" };
+
+/* The names of the kinds of failed region in the checkpoint file. */
+static const char* nwipe_checkpoint_badmap_name[NWIPE_BADMAP_KINDS] = { "write", "read", "verify" };
+
+/* The longest line of a checkpoint file, which holds the PRNG seed in hex. */
+#define NWIPE_CHECKPOINT_LINE ( NWIPE_KNOB_PRNG_STATE_LENGTH * 2 + 64 )
+
+static int nwipe_checkpoint_identified( nwipe_context_t* c )
+{
+    /* Anonymized serial numbers are all the same, so they can't identify a device. */
+    return c->device_serial_no[0] != 0 && !nwipe_options.quiet;
+}
+
+static int nwipe_checkpoint_filename( nwipe_context_t* c, char* filename, size_t size )
+{
+    /**
+     * Names the checkpoint file of a device after its model and serial number, or after the
+     * device file when the serial number is not known.
+     *
+     * @returns  0 on success, -1 if the path is too long.
+     */
+
+    char model[NWIPE_DEVICE_LABEL_LENGTH];
+    char serial[sizeof( c->device_serial_no )];
+    char name[100];
+    int r;
+
+    if( nwipe_checkpoint_identified( c ) )
+    {
+        snprintf( model, sizeof( model ), "%s", c->device_model != NULL ? c->device_model : "" );
+        snprintf( serial, sizeof( serial ), "%s", c->device_serial_no );
+        replace_non_alphanumeric( model, '_' );
+        replace_non_alphanumeric( serial, '_' );
+
+        r = snprintf(
+            filename, size, "%s/nwipe_checkpoint_Model_%s_Serial_%s.txt", nwipe_options.state_dir, model, serial );
+    }
+    else
+    {
+        snprintf( name, sizeof( name ), "%s", c->device_name );
+        replace_non_alphanumeric( name, '_' );
+
+        r = snprintf( filename, size, "%s/nwipe_checkpoint_Device%s.txt", nwipe_options.state_dir, name );
+    }
+
+    if( r < 0 || (size_t) r >= size )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "The path of the checkpoint of '%s' is too long.", c->device_name );
+        filename[0] = 0;
+        return -1;
+    }
+
+    return 0;
+
+} /* nwipe_checkpoint_filename */
+
+static void nwipe_checkpoint_hex( FILE* fp, const void* data, int length )
+{
+    const unsigned char* p = data;
+    int i;
+
+    for( i = 0; i < length; i++ )
+    {
+        fprintf( fp, "%02x", p[i] );
+    }
+
+} /* nwipe_checkpoint_hex */
+
+static int nwipe_checkpoint_unhex( const char* text, char* data, int length )
+{
+    /**
+     * Converts length bytes of hex text back.
+     *
+     * @returns  0 on success, -1 if the text is not exactly length bytes of hex.
+     */
+
+    unsigned int byte;
+    int i;
+
+    for( i = 0; i < length; i++ )
+    {
+        if( !isxdigit( (unsigned char) text[2 * i] ) || !isxdigit( (unsigned char) text[2 * i + 1] )
+            || sscanf( &text[2 * i], "%2x", &byte ) != 1 )
+        {
+            return -1;
+        }
+
+        data[i] = (char) byte;
+    }
+
+    return text[2 * length] == 0 ? 0 : -1;
+
+} /* nwipe_checkpoint_unhex */
+
+static void nwipe_checkpoint_free( nwipe_checkpoint_t* st )
+{
+    free( st->loaded );
+    free( st->pattern_data );
+    free( st->seed );
+    free( st );
+
+} /* nwipe_checkpoint_free */
+
+static nwipe_checkpoint_t* nwipe_checkpoint_new( nwipe_context_t* c )
+{
+    nwipe_checkpoint_t* st = calloc( 1, sizeof( nwipe_checkpoint_t ) );
+
+    if( !st )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to write checkpoints of '%s'.", c->device_name );
+        return NULL;
+    }
+
+    if( nwipe_checkpoint_filename( c, st->filename, sizeof( st->filename ) ) != 0 )
+    {
+        free( st );
+        return NULL;
+    }
+
+    return st;
+
+} /* nwipe_checkpoint_new */
+
+static int nwipe_checkpoint_add_pattern( nwipe_checkpoint_t* st, const char* text )
+{
+    /**
+     * Adds a pattern of a checkpoint file, "random" for the PRNG stream or the bytes in hex.
+     *
+     * @returns  0 on success, -1 if the pattern is not valid or there is no memory.
+     */
+
+    nwipe_pattern_t* loaded;
+    char* data;
+
+    /* The offset of each pattern in pattern_data, the pointers are set when all are read. */
+    size_t used = 0;
+    int length;
+    int i;
+
+    length = strcmp( text, "random" ) == 0 ? -1 : (int) strlen( text ) / 2;
+
+    if( length == 0 || ( length > 0 && strlen( text ) % 2 != 0 ) )
+    {
+        return -1;
+    }
+
+    for( i = 0; i < st->pattern_count; i++ )
+    {
+        if( st->loaded[i].length > 0 )
+        {
+            used += st->loaded[i].length;
+        }
+    }
+
+    loaded = realloc( st->loaded, ( st->pattern_count + 2 ) * sizeof( nwipe_pattern_t ) );
+
+    if( !loaded )
+    {
+        return -1;
+    }
+
+    st->loaded = loaded;
+
+    data = realloc( st->pattern_data, used + ( length > 0 ? length : 0 ) + 1 );
+
+    if( !data )
+    {
+        return -1;
+    }
+
+    st->pattern_data = data;
+
+    if( length > 0 && nwipe_checkpoint_unhex( text, st->pattern_data + used, length ) != 0 )
+    {
+        return -1;
+    }
+
+    st->loaded[st->pattern_count].length = length;
+    st->pattern_count++;
+    st->loaded[st->pattern_count].length = 0;
+    st->loaded[st->pattern_count].s = NULL;
+
+    /* The data may have moved. */
+    used = 0;
+
+    for( i = 0; i < st->pattern_count; i++ )
+    {
+        st->loaded[i].s = st->loaded[i].length > 0 ? st->pattern_data + used : "";
+        used += st->loaded[i].length > 0 ? st->loaded[i].length : 0;
+    }
+
+    return 0;
+
+} /* nwipe_checkpoint_add_pattern */
+
+static void nwipe_checkpoint_restart( nwipe_context_t* c )
+{
+    /**
+     * Forgets the progress restored from a checkpoint, when the wipe starts from the beginning after all.
+     */
+
+    c->round_done = 0;
+    c->bytes_erased = 0;
+    c->pass_errors = 0;
+    c->verify_errors = 0;
+    c->verify_mismatch_bytes = 0;
+    c->fsyncdata_errors = 0;
+    nwipe_badmap_free( c );
+
+} /* nwipe_checkpoint_restart */
+
+int nwipe_checkpoint_load( nwipe_context_t* c )
+{
+    nwipe_checkpoint_t* st;
+    FILE* fp;
+
+    char line[NWIPE_CHECKPOINT_LINE];
+    char* value;
+    char* end;
+
+    /* What the checkpoint was written for. */
+    char serial[sizeof( c->device_serial_no )] = "";
+    char method[100] = "";
+    char prng[100] = "";
+    u64 size = 0;
+    u64 io_size = 0;
+    int rounds = -1;
+    int verify = -1;
+    int noblank = -1;
+    int verify_inline = 0;
+    int write_threads = 1;
+
+    /* The region of a failed region line. */
+    u64 start;
+    u64 length;
+    char kind[16];
+
+    /* A mismatch, or NULL. */
+    const char* differs = NULL;
+
+    /* Set when a line could not be read. */
+    int damaged = 0;
+
+    /* Set when the step of the checkpoint has been read. */
+    int stage = -1;
+
+    int i;
+
+    st = nwipe_checkpoint_new( c );
+
+    if( st == NULL )
+    {
+        return 1;
+    }
+
+    st->round = -1;
+    st->pass = -1;
+
+    fp = fopen( st->filename, "r" );
+
+    if( fp == NULL )
+    {
+        if( errno != ENOENT )
+        {
+            nwipe_perror( errno, __FUNCTION__, "fopen" );
+        }
+
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "No checkpoint of '%s' to resume, the wipe starts from the beginning.",
+                   c->device_name );
+        nwipe_checkpoint_free( st );
+        return 1;
+    }
+
+    /* The counters and failed regions of the interrupted wipe. */
+    nwipe_checkpoint_restart( c );
+
+    while( !damaged && fgets( line, sizeof( line ), fp ) != NULL )
+    {
+        end = strchr( line, '\n' );
+
+        if( end == NULL )
+        {
+            /* Too long. */
+            damaged = 1;
+            break;
+        }
+
+        *end = 0;
+
+        if( line[0] == '#' || line[0] == 0 )
+        {
+            continue;
+        }
+
+        value = strchr( line, '=' );
+
+        if( value == NULL )
+        {
+            damaged = 1;
+            break;
+        }
+
+        *value++ = 0;
+
+        if( strcmp( line, "serial" ) == 0 )
+        {
+            snprintf( serial, sizeof( serial ), "%s", value );
+        }
+        else if( strcmp( line, "method" ) == 0 )
+        {
+            snprintf( method, sizeof( method ), "%s", value );
+        }
+        else if( strcmp( line, "prng" ) == 0 )
+        {
+            snprintf( prng, sizeof( prng ), "%s", value );
+        }
+        else if( strcmp( line, "size" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &size ) != 1;
+        }
+        else if( strcmp( line, "io_size" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &io_size ) != 1;
+        }
+        else if( strcmp( line, "rounds" ) == 0 )
+        {
+            damaged = sscanf( value, "%i", &rounds ) != 1;
+        }
+        else if( strcmp( line, "verify" ) == 0 )
+        {
+            damaged = sscanf( value, "%i", &verify ) != 1;
+        }
+        else if( strcmp( line, "noblank" ) == 0 )
+        {
+            damaged = sscanf( value, "%i", &noblank ) != 1;
+        }
+        else if( strcmp( line, "verify_inline" ) == 0 )
+        {
+            damaged = sscanf( value, "%i", &verify_inline ) != 1;
+        }
+        else if( strcmp( line, "write_threads" ) == 0 )
+        {
+            damaged = sscanf( value, "%i", &write_threads ) != 1;
+        }
+        else if( strcmp( line, "round" ) == 0 )
+        {
+            damaged = sscanf( value, "%i", &st->round ) != 1;
+        }
+        else if( strcmp( line, "pass" ) == 0 )
+        {
+            damaged = sscanf( value, "%i", &st->pass ) != 1;
+        }
+        else if( strcmp( line, "stage" ) == 0 )
+        {
+            for( i = 0; i < NWIPE_CHECKPOINT_STAGES; i++ )
+            {
+                if( strcmp( value, nwipe_checkpoint_stage_name[i] ) == 0 )
+                {
+                    stage = i;
+                }
+            }
+
+            damaged = stage < 0;
+        }
+        else if( strcmp( line, "offset" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &st->offset ) != 1;
+        }
+        else if( strcmp( line, "round_done" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &c->round_done ) != 1;
+        }
+        else if( strcmp( line, "bytes_erased" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &c->bytes_erased ) != 1;
+        }
+        else if( strcmp( line, "pass_errors" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &c->pass_errors ) != 1;
+        }
+        else if( strcmp( line, "verify_errors" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &c->verify_errors ) != 1;
+        }
+        else if( strcmp( line, "verify_mismatch_bytes" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &c->verify_mismatch_bytes ) != 1;
+        }
+        else if( strcmp( line, "fsyncdata_errors" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu", &c->fsyncdata_errors ) != 1;
+        }
+        else if( strcmp( line, "seed" ) == 0 )
+        {
+            st->seed_length = (int) strlen( value ) / 2;
+            st->seed = malloc( st->seed_length > 0 ? st->seed_length : 1 );
+            damaged = st->seed == NULL || nwipe_checkpoint_unhex( value, st->seed, st->seed_length ) != 0;
+        }
+        else if( strcmp( line, "pattern" ) == 0 )
+        {
+            damaged = nwipe_checkpoint_add_pattern( st, value ) != 0;
+        }
+        else if( strcmp( line, "region" ) == 0 )
+        {
+            damaged = sscanf( value, "%llu %llu %15s", &start, &length, kind ) != 3;
+
+            for( i = 0; !damaged && i < NWIPE_BADMAP_KINDS; i++ )
+            {
+                if( strcmp( kind, nwipe_checkpoint_badmap_name[i] ) == 0 )
+                {
+                    nwipe_badmap_add( c, start, length, (nwipe_badmap_kind_t) i );
+                    break;
+                }
+            }
+        }
+    }
+
+    fclose( fp );
+
+    if( damaged || stage < 0 || st->round < 0 || st->pass < 0 || st->seed == NULL )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "The checkpoint of '%s' in %s is damaged, the wipe starts from the beginning.",
+                   c->device_name,
+                   st->filename );
+        nwipe_checkpoint_restart( c );
+        nwipe_checkpoint_free( st );
+        return 1;
+    }
+
+    st->stage = (nwipe_checkpoint_stage_t) stage;
+
+    if( nwipe_checkpoint_identified( c ) && strcmp( serial, c->device_serial_no ) != 0 )
+    {
+        differs = "serial number";
+    }
+    else if( size != c->device_size || st->offset > c->device_size )
+    {
+        differs = "device size";
+    }
+    else if( strcmp( method, nwipe_method_label( nwipe_options.method ) ) != 0 )
+    {
+        differs = "method";
+    }
+    else if( strcmp( prng, nwipe_options.prng->label ) != 0 || st->seed_length != NWIPE_KNOB_PRNG_STATE_LENGTH )
+    {
+        differs = "PRNG";
+    }
+    else if( rounds != nwipe_options.rounds )
+    {
+        differs = "number of rounds";
+    }
+    else if( verify != (int) nwipe_options.verify || noblank != nwipe_options.noblank
+             || verify_inline != nwipe_options.verify_inline )
+    {
+        differs = "verification or blanking option";
+    }
+    else if( write_threads != nwipe_options.write_threads && nwipe_options.prng->seek == NULL )
+    {
+        /* The streams of a PRNG that can't seek depend on the number of stripes. */
+        differs = "number of write threads";
+    }
+    else if( io_size == 0 || io_size % c->device_io_align != 0 || io_size % c->device_stat.st_blksize != 0
+             || st->offset % c->device_io_align != 0 )
+    {
+        differs = "I/O size";
+    }
+
+    if( differs != NULL )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "The checkpoint of '%s' is for a different %s, the wipe starts from the beginning.",
+                   c->device_name,
+                   differs );
+        nwipe_checkpoint_restart( c );
+        nwipe_checkpoint_free( st );
+        return 1;
+    }
+
+    if( !nwipe_checkpoint_identified( c ) )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "The serial number of '%s' is not known, the checkpoint only matches the device name and size.",
+                   c->device_name );
+    }
+
+    /* The blocks of a PRNG stream that can't seek are regenerated in the same sizes. */
+    if( io_size != c->device_io_size )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "%s, I/O size %llu bytes of the interrupted wipe", c->device_name, io_size );
+        c->device_io_size = (size_t) io_size;
+    }
+
+    st->resuming = 1;
+    c->checkpoint = st;
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Resuming '%s' at round %i, pass %i, %s, byte %llu of %llu.",
+               c->device_name,
+               st->round,
+               st->pass,
+               nwipe_checkpoint_stage_label[st->stage],
+               st->offset,
+               c->device_size );
+
+    return 0;
+
+} /* nwipe_checkpoint_load */
+
+nwipe_pattern_t* nwipe_checkpoint_begin( nwipe_context_t* c, nwipe_pattern_t* patterns )
+{
+    nwipe_checkpoint_t* st = c->checkpoint;
+    int count = 0;
+
+    while( patterns[count].length )
+    {
+        count++;
+    }
+
+    if( st == NULL )
+    {
+        st = nwipe_checkpoint_new( c );
+
+        if( st == NULL )
+        {
+            return patterns;
+        }
+
+        c->checkpoint = st;
+    }
+
+    /* Only the owner may list the checkpoints, see nwipe_checkpoint_write(). */
+    if( mkdir( nwipe_options.state_dir, 0700 ) != 0 && errno != EEXIST )
+    {
+        nwipe_perror( errno, __FUNCTION__, "mkdir" );
+    }
+
+    if( st->resuming && st->pattern_count != count )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "The checkpoint of '%s' has different passes, the wipe starts from the beginning.",
+                   c->device_name );
+        st->resuming = 0;
+        nwipe_checkpoint_restart( c );
+    }
+
+    if( st->resuming && st->loaded != NULL )
+    {
+        patterns = st->loaded;
+    }
+
+    st->patterns = patterns;
+    st->pattern_count = count;
+
+    return patterns;
+
+} /* nwipe_checkpoint_begin */
+
+int nwipe_checkpoint_step( nwipe_context_t* c, nwipe_checkpoint_stage_t stage )
+{
+    nwipe_checkpoint_t* st = c->checkpoint;
+
+    /* The order of this step and the step of the checkpoint. */
+    int order;
+
+    if( st == NULL )
+    {
+        return 0;
+    }
+
+    if( st->resuming )
+    {
+        order = c->round_working != st->round ? c->round_working - st->round
+            : c->pass_working != st->pass     ? c->pass_working - st->pass
+                                              : (int) stage - (int) st->stage;
+
+        if( order < 0 )
+        {
+            return 1;
+        }
+
+        st->resuming = 0;
+
+        if( order > 0 )
+        {
+            nwipe_log( NWIPE_LOG_SANITY,
+                       "%s: The step of the checkpoint of '%s' was not found.",
+                       __FUNCTION__,
+                       c->device_name );
+        }
+        else
+        {
+            st->resume_offset = st->offset;
+
+            if( c->prng_seed.s != NULL && c->prng_seed.length == st->seed_length )
+            {
+                memcpy( c->prng_seed.s, st->seed, st->seed_length );
+            }
+
+            nwipe_log( NWIPE_LOG_NOTICE,
+                       "Resuming the %s of pass %i/%i, round %i/%i, on '%s' at byte %llu.",
+                       nwipe_checkpoint_stage_label[stage],
+                       c->pass_working,
+                       c->pass_count,
+                       c->round_working,
+                       c->round_count,
+                       c->device_name,
+                       st->resume_offset );
+        }
+    }
+
+    st->round = c->round_working;
+    st->pass = c->pass_working;
+    st->stage = stage;
+    nwipe_checkpoint_save( c, st->resume_offset );
+
+    return 0;
+
+} /* nwipe_checkpoint_step */
+
+u64 nwipe_checkpoint_resume_offset( nwipe_context_t* c )
+{
+    u64 offset;
+
+    if( c->checkpoint == NULL )
+    {
+        return 0;
+    }
+
+    offset = c->checkpoint->resume_offset;
+    c->checkpoint->resume_offset = 0;
+
+    return offset;
+
+} /* nwipe_checkpoint_resume_offset */
+
+int nwipe_checkpoint_due( nwipe_context_t* c )
+{
+    return c->checkpoint != NULL && time( NULL ) - c->checkpoint->saved >= NWIPE_KNOB_CHECKPOINT_INTERVAL;
+
+} /* nwipe_checkpoint_due */
+
+static int nwipe_checkpoint_write( nwipe_context_t* c, const char* filename )
+{
+    /**
+     * Writes the checkpoint file and makes sure it is on disk.
+     *
+     * @returns  0 on success, -1 on failure with errno set.
+     */
+
+    nwipe_checkpoint_t* st = c->checkpoint;
+    nwipe_badmap_extent_t* e;
+    FILE* fp;
+    int fd;
+    int r;
+    int i;
+
+    /* The checkpoint holds the PRNG seed, from which the random passes can be regenerated, so only
+     * the owner may read it. A temporary file left behind by a crash is replaced. */
+    unlink( filename );
+    fd = open( filename, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0600 );
+
+    if( fd < 0 )
+    {
+        return -1;
+    }
+
+    fp = fdopen( fd, "w" );
+
+    if( fp == NULL )
+    {
+        r = errno;
+        close( fd );
+        errno = r;
+        return -1;
+    }
+
+    fprintf( fp, "# nwipe checkpoint, resume the wipe with --resume\n" );
+    fprintf( fp, "# Device: %s\n", c->device_name );
+    fprintf( fp, "# Model: %s\n", c->device_model != NULL ? c->device_model : "" );
+    fprintf( fp, "serial=%s\n", c->device_serial_no );
+    fprintf( fp, "size=%llu\n", c->device_size );
+    fprintf( fp, "io_size=%llu\n", (u64) c->device_io_size );
+    fprintf( fp, "method=%s\n", nwipe_method_label( nwipe_options.method ) );
+    fprintf( fp, "prng=%s\n", nwipe_options.prng->label );
+    fprintf( fp, "rounds=%i\n", nwipe_options.rounds );
+    fprintf( fp, "verify=%i\n", (int) nwipe_options.verify );
+    fprintf( fp, "noblank=%i\n", nwipe_options.noblank );
+    fprintf( fp, "verify_inline=%i\n", nwipe_options.verify_inline );
+    fprintf( fp, "write_threads=%i\n", nwipe_options.write_threads );
+    fprintf( fp, "round=%i\n", st->round );
+    fprintf( fp, "pass=%i\n", st->pass );
+    fprintf( fp, "stage=%s\n", nwipe_checkpoint_stage_name[st->stage] );
+    fprintf( fp, "offset=%llu\n", st->offset );
+    fprintf( fp, "round_done=%llu\n", c->round_done );
+    fprintf( fp, "bytes_erased=%llu\n", c->bytes_erased );
+    fprintf( fp, "pass_errors=%llu\n", c->pass_errors );
+    fprintf( fp, "verify_errors=%llu\n", c->verify_errors );
+    fprintf( fp, "verify_mismatch_bytes=%llu\n", c->verify_mismatch_bytes );
+    fprintf( fp, "fsyncdata_errors=%llu\n", c->fsyncdata_errors );
+
+    fprintf( fp, "seed=" );
+    nwipe_checkpoint_hex( fp, c->prng_seed.s, c->prng_seed.s != NULL ? c->prng_seed.length : 0 );
+    fprintf( fp, "\n" );
+
+    for( i = 0; i < st->pattern_count; i++ )
+    {
+        fprintf( fp, "pattern=" );
+
+        if( st->patterns[i].length < 0 )
+        {
+            fprintf( fp, "random" );
+        }
+        else
+        {
+            nwipe_checkpoint_hex( fp, st->patterns[i].s, st->patterns[i].length );
+        }
+
+        fprintf( fp, "\n" );
+    }
+
+    for( i = 0; c->badmap != NULL && i < c->badmap->count; i++ )
+    {
+        e = &c->badmap->extent[i];
+        fprintf( fp, "region=%llu %llu %s\n", e->start, e->end - e->start, nwipe_checkpoint_badmap_name[e->kind] );
+    }
+
+    if( fflush( fp ) != 0 || fsync( fileno( fp ) ) != 0 )
+    {
+        i = errno;
+        fclose( fp );
+        errno = i;
+        return -1;
+    }
+
+    return fclose( fp );
+
+} /* nwipe_checkpoint_write */
+
+void nwipe_checkpoint_save( nwipe_context_t* c, u64 offset )
+{
+    nwipe_checkpoint_t* st = c->checkpoint;
+
+    /* The file that is written and then renamed over the checkpoint. */
+    char temporary[FILENAME_MAX + 4];
+
+    /* The state directory, synced so that the rename is on disk. */
+    int fd;
+
+    if( st == NULL )
+    {
+        return;
+    }
+
+    st->offset = offset;
+    st->saved = time( NULL );
+
+    snprintf( temporary, sizeof( temporary ), "%s.tmp", st->filename );
+
+    if( nwipe_checkpoint_write( c, temporary ) != 0 || rename( temporary, st->filename ) != 0 )
+    {
+        if( !st->failed )
+        {
+            nwipe_perror( errno, __FUNCTION__, "write" );
+            nwipe_log( NWIPE_LOG_WARNING,
+                       "Unable to write the checkpoint of '%s' to %s, the wipe can't be resumed.",
+                       c->device_name,
+                       st->filename );
+            st->failed = 1;
+        }
+
+        unlink( temporary );
+        return;
+    }
+
+    fd = open( nwipe_options.state_dir, O_RDONLY | O_DIRECTORY );
+
+    if( fd >= 0 )
+    {
+        fsync( fd );
+        close( fd );
+    }
+
+} /* nwipe_checkpoint_save */
+
+void nwipe_checkpoint_end( nwipe_context_t* c, int result )
+{
+    nwipe_checkpoint_t* st = c->checkpoint;
+
+    if( st == NULL )
+    {
+        return;
+    }
+
+    if( result >= 0 )
+    {
+        if( unlink( st->filename ) != 0 && errno != ENOENT )
+        {
+            nwipe_perror( errno, __FUNCTION__, "unlink" );
+        }
+    }
+    else if( !st->failed )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "The wipe of '%s' can be resumed with --resume.", c->device_name );
+    }
+
+    c->checkpoint = NULL;
+    nwipe_checkpoint_free( st );
+
+} /* nwipe_checkpoint_end */
@@ -0,0 +1,105 @@
+/*
+ *  checkpoint.h: Checkpoints of the progress of a wipe, so that it can be resumed.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+/* The steps of each pass, in the order that they are run. */
+typedef enum nwipe_checkpoint_stage_t_ {
+    NWIPE_CHECKPOINT_WRITE = 0,  // Writing a pass of the method.
+    NWIPE_CHECKPOINT_VERIFY,  // Verifying a pass of the method.
+    NWIPE_CHECKPOINT_FINAL_WRITE,  // Writing the final blanking or OPS-II pass.
+    NWIPE_CHECKPOINT_FINAL_VERIFY,  // Verifying the final pass, or the device for the verify methods.
+    NWIPE_CHECKPOINT_STAGES  // The number of steps.
+} nwipe_checkpoint_stage_t;
+
+/* Where a wipe has got to. */
+typedef struct nwipe_checkpoint_t_
+{
+    int round;  // The working round.
+    int pass;  // The working pass.
+    nwipe_checkpoint_stage_t stage;  // The step of the pass.
+    u64 offset;  // The offset the step has reached, everything before it has been written or verified.
+    nwipe_pattern_t* patterns;  // The patterns of the method, in the order that they are written.
+    int pattern_count;  // The number of patterns.
+    nwipe_pattern_t* loaded;  // The patterns read from a checkpoint, which replace those of the method.
+    char* pattern_data;  // The bytes of the loaded patterns.
+    char* seed;  // The PRNG seed of the step that is resumed.
+    int seed_length;  // The length of the seed.
+    int resuming;  // Set from loading a checkpoint until the wipe reaches the step it was written in.
+    u64 resume_offset;  // The offset the resumed step starts at, until the pass takes it.
+    time_t saved;  // When the checkpoint was last written.
+    int failed;  // Set when a checkpoint could not be written, so that the warning is logged once.
+    char filename[FILENAME_MAX];  // The checkpoint file of the device.
+} nwipe_checkpoint_t;
+
+/**
+ * Reads the checkpoint of a device for --resume, before the wipe is started. The device must
+ * have the serial number and size, and the options the method, PRNG, rounds, verification and
+ * blanking of the interrupted wipe. The error counters and failed regions of the interrupted
+ * wipe are restored.
+ *
+ * @returns  0 when the wipe will be resumed, 1 when it starts from the beginning.
+ */
+int nwipe_checkpoint_load( nwipe_context_t* c );
+
+/**
+ * Starts writing checkpoints at the beginning of a method, to the state directory. A resumed
+ * wipe must have the same number of patterns, which are replaced by those of the checkpoint,
+ * as the random characters and the order of some methods differ on every run.
+ *
+ * @returns  The patterns to write.
+ */
+nwipe_pattern_t* nwipe_checkpoint_begin( nwipe_context_t* c, nwipe_pattern_t* patterns );
+
+/**
+ * Marks the start of a step of the method, round_working and pass_working are the step's round
+ * and pass. The steps before the checkpoint of a resumed wipe are skipped, the step of the
+ * checkpoint gets its PRNG seed back and starts at its offset. A checkpoint of the step is
+ * written, so a random pass must have been seeded.
+ *
+ * @returns  1 if the step was completed before the wipe was interrupted, 0 to run it.
+ */
+int nwipe_checkpoint_step( nwipe_context_t* c, nwipe_checkpoint_stage_t stage );
+
+/**
+ * Takes the offset a pass starts at, which is not zero for the step of a resumed checkpoint.
+ *
+ * @returns  The offset, a multiple of the I/O size of the device.
+ */
+u64 nwipe_checkpoint_resume_offset( nwipe_context_t* c );
+
+/**
+ * @returns  1 when NWIPE_KNOB_CHECKPOINT_INTERVAL seconds have passed since the last checkpoint.
+ */
+int nwipe_checkpoint_due( nwipe_context_t* c );
+
+/**
+ * Writes a checkpoint of the current step. Everything before the offset must be on the device,
+ * i.e. synced after writing. The file is replaced atomically, so an interruption leaves either
+ * the old or the new checkpoint.
+ */
+void nwipe_checkpoint_save( nwipe_context_t* c, u64 offset );
+
+/**
+ * Stops writing checkpoints at the end of a method. The checkpoint is removed if the method
+ * finished, and kept for --resume after a fatal error.
+ */
+void nwipe_checkpoint_end( nwipe_context_t* c, int result );
+
+#endif /* CHECKPOINT_H_ */
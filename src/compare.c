@@ -0,0 +1,284 @@
+/*
+ *  compare.c: The compare routines of the verification passes.
+ *
+ *  The data read back from a device is compared with the expected data in wide
+ *  vectors, AVX2 or SSE2 on x86-64 and 64 bit words elsewhere, so that the
+ *  verification is limited by the device rather than the CPU. Patterns of one
+ *  repeated byte are compared with a register instead of a second buffer. The
+ *  routines find the exact offset of the first difference and count the bytes
+ *  that differ, so a verification can report how much of a device failed.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "compare.h"
+
+// Define NWIPE_COMPARE_NO_SIMD to build the portable code only
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && !defined( NWIPE_COMPARE_NO_SIMD )
+#include <immintrin.h>
+#define NWIPE_COMPARE_X86 1
+#endif
+
+/* In all the routines below b is the expected data, or NULL when every expected byte is x. */
+
+static size_t nwipe_compare_find_scalar( const char* a, const char* b, unsigned char x, size_t length )
+{
+    uint64_t wa;
+    uint64_t wb = 0x0101010101010101ULL * x;
+    size_t i = 0;
+
+    for( ; i + 8 <= length; i += 8 )
+    {
+        memcpy( &wa, a + i, 8 );
+
+        if( b != NULL )
+        {
+            memcpy( &wb, b + i, 8 );
+        }
+
+        if( wa != wb )
+        {
+            break;
+        }
+    }
+
+    for( ; i < length; i++ )
+    {
+        if( (unsigned char) a[i] != ( b != NULL ? (unsigned char) b[i] : x ) )
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+static size_t nwipe_compare_count_scalar( const char* a, const char* b, unsigned char x, size_t length )
+{
+    size_t n = 0;
+    size_t i;
+
+    for( i = 0; i < length; i++ )
+    {
+        n += (unsigned char) a[i] != ( b != NULL ? (unsigned char) b[i] : x );
+    }
+
+    return n;
+}
+
+#ifdef NWIPE_COMPARE_X86
+
+// SSE2, four vectors of 16 bytes per iteration until the first difference
+static size_t nwipe_compare_find_sse2( const char* a, const char* b, unsigned char x, size_t length )
+{
+    __m128i b0 = _mm_set1_epi8( (char) x );
+    __m128i b1 = b0, b2 = b0, b3 = b0;
+    __m128i e;
+    unsigned mask;
+    size_t i = 0;
+
+    for( ; i + 64 <= length; i += 64 )
+    {
+        if( b != NULL )
+        {
+            b0 = _mm_loadu_si128( (const __m128i*) ( b + i ) );
+            b1 = _mm_loadu_si128( (const __m128i*) ( b + i + 16 ) );
+            b2 = _mm_loadu_si128( (const __m128i*) ( b + i + 32 ) );
+            b3 = _mm_loadu_si128( (const __m128i*) ( b + i + 48 ) );
+        }
+
+        e = _mm_and_si128( _mm_and_si128( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*) ( a + i ) ), b0 ),
+                                          _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*) ( a + i + 16 ) ), b1 ) ),
+                           _mm_and_si128( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*) ( a + i + 32 ) ), b2 ),
+                                          _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*) ( a + i + 48 ) ), b3 ) ) );
+
+        if( _mm_movemask_epi8( e ) != 0xFFFF )
+        {
+            break;
+        }
+    }
+
+    // Locate the difference, or compare the tail
+    for( ; i + 16 <= length; i += 16 )
+    {
+        if( b != NULL )
+        {
+            b0 = _mm_loadu_si128( (const __m128i*) ( b + i ) );
+        }
+
+        mask = ~(unsigned) _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*) ( a + i ) ), b0 ) )
+            & 0xFFFF;
+
+        if( mask != 0 )
+        {
+            return i + (size_t) __builtin_ctz( mask );
+        }
+    }
+
+    return i + nwipe_compare_find_scalar( a + i, b != NULL ? b + i : NULL, x, length - i );
+}
+
+static size_t nwipe_compare_count_sse2( const char* a, const char* b, unsigned char x, size_t length )
+{
+    __m128i b0 = _mm_set1_epi8( (char) x );
+    unsigned mask;
+    size_t n = 0;
+    size_t i = 0;
+
+    for( ; i + 16 <= length; i += 16 )
+    {
+        if( b != NULL )
+        {
+            b0 = _mm_loadu_si128( (const __m128i*) ( b + i ) );
+        }
+
+        mask = ~(unsigned) _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*) ( a + i ) ), b0 ) )
+            & 0xFFFF;
+
+        // Most blocks that are counted differ in every byte, which needs no popcount
+        n += mask == 0xFFFF ? 16 : (size_t) __builtin_popcount( mask );
+    }
+
+    return n + nwipe_compare_count_scalar( a + i, b != NULL ? b + i : NULL, x, length - i );
+}
+
+// AVX2, four vectors of 32 bytes per iteration until the first difference
+__attribute__( ( target( "avx2" ) ) ) static size_t
+nwipe_compare_find_avx2( const char* a, const char* b, unsigned char x, size_t length )
+{
+    __m256i b0 = _mm256_set1_epi8( (char) x );
+    __m256i b1 = b0, b2 = b0, b3 = b0;
+    __m256i e;
+    unsigned mask;
+    size_t i = 0;
+
+    for( ; i + 128 <= length; i += 128 )
+    {
+        if( b != NULL )
+        {
+            b0 = _mm256_loadu_si256( (const __m256i*) ( b + i ) );
+            b1 = _mm256_loadu_si256( (const __m256i*) ( b + i + 32 ) );
+            b2 = _mm256_loadu_si256( (const __m256i*) ( b + i + 64 ) );
+            b3 = _mm256_loadu_si256( (const __m256i*) ( b + i + 96 ) );
+        }
+
+        e = _mm256_and_si256(
+            _mm256_and_si256( _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*) ( a + i ) ), b0 ),
+                              _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*) ( a + i + 32 ) ), b1 ) ),
+            _mm256_and_si256( _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*) ( a + i + 64 ) ), b2 ),
+                              _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*) ( a + i + 96 ) ), b3 ) ) );
+
+        if( (unsigned) _mm256_movemask_epi8( e ) != 0xFFFFFFFFu )
+        {
+            break;
+        }
+    }
+
+    // Locate the difference, or compare the tail
+    for( ; i + 32 <= length; i += 32 )
+    {
+        if( b != NULL )
+        {
+            b0 = _mm256_loadu_si256( (const __m256i*) ( b + i ) );
+        }
+
+        mask = ~(unsigned) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*) ( a + i ) ), b0 ) );
+
+        if( mask != 0 )
+        {
+            return i + (size_t) __builtin_ctz( mask );
+        }
+    }
+
+    return i + nwipe_compare_find_scalar( a + i, b != NULL ? b + i : NULL, x, length - i );
+}
+
+__attribute__( ( target( "avx2,popcnt" ) ) ) static size_t
+nwipe_compare_count_avx2( const char* a, const char* b, unsigned char x, size_t length )
+{
+    __m256i b0 = _mm256_set1_epi8( (char) x );
+    unsigned mask;
+    size_t n = 0;
+    size_t i = 0;
+
+    for( ; i + 32 <= length; i += 32 )
+    {
+        if( b != NULL )
+        {
+            b0 = _mm256_loadu_si256( (const __m256i*) ( b + i ) );
+        }
+
+        mask = ~(unsigned) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*) ( a + i ) ), b0 ) );
+
+        n += (size_t) __builtin_popcount( mask );
+    }
+
+    return n + nwipe_compare_count_scalar( a + i, b != NULL ? b + i : NULL, x, length - i );
+}
+
+#endif /* NWIPE_COMPARE_X86 */
+
+static size_t nwipe_compare_find_any( const char* a, const char* b, unsigned char x, size_t length )
+{
+#ifdef NWIPE_COMPARE_X86
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        return nwipe_compare_find_avx2( a, b, x, length );
+    }
+
+    return nwipe_compare_find_sse2( a, b, x, length );
+#else
+    return nwipe_compare_find_scalar( a, b, x, length );
+#endif
+}
+
+static size_t nwipe_compare_count_any( const char* a, const char* b, unsigned char x, size_t length )
+{
+#ifdef NWIPE_COMPARE_X86
+    if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "popcnt" ) )
+    {
+        return nwipe_compare_count_avx2( a, b, x, length );
+    }
+
+    return nwipe_compare_count_sse2( a, b, x, length );
+#else
+    return nwipe_compare_count_scalar( a, b, x, length );
+#endif
+}
+
+size_t nwipe_compare_find( const char* a, const char* b, size_t length )
+{
+    return nwipe_compare_find_any( a, b, 0, length );
+}
+
+size_t nwipe_compare_find_byte( const char* a, unsigned char x, size_t length )
+{
+    return nwipe_compare_find_any( a, NULL, x, length );
+}
+
+size_t nwipe_compare_count( const char* a, const char* b, size_t length )
+{
+    return nwipe_compare_count_any( a, b, 0, length );
+}
+
+size_t nwipe_compare_count_byte( const char* a, unsigned char x, size_t length )
+{
+    return nwipe_compare_count_any( a, NULL, x, length );
+}
@@ -0,0 +1,52 @@
+/*
+ *  compare.h: The compare routines of the verification passes.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef COMPARE_H_
+#define COMPARE_H_
+
+#include <stddef.h>
+
+/**
+ * Finds the first byte at which two buffers differ.
+ *
+ * @returns  The offset of the first byte that differs, or length if the buffers are equal.
+ */
+size_t nwipe_compare_find( const char* a, const char* b, size_t length );
+
+/**
+ * Finds the first byte of a buffer that is not equal to x, for patterns of one repeated byte.
+ *
+ * @returns  The offset of the first byte that is not x, or length if every byte is x.
+ */
+size_t nwipe_compare_find_byte( const char* a, unsigned char x, size_t length );
+
+/**
+ * Counts the bytes at which two buffers differ.
+ *
+ * @returns  The number of bytes that differ.
+ */
+size_t nwipe_compare_count( const char* a, const char* b, size_t length );
+
+/**
+ * Counts the bytes of a buffer that are not equal to x.
+ *
+ * @returns  The number of bytes that are not x.
+ */
+size_t nwipe_compare_count_byte( const char* a, unsigned char x, size_t length );
+
+#endif /* COMPARE_H_ */
@@ -24,6 +24,7 @@
 #define CONTEXT_H_
 
 #include "prng.h"
+#include "smart.h"
 #ifndef __HDDTEMP_H__
 #include "hddtemp_scsi/hddtemp.h"
 #endif /* __HDDTEMP_H__ */
@@ -112,6 +113,11 @@ typedef struct nwipe_context_t_
     char* device_model;  // The model of the device.
     char device_label[NWIPE_DEVICE_LABEL_LENGTH];  // The label (name, model, size and serial) of the device.
     struct stat device_stat;  // The device file state from fstat().
+    size_t device_io_size;  // The size of each read and write issued by the passes, a multiple of st_blksize.
+    int io_uring_unavailable;  // Set when io_uring could not be set up, subsequent passes use synchronous I/O.
+    int io_uring_retried;  // Set once a failed io_uring transfer has been logged, the retries report each block.
+    int device_direct;  // Set when the device has been opened with O_DIRECT.
+    size_t device_io_align;  // The alignment of I/O buffers, offsets and lengths, the physical sector size.
     nwipe_device_t device_type;  // Indicates an IDE, SCSI, or Compaq SMART device in enumerated form (int)
     char device_type_str[14];  // Indicates an IDE, SCSI, USB etc as per nwipe_device_t but in ascii
     int device_is_ssd;  // 0 = no SSD, 1 = is a SSD
@@ -145,6 +151,12 @@ typedef struct nwipe_context_t_
     u64 throughput;  // Average throughput in bytes per second.
     char throughput_txt[13];  // Human readable throughput.
     u64 verify_errors;  // The number of verification errors across all passes.
+    u64 verify_mismatch_bytes;  // The number of bytes that differed from the expected data across all passes.
+    struct nwipe_badmap_t_* badmap;  // The regions that failed to be written or verified, NULL when there are none.
+    char badmap_filename[FILENAME_MAX];  // The file the map of the failed regions was saved to.
+    struct nwipe_checkpoint_t_* checkpoint;  // The checkpoint of the wipe, NULL when none is written.
+    int verify_quiet;  // Set when verification mismatches are expected, they are counted but not logged or mapped.
+    int verify_inline;  // Set while a write pass reads back each block as soon as it is written, --verify-inline.
     int templ_has_hwmon_data;  // 0 = no hwmon data available, 1 = hwmon data available
     int templ_has_scsitemp_data;  // 0 = no scsitemp data available, 1 = scsitemp data available
     char temp1_path[MAX_HWMON_PATH_LENGTH];  // path to temperature variables /sys/class/hwmon/hwmonX/ etc.
@@ -164,6 +176,14 @@ typedef struct nwipe_context_t_
     time_t temp1_time;  // The time when temperature was last checked, seconds since epoch
     struct disk* templ_disk;  // Pointer to disk structure for hddtemp SCSI routines
     int wipe_status;  // Wipe finished = 0, wipe in progress = 1, wipe yet to start = -1.
+    int wipe_queued;  // Set while the wipe waits in the queue for --max-wipes or --max-wipes-per-controller.
+    int wipe_group;  // The controller or SAS expander of the device, -1 if not known, see scheduler.c.
+    struct nwipe_link_t_* link;  // The link the device shares with other devices, NULL if not known.
+    int numa_node;  // The NUMA node of the controller of the device, -1 if not known.
+    nwipe_smart_t smart_before;  // The SMART data read before the wipe, for the report.
+    nwipe_smart_t smart_after;  // The SMART data read after the wipe, for the report.
+    time_t station_reported;  // When --station reported the wipe, 0 until then.
+    int event_fd;  // The eventfd written when the wipe thread finishes, -1 if there is none, see events.c.
     char wipe_status_txt[10];  // ERASED, FAILED, ABORTED, INSANITY
     int spinner_idx;  // Index into the spinner character array
     char spinner_character[1];  // The current spinner character
@@ -213,6 +233,8 @@ typedef struct
     time_t maxeta;  // The estimated runtime of the slowest device.
     u64 throughput;  // Total throughput.
     u64 errors;  // The combined number of errors of all processes.
+    int running;  // The number of wipes in progress.
+    int queued;  // The number of wipes waiting in the queue.
     pthread_t* gui_thread;  // The ID of GUI thread.
 } nwipe_misc_thread_data_t;
 
@@ -44,6 +44,8 @@
 #include "miscellaneous.h"
 #include <libconfig.h>
 #include "conf.h"
+#include "badmap.h"
+#include "smart.h"
 
 #define text_size_data 10
 
@@ -87,6 +89,8 @@ int create_pdf( nwipe_context_t* ptr )
     char HPA_status_text[50] = "";
     char HPA_size_text[50] = "";
     char errors[50] = "";
+    char bad_regions[FILENAME_MAX + 100] = "";
+    const char* badmap_name;
     char throughput_txt[50] = "";
     char bytes_percent_str[7] = "";
 
@@ -721,6 +725,30 @@ int create_pdf( nwipe_context_t* ptr )
     }
     pdf_set_font( pdf, "Helvetica" );
 
+    /*************
+     * Bad regions
+     */
+    if( c->badmap != NULL )
+    {
+        pdf_add_text( pdf, NULL, "Bad regions:", 12, 60, 150, PDF_GRAY );
+        pdf_set_font( pdf, "Helvetica-Bold" );
+
+        /* The map is saved next to the log or the report, so only its name is shown. */
+        badmap_name = strrchr( c->badmap_filename, '/' );
+        badmap_name = badmap_name != NULL ? badmap_name + 1 : c->badmap_filename;
+
+        snprintf( bad_regions,
+                  sizeof( bad_regions ),
+                  "%i, %llu sectors failed%s%s",
+                  c->badmap->count,
+                  nwipe_badmap_sectors( c, NWIPE_BADMAP_WRITE ) + nwipe_badmap_sectors( c, NWIPE_BADMAP_READ )
+                      + nwipe_badmap_sectors( c, NWIPE_BADMAP_VERIFY ),
+                  badmap_name[0] != 0 ? ", see " : "",
+                  badmap_name );
+        pdf_add_text( pdf, NULL, bad_regions, text_size_data, 135, 150, PDF_RED );
+        pdf_set_font( pdf, "Helvetica" );
+    }
+
     /*************
      * Information
      */
@@ -819,154 +847,247 @@ int create_pdf( nwipe_context_t* ptr )
     return 0;
 }
 
+static void nwipe_smart_pdf_line( nwipe_context_t* c, const char* text, int* y, int* page_number )
+{
+    /**
+     * Adds a line of SMART data to the report, on a new page when the page is full.
+     */
+
+    char page_title[50];
+
+    /* Have we reached the bottom of the page yet */
+    if( *y < 60 )
+    {
+        /* Append an extra page */
+        page = pdf_append_page( pdf );
+        ( *page_number )++;
+        *y = 630;
+
+        /* create the header and footer for the next page */
+        snprintf( page_title, sizeof( page_title ), "Page %i - Smart Data", *page_number );
+        create_header_and_footer( c, page_title );
+    }
+
+    pdf_set_font( pdf, "Courier" );
+    pdf_add_text( pdf, NULL, text, 8, 50, *y, PDF_BLACK );
+    *y -= 9;
+
+} /* nwipe_smart_pdf_line */
+
+static void nwipe_smart_pdf_value( char* str, size_t size, const nwipe_smart_t* smart, long long value )
+{
+    /* A value of the summary, "-" when the drive wasn't read or doesn't report it. */
+    if( smart->source == NWIPE_SMART_NONE || value < 0 )
+    {
+        snprintf( str, size, "-" );
+    }
+    else
+    {
+        snprintf( str, size, "%lli", value );
+    }
+
+} /* nwipe_smart_pdf_value */
+
 int nwipe_get_smart_data( nwipe_context_t* c )
 {
-    FILE* fp;
+    /**
+     * Adds the SMART data read before and after the wipe to the report, from page 2. The
+     * data is read when the report is created if the device wasn't wiped.
+     */
+
+    const nwipe_smart_t* s[2] = { &c->smart_before, &c->smart_after };
+    const nwipe_smart_attribute_t* a;
+    const nwipe_smart_attribute_t* b;
+    const char* source;
+    struct tm* p;
 
-    char* pdata;
     char page_title[50];
+    char line[128];
+    char value[2][32];
+    char raw[2][24];
 
-    char smartctl_command[] = "smartctl -a %s";
-    char smartctl_command2[] = "/sbin/smartctl -a %s";
-    char smartctl_command3[] = "/usr/bin/smartctl -a %s";
-    char smartctl_command4[] = "/usr/sbin/smartctl -a %s";
-    char final_cmd_smartctl[sizeof( smartctl_command3 ) + 256];
-    char result[512];
-    char smartctl_labels_to_anonymize[][18] = {
-        "serial number:", "lu wwn device id:", "logical unit id:", "" /* Don't remove this empty string !, important */
-    };
-
-    int idx, idx2, idx3;
-    int x, y;
-    int set_return_value;
+    int y;
     int page_number;
+    int idx;
+    int i;
+    int j;
 
-    final_cmd_smartctl[0] = 0;
+    /* The summary rows, the values of which are -1 when not reported. */
+    const char* labels[] = { "Temperature (C)",       "Power on hours",       "Power cycles",
+                             "Reallocated sectors",   "Pending sectors",      "Uncorrectable errors",
+                             "Percentage used",       "Data written (bytes)", "Critical warning" };
+    long long values[2][9];
 
-    /* Determine whether we can access smartctl, required if the PATH environment is not setup ! (Debian sid 'su' as
-     * opposed to 'su -' */
-    if( system( "which smartctl > /dev/null 2>&1" ) )
+    if( c->smart_before.source == NWIPE_SMART_NONE && c->smart_after.source == NWIPE_SMART_NONE )
     {
-        if( system( "which /sbin/smartctl > /dev/null 2>&1" ) )
-        {
-            if( system( "which /usr/bin/smartctl > /dev/null 2>&1" ) )
-            {
-                if( system( "which /usr/sbin/smartctl > /dev/null 2>&1" ) )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Command not found. Install smartmontools !" );
-                }
-                else
-                {
-                    sprintf( final_cmd_smartctl, smartctl_command4, c->device_name );
-                }
-            }
-            else
-            {
-                sprintf( final_cmd_smartctl, smartctl_command3, c->device_name );
-            }
-        }
-        else
-        {
-            sprintf( final_cmd_smartctl, smartctl_command2, c->device_name );
-        }
+        nwipe_smart_read( c->device_name, &c->smart_after );
     }
-    else
+
+    for( idx = 0; idx < 2; idx++ )
     {
-        sprintf( final_cmd_smartctl, smartctl_command, c->device_name );
+        values[idx][0] = s[idx]->temperature;
+        values[idx][1] = s[idx]->power_on_hours;
+        values[idx][2] = s[idx]->power_cycles;
+        values[idx][3] = s[idx]->reallocated;
+        values[idx][4] = s[idx]->pending;
+        values[idx][5] = s[idx]->uncorrectable;
+        values[idx][6] = s[idx]->percentage_used;
+        values[idx][7] = s[idx]->written;
+        values[idx][8] = s[idx]->source == NWIPE_SMART_NVME ? s[idx]->critical_warning : -1;
     }
 
-    if( final_cmd_smartctl[0] != 0 )
+    y = 630;  // top row of page
+    page_number = 2;
+
+    /* Create Page 2 of the report. This shows the drives smart data
+     */
+    page = pdf_append_page( pdf );
+
+    /* Create the header and footer for page 2, the start of the smart data */
+    snprintf( page_title, sizeof( page_title ), "Page %i - Smart Data", page_number );
+    create_header_and_footer( c, page_title );
+
+    switch( c->smart_after.source != NWIPE_SMART_NONE ? c->smart_after.source : c->smart_before.source )
     {
-        fp = popen( final_cmd_smartctl, "r" );
+        case NWIPE_SMART_ATA:
+            source = "ATA SMART READ DATA";
+            break;
 
-        if( fp == NULL )
+        case NWIPE_SMART_SCSI:
+            source = "SCSI LOG SENSE";
+            break;
+
+        case NWIPE_SMART_NVME:
+            source = "NVMe SMART / Health Information log";
+            break;
+
+        default:
+            nwipe_smart_pdf_line( c, "SMART data is not available for this device.", &y, &page_number );
+            return 1;
+    }
+
+    snprintf( line, sizeof( line ), "Source: %s", source );
+    nwipe_smart_pdf_line( c, line, &y, &page_number );
+    nwipe_smart_pdf_line( c, "", &y, &page_number );
+
+    snprintf( line, sizeof( line ), "%-28s %-24s %-24s", "", "Before wipe", "After wipe" );
+    nwipe_smart_pdf_line( c, line, &y, &page_number );
+
+    for( idx = 0; idx < 2; idx++ )
+    {
+        value[idx][0] = 0;
+
+        if( s[idx]->source != NWIPE_SMART_NONE && ( p = localtime( &s[idx]->time ) ) != NULL )
         {
-            nwipe_log( NWIPE_LOG_WARNING, "nwipe_get_smart_data(): Failed to create stream to %s", smartctl_command );
+            strftime( value[idx], sizeof( value[idx] ), "%Y/%m/%d %H:%M:%S", p );
+        }
+    }
+
+    snprintf( line, sizeof( line ), "%-28s %-24s %-24s", "Read at", value[0], value[1] );
+    nwipe_smart_pdf_line( c, line, &y, &page_number );
 
-            set_return_value = 3;
+    for( idx = 0; idx < 2; idx++ )
+    {
+        if( s[idx]->source == NWIPE_SMART_NONE || s[idx]->health == -1 )
+        {
+            snprintf( value[idx], sizeof( value[idx] ), "-" );
         }
         else
         {
-            x = 50;  // left side of page
-            y = 630;  // top row of page
-            page_number = 2;
-
-            /* Create Page 2 of the report. This shows the drives smart data
-             */
-            page = pdf_append_page( pdf );
+            snprintf( value[idx], sizeof( value[idx] ), "%s", s[idx]->health ? "PASSED" : "FAILING" );
+        }
+    }
 
-            /* Create the header and footer for page 2, the start of the smart data */
-            snprintf( page_title, sizeof( page_title ), "Page %i - Smart Data", page_number );
-            create_header_and_footer( c, page_title );
+    snprintf( line, sizeof( line ), "%-28s %-24s %-24s", "Overall health", value[0], value[1] );
+    nwipe_smart_pdf_line( c, line, &y, &page_number );
 
-            /* Read the output a line at a time - output it. */
-            while( fgets( result, sizeof( result ) - 1, fp ) != NULL )
-            {
-                /* Convert the label, i.e everything before the ':' to lower case, it's required to
-                 * convert to lower case as smartctl seems to use inconsistent case when labeling
-                 * for serial number, i.e mostly it produces labels "Serial Number:" but occasionally
-                 * it produces a label "Serial number:" */
+    snprintf( line,
+              sizeof( line ),
+              "%-28s %-24s %-24s",
+              "Firmware",
+              c->smart_before.firmware[0] ? c->smart_before.firmware : "-",
+              c->smart_after.firmware[0] ? c->smart_after.firmware : "-" );
+    nwipe_smart_pdf_line( c, line, &y, &page_number );
 
-                idx = 0;
+    for( i = 0; i < 9; i++ )
+    {
+        if( values[0][i] < 0 && values[1][i] < 0 )
+        {
+            continue;
+        }
 
-                while( result[idx] != 0 && result[idx] != ':' )
-                {
-                    /* If upper case alpha character, change to lower case */
-                    if( result[idx] >= 'A' && result[idx] <= 'Z' )
-                    {
-                        result[idx] += 32;
-                    }
-                    idx++;
-                }
+        nwipe_smart_pdf_value( value[0], sizeof( value[0] ), s[0], values[0][i] );
+        nwipe_smart_pdf_value( value[1], sizeof( value[1] ), s[1], values[1][i] );
+        snprintf( line, sizeof( line ), "%-28s %-24s %-24s", labels[i], value[0], value[1] );
+        nwipe_smart_pdf_line( c, line, &y, &page_number );
+    }
 
-                if( nwipe_options.quiet == 1 )
-                {
-                    for( idx2 = 0; idx2 < 3; idx2++ )
-                    {
-                        if( strstr( result, &smartctl_labels_to_anonymize[idx2][0] ) )
-                        {
-                            if( ( pdata = strstr( result, ":" ) ) )
-                            {
-                                idx3 = 1;
-                                while( pdata[idx3] != 0 )
-                                {
-                                    if( pdata[idx3] != ' ' )
-                                    {
-                                        pdata[idx3] = 'X';
-                                    }
-                                    idx3++;
-                                }
-                            }
-                        }
-                    }
-                }
+    /* The attribute table of an ATA drive, the raw values before and after the wipe. */
+    if( c->smart_before.attributes == 0 && c->smart_after.attributes == 0 )
+    {
+        return 0;
+    }
 
-                pdf_set_font( pdf, "Courier" );
-                pdf_add_text( pdf, NULL, result, 8, x, y, PDF_BLACK );
-                y -= 9;
+    nwipe_smart_pdf_line( c, "", &y, &page_number );
+    snprintf( line,
+              sizeof( line ),
+              "%3s %-24s %-6s %5s %5s %6s  %-18s %-18s",
+              "ID#",
+              "ATTRIBUTE_NAME",
+              "FLAG",
+              "VALUE",
+              "WORST",
+              "THRESH",
+              "RAW_VALUE BEFORE",
+              "RAW_VALUE AFTER" );
+    nwipe_smart_pdf_line( c, line, &y, &page_number );
+
+    /* The table lists the attributes after the wipe, or before if it couldn't be read again. */
+    idx = c->smart_after.attributes > 0 ? 1 : 0;
+
+    for( i = 0; i < s[idx]->attributes; i++ )
+    {
+        a = &s[idx]->attribute[i];
+        b = NULL;
 
-                /* Have we reached the bottom of the page yet */
-                if( y < 60 )
-                {
-                    /* Append an extra page */
-                    page = pdf_append_page( pdf );
-                    page_number++;
-                    y = 630;
-
-                    /* create the header and footer for the next page */
-                    snprintf( page_title, sizeof( page_title ), "Page %i - Smart Data", page_number );
-                    create_header_and_footer( c, page_title );
-                }
+        /* The same attribute of the other read. */
+        for( j = 0; j < s[1 - idx]->attributes; j++ )
+        {
+            if( s[1 - idx]->attribute[j].id == a->id )
+            {
+                b = &s[1 - idx]->attribute[j];
+                break;
             }
-            set_return_value = 0;
         }
+
+        snprintf( raw[idx], sizeof( raw[idx] ), "%llu", a->raw );
+
+        if( b != NULL )
+        {
+            snprintf( raw[1 - idx], sizeof( raw[1 - idx] ), "%llu", b->raw );
+        }
+        else
+        {
+            snprintf( raw[1 - idx], sizeof( raw[1 - idx] ), "-" );
+        }
+
+        snprintf( line,
+                  sizeof( line ),
+                  "%3i %-24s 0x%04x %5i %5i %6i  %-18s %-18s",
+                  a->id,
+                  nwipe_smart_attribute_name( a->id ),
+                  a->flags,
+                  a->value,
+                  a->worst,
+                  a->threshold,
+                  raw[0],
+                  raw[1] );
+        nwipe_smart_pdf_line( c, line, &y, &page_number );
     }
-    else
-    {
-        set_return_value = 1;
-    }
-    return set_return_value;
-}
+
+    return 0;
+
+} /* nwipe_get_smart_data */
 
 void create_header_and_footer( nwipe_context_t* c, char* page_title )
 {
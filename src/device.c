@@ -27,6 +27,9 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "nwipe.h"
 #include "context.h"
@@ -43,14 +46,169 @@
 #include <ctype.h>
 #include "hpa_dco.h"
 #include "miscellaneous.h"
+#include "sgio.h"
 
 #include <parted/parted.h>
 #include <parted/debug.h>
 
-int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount );
+nwipe_context_t* check_device( PedDevice* dev );
 char* trim( char* str );
 
 extern int terminate_signal;
+extern int global_wipe_status;
+
+/* The probe of one device, which runs in its own thread. */
+typedef struct nwipe_device_probe_t_
+{
+    PedDevice* dev;  // The device found by libparted.
+    nwipe_context_t* c;  // The context of the device, NULL if it is not wiped.
+    pthread_t thread;  // The thread.
+    int done;  // Set when the probe has finished.
+    int abandoned;  // Set when the probe took too long, the thread then frees the probe.
+    nwipe_log_buffer_t log;  // The messages of the probe, logged together once it has finished.
+} nwipe_device_probe_t;
+
+static pthread_mutex_t nwipe_device_probe_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nwipe_device_probe_done = PTHREAD_COND_INITIALIZER;
+
+static void* nwipe_device_probe_thread( void* ptr )
+{
+    nwipe_device_probe_t* probe = (nwipe_device_probe_t*) ptr;
+    nwipe_context_t* c;
+
+    /* The probes run at the same time, so the messages of each are kept together. */
+    nwipe_log_defer( &probe->log );
+    c = check_device( probe->dev );
+    nwipe_log_defer( NULL );
+
+    pthread_mutex_lock( &nwipe_device_probe_mutex );
+
+    if( probe->abandoned )
+    {
+        /* The scan has moved on without this device. */
+        pthread_mutex_unlock( &nwipe_device_probe_mutex );
+        nwipe_log_flush( &probe->log );
+        free( c );
+        free( probe );
+        return NULL;
+    }
+
+    probe->c = c;
+    probe->done = 1;
+    pthread_cond_broadcast( &nwipe_device_probe_done );
+    pthread_mutex_unlock( &nwipe_device_probe_mutex );
+
+    return NULL;
+
+} /* nwipe_device_probe_thread */
+
+static int nwipe_device_probe_all( nwipe_context_t*** c, PedDevice** devs, int count )
+{
+    /**
+     * Probes the devices concurrently, each in its own thread, so that slow devices don't
+     * hold up the others. A device that hasn't been probed within NWIPE_KNOB_PROBE_TIMEOUT
+     * seconds, e.g. behind a hung USB bridge, is left out.
+     *
+     * @returns  The number of devices in the array of contexts, in the order they were found.
+     */
+
+    nwipe_device_probe_t** probe;
+    struct timespec deadline;
+    int dcount = 0;
+    int i;
+    int r;
+
+    probe = calloc( count, sizeof( nwipe_device_probe_t* ) );
+
+    if( count > 0 && !probe )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to create the array of enumeration contexts." );
+        return 0;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        probe[i] = calloc( 1, sizeof( nwipe_device_probe_t ) );
+
+        if( !probe[i] )
+        {
+            nwipe_perror( errno, __FUNCTION__, "calloc" );
+            continue;
+        }
+
+        probe[i]->dev = devs[i];
+        r = pthread_create( &probe[i]->thread, NULL, nwipe_device_probe_thread, probe[i] );
+
+        if( r != 0 )
+        {
+            /* Probe it here instead. */
+            nwipe_perror( r, __FUNCTION__, "pthread_create" );
+            probe[i]->c = check_device( devs[i] );
+            probe[i]->done = 1;
+            probe[i]->thread = 0;
+        }
+        else
+        {
+            pthread_detach( probe[i]->thread );
+        }
+    }
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += NWIPE_KNOB_PROBE_TIMEOUT;
+
+    pthread_mutex_lock( &nwipe_device_probe_mutex );
+
+    for( i = 0; i < count; i++ )
+    {
+        if( !probe[i] )
+        {
+            continue;
+        }
+
+        r = 0;
+
+        while( !probe[i]->done && r == 0 && terminate_signal != 1 )
+        {
+            r = pthread_cond_timedwait( &nwipe_device_probe_done, &nwipe_device_probe_mutex, &deadline );
+        }
+
+        if( !probe[i]->done )
+        {
+            nwipe_log( NWIPE_LOG_WARNING,
+                       "%s did not respond within %i seconds and is left out.",
+                       devs[i]->path,
+                       NWIPE_KNOB_PROBE_TIMEOUT );
+            probe[i]->abandoned = 1;
+            continue;
+        }
+
+        /* The messages of the devices are logged in the order the devices were found. */
+        nwipe_log_flush( &probe[i]->log );
+
+        /* to have some progress indication. can help if there are many/slow disks, but not once
+         * the status window is up and a station probes the drives that are plugged in. */
+        if( global_wipe_status == 0 )
+        {
+            fprintf( stderr, "." );
+        }
+
+        if( probe[i]->c != NULL )
+        {
+            *c = realloc( *c, ( dcount + 1 ) * sizeof( nwipe_context_t* ) );
+            ( *c )[dcount++] = probe[i]->c;
+        }
+
+        free( probe[i] );
+    }
+
+    pthread_mutex_unlock( &nwipe_device_probe_mutex );
+
+    free( probe );
+
+    return dcount;
+
+} /* nwipe_device_probe_all */
 
 int nwipe_device_scan( nwipe_context_t*** c )
 {
@@ -64,26 +222,21 @@ int nwipe_device_scan( nwipe_context_t*** c )
      */
 
     PedDevice* dev = NULL;
-    ped_device_probe_all();
+    PedDevice** devs = NULL;
+    int count = 0;
+    int dcount;
 
-    int dcount = 0;
+    ped_device_probe_all();
 
     while( ( dev = ped_device_get_next( dev ) ) )
     {
-        /* to have some progress indication. can help if there are many/slow disks */
-        fprintf( stderr, "." );
-
-        if( check_device( c, dev, dcount ) )
-            dcount++;
-
-        /* Don't bother scanning drives if the terminate signal is active ! as in the case of
-         * the readlink program missing which is required if the --nousb option has been specified */
-        if( terminate_signal == 1 )
-        {
-            break;
-        }
+        devs = realloc( devs, ( count + 1 ) * sizeof( PedDevice* ) );
+        devs[count++] = dev;
     }
 
+    dcount = nwipe_device_probe_all( c, devs, count );
+    free( devs );
+
     /* Return the number of devices that were found. */
     return dcount;
 
@@ -92,15 +245,22 @@ int nwipe_device_scan( nwipe_context_t*** c )
 int nwipe_device_get( nwipe_context_t*** c, char** devnamelist, int ndevnames )
 {
     PedDevice* dev = NULL;
+    PedDevice** devs;
 
     int i;
-    int dcount = 0;
+    int count = 0;
+    int dcount;
 
-    for( i = 0; i < ndevnames; i++ )
+    devs = calloc( ndevnames, sizeof( PedDevice* ) );
+
+    if( ndevnames > 0 && !devs )
     {
-        /* to have some progress indication. can help if there are many/slow disks */
-        fprintf( stderr, "." );
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        return 0;
+    }
 
+    for( i = 0; i < ndevnames; i++ )
+    {
         dev = ped_device_get( devnamelist[i] );
         if( !dev )
         {
@@ -108,24 +268,25 @@ int nwipe_device_get( nwipe_context_t*** c, char** devnamelist, int ndevnames )
             continue;
         }
 
-        if( check_device( c, dev, dcount ) )
-            dcount++;
-
-        /* Don't bother scanning drives if the terminate signal is active ! as in the case of
-         * the readlink program missing which is required if the --nousb option has been specified */
-        if( terminate_signal == 1 )
-        {
-            break;
-        }
+        devs[count++] = dev;
     }
 
+    dcount = nwipe_device_probe_all( c, devs, count );
+    free( devs );
+
     /* Return the number of devices that were found. */
     return dcount;
 
 } /* nwipe_device_get */
 
-int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount )
+nwipe_context_t* check_device( PedDevice* dev )
 {
+    /**
+     * Identifies a device and creates its context, unless it is excluded.
+     *
+     * @returns  The context, or NULL if the device is not wiped.
+     */
+
     /* Populate this struct, then assign it to overall array of structs. */
     nwipe_context_t* next_device;
     int fd;
@@ -145,7 +306,7 @@ int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount )
         if( !strcmp( dev->path, nwipe_options.exclude[idx++] ) )
         {
             nwipe_log( NWIPE_LOG_NOTICE, "Device %s excluded as per command line option -e", dev->path );
-            return 0;
+            return NULL;
         }
     }
 
@@ -159,36 +320,20 @@ int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount )
         r = nwipe_get_device_bus_type_and_serialno( dev->path, &bus, &is_ssd, tmp_serial );
 
         /* See nwipe_get_device_bus_type_and_serialno() function for meaning of these codes */
-        if( r == 0 || ( r >= 3 && r <= 6 ) )
+        if( ( r == 0 || r == 5 ) && bus == NWIPE_DEVICE_USB )
         {
-            if( bus == NWIPE_DEVICE_USB )
-            {
-                nwipe_log( NWIPE_LOG_NOTICE, "Device %s ignored as per command line option --nousb", dev->path );
-                return 0;
-            }
-        }
-        else
-        {
-            if( r == 2 )
-            {
-                nwipe_log(
-                    NWIPE_LOG_NOTICE, "--nousb requires the 'readlink' program, please install readlink", dev->path );
-                terminate_signal = 1;
-                return 0;
-            }
+            nwipe_log( NWIPE_LOG_NOTICE, "Device %s ignored as per command line option --nousb", dev->path );
+            return NULL;
         }
     }
 
-    /* Try opening the device to see if it's valid. Close on completion. */
-    if( !ped_device_open( dev ) )
+    /* Try opening the device to see if it's valid. libparted isn't thread safe, so it's opened directly. */
+    if( ( fd = open( dev->path, O_RDONLY | O_NONBLOCK ) ) < 0 )
     {
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to open device" );
-        return 0;
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to open device %s", dev->path );
+        return NULL;
     }
-    ped_device_close( dev );
-
-    /* New device, reallocate memory for additional struct pointer */
-    *c = realloc( *c, ( dcount + 1 ) * sizeof( nwipe_context_t* ) );
+    close( fd );
 
     next_device = malloc( sizeof( nwipe_context_t ) );
 
@@ -197,7 +342,7 @@ int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount )
     {
         nwipe_perror( errno, __FUNCTION__, "malloc" );
         nwipe_log( NWIPE_LOG_FATAL, "Unable to create the array of enumeration contexts." );
-        return 0;
+        return NULL;
     }
 
     /* Zero the allocation. */
@@ -237,6 +382,7 @@ int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount )
     Determine_C_B_nomenclature( next_device->device_size, next_device->device_size_txt, NWIPE_DEVICE_SIZE_TXT_LENGTH );
     next_device->device_size_text = next_device->device_size_txt;
     next_device->result = -2;
+    next_device->event_fd = -1;
 
     /* Attempt to get serial number of device.
      */
@@ -431,8 +577,7 @@ int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount )
     /* print an empty line to separate the drives in the log */
     nwipe_log( NWIPE_LOG_INFO, " " );
 
-    ( *c )[dcount] = next_device;
-    return 1;
+    return next_device;
 }
 
 /* Remove leading/trailing whitespace from a string and left justify result */
@@ -488,6 +633,38 @@ char* trim( char* str )
     return str;
 }
 
+static void nwipe_device_sysfs_read( const char* name, const char* file, char* value, size_t size )
+{
+    /**
+     * Reads the first line of a sysfs attribute of a block device, e.g. queue/rotational,
+     * without the trailing newline and spaces. The value is empty if it can't be read.
+     */
+
+    char filename[FILENAME_MAX];
+    FILE* fp;
+
+    value[0] = 0;
+    snprintf( filename, sizeof( filename ), "/sys/block/%s/%s", name, file );
+
+    fp = fopen( filename, "r" );
+
+    if( fp == NULL )
+    {
+        return;
+    }
+
+    if( fgets( value, size, fp ) == NULL )
+    {
+        value[0] = 0;
+    }
+
+    fclose( fp );
+
+    strip_CR_LF( value );
+    trim( value );
+
+} /* nwipe_device_sysfs_read */
+
 int nwipe_get_device_bus_type_and_serialno( char* device, nwipe_device_t* bus, int* is_ssd, char* serialnumber )
 {
     /* The caller provides a string that contains the device, i.e. /dev/sdc, also a pointer
@@ -497,428 +674,321 @@ int nwipe_get_device_bus_type_and_serialno( char* device, nwipe_device_t* bus, i
      * The function populates the bus integer and serial number strings for the given device.
      * Results for bus would typically be ATA or USB see nwipe_device_t in context.h
      *
+     * The bus and whether the device is rotational come from sysfs, the serial number from sysfs
+     * for NVMe and MMC devices, otherwise from the ATA IDENTIFY data, which USB bridges pass
+     * through to the drive behind them, or from the unit serial number page of a SCSI device.
+     * No external programs are run, so devices can be probed in parallel.
+     *
      * Return Values:
      * 0 = Success
-     * 1 = popen failed to create stream for readlink
-     * 2 = readlink exit code not 0, see nwipe logs
-     * 3 = popen failed to create stream for smartctl
-     * 4 = smartctl command not found, install smartmontools
-     * 5 = smartctl detected unsupported USB to IDE/SATA adapter
-     * 6 = All other errors !
+     * 1 = The device is not in /sys/block, e.g. a file or a partition
+     * 5 = The serial number of a USB or MMC device is not available
      *
      */
 
-    FILE* fp;
+    /* The name of the device without /dev/, its sysfs link, and the path the link points to. */
+    const char* name;
+    char link[FILENAME_MAX];
+    char path[PATH_MAX];
 
-    int r;  // A result buffer.
-    int idx_src;
-    int idx_dest;
-    int device_len;
-    int set_return_value;
-    int exit_status;
-    int idx;
-    int idx2;
-
-    char readlink_command[] = "readlink /sys/block/%s";
-    char readlink_command2[] = "/usr/bin/readlink /sys/block/%s";
-    char readlink_command3[] = "/sbin/readlink /sys/block/%s";
-    char smartctl_command[] = "smartctl -i %s";
-    char smartctl_command2[] = "/sbin/smartctl -i %s";
-    char smartctl_command3[] = "/usr/bin/smartctl -i %s";
-    char smartctl_command4[] = "/usr/sbin/smartctl -i %s";
-    char device_shortform[50];
-    char result[512];
-    char final_cmd_readlink[sizeof( readlink_command ) + sizeof( device_shortform )];
-    char final_cmd_smartctl[sizeof( smartctl_command ) + 256];
-    char* pResult;
-    char smartctl_labels_to_anonymize[][18] = {
-        "serial number:", "lu wwn device id:", "logical unit id:", "" /* Don't remove this empty string !, important */
-    };
-
-    /* Initialise return value */
-    set_return_value = 0;
+    /* A sysfs attribute, and the serial number as read before it is truncated. */
+    char value[64];
+    char serial[NWIPE_SG_SECTOR];
+
+    /* The IDENTIFY, INQUIRY and vital product data. */
+    unsigned char data[NWIPE_SG_SECTOR];
+    int length;
+
+    int fd;
 
     *bus = 0;
+    *is_ssd = 0;
+    serialnumber[0] = 0;
+    serial[0] = 0;
 
-    /* Scan device name and if device is for instance /dev/sdx then convert to sdx
-     * If already sdx then just copy. */
+    name = strrchr( device, '/' );
+    name = name != NULL ? name + 1 : device;
 
-    idx_dest = 0;
-    device_shortform[idx_dest] = 0;
-    device_len = strlen( device );
-    idx_src = device_len;
+    snprintf( link, sizeof( link ), "/sys/block/%s", name );
 
-    while( idx_src >= 0 )
+    if( realpath( link, path ) == NULL )
     {
-        if( device[idx_src] == '/' || idx_src == 0 )
-        {
-            idx_src++;
-
-            /* Now scan forwards copying the short form device i.e sdc */
-            while( idx_src < device_len )
-            {
-                device_shortform[idx_dest++] = device[idx_src++];
-            }
-            break;
-        }
-        else
-        {
-            idx_src--;
-        }
+        return 1;
     }
-    device_shortform[idx_dest] = 0;
-
-    final_cmd_readlink[0] = 0;
 
-    /* Determine whether we can access readlink, required if the PATH environment is not setup ! (Debian sid 'su' as
-     * opposed to 'su -' */
-    if( system( "which readlink > /dev/null 2>&1" ) )
+    if( nwipe_options.verbose )
     {
-        if( system( "which /sbin/readlink > /dev/null 2>&1" ) )
-        {
-            if( system( "which /usr/bin/readlink > /dev/null 2>&1" ) )
-            {
-                nwipe_log( NWIPE_LOG_WARNING, "Command not found. Install readlink !" );
-                set_return_value = 2;
+        nwipe_log( NWIPE_LOG_DEBUG, "sysfs: %s", path );
+    }
 
-                /* Return immediately if --nousb specified. Readlink is a requirement for this option. */
-                if( nwipe_options.nousb )
-                {
-                    return set_return_value;
-                }
-            }
-            else
-            {
-                sprintf( final_cmd_readlink, readlink_command3, device_shortform );
-            }
-        }
-        else
-        {
-            sprintf( final_cmd_readlink, readlink_command2, device_shortform );
-        }
+    /* Scan the sysfs path for bus types, i.e. USB or ATA
+     * Example:
+     * /sys/devices/pci0000:00/0000:00:1d.0/usb2/2-1/2-1.3/2-1.3:1.0/host6/target6:0:0/6:0:0:0/block/sdd
+     */
+    if( strstr( path, "/usb" ) != 0 )
+    {
+        *bus = NWIPE_DEVICE_USB;
     }
-    else
+    else if( strstr( path, "/ata" ) != 0 )
     {
-        sprintf( final_cmd_readlink, readlink_command, device_shortform );
+        *bus = NWIPE_DEVICE_ATA;
     }
-
-    if( final_cmd_readlink[0] != 0 )
+    else if( strstr( path, "/nvme/" ) != 0 )
+    {
+        *bus = NWIPE_DEVICE_NVME;
+    }
+    else if( strstr( path, "/virtual/" ) != 0 )
+    {
+        *bus = NWIPE_DEVICE_VIRT;
+    }
+    else if( strstr( path, "/mmcblk" ) != 0 )
     {
+        *bus = NWIPE_DEVICE_MMC;
+    }
+    else if( strstr( path, "/end_device-" ) != 0 || strstr( path, "/expander-" ) != 0 )
+    {
+        /* Behind a SAS HBA, a SATA drive is told apart by its INQUIRY data below. */
+        *bus = NWIPE_DEVICE_SAS;
+    }
 
-        fp = popen( final_cmd_readlink, "r" );
+    if( *bus != NWIPE_DEVICE_VIRT )
+    {
+        nwipe_device_sysfs_read( name, "queue/rotational", value, sizeof( value ) );
 
-        if( fp == NULL )
+        if( strcmp( value, "0" ) == 0 )
         {
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "nwipe_get_device_bus_type_and_serialno: Failed to create stream to %s",
-                       readlink_command );
-
-            set_return_value = 1;
+            *is_ssd = 1;
         }
+    }
 
-        if( fp != NULL )
+    /* NVMe and MMC devices publish their serial numbers. */
+    nwipe_device_sysfs_read( name, "device/serial", serial, sizeof( serial ) );
+
+    if( serial[0] == 0 && *bus != NWIPE_DEVICE_NVME && *bus != NWIPE_DEVICE_VIRT && *bus != NWIPE_DEVICE_MMC )
+    {
+        fd = open( device, O_RDONLY | O_NONBLOCK );
+
+        if( fd >= 0 )
         {
-            /* Read the output a line at a time - output it. */
-            if( fgets( result, sizeof( result ) - 1, fp ) != NULL )
+            if( nwipe_sg_ata_identify( fd, data ) == 0 )
             {
-                if( nwipe_options.verbose )
-                {
-                    strip_CR_LF( result );
-                    nwipe_log( NWIPE_LOG_DEBUG, "Readlink: %s", result );
-                }
-
-                /* Scan the readlink results for bus types, i.e. USB or ATA
-                 * Example: readlink
-                 * /sys/block/sdd../devices/pci0000:00/0000:00:1d.0/usb2/2-1/2-1.3/2-1.3:1.0/host6/target6:0:0/6:0:0:0/block/sdd
-                 */
+                /* Words 10-19 are the serial number, word 217 is 1 for a device that doesn't rotate. */
+                nwipe_sg_ata_string( data, 10, 10, serial );
 
-                if( strstr( result, "/usb" ) != 0 )
+                if( data[434] == 1 && data[435] == 0 )
                 {
-                    *bus = NWIPE_DEVICE_USB;
-                }
-                else
-                {
-                    if( strstr( result, "/ata" ) != 0 )
-                    {
-                        *bus = NWIPE_DEVICE_ATA;
-                    }
-                    else
-                    {
-                        if( strstr( result, "/nvme/" ) != 0 )
-                        {
-                            *bus = NWIPE_DEVICE_NVME;
-                        }
-                        else
-                        {
-                            if( strstr( result, "/virtual/" ) != 0 )
-                            {
-                                *bus = NWIPE_DEVICE_VIRT;
-                            }
-                            else
-                            {
-                                if( strstr( result, "/mmcblk" ) != 0 )
-                                {
-                                    *bus = NWIPE_DEVICE_MMC;
-                                }
-                            }
-                        }
-                    }
+                    *is_ssd = 1;
                 }
             }
-            /* close */
-            r = pclose( fp );
 
-            if( r > 0 )
+            if( nwipe_sg_inquiry( fd, -1, data, 36 ) == 0 && *bus == NWIPE_DEVICE_SAS
+                && strncmp( (char*) &data[8], "ATA     ", 8 ) == 0 )
             {
-                exit_status = WEXITSTATUS( r );
-                if( nwipe_options.verbose )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING,
-                               "nwipe_get_device_bus_type_and_serialno(): readlink failed, \"%s\" exit status = %u",
-                               final_cmd_readlink,
-                               exit_status );
-                }
+                /* A SATA drive translated by the HBA. */
+                *bus = NWIPE_DEVICE_ATA;
+            }
 
-                if( exit_status == 127 )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Command not found. Install Readlink recommended !" );
-                    set_return_value = 2;
-                    if( nwipe_options.nousb )
-                    {
-                        return set_return_value;
-                    }
-                }
+            if( serial[0] == 0 && nwipe_sg_inquiry( fd, 0x80, data, 255 ) == 0 )
+            {
+                /* The unit serial number page, its length fits in the buffer. */
+                length = data[3];
+                memcpy( serial, &data[4], length );
+                serial[length] = 0;
+                trim( serial );
             }
-        }
-    }
 
-    /*
-     * Retrieve smartmontools drive information if USB bridge supports it, so we can retrieve the serial number of the
-     * drive that's on the other side of the USB bridge.. */
+            if( nwipe_sg_inquiry( fd, 0xb1, data, 64 ) == 0 && data[4] == 0 && data[5] == 1 )
+            {
+                /* The block device characteristics page, a medium rotation rate of 1 is a non-rotating medium. */
+                *is_ssd = 1;
+            }
 
-    final_cmd_smartctl[0] = 0;
+            close( fd );
+        }
+    }
 
-    /* Determine whether we can access smartctl, required if the PATH environment is not setup ! (Debian sid 'su' as
-     * opposed to 'su -' */
-    if( system( "which smartctl > /dev/null 2>&1" ) )
+    if( serial[0] == 0 )
     {
-        if( system( "which /sbin/smartctl > /dev/null 2>&1" ) )
+        if( *bus == NWIPE_DEVICE_USB || *bus == NWIPE_DEVICE_MMC )
         {
-            if( system( "which /usr/bin/smartctl > /dev/null 2>&1" ) )
-            {
-                if( system( "which /usr/sbin/smartctl > /dev/null 2>&1" ) )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Command not found. Install smartmontools !" );
-                }
-                else
-                {
-                    sprintf( final_cmd_smartctl, smartctl_command4, device );
-                }
-            }
-            else
-            {
-                sprintf( final_cmd_smartctl, smartctl_command3, device );
-            }
+            strcpy( serialnumber, "(S/N: unknown)" );
+            return 5;
         }
-        else
+
+        return 0;
+    }
+
+    strncpy( serialnumber, serial, NWIPE_SERIALNUMBER_LENGTH );
+    serialnumber[NWIPE_SERIALNUMBER_LENGTH] = 0;
+
+    return 0;
+}
+
+void remove_ATA_prefix( char* str )
+{
+    /* Remove "ATA" prefix if present in the model no. string, left justifing string */
+
+    int idx_pre = 4;
+    int idx_post = 0;
+
+    if( !strncmp( str, "ATA ", 4 ) )
+    {
+        while( str[idx_pre] != 0 )
         {
-            sprintf( final_cmd_smartctl, smartctl_command2, device );
+            str[idx_post++] = str[idx_pre++];
         }
+
+        str[idx_post] = 0;
     }
-    else
+}
+
+size_t nwipe_device_io_align( nwipe_context_t* c )
+{
+    /**
+     * Determines the alignment of direct I/O buffers, offsets and lengths. The physical
+     * sector size is used so that writes never cause a read-modify-write.
+     *
+     * @parameter c  The device context, with the sector sizes already determined.
+     * @returns      The alignment in bytes, at least 512.
+     */
+
+    size_t align = 512;
+
+    if( c->device_sector_size > 0 && (size_t) c->device_sector_size > align )
     {
-        sprintf( final_cmd_smartctl, smartctl_command, device );
+        align = c->device_sector_size;
     }
 
-    if( final_cmd_smartctl[0] != 0 )
+    if( c->device_phys_sector_size > 0 && (size_t) c->device_phys_sector_size > align )
     {
-        fp = popen( final_cmd_smartctl, "r" );
+        align = c->device_phys_sector_size;
+    }
 
-        if( fp == NULL )
-        {
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "nwipe_get_device_bus_type_and_serialno(): Failed to create stream to %s",
-                       smartctl_command );
+    return align;
 
-            set_return_value = 3;
-        }
-        else
-        {
-            /* Read the output a line at a time - output it. */
-            while( fgets( result, sizeof( result ) - 1, fp ) != NULL )
-            {
-                /* Convert the label, i.e everything before the ':' to lower case, it's required to
-                 * convert to lower case as smartctl seems to use inconsistent case when labeling
-                 * for serial number, i.e mostly it produces labels "Serial Number:" but occasionally
-                 * it produces a label "Serial number:" */
+} /* nwipe_device_io_align */
 
-                idx = 0;
-                while( result[idx] != 0 && result[idx] != ':' )
-                {
-                    /* If upper case alpha character, change to lower case */
-                    if( result[idx] >= 'A' && result[idx] <= 'Z' )
-                    {
-                        result[idx] = tolower( result[idx] );
-                    }
+size_t nwipe_device_io_size( nwipe_context_t* c )
+{
+    /**
+     * Determines the size of the reads and writes issued by the pass routines.
+     *
+     * Unless the user has specified --io-size, the size is derived from the optimal I/O size
+     * (BLKIOOPT) and the largest request the block layer will issue (max_sectors_kb), so that
+     * each write maps onto a small number of whole requests. The result is always a multiple
+     * of the device block size and no larger than NWIPE_KNOB_IO_SIZE_MAX.
+     *
+     * @parameter c  The device context, the device must already be open and stat'ed.
+     * @returns      The I/O size in bytes.
+     */
 
-                    idx++;
-                }
+    char sysfs_path[FILENAME_MAX];
+    FILE* fp;
 
-                if( nwipe_options.verbose && result[0] != 0x0A )
-                {
-                    strip_CR_LF( result );
-
-                    /* Remove serial number if -q option specified */
-                    if( nwipe_options.quiet )
-                    {
-                        /* initialise index into string array */
-                        idx2 = 0;
-
-                        while( smartctl_labels_to_anonymize[idx2][0] != 0 )
-                        {
-                            if( ( pResult = strstr( result, &smartctl_labels_to_anonymize[idx2][0] ) ) != 0 )
-                            {
-                                /* set index to character after end of label string */
-                                idx = strlen( &smartctl_labels_to_anonymize[idx2][0] );
-
-                                /* Ignore spaces, overwrite other characters */
-                                while( *( pResult + idx ) != 0x0A && *( pResult + idx ) != 0x0D
-                                       && *( pResult + idx ) != 0 && idx <= sizeof( result ) - 1 )
-                                {
-                                    if( *( pResult + idx ) == ' ' )
-                                    {
-                                        idx++;
-                                        continue;
-                                    }
-                                    else
-                                    {
-                                        /* ignore if the serial number has been written over with '?' */
-                                        if( *( pResult + idx ) != '?' )
-                                        {
-                                            *( pResult + idx ) = 'X';
-                                        }
-                                        idx++;
-                                    }
-                                }
-                            }
-                            idx2++;
-                        }
-                    }
-
-                    nwipe_log( NWIPE_LOG_INFO, "smartctl: %s", result );
-                }
+    /* The granularity of the I/O size. */
+    size_t granularity;
 
-                if( strstr( result, "serial number:" ) != 0 )
-                {
-                    /* strip any leading or trailing spaces and left justify, +15 is the length of "Serial Number:" */
-                    trim( &result[15] );
+    /* The result. */
+    size_t io_size;
 
-                    strncpy( serialnumber, &result[15], NWIPE_SERIALNUMBER_LENGTH );
-                    serialnumber[NWIPE_SERIALNUMBER_LENGTH] = 0;
-                }
+    /* The optimal I/O size reported by the driver, often zero. */
+    unsigned int io_opt = 0;
 
-                if( *bus == 0 )
-                {
-                    if( strstr( result, "transport protocol:" ) != 0 )
-                    {
-                        /* strip any leading or trailing spaces and left justify, +4 is the length of "bus type:" */
-                        trim( &result[19] );
-                        for( idx = 19; result[idx]; idx++ )
-                        {
-                            result[idx] = tolower( result[idx] );
-                        }
-
-                        if( strncmp( &result[19], "sas", 3 ) == 0 )
-                        {
-                            *bus = NWIPE_DEVICE_SAS;
-                        }
-                    }
-
-                    if( strstr( result, "sata version is:" ) != 0 )
-                    {
-
-                        /* strip any leading or trailing spaces and left justify, +4 is the length of "bus type:" */
-                        trim( &result[16] );
-                        for( idx = 16; result[idx]; idx++ )
-                        {
-                            result[idx] = tolower( result[idx] );
-                        }
-
-                        if( strncmp( &result[16], "sata", 4 ) == 0 )
-                        {
-                            *bus = NWIPE_DEVICE_ATA;
-                        }
-                    }
-                }
-                if( strstr( result, "rotation rate:" ) != 0 )
-                {
-                    /* strip any leading or trailing spaces and left justify, +15 is the length of "Rotation Rate:" */
-                    trim( &result[15] );
-                    for( idx = 15; result[idx]; idx++ )
-                    {
-                        result[idx] = tolower( result[idx] );
-                    }
-
-                    if( strncmp( &result[15], "solid state device", 19 ) == 0 )
-                    {
-                        *is_ssd = 1;
-                    }
-                }
-            }
+    /* The device name without /dev/. */
+    const char* name;
 
-            /* close */
-            r = pclose( fp );
+    /* The maximum request size of the block queue. */
+    unsigned long max_sectors_kb = 0;
+    size_t max_request;
 
-            if( r > 0 )
-            {
-                exit_status = WEXITSTATUS( r );
-                if( nwipe_options.verbose && exit_status != 1 )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING,
-                               "nwipe_get_device_bus_type_and_serialno(): smartctl failed, \"%s\" exit status = %u",
-                               final_cmd_smartctl,
-                               exit_status );
-                }
-                set_return_value = 6;
+    granularity = c->device_stat.st_blksize > 0 ? (size_t) c->device_stat.st_blksize : 512;
 
-                if( exit_status == 127 )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Command not found. Install Smartctl recommended !" );
+    /* Direct I/O requires whole physical sectors. */
+    if( c->device_io_align > granularity )
+    {
+        granularity = c->device_io_align;
+    }
 
-                    set_return_value = 4;
-                }
+    if( nwipe_options.io_size )
+    {
+        io_size = nwipe_options.io_size;
+    }
+    else
+    {
+        io_size = NWIPE_KNOB_IO_SIZE;
 
-                if( exit_status == 1 )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Smartctl is unable to provide smart data for %s", device );
+        if( ioctl( c->device_fd, BLKIOOPT, &io_opt ) == 0 && io_opt > 0 && io_opt % granularity == 0 )
+        {
+            /* RAID volumes and some SSDs report a preferred request size, keep writes a whole multiple of it. */
+            granularity = io_opt;
+        }
 
-                    if( *bus == NWIPE_DEVICE_USB || *bus == NWIPE_DEVICE_MMC )
-                    {
-                        strcpy( serialnumber, "(S/N: unknown)" );
-                        set_return_value = 5;
-                    }
-                }
+        /* device_name_without_path is padded for the GUI, the block device is named after the basename. */
+        name = strrchr( c->device_name, '/' );
+        snprintf( sysfs_path,
+                  sizeof( sysfs_path ),
+                  "/sys/class/block/%s/queue/max_sectors_kb",
+                  name != NULL ? name + 1 : c->device_name );
+
+        fp = fopen( sysfs_path, "r" );
+        if( fp != NULL )
+        {
+            if( fscanf( fp, "%lu", &max_sectors_kb ) != 1 )
+            {
+                max_sectors_kb = 0;
             }
+            fclose( fp );
         }
-    }
 
-    return set_return_value;
-}
+        if( max_sectors_kb == 0 && nwipe_options.verbose )
+        {
+            nwipe_log( NWIPE_LOG_DEBUG,
+                       "Unable to read %s, the I/O size of %s ignores its request limit.",
+                       sysfs_path,
+                       c->device_name );
+        }
 
-void remove_ATA_prefix( char* str )
-{
-    /* Remove "ATA" prefix if present in the model no. string, left justifing string */
+        if( max_sectors_kb > 0 )
+        {
+            max_request = max_sectors_kb * 1024;
 
-    int idx_pre = 4;
-    int idx_post = 0;
+            /* Use at least one whole request, otherwise a whole number of requests. */
+            if( max_request >= io_size )
+            {
+                io_size = max_request;
+            }
+            else
+            {
+                io_size = ( ( io_size + max_request - 1 ) / max_request ) * max_request;
+            }
+        }
 
-    if( !strncmp( str, "ATA ", 4 ) )
+        /* Round up to the granularity. */
+        io_size = ( ( io_size + granularity - 1 ) / granularity ) * granularity;
+    }
+
+    if( io_size > NWIPE_KNOB_IO_SIZE_MAX )
     {
-        while( str[idx_pre] != 0 )
-        {
-            str[idx_post++] = str[idx_pre++];
-        }
+        io_size = NWIPE_KNOB_IO_SIZE_MAX;
+    }
 
-        str[idx_post] = 0;
+    /* The pass routines account for errors in units of st_blksize, so the I/O size must be a multiple of it. */
+    io_size -= io_size % granularity;
+
+    if( io_size < granularity )
+    {
+        io_size = granularity;
     }
+
+    if( nwipe_options.io_size && io_size != nwipe_options.io_size )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "%s: I/O size %zu is not a multiple of the block size %zu, using %zu bytes.",
+                   c->device_name,
+                   nwipe_options.io_size,
+                   granularity,
+                   io_size );
+    }
+
+    return io_size;
 }
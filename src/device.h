@@ -42,6 +42,8 @@ int nwipe_device_get( nwipe_context_t*** c, char** devnamelist, int ndevnames );
 
 int nwipe_get_device_bus_type_and_serialno( char*, nwipe_device_t*, int*, char* );
 void strip_CR_LF( char* );
+size_t nwipe_device_io_align( nwipe_context_t* c );  // Determine the alignment required by O_DIRECT.
+size_t nwipe_device_io_size( nwipe_context_t* c );  // Determine the read/write size used by the passes.
 void determine_disk_capacity_nomenclature( u64, char* );
 void remove_ATA_prefix( char* );
 char* trim( char* );
@@ -0,0 +1,333 @@
+/*
+ *  events.c: The event loop of the main thread.
+ *
+ *  The main thread used to check on the wipes once a second, and the other
+ *  threads slept in steps of a second or less to notice that nwipe was
+ *  shutting down. Instead the main thread waits in epoll for what it has to
+ *  act on: an eventfd per wipe, written by the wipe thread when it finishes,
+ *  an eventfd the other threads write to wake it up, and a timerfd for the
+ *  periodic work, which is only armed while there is some. Another eventfd
+ *  is written when nwipe shuts down and never read, so that every thread
+ *  waiting on it wakes up at once and for good.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "nwipe.h"
+#include "context.h"
+#include "logging.h"
+#include "events.h"
+
+#define NWIPE_EVENTS_MAX 64  // The most events handled at each wake-up, the others are left for the next.
+
+extern int terminate_signal;
+
+static int nwipe_events_epoll = -1;
+static int nwipe_events_wake_fd = -1;
+static int nwipe_events_shutdown_fd = -1;
+static int nwipe_events_timer_fd = -1;
+
+/* The interval the timer is armed with, in seconds. */
+static int nwipe_events_interval = 0;
+
+static int nwipe_events_watch( int fd, void* ptr )
+{
+    /**
+     * Adds a file descriptor to the epoll instance, identified by the pointer in its events.
+     *
+     * @returns  0 on success, -1 on failure.
+     */
+
+    struct epoll_event event;
+
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = ptr;
+
+    if( epoll_ctl( nwipe_events_epoll, EPOLL_CTL_ADD, fd, &event ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "epoll_ctl" );
+        return -1;
+    }
+
+    return 0;
+
+} /* nwipe_events_watch */
+
+static void nwipe_events_signal( int fd )
+{
+    /* Adds one to the counter of an eventfd, which makes it readable. */
+    uint64_t value = 1;
+
+    if( fd >= 0 && write( fd, &value, sizeof( value ) ) != sizeof( value ) && errno != EAGAIN )
+    {
+        nwipe_perror( errno, __FUNCTION__, "write" );
+    }
+
+} /* nwipe_events_signal */
+
+static void nwipe_events_drain( int fd )
+{
+    /* Reads the counter of an eventfd or the expirations of a timerfd, which makes it unreadable. */
+    uint64_t value;
+
+    if( read( fd, &value, sizeof( value ) ) < 0 && errno != EAGAIN )
+    {
+        nwipe_perror( errno, __FUNCTION__, "read" );
+    }
+
+} /* nwipe_events_drain */
+
+int nwipe_events_init( void )
+{
+    nwipe_events_epoll = epoll_create1( EPOLL_CLOEXEC );
+    nwipe_events_wake_fd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    nwipe_events_shutdown_fd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    nwipe_events_timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK );
+
+    if( nwipe_events_epoll < 0 || nwipe_events_wake_fd < 0 || nwipe_events_shutdown_fd < 0
+        || nwipe_events_timer_fd < 0 || nwipe_events_watch( nwipe_events_wake_fd, &nwipe_events_wake_fd ) != 0
+        || nwipe_events_watch( nwipe_events_shutdown_fd, &nwipe_events_shutdown_fd ) != 0
+        || nwipe_events_watch( nwipe_events_timer_fd, &nwipe_events_timer_fd ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "epoll_create1" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to create the event loop, the wipes are checked on every second." );
+        nwipe_events_free();
+        return -1;
+    }
+
+    return 0;
+
+} /* nwipe_events_init */
+
+void nwipe_events_free( void )
+{
+    if( nwipe_events_timer_fd >= 0 )
+    {
+        close( nwipe_events_timer_fd );
+    }
+
+    if( nwipe_events_shutdown_fd >= 0 )
+    {
+        close( nwipe_events_shutdown_fd );
+    }
+
+    if( nwipe_events_wake_fd >= 0 )
+    {
+        close( nwipe_events_wake_fd );
+    }
+
+    if( nwipe_events_epoll >= 0 )
+    {
+        close( nwipe_events_epoll );
+    }
+
+    nwipe_events_timer_fd = -1;
+    nwipe_events_shutdown_fd = -1;
+    nwipe_events_wake_fd = -1;
+    nwipe_events_epoll = -1;
+    nwipe_events_interval = 0;
+
+} /* nwipe_events_free */
+
+int nwipe_events_wait( void )
+{
+    struct epoll_event events[NWIPE_EVENTS_MAX];
+    int result = 0;
+    int count;
+    int i;
+
+    if( nwipe_events_epoll < 0 )
+    {
+        /* Without the events, everything is checked on every second. */
+        sleep( 1 );
+        return NWIPE_EVENT_TIMER;
+    }
+
+    count = epoll_wait( nwipe_events_epoll, events, NWIPE_EVENTS_MAX, -1 );
+
+    if( count < 0 && errno != EINTR )
+    {
+        nwipe_perror( errno, __FUNCTION__, "epoll_wait" );
+        sleep( 1 );
+        return NWIPE_EVENT_TIMER;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( events[i].data.ptr == &nwipe_events_wake_fd )
+        {
+            nwipe_events_drain( nwipe_events_wake_fd );
+            result |= NWIPE_EVENT_WAKE;
+        }
+        else if( events[i].data.ptr == &nwipe_events_timer_fd )
+        {
+            nwipe_events_drain( nwipe_events_timer_fd );
+            result |= NWIPE_EVENT_TIMER;
+        }
+        else if( events[i].data.ptr == &nwipe_events_shutdown_fd )
+        {
+            /* Left readable, for the other threads. */
+            result |= NWIPE_EVENT_SHUTDOWN;
+        }
+        else
+        {
+            /* A wipe finishes once. */
+            nwipe_events_remove_wipe( (nwipe_context_t*) events[i].data.ptr );
+            result |= NWIPE_EVENT_WIPE;
+        }
+    }
+
+    return result;
+
+} /* nwipe_events_wait */
+
+void nwipe_events_timer( int seconds )
+{
+    struct itimerspec interval;
+
+    if( nwipe_events_timer_fd < 0 || seconds == nwipe_events_interval )
+    {
+        return;
+    }
+
+    memset( &interval, 0, sizeof( interval ) );
+    interval.it_value.tv_sec = seconds;
+    interval.it_interval.tv_sec = seconds;
+
+    if( timerfd_settime( nwipe_events_timer_fd, 0, &interval, NULL ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "timerfd_settime" );
+        return;
+    }
+
+    nwipe_events_interval = seconds;
+
+} /* nwipe_events_timer */
+
+void nwipe_events_wake( void )
+{
+    nwipe_events_signal( nwipe_events_wake_fd );
+
+} /* nwipe_events_wake */
+
+void nwipe_events_shutdown( void )
+{
+    nwipe_events_signal( nwipe_events_shutdown_fd );
+
+} /* nwipe_events_shutdown */
+
+void nwipe_events_add_wipe( nwipe_context_t* c )
+{
+    c->event_fd = -1;
+
+    if( nwipe_events_epoll < 0 )
+    {
+        return;
+    }
+
+    c->event_fd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+
+    if( c->event_fd < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "eventfd" );
+        return;
+    }
+
+    if( nwipe_events_watch( c->event_fd, c ) != 0 )
+    {
+        close( c->event_fd );
+        c->event_fd = -1;
+    }
+
+} /* nwipe_events_add_wipe */
+
+void nwipe_events_remove_wipe( nwipe_context_t* c )
+{
+    if( c->event_fd < 0 )
+    {
+        return;
+    }
+
+    epoll_ctl( nwipe_events_epoll, EPOLL_CTL_DEL, c->event_fd, NULL );
+    close( c->event_fd );
+    c->event_fd = -1;
+
+} /* nwipe_events_remove_wipe */
+
+void nwipe_events_wipe_done( nwipe_context_t* c )
+{
+    nwipe_events_signal( c->event_fd );
+
+} /* nwipe_events_wipe_done */
+
+int nwipe_events_sleep( int seconds )
+{
+    struct pollfd pfd;
+
+    if( nwipe_events_shutdown_fd < 0 )
+    {
+        sleep( seconds > 0 ? seconds : 1 );
+        return terminate_signal == 1;
+    }
+
+    pfd.fd = nwipe_events_shutdown_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    poll( &pfd, 1, seconds < 0 ? -1 : seconds * 1000 );
+
+    return terminate_signal == 1 || ( pfd.revents & POLLIN ) != 0;
+
+} /* nwipe_events_sleep */
+
+int nwipe_events_input( int fd, int milliseconds )
+{
+    struct pollfd pfd[2];
+
+    /* poll() skips the shutdown eventfd if there is none, terminate_signal is then checked every second. */
+    if( nwipe_events_shutdown_fd < 0 && ( milliseconds < 0 || milliseconds > 1000 ) )
+    {
+        milliseconds = 1000;
+    }
+
+    pfd[0].fd = fd;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd = nwipe_events_shutdown_fd;
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
+
+    if( poll( pfd, 2, milliseconds ) <= 0 )
+    {
+        return 0;
+    }
+
+    if( pfd[0].revents & ( POLLHUP | POLLERR | POLLNVAL ) )
+    {
+        return -1;
+    }
+
+    return ( pfd[0].revents & POLLIN ) != 0;
+
+} /* nwipe_events_input */
@@ -0,0 +1,97 @@
+/*
+ *  events.h: The event loop of the main thread.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+/* What woke the main thread up, or'ed together. */
+#define NWIPE_EVENT_WIPE 0x01  // A wipe thread has finished.
+#define NWIPE_EVENT_TIMER 0x02  // The timer has expired.
+#define NWIPE_EVENT_WAKE 0x04  // Another thread has something for the main thread, e.g. a drive plugged in.
+#define NWIPE_EVENT_SHUTDOWN 0x08  // nwipe is shutting down.
+
+/**
+ * Creates the epoll instance of the main thread and the eventfds and timerfd it waits on. It is
+ * called before any other thread is started.
+ *
+ * @returns  0 on success, -1 if the events are not available, the main thread then wakes up
+ *           every second instead.
+ */
+int nwipe_events_init( void );
+
+/**
+ * Closes the file descriptors of the events, once the other threads have stopped.
+ */
+void nwipe_events_free( void );
+
+/**
+ * Waits for the next events of the main thread.
+ *
+ * @returns  The NWIPE_EVENT_ bits of the events that occurred.
+ */
+int nwipe_events_wait( void );
+
+/**
+ * Arms the timer of the main thread to expire every given number of seconds, 0 disarms it.
+ */
+void nwipe_events_timer( int seconds );
+
+/**
+ * Wakes the main thread up, from any thread.
+ */
+void nwipe_events_wake( void );
+
+/**
+ * Wakes every thread waiting for an event up for good, once terminate_signal has been set.
+ */
+void nwipe_events_shutdown( void );
+
+/**
+ * Creates the eventfd the wipe thread of a device writes when it finishes, and adds it to the
+ * events of the main thread. It is called before the thread is created.
+ */
+void nwipe_events_add_wipe( nwipe_context_t* c );
+
+/**
+ * Removes the eventfd of a wipe from the events of the main thread and closes it. The main thread
+ * does this once the wipe has finished, or before it frees a context whose wipe was stopped.
+ */
+void nwipe_events_remove_wipe( nwipe_context_t* c );
+
+/**
+ * Tells the main thread that the wipe of a device has finished, from its wipe thread.
+ */
+void nwipe_events_wipe_done( nwipe_context_t* c );
+
+/**
+ * Waits for the given number of seconds, -1 for ever, or until nwipe shuts down.
+ *
+ * @returns  1 if nwipe is shutting down, 0 otherwise.
+ */
+int nwipe_events_sleep( int seconds );
+
+/**
+ * Waits for input on a file descriptor, such as a key pressed in the terminal, for the given
+ * number of milliseconds or until nwipe shuts down.
+ *
+ * @returns  1 if there is input, 0 if there is none, -1 if the file descriptor has been closed,
+ *           e.g. the terminal has gone.
+ */
+int nwipe_events_input( int fd, int milliseconds );
+
+#endif /* EVENTS_H_ */
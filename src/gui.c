@@ -63,6 +63,9 @@
 #include "hpa_dco.h"
 #include "customers.h"
 #include "conf.h"
+#include "scheduler.h"
+#include "station.h"
+#include "events.h"
 #include "unistd.h"
 
 #define NWIPE_GUI_PANE 8
@@ -172,6 +175,7 @@ const char* selection_footer_add_customer_yes_no = "Save Customer Details Y/N";
 char** p_end_wipe_footer; /* Contains a pointer to either end_wipe_footer or shredos_end_wipe_footer */
 const char* end_wipe_footer = "B=[Toggle between dark\\blank\\blue screen] Ctrl+C=Quit";
 const char* shredos_end_wipe_footer = "b=[Toggle dark\\blank\\blue screen] f=Font size Ctrl+C=Quit";
+const char* station_footer = "S=[Wipe waiting drives] B=[Toggle dark\\blank\\blue screen] Ctrl+C=Quit";
 const char* rounds_footer = "Left=Erase Esc=Cancel Ctrl+C=Quit";
 const char* selection_footer_text_entry = "Esc=Cancel Return=Submit Ctrl+C=Quit";
 
@@ -987,6 +991,7 @@ void nwipe_gui_select( int count, nwipe_context_t** c )
                                "nwipe? Exiting nwipe now." );
                     /* Issue signal to nwipe to exit immediately but gracefully */
                     terminate_signal = 1;
+                    nwipe_events_shutdown();
                 }
             }
             else
@@ -1641,13 +1646,14 @@ void nwipe_gui_prng( void )
     extern nwipe_prng_t nwipe_isaac;
     extern nwipe_prng_t nwipe_isaac64;
     extern nwipe_prng_t nwipe_aes_ctr_prng;
+    extern nwipe_prng_t nwipe_philox_prng;
     extern nwipe_prng_t nwipe_xoroshiro256_prng;
     extern nwipe_prng_t nwipe_add_lagg_fibonacci_prng;
 
     extern int terminate_signal;
 
     /* The number of implemented PRNGs. */
-    const int count = 5;
+    const int count = 7;
 
     /* The first tabstop. */
     const int tab1 = 2;
@@ -1689,6 +1695,14 @@ void nwipe_gui_prng( void )
     {
         focus = 4;
     }
+    if( nwipe_options.prng == &nwipe_aes_ctr_prng )
+    {
+        focus = 5;
+    }
+    if( nwipe_options.prng == &nwipe_philox_prng )
+    {
+        focus = 6;
+    }
     do
     {
         /* Clear the main window. */
@@ -1705,6 +1719,8 @@ void nwipe_gui_prng( void )
         mvwprintw( main_window, yy++, tab1, "  %s", nwipe_isaac64.label );
         mvwprintw( main_window, yy++, tab1, "  %s", nwipe_add_lagg_fibonacci_prng.label );
         mvwprintw( main_window, yy++, tab1, "  %s", nwipe_xoroshiro256_prng.label );
+        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_aes_ctr_prng.label );
+        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_philox_prng.label );
         yy++;
 
         /* Print the cursor. */
@@ -1879,6 +1895,82 @@ void nwipe_gui_prng( void )
                            tab1,
                            "especially for legacy systems, due to its efficiency and minimal demands.  " );
                 break;
+
+            case 5:
+
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "AES-256 in counter mode encrypts an incrementing 128 bit counter with a key" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "taken from the random seed of the pass. The output is a cryptographically" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "strong stream, it can not be told apart from random data or predicted" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "without knowing the key. The period is 2^128 blocks of 16 bytes." );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "                                                                            " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "On CPUs with the AES instructions (AES-NI on x86-64, the crypto extension on" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "ARMv8) it runs at several GB/s per core, faster than most disks can write." );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "Without them a portable implementation is used, which is considerably slower" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "but produces the identical stream." );
+                break;
+
+            case 6:
+
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "Philox4x64-10, published by Salmon, Moraes, Dror and Shaw in 2011, is a" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "counter-based generator. Each 32 byte block is a keyed scramble of its own" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "position in the stream, ten rounds of 64 bit multiplications, so any part of" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "the stream can be computed without generating what comes before it. It passes" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "the BigCrush statistical tests but is not a cryptographic generator." );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "                                                                            " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "Because the stream can start at any offset, a verification can be split over" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "several threads with --verify-threads." );
+                break;
         }
 
         /* switch */
@@ -1949,6 +2041,14 @@ void nwipe_gui_prng( void )
                 {
                     nwipe_options.prng = &nwipe_xoroshiro256_prng;
                 }
+                if( focus == 5 )
+                {
+                    nwipe_options.prng = &nwipe_aes_ctr_prng;
+                }
+                if( focus == 6 )
+                {
+                    nwipe_options.prng = &nwipe_philox_prng;
+                }
                 return;
 
             case KEY_BACKSPACE:
@@ -4110,6 +4210,7 @@ void nwipe_gui_list( int count, char* window_title, char** list, int* selected_e
                                "nwipe? Exiting nwipe now." );
                     /* Issue signal to nwipe to exit immediately but gracefully */
                     terminate_signal = 1;
+                    nwipe_events_shutdown();
                 }
             }
             else
@@ -6242,6 +6343,14 @@ void* nwipe_gui_status( void* ptr )
     /* Spinner character */
     char spinner_string[2];
 
+    /* The footer while wiping, a station that doesn't wipe the drives at once tells how to wipe them. */
+    const char* wipe_footer = *p_end_wipe_footer;
+
+    if( nwipe_options.station && !nwipe_options.autonuke )
+    {
+        wipe_footer = station_footer;
+    }
+
     /* Create the finish message, this changes based on whether PDF creation is enabled
      * and whether a logfile has been specified
      */
@@ -6348,19 +6457,9 @@ void* nwipe_gui_status( void* ptr )
     /* Set to 1 initially to start loop.    */
     int nwipe_active = 1;
 
-    /* Used in the gui status loop to trap a failure of the halfdelay(), getch() mechanism to block for the designated
-     * period */
-    int expected_iterations;
-
-    /* Used in the selection loop to trap a failure of the timeout(), getch() mechanism to block for the designated
-     * period, initialise the counter */
-    int iteration_counter = 0;
-
-    time_t previous_iteration_timestamp = time( NULL );
-
-    /* Calculate Maximum allowed iterations per second (typically 20), which is double the expected iterations
-     * (typically 10) */
-    expected_iterations = ( 1000 / GETCH_GUI_STATS_UPDATE_MS ) * 2;
+    /* Whether the terminal has input, and the number of times in a row it had input but no key. */
+    int input;
+    int no_key_count = 0;
 
     if( nwipe_time_start == 0 )
     {
@@ -6368,53 +6467,40 @@ void* nwipe_gui_status( void* ptr )
         nwipe_time_start = time( NULL ) - 1;
     }
 
-    nwipe_gui_title( footer_window, *p_end_wipe_footer );
+    nwipe_gui_title( footer_window, wipe_footer );
 
     loop_control = 1;
 
     while( loop_control )
     {
-        /* IMPORTANT ! Halfdelay(1) causes getch() to pause for 0.1 secs. This is important for two reasons.
-         * 1. Pauses the getch for 0.1 secs so that the screen is only updated max 10 times/sec. Without
-         *    this delay the loop would run hundreds of times per sec maxing out the core.
-         * 2. By keeping the delay below 0.2 seconds, i.e 0.1, it makes the keypress and resizing
-         *    nice and responsive.
+        /* The screen is updated when a key is pressed, when nwipe shuts down, or every GUI_STATS_REFRESH_MS
+         * otherwise, see events.c. getch() doesn't block, it only reads the key that woke the thread up.
          */
-        halfdelay( GETCH_GUI_STATS_UPDATE_MS );  // Important, don't change this unless you know what you are doing !
-                                                 // Related to getch().
-
+        input = nwipe_events_input( STDIN_FILENO, GUI_STATS_REFRESH_MS );
+        nodelay( stdscr, TRUE );
         keystroke = getch();  // Get user input.
 
-        iteration_counter++;
-
-        /* Much like the same check we perform in the nwipe_gui_select() function, here we check that we are not looping
-         * any faster than as defined by the halfdelay() function above, typically this loop runs at 10 times a second.
-         * This check makes sure that if the loop runs faster than double this value i.e 20 times a second then the
-         * program exits. This check is therefore determining whether the getch() function is returning immediately
-         * rather than blocking for the defined period of 100ms. Why is this necessary? Some terminals (konsole &
-         * deriviatives) that are exited while nwipe is still running fail to terminate nwipe this causes the
-         * halfdelay()/getch() functions to immediately fail causing the loop frequency to drastically increase. We
-         * detect that speed increase here and therefore close down nwipe. This doesn't affect the use of the tmux
-         * terminal by which you can detach and reattach to running nwipe processes. tmux still works correctly.
+        /* Some terminals (konsole & deriviatives) that are exited while nwipe is still running fail to terminate
+         * nwipe, the terminal then hangs up, or has input that never makes a key. We detect that here and
+         * therefore close down nwipe. This doesn't affect the use of the tmux terminal by which you can detach
+         * and reattach to running nwipe processes. tmux still works correctly.
          */
-        if( previous_iteration_timestamp == time( NULL ) )
-        {
-            if( iteration_counter > expected_iterations )
-            {
-                nwipe_log( NWIPE_LOG_ERROR,
-                           "GUI.c,nwipe_gui_status(), loop runaway, did you close the terminal without exiting "
-                           "nwipe? Initiating shutdown now." );
-                /* Issue signal to nwipe to shutdown immediately but gracefully */
-                terminate_signal = 1;
-            }
-        }
-        else
+        no_key_count = input > 0 && keystroke == ERR ? no_key_count + 1 : 0;
+
+        if( input < 0 || no_key_count > GUI_STATS_NO_KEY_MAX )
         {
-            /* new second, so reset counter */
-            iteration_counter = 0;
-            previous_iteration_timestamp = time( NULL );
+            nwipe_log( NWIPE_LOG_ERROR,
+                       "GUI.c,nwipe_gui_status(), the terminal has gone, did you close the terminal without exiting "
+                       "nwipe? Initiating shutdown now." );
+            /* Issue signal to nwipe to shutdown immediately but gracefully */
+            terminate_signal = 1;
+            nwipe_events_shutdown();
         }
 
+        /* The drives of a station change as they are plugged in and pulled. */
+        pthread_mutex_lock( &nwipe_station_mutex );
+        count = nwipe_misc_thread_data->nwipe_selected;
+
         /* Get the current time. */
         if( nwipe_active && terminate_signal != 1 )
         {
@@ -6441,7 +6527,7 @@ void* nwipe_gui_status( void* ptr )
             if( nwipe_active != 0 )
             {
                 /* if resizing the terminal during a wipe a specific footer is required */
-                nwipe_gui_create_all_windows_on_terminal_resize( 0, *p_end_wipe_footer );
+                nwipe_gui_create_all_windows_on_terminal_resize( 0, wipe_footer );
             }
             else
             {
@@ -6462,6 +6548,12 @@ void* nwipe_gui_status( void* ptr )
         /* Each element prints three lines. */
         slots /= 3;
 
+        /* Keep the window filled when drives are removed. */
+        if( offset > 0 && offset + slots > count )
+        {
+            offset = count > slots ? count - slots : 0;
+        }
+
         if( nwipe_active == 0 || terminate_signal == 1 )
         {
             nwipe_gui_title( footer_window, finish_message );
@@ -6479,7 +6571,7 @@ void* nwipe_gui_status( void* ptr )
         {
             tft_saver = 0;
             nwipe_init_pairs();
-            nwipe_gui_create_all_windows_on_terminal_resize( 1, *p_end_wipe_footer );
+            nwipe_gui_create_all_windows_on_terminal_resize( 1, wipe_footer );
 
             /* Show screen */
             nwipe_gui_blank = 0;
@@ -6496,7 +6588,7 @@ void* nwipe_gui_status( void* ptr )
             show_panel( main_panel );
 
             /* Reprint the footer */
-            nwipe_gui_title( footer_window, *p_end_wipe_footer );
+            nwipe_gui_title( footer_window, wipe_footer );
 
             // Refresh the footer_window ;
             wnoutrefresh( footer_window );
@@ -6519,7 +6611,7 @@ void* nwipe_gui_status( void* ptr )
                         /* grey text on black background */
                         tft_saver = 1;
                         nwipe_init_pairs();
-                        nwipe_gui_create_all_windows_on_terminal_resize( 1, *p_end_wipe_footer );
+                        nwipe_gui_create_all_windows_on_terminal_resize( 1, wipe_footer );
                     }
                     else
                     {
@@ -6587,6 +6679,18 @@ void* nwipe_gui_status( void* ptr )
 
                     break;
 
+                case 's':
+                case 'S':
+
+                    /* Wipe the drives that are waiting in a station, the main thread queues them. */
+                    if( nwipe_options.station )
+                    {
+                        nwipe_station_wipe_requested = 1;
+                        nwipe_events_wake();
+                    }
+
+                    break;
+
                 case 'f':
 
                     /* The f key is only meaningful for ShredOS, it toggles the fontsize */
@@ -6625,6 +6729,12 @@ void* nwipe_gui_status( void* ptr )
             if( terminate_signal != 1 )
             {
                 nwipe_active = compute_stats( ptr );  // Returns number of active wipe threads
+
+                /* A station doesn't finish, it waits for the next drive until it is quit. */
+                if( nwipe_options.station && nwipe_active == 0 )
+                {
+                    nwipe_active = 1;
+                }
             }
 
             /* Only print the stats if the user hasn't blanked the screen */
@@ -6646,7 +6756,15 @@ void* nwipe_gui_status( void* ptr )
                     wprintw( main_window, " %s/%s", c[i]->device_model, c[i]->device_serial_no );
 
                     /* Check whether the child process is still running the wipe. */
-                    if( c[i]->wipe_status == 1 )
+                    if( c[i]->select == NWIPE_SELECT_FALSE )
+                    {
+                        mvwprintw( main_window, yy++, 4, "[waiting, press S to wipe] " );
+                    }
+                    else if( c[i]->wipe_queued )
+                    {
+                        mvwprintw( main_window, yy++, 4, "[queued, waiting for a free slot] " );
+                    }
+                    else if( c[i]->wipe_status == 1 )
                     {
                         /* Print percentage and pass information. */
                         mvwprintw( main_window,
@@ -6739,6 +6857,15 @@ void* nwipe_gui_status( void* ptr )
 
                     wprintw( main_window, "[%s/s] ", nomenclature_result_str );
 
+                    /* Show the throughput of the link the drive shares with others. */
+                    if( c[i]->wipe_status == 1 && c[i]->link != NULL && c[i]->link->devices > 1 )
+                    {
+                        Determine_C_B_nomenclature(
+                            c[i]->link->throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
+
+                        wprintw( main_window, "[link %i %s/s] ", c[i]->link->number, nomenclature_result_str );
+                    }
+
                     /* Insert whitespace. */
                     yy += 1;
 
@@ -6848,6 +6975,17 @@ void* nwipe_gui_status( void* ptr )
                 /* Add a title. */
                 mvwprintw( stats_window, 0, ( NWIPE_GUI_STATS_W - strlen( stats_title ) ) / 2, "%s", stats_title );
 
+                /* Show the queue of the wipes in the bottom border. */
+                if( nwipe_options.max_wipes > 0 || nwipe_options.max_wipes_per_controller > 0 )
+                {
+                    mvwprintw( stats_window,
+                               NWIPE_GUI_STATS_H - 1,
+                               2,
+                               " %i running, %i queued ",
+                               nwipe_misc_thread_data->running,
+                               nwipe_misc_thread_data->queued );
+                }
+
                 /* Refresh internal representation of stats window */
                 wnoutrefresh( stats_window );
 
@@ -6858,10 +6996,13 @@ void* nwipe_gui_status( void* ptr )
 
         }  // end wipes have started if
 
+        pthread_mutex_unlock( &nwipe_station_mutex );
+
     } /* End of while loop */
 
     nwipe_gui_title( footer_window, finish_message );
     terminate_signal = 1;
+    nwipe_events_shutdown();
 
     return NULL;
 } /* nwipe_gui_status */
@@ -6886,10 +7027,17 @@ int compute_stats( void* ptr )
     nwipe_misc_thread_data->throughput = 0;
     nwipe_misc_thread_data->maxeta = 0;
     nwipe_misc_thread_data->errors = 0;
+    nwipe_misc_thread_data->queued = 0;
 
     /* Enumerate all contexts to compute statistics. */
     for( i = 0; i < count; i++ )
     {
+        /* A queued wipe has yet to run. */
+        if( c[i]->wipe_queued )
+        {
+            nwipe_misc_thread_data->queued += 1;
+        }
+
         /* Check whether the child process is still running the wipe. */
         if( c[i]->wipe_status == 1 )
         {
@@ -6946,7 +7094,10 @@ int compute_stats( void* ptr )
 
     } /* for statistics */
 
-    return nwipe_active;
+    nwipe_misc_thread_data->running = nwipe_active;
+
+    /* The wipes are not finished while any are queued. */
+    return nwipe_active + nwipe_misc_thread_data->queued;
 }
 
 void nwipe_update_speedring( nwipe_speedring_t* speedring, u64 speedring_bytes, time_t speedring_now )
@@ -127,10 +127,13 @@ void nwipe_update_speedring( nwipe_speedring_t* speedring, u64 speedring_done, t
  * the drive selection screen is displayed. (prior to wipe starting). */
 #define GETCH_BLOCK_MS 250 /* millisecond block time for getch() */
 
-/* Note The value of 1 (100ms) is the ideal speed for screen refresh during a wipe, a value of 2 is noticeably slower,
- * don't change unless you understand how this value affects keyboard responsiveness and speed of screen stats/spinner
- * updating */
-#define GETCH_GUI_STATS_UPDATE_MS 1 /* 1 * 100 = 1/10/sec = millisecond block time for gui stats screen updates */
+/* Note The stats are computed once a second, so the status screen is refreshed as often. A key pressed updates the
+ * screen straight away whatever this value, see nwipe_events_input(). */
+#define GUI_STATS_REFRESH_MS 1000 /* millisecond refresh time of the gui stats screen */
+
+/* The times in a row the terminal may have input that getch() doesn't return as a key before the terminal is
+ * considered to have gone and nwipe is shut down */
+#define GUI_STATS_NO_KEY_MAX 10
 
 #define FIELD_LENGTH 256
 
@@ -28,8 +28,6 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
-#include <scsi/sg.h>
-#include <scsi/scsi_ioctl.h>
 #include "nwipe.h"
 #include "context.h"
 #include "version.h"
@@ -38,488 +36,279 @@
 #include "options.h"
 #include "hpa_dco.h"
 #include "miscellaneous.h"
+#include "sgio.h"
 
-/* This function makes use of both the hdparm program to determine HPA/DCO status and we also access
- * the device configuration overlay identify data structure via the sg driver with ioctl calls.
- * I would prefer to write these functions without any reliance on hdparm however for the time being
- * we will utilize both methods. However, I don't like doing it like this as a change in formatted
- * output of hdparm could potentially break HPA/DCO detection requiring a fix. Time permitting I may
- * come back to this and fully implement it without any reliance on hdparm.
+/* The HPA and DCO status is read with ATA commands issued directly through SG_IO (see sgio.c),
+ * the same way hdparm -N and hdparm --dco-identify do, rather than by running hdparm and parsing
+ * its output. As the devices are probed in parallel, so are these commands.
  */
 
-int hpa_dco_status( nwipe_context_t* ptr )
-{
-    nwipe_context_t* c;
-    c = ptr;
-
-    int r;  // A result buffer.
-    int set_return_value;
-    int exit_status;
-    int hpa_line_found;
-    int dco_line_found;
-
-    FILE* fp;
-    char path_hdparm_cmd10_get_hpa[] = "hdparm --verbose -N";
-    char path_hdparm_cmd20_get_hpa[] = "/sbin/hdparm --verbose -N";
-    char path_hdparm_cmd30_get_hpa[] = "/usr/bin/hdparm --verbose -N";
-    char path_hdparm_cmd31_get_hpa[] = "/usr/sbin/hdparm --verbose -N";
+/* The IDENTIFY DEVICE words and bits that tell which commands are supported. */
+#define HPA_DCO_WORD_HPA 82  // Bit 10, the host protected area feature set.
+#define HPA_DCO_WORD_48BIT 83  // Bit 10, 48-bit addresses, bit 11, the device configuration overlay.
+#define HPA_DCO_WORD_AMA 119  // Bit 8, the accessible max address feature set of ACS-3.
 
-    char path_hdparm_cmd40_get_dco[] = "hdparm --verbose --dco-identify";
-    char path_hdparm_cmd50_get_dco[] = "/sbin/hdparm --verbose --dco-identify";
-    char path_hdparm_cmd60_get_dco[] = "/usr/bin/hdparm --verbose --dco-identify";
-    char path_hdparm_cmd61_get_dco[] = "/usr/sbin/hdparm --verbose --dco-identify";
+static int hpa_dco_identify_bit( const unsigned char* identify, int word, int bit )
+{
+    int value = identify[word * 2] | ( identify[word * 2 + 1] << 8 );
 
-    char pipe_std_err[] = "2>&1";
+    /* Words 82 to 84 are only valid when bit 14 of word 83 is set and bit 15 is cleared, word
+     * 119 when its own bits are. */
+    int valid = word >= 82 && word <= 84 ? 83 : word;
+    int signature = identify[valid * 2] | ( identify[valid * 2 + 1] << 8 );
 
-    char result[512];
+    if( ( signature & 0xc000 ) != 0x4000 )
+    {
+        return 0;
+    }
 
-    u64 nwipe_dco_real_max_sectors;
+    return ( value >> bit ) & 1;
 
-    char* p;
+} /* hpa_dco_identify_bit */
 
-    /* Use the longest of the 'path_hdparm_cmd.....' strings above to
-     *determine size in the strings below
+static u64 hpa_dco_identify_sectors( const unsigned char* identify )
+{
+    /**
+     * Returns the user addressable sectors from the IDENTIFY DEVICE data, i.e. the size the drive
+     * reports with any hidden area excluded, the first value of hdparm -N.
      */
-    char hdparm_cmd_get_hpa[sizeof( path_hdparm_cmd30_get_hpa ) + sizeof( c->device_name ) + sizeof( pipe_std_err )];
-    char hdparm_cmd_get_dco[sizeof( path_hdparm_cmd60_get_dco ) + sizeof( c->device_name ) + sizeof( pipe_std_err )];
 
-    /* Initialise return value */
-    set_return_value = 0;
+    int i;
+    u64 sectors = 0;
 
-    /* Construct the command including path to the binary if required, I do it like this to cope
-     * with distros that don't setup their paths in a standard way or maybe don't even define a
-     * path. By doing this we avoid the 'No such file or directory' message you would otherwise
-     * get on some distros. -> debian SID
-     */
-
-    if( system( "which hdparm > /dev/null 2>&1" ) )
+    if( hpa_dco_identify_bit( identify, HPA_DCO_WORD_48BIT, 10 ) )
     {
-        if( system( "which /sbin/hdparm > /dev/null 2>&1" ) )
+        /* Words 100-103. */
+        for( i = 207; i >= 200; i-- )
         {
-            if( system( "which /usr/bin/hdparm > /dev/null 2>&1" ) )
-            {
-                if( system( "which /usr/sbin/hdparm > /dev/null 2>&1" ) )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "hdparm command not found." );
-                    nwipe_log( NWIPE_LOG_WARNING,
-                               "Required by nwipe for HPA/DCO detection & correction and ATA secure erase." );
-                    nwipe_log( NWIPE_LOG_WARNING, "** Please install hdparm **\n" );
-                    cleanup();
-                    exit( 1 );
-                }
-                else
-                {
-                    snprintf( hdparm_cmd_get_hpa,
-                              sizeof( hdparm_cmd_get_hpa ),
-                              "%s %s %s\n",
-                              path_hdparm_cmd31_get_hpa,
-                              c->device_name,
-                              pipe_std_err );
-                    snprintf( hdparm_cmd_get_dco,
-                              sizeof( hdparm_cmd_get_dco ),
-                              "%s %s %s\n",
-                              path_hdparm_cmd61_get_dco,
-                              c->device_name,
-                              pipe_std_err );
-                }
-            }
-            else
-            {
-                snprintf( hdparm_cmd_get_hpa,
-                          sizeof( hdparm_cmd_get_hpa ),
-                          "%s %s %s\n",
-                          path_hdparm_cmd30_get_hpa,
-                          c->device_name,
-                          pipe_std_err );
-                snprintf( hdparm_cmd_get_dco,
-                          sizeof( hdparm_cmd_get_dco ),
-                          "%s %s %s\n",
-                          path_hdparm_cmd60_get_dco,
-                          c->device_name,
-                          pipe_std_err );
-            }
-        }
-        else
-        {
-            snprintf( hdparm_cmd_get_hpa,
-                      sizeof( hdparm_cmd_get_hpa ),
-                      "%s %s %s\n",
-                      path_hdparm_cmd20_get_hpa,
-                      c->device_name,
-                      pipe_std_err );
-            snprintf( hdparm_cmd_get_dco,
-                      sizeof( hdparm_cmd_get_dco ),
-                      "%s %s %s\n",
-                      path_hdparm_cmd50_get_dco,
-                      c->device_name,
-                      pipe_std_err );
+            sectors = ( sectors << 8 ) | identify[i];
         }
     }
-    else
+
+    if( sectors == 0 )
     {
-        snprintf( hdparm_cmd_get_hpa,
-                  sizeof( hdparm_cmd_get_hpa ),
-                  "%s %s %s\n",
-                  path_hdparm_cmd10_get_hpa,
-                  c->device_name,
-                  pipe_std_err );
-        snprintf( hdparm_cmd_get_dco,
-                  sizeof( hdparm_cmd_get_dco ),
-                  "%s %s %s\n",
-                  path_hdparm_cmd40_get_dco,
-                  c->device_name,
-                  pipe_std_err );
+        /* Words 60-61. */
+        for( i = 123; i >= 120; i-- )
+        {
+            sectors = ( sectors << 8 ) | identify[i];
+        }
     }
 
-    /* Initialise the results buffer, so we don't some how inadvertently process a past result */
-    memset( result, 0, sizeof( result ) );
+    return sectors;
 
-    if( hdparm_cmd_get_hpa[0] != 0 )
-    {
+} /* hpa_dco_identify_sectors */
 
-        fp = popen( hdparm_cmd_get_hpa, "r" );
+static int hpa_dco_native_max( int fd, const unsigned char* identify, u64* native, int* ama )
+{
+    /**
+     * Reads the native max address of the drive, with GET NATIVE MAX ADDRESS EXT when the
+     * drive supports the accessible max address feature set, READ NATIVE MAX ADDRESS EXT
+     * when it supports 48-bit addresses and READ NATIVE MAX ADDRESS otherwise.
+     *
+     * @returns  0 on success with the number of native sectors, the second value of hdparm -N,
+     *           -1 if the drive or the bridge in front of it doesn't support the command.
+     */
 
-        if( fp == NULL )
-        {
-            nwipe_log( NWIPE_LOG_WARNING, "hpa_dco_status: Failed to create stream to %s", hdparm_cmd_get_hpa );
+    nwipe_sg_ata_t ata;
+    int extend;
 
-            set_return_value = 1;
-        }
+    memset( &ata, 0, sizeof( ata ) );
+    ata.device = 0x40;
 
-        if( fp != NULL )
-        {
-            hpa_line_found = 0;  //* init */
+    *ama = hpa_dco_identify_bit( identify, HPA_DCO_WORD_AMA, 8 );
+    extend = *ama || hpa_dco_identify_bit( identify, HPA_DCO_WORD_48BIT, 10 );
 
-            /* Read the output a line at a time - output it. */
-            while( fgets( result, sizeof( result ) - 1, fp ) != NULL )
-            {
-                if( nwipe_options.verbose )
-                {
-                    nwipe_log( NWIPE_LOG_DEBUG, "%s \n%s", hdparm_cmd_get_hpa, result );
-                }
+    if( *ama )
+    {
+        ata.command = 0x78;  // GET NATIVE MAX ADDRESS EXT, feature 0x0000
+    }
+    else
+    {
+        ata.command = extend ? 0x27 : 0xf8;
+    }
 
-                /* Change the output of hdparm to lower case and search using lower case strings, to try
-                 * to avoid minor changes in case in hdparm's output from breaking HPA/DCO detection
-                 */
-                strlower( result );  // convert the result to lower case
+    if( nwipe_sg_ata( fd, &ata, NWIPE_SG_NONE, NULL, 0, extend ) != 0 )
+    {
+        return -1;
+    }
 
-                /* Scan the hdparm results for HPA is disabled
-                 */
-                if( strstr( result, "sg_io: bad/missing sense data" ) != 0 )
-                {
-                    c->HPA_status = HPA_UNKNOWN;
-                    nwipe_log( NWIPE_LOG_ERROR, "SG_IO bad/missing sense data %s", hdparm_cmd_get_hpa );
-                    break;
-                }
-                else
-                {
-                    if( strstr( result, "hpa is disabled" ) != 0 )
-                    {
-                        c->HPA_status = HPA_DISABLED;
-
-                        nwipe_log( NWIPE_LOG_DEBUG,
-                                   "hdparm says the host protected area is disabled on %s but this information may or "
-                                   "may not be correct, as occurs when you get a SG_IO error and 0/1 sectors and it "
-                                   "says HPA is enabled. Further checks are conducted below..",
-                                   c->device_name );
-                        hpa_line_found = 1;
-                        break;
-                    }
-                    else
-                    {
-                        if( strstr( result, "hpa is enabled" ) != 0 )
-                        {
-                            c->HPA_status = HPA_ENABLED;
-                            nwipe_log( NWIPE_LOG_DEBUG,
-                                       "hdparm says the host protected area is enabled on %s but this information may "
-                                       "or may not be correct, as occurs when you get a SG_IO error and 0/1 sectors "
-                                       "and it says HPA is enabled. Further checks are conducted below..",
-                                       c->device_name );
-                            hpa_line_found = 1;
-                            break;
-                        }
-                        else
-                        {
-                            if( strstr( result, "accessible max address disabled" ) != 0 )
-                            {
-                                c->HPA_status = HPA_DISABLED;
-                                nwipe_log( NWIPE_LOG_DEBUG,
-                                           "hdparm says the accessible max address disabled on %s"
-                                           "this means that there are no hidden sectors,  "
-                                           "",
-                                           c->device_name );
-                                hpa_line_found = 1;
-                                break;
-                            }
-                            else
-                            {
-                                if( strstr( result, "accessible max address enabled" ) != 0 )
-                                {
-                                    c->HPA_status = HPA_ENABLED;
-                                    nwipe_log( NWIPE_LOG_DEBUG,
-                                               "hdparm says the accessible max address enabled on %s"
-                                               "this means that there are hidden sectors",
-                                               c->device_name );
-                                    hpa_line_found = 1;
-                                    break;
-                                }
-                                else
-                                {
-                                    if( strstr( result, "invalid" ) != 0 )
-                                    {
-                                        nwipe_log(
-                                            NWIPE_LOG_WARNING,
-                                            "hdparm reports invalid output, sector information may be invalid, buggy "
-                                            "drive firmware on %s?",
-                                            c->device_name );
-                                        // We'll assume the HPA values are in the string as we may be able to extract
-                                        // something meaningful
-                                        hpa_line_found = 1;
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+    /* The command returns the highest address, not the number of sectors. */
+    *native = ata.lba + 1;
 
-            /* if the HPA line was found then process the line,
-             * extracting the 'hpa set' and 'hpa real' values.
-             */
-            if( hpa_line_found == 1 )
-            {
-                /* Extract the 'HPA set' value, the first value in the line and convert
-                 * to binary and save in context */
+    return 0;
 
-                nwipe_log( NWIPE_LOG_INFO, "HPA: %s on %s", result, c->device_name );
+} /* hpa_dco_native_max */
 
-                c->HPA_reported_set = str_ascii_number_to_ll( result );
+static u64 hpa_dco_real_max_sectors( int fd )
+{
+    /**
+     * Issues DEVICE CONFIGURATION IDENTIFY and extracts the real max sectors from words 3-6
+     * of the returned data, incremented by 1 the way hdparm --dco-identify reports them.
+     *
+     * @returns  The real max sectors, 0 if the drive doesn't support the command.
+     */
 
-                /* Check whether the number was too large or no number found & log */
-                if( c->HPA_reported_set == -1 )
-                {
-                    nwipe_log( NWIPE_LOG_INFO, "HPA_set_value: HPA set value too large on %s", c->device_name );
-                    c->HPA_reported_set = 0;
-                }
-                else
-                {
-                    if( c->HPA_reported_set == -2 )
-                    {
-                        nwipe_log( NWIPE_LOG_INFO, "HPA_set_value: No HPA set value found %s", c->device_name );
-                        c->HPA_reported_set = 0;
-                    }
-                }
+    nwipe_sg_ata_t ata;
+    unsigned char buffer[NWIPE_SG_SECTOR];
+    unsigned char sum = 0;
+    u64 sectors = 0;
+    int i;
 
-                /* Extract the 'HPA real' value, the second value in the line and convert
-                 * to binary and save in context, this is a little more difficult as sometimes
-                 * a odd value is returned so instead of nnnnn/nnnnn you get nnnnnn/1(nnnnnn).
-                 * So first we scan for a open bracket '(' then if there is no '(' we then start the
-                 * search immediately after the '/'.
-                 */
-                if( ( p = strstr( result, "(" ) ) )
-                {
-                    c->HPA_reported_real = str_ascii_number_to_ll( p + 1 );
-                }
-                else
-                {
-                    if( ( p = strstr( result, "/" ) ) )
-                    {
-                        c->HPA_reported_real = str_ascii_number_to_ll( p + 1 );
-                    }
-                }
+    memset( &ata, 0, sizeof( ata ) );
+    ata.command = 0xb1;  // DEVICE CONFIGURATION
+    ata.features = 0xc2;  // IDENTIFY
+    ata.count = 1;
+    ata.device = 0x40;
 
-                /* Check whether the number was too large or no number found & log */
-                if( c->HPA_reported_real == -1 )
-                {
-                    nwipe_log( NWIPE_LOG_INFO, "HPA_set_value: HPA real value too large on %s", c->device_name );
-                    c->HPA_reported_real = 0;
-                }
-                else
-                {
-                    if( c->HPA_reported_real == -2 )
-                    {
-                        nwipe_log( NWIPE_LOG_INFO, "HPA_set_value: No HPA real value found %s", c->device_name );
-                        c->HPA_reported_real = 0;
-                    }
-                }
+    memset( buffer, 0, sizeof( buffer ) );
 
-                nwipe_log( NWIPE_LOG_INFO,
-                           "HPA values %lli / %lli on %s",
-                           c->HPA_reported_set,
-                           c->HPA_reported_real,
-                           c->device_name );
-            }
-            else
-            {
-                c->HPA_status = HPA_UNKNOWN;
-                nwipe_log( NWIPE_LOG_WARNING,
-                           "[UNKNOWN] We can't find the HPA line, has hdparm ouput unknown/changed? %s",
-                           c->device_name );
-            }
+    if( nwipe_sg_ata( fd, &ata, NWIPE_SG_IN, buffer, 1, 0 ) != 0 )
+    {
+        return 0;
+    }
 
-            /* close */
-            r = pclose( fp );
-            if( r > 0 )
-            {
-                exit_status = WEXITSTATUS( r );
-                if( nwipe_options.verbose )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING,
-                               "hpa_dco_status(): hdparm failed, \"%s\" exit status = %u",
-                               hdparm_cmd_get_hpa,
-                               exit_status );
-                }
+    /* Check the integrity word when it is set, as with the IDENTIFY DEVICE data. */
+    if( buffer[510] == 0xa5 )
+    {
+        for( i = 0; i < NWIPE_SG_SECTOR; i++ )
+        {
+            sum += buffer[i];
+        }
 
-                if( exit_status == 127 )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Command not found. Installing hdparm is mandatory !" );
-                    set_return_value = 2;
-                    if( nwipe_options.nousb )
-                    {
-                        return set_return_value;
-                    }
-                }
-            }
+        if( sum != 0 )
+        {
+            nwipe_log( NWIPE_LOG_WARNING, "The DCO identify data fails its checksum" );
+            return 0;
         }
     }
 
-    /* Initialise the results buffer again, so we don't
-     * some how inadvertently process a past result */
-    memset( result, 0, sizeof( result ) );
+    for( i = 13; i >= 6; i-- )
+    {
+        sectors = ( sectors << 8 ) | buffer[i];
+    }
 
-    /* -----------------------------------------------
-     * Run the dco identify command and determine the
-     * real max sectors, store it in the drive context
-     * for comparison against the hpa reported drive
-     * size values.
+    /* hdparm adds 1 to the real max sectors too, as it is the highest address,
+     * but only increment if it's already greater than zero
      */
+    if( sectors > 0 )
+    {
+        sectors++;
+    }
 
-    dco_line_found = 0;
+    return sectors;
 
-    if( hdparm_cmd_get_dco[0] != 0 )
-    {
+} /* hpa_dco_real_max_sectors */
 
-        fp = popen( hdparm_cmd_get_dco, "r" );
+int hpa_dco_status( nwipe_context_t* ptr )
+{
+    nwipe_context_t* c;
+    c = ptr;
+
+    int fd;
+    int ama;
+    int set_return_value;
+
+    unsigned char identify[NWIPE_SG_SECTOR];
+
+    u64 native;
 
-        if( fp == NULL )
+    /* Initialise return value */
+    set_return_value = 0;
+
+    c->HPA_reported_set = 0;
+    c->HPA_reported_real = 0;
+    c->DCO_reported_real_max_sectors = 0;
+
+    /* Opened read/write as some kernels only pass ATA commands through on a writable descriptor. */
+    if( ( fd = open( c->device_name, O_RDWR | O_NONBLOCK ) ) < 0 )
+    {
+        nwipe_log( NWIPE_LOG_WARNING, "hpa_dco_status: Unable to open %s", c->device_name );
+        set_return_value = 1;
+    }
+    else if( nwipe_sg_ata_identify( fd, identify ) != 0 )
+    {
+        /* Usually a SAS drive, or a USB adapter that doesn't support ATA pass through */
+        nwipe_log( NWIPE_LOG_INFO, "ATA IDENTIFY DEVICE is not supported on %s", c->device_name );
+        close( fd );
+    }
+    else
+    {
+        /* ---------------------------------------------------------------
+         * Read the size the drive reports and its native size, as hdparm -N does.
+         */
+        if( !hpa_dco_identify_bit( identify, HPA_DCO_WORD_HPA, 10 )
+            && !hpa_dco_identify_bit( identify, HPA_DCO_WORD_AMA, 8 ) )
         {
-            nwipe_log( NWIPE_LOG_WARNING, "hpa_dco_status: Failed to create stream to %s", hdparm_cmd_get_dco );
+            /* Without the HPA feature set there is no native max address to read, nor an area
+             * hidden by SET MAX ADDRESS, the device configuration overlay is checked below. */
+            c->HPA_reported_set = hpa_dco_identify_sectors( identify );
+            c->HPA_reported_real = c->HPA_reported_set;
 
-            set_return_value = 1;
+            nwipe_log( NWIPE_LOG_INFO, "HPA is not supported on %s", c->device_name );
         }
-
-        if( fp != NULL )
+        else if( hpa_dco_native_max( fd, identify, &native, &ama ) == 0 )
         {
-            /* Read the output a line at a time - output it. */
-            while( fgets( result, sizeof( result ) - 1, fp ) != NULL )
-            {
-                /* Change the output of hdparm to lower case and search using lower case strings, to try
-                 * to avoid minor changes in case in hdparm's output from breaking HPA/DCO detection */
-                strlower( result );
+            c->HPA_reported_set = hpa_dco_identify_sectors( identify );
+            c->HPA_reported_real = native;
+
+            nwipe_log( NWIPE_LOG_INFO,
+                       "HPA: max sectors = %llu/%llu, %s is %s on %s",
+                       c->HPA_reported_set,
+                       c->HPA_reported_real,
+                       ama ? "accessible max address" : "HPA",
+                       c->HPA_reported_set != c->HPA_reported_real ? "enabled" : "disabled",
+                       c->device_name );
+        }
+        else
+        {
+            nwipe_log( NWIPE_LOG_WARNING, "[UNKNOWN] The native max address can't be read on %s", c->device_name );
+        }
 
-                if( nwipe_options.verbose )
-                {
-                    nwipe_log( NWIPE_LOG_DEBUG, "%s \n%s", hdparm_cmd_get_dco, result );
-                }
+        /* -----------------------------------------------
+         * Read the device configuration overlay and determine the
+         * real max sectors, store it in the drive context
+         * for comparison against the hpa reported drive
+         * size values.
+         */
+        if( hpa_dco_identify_bit( identify, HPA_DCO_WORD_48BIT, 11 ) )
+        {
+            c->DCO_reported_real_max_sectors = hpa_dco_real_max_sectors( fd );
 
-                if( strstr( result, "real max sectors" ) != 0 )
-                {
-                    /* extract the real max sectors, convert to binary and store in drive context */
-                    dco_line_found = 1;
-                    break;
-                }
-            }
-            /* DCO line found, now process it */
-            if( dco_line_found == 1 )
+            /* Validate the real max sectors to detect extreme or impossible
+             * values, so the size must be greater than zero but less than
+             * 200TB (429496729600 sectors).
+             */
+            if( c->DCO_reported_real_max_sectors > 0 && c->DCO_reported_real_max_sectors < 429496729600 )
             {
-                c->DCO_reported_real_max_sectors = str_ascii_number_to_ll( result );
                 nwipe_log( NWIPE_LOG_INFO,
-                           "hdparm:DCO Real max sectors reported as %lli on %s",
+                           "NWipe: DCO Real max sectors reported as %lli on %s",
                            c->DCO_reported_real_max_sectors,
                            c->device_name );
-
-                /* Validate the real max sectors to detect extreme or impossible
-                 * values, so the size must be greater than zero but less than
-                 * 200TB (429496729600 sectors). As its 2023 and the largest drive
-                 * available is 20TB I wonder if somebody in the future will be looking
-                 * at this and thinking, yep we need to increase that value... and I'm
-                 * wondering what year that will be. This validation is necessary all
-                 * because of a bug in hdparm v9.60 (and maybe other versions) which
-                 * produced wildly inaccurate values, often negative.
-                 */
-                if( c->DCO_reported_real_max_sectors > 0 && c->DCO_reported_real_max_sectors < 429496729600 )
-                {
-                    nwipe_log( NWIPE_LOG_INFO,
-                               "NWipe: DCO Real max sectors reported as %lli on %s",
-                               c->DCO_reported_real_max_sectors,
-                               c->device_name );
-                }
-                else
-                {
-                    /* Call nwipe's own low level function to retrieve the drive configuration
-                     * overlay and retrieve the real max sectors. We may remove reliance on hdparm
-                     * if nwipes own low level drive access code works well.
-                     */
-                    c->DCO_reported_real_max_sectors = nwipe_read_dco_real_max_sectors( c->device_name );
-
-                    /* Check our real max sectors function is returning sensible data too */
-                    if( c->DCO_reported_real_max_sectors > 0 && c->DCO_reported_real_max_sectors < 429496729600 )
-                    {
-                        nwipe_log( NWIPE_LOG_INFO,
-                                   "NWipe: DCO Real max sectors reported as %lli on %s",
-                                   c->DCO_reported_real_max_sectors,
-                                   c->device_name );
-                    }
-                    else
-                    {
-                        c->DCO_reported_real_max_sectors = 0;
-                        nwipe_log( NWIPE_LOG_INFO, "DCO Real max sectors not found" );
-                    }
-                }
             }
             else
             {
                 c->DCO_reported_real_max_sectors = 0;
                 nwipe_log( NWIPE_LOG_INFO, "DCO Real max sectors not found" );
             }
-
-            nwipe_log(
-                NWIPE_LOG_INFO,
-                "libata: apparent max sectors reported as %lli with sector size as %i/%i (logical/physical) on %s",
-                c->device_size_in_sectors,
-                c->device_sector_size,  // logical
-                c->device_phys_sector_size,  // physical
-                c->device_name );
-
-            /* close */
-            r = pclose( fp );
-            if( r > 0 )
-            {
-                exit_status = WEXITSTATUS( r );
-                if( nwipe_options.verbose )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING,
-                               "hpa_dco_status(): hdparm failed, \"%s\" exit status = %u",
-                               hdparm_cmd_get_dco,
-                               exit_status );
-                }
-
-                if( exit_status == 127 )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Command not found. Installing hdparm is mandatory !" );
-                    set_return_value = 2;
-                    if( nwipe_options.nousb )
-                    {
-                        return set_return_value;
-                    }
-                }
-            }
         }
+        else
+        {
+            /* More recent drives no longer support the device configuration overlay */
+            nwipe_log( NWIPE_LOG_INFO, "DCO is not supported on %s", c->device_name );
+        }
+
+        close( fd );
     }
 
-    /* Compare the results of hdparm -N (HPA set / HPA real)
-     * and hdparm --dco-identidy (real max sectors). All three
+    nwipe_log( NWIPE_LOG_INFO,
+               "libata: apparent max sectors reported as %lli with sector size as %i/%i (logical/physical) on %s",
+               c->device_size_in_sectors,
+               c->device_sector_size,  // logical
+               c->device_phys_sector_size,  // physical
+               c->device_name );
+
+    /* Compare the native max address (HPA set / HPA real)
+     * and the DCO identify data (real max sectors). All three
      * values may be different or perhaps 'HPA set' and 'HPA real' are
      * different and 'HPA real' matches 'real max sectors'.
      *
@@ -617,8 +406,6 @@ int hpa_dco_status( nwipe_context_t* ptr )
 
     c->DCO_reported_real_max_size = c->DCO_reported_real_max_sectors * c->device_sector_size;
 
-    nwipe_dco_real_max_sectors = nwipe_read_dco_real_max_sectors( c->device_name );
-
     /* Analyse all the variations to produce the final real max bytes which takes into
      * account drives that don't support DCO or HPA. This result is used in the PDF
      * creation functions.
@@ -726,165 +513,25 @@ u64 nwipe_read_dco_real_max_sectors( char* device )
 {
     /* This function sends a device configuration overlay identify command 0xB1 (dco-identify)
      * to the drive and extracts the real max sectors. The value is incremented by 1 and
-     * then returned. We rely upon this function to determine real max sectors as there
-     * is a bug in hdparm 9.60, including possibly earlier or later versions but which is
-     * fixed in 9.65, that returns a incorrect (negative) value
-     * for some drives that are possibly over a certain size.
+     * then returned, 0 if the drive doesn't support the command.
      */
 
-    /* TODO Add checks in case of failure, especially with recent drives that may not
-     * support drive configuration overlay commands.
-     */
-
-#define LBA_SIZE 512
-#define CMD_LEN 16
-#define BLOCK_MAX 65535
-#define LBA_MAX ( 1 << 30 )
-#define SENSE_BUFFER_SIZE 32
-
     u64 nwipe_real_max_sectors;
-
-    /* This command issues command 0xb1 (dco-identify) 15th byte */
-    unsigned char cmd_blk[CMD_LEN] = { 0x85, 0x08, 0x0e, 0x00, 0xc2, 0, 0x01, 0, 0, 0, 0, 0, 0, 0x40, 0xb1, 0 };
-
-    sg_io_hdr_t io_hdr;
-    unsigned char buffer[LBA_SIZE];  // Received data block
-    unsigned char sense_buffer[SENSE_BUFFER_SIZE];  // Sense data
-
-    /* Zero the data block prior to use */
-    memset( buffer, 0, LBA_SIZE );
-
-    /* three characters represent one byte of sense data, i.e
-     * two characters and a space "01 AE 67"
-     */
-    char sense_buffer_hex[( SENSE_BUFFER_SIZE * 3 ) + 1];
-
-    int i, i2;  // index
     int fd;  // file descripter
 
-    if( ( fd = open( device, O_RDWR ) ) < 0 )
+    if( ( fd = open( device, O_RDWR | O_NONBLOCK ) ) < 0 )
     {
         /* Unable to open device */
-        return -1;
+        return 0;
     }
 
-    /******************************************
-     * Initialise the sg header for reading the
-     * device configuration overlay identify data
-     */
-    memset( &io_hdr, 0, sizeof( sg_io_hdr_t ) );
-    io_hdr.interface_id = 'S';
-    io_hdr.cmd_len = sizeof( cmd_blk );
-    io_hdr.mx_sb_len = sizeof( sense_buffer );
-    io_hdr.dxfer_direction = SG_DXFER_FROM_DEV;
-    io_hdr.dxfer_len = LBA_SIZE;
-    io_hdr.dxferp = buffer;
-    io_hdr.cmdp = cmd_blk;
-    io_hdr.sbp = sense_buffer;
-    io_hdr.timeout = 20000;
-
-    if( ioctl( fd, SG_IO, &io_hdr ) < 0 )
-    {
-        nwipe_log( NWIPE_LOG_ERROR, "IOCTL command failed retrieving DCO" );
-        i2 = 0;
-        for( i = 0, i2 = 0; i < SENSE_BUFFER_SIZE; i++, i2 += 3 )
-        {
-            /* IOCTL returned an error */
-            snprintf( &sense_buffer_hex[i2], sizeof( sense_buffer_hex ), "%02x ", sense_buffer[i] );
-        }
-        sense_buffer_hex[i2] = 0;  // terminate string
-        nwipe_log( NWIPE_LOG_DEBUG, "Sense buffer from failed DCO identify cmd:%s", sense_buffer_hex );
-        return -2;
-    }
+    nwipe_real_max_sectors = hpa_dco_real_max_sectors( fd );
 
     /* Close the device */
     close( fd );
 
-    /***************************************************************
-     * Extract the real max sectors from the returned 512 byte block.
-     * Assuming the first word/byte is 0. We extract the bytes & switch
-     * the endian. Words 3-6(bytes 6-13) contain the max sector address
-     */
-    nwipe_real_max_sectors = (u64) ( (u64) buffer[13] << 56 ) | ( (u64) buffer[12] << 48 ) | ( (u64) buffer[11] << 40 )
-        | ( (u64) buffer[10] << 32 ) | ( (u64) buffer[9] << 24 ) | ( (u64) buffer[8] << 16 ) | ( (u64) buffer[7] << 8 )
-        | buffer[6];
-
-    /* Don't really understand this but hdparm adds 1 to
-     * the real max sectors too, counting zero as sector?
-     * but only increment if it's already greater than zero
-     */
-    if( nwipe_real_max_sectors > 0 )
-    {
-        nwipe_real_max_sectors++;
-    }
-
     nwipe_log(
         NWIPE_LOG_INFO, "func:nwipe_read_dco_real_max_sectors(), DCO real max sectors = %lli", nwipe_real_max_sectors );
 
     return nwipe_real_max_sectors;
 }
-
-int ascii2binary_array( char* input, unsigned char* output_bin, int bin_size )
-{
-    /* Converts ascii sense data output by hdparm to binary.
-     * Scans a character string that contains hexadecimal ascii data, ignores spaces
-     * and extracts and converts the hexadecimal ascii data to binary and places in a array.
-     * Typically for dco_identify sense data the bin size will be 512 bytes but for error
-     * sense data this would be 32 bytes.
-     */
-    int idx_in;  // Index into ascii input string
-    int idx_out;  // Index into the binary output array
-    int byte_count;  // Counts which 4 bit value we are working on
-    char upper4bits;
-    char lower4bits;
-
-    byte_count = 0;
-    idx_in = 0;
-    idx_out = 0;
-    while( input[idx_in] != 0 )
-    {
-        if( input[idx_in] >= '0' && input[idx_in] <= '9' )
-        {
-            if( byte_count == 0 )
-            {
-                upper4bits = input[idx_in] - 0x30;
-                byte_count++;
-            }
-            else
-            {
-                lower4bits = input[idx_in] - 0x30;
-                output_bin[idx_out++] = ( upper4bits << 4 ) | ( lower4bits );
-                byte_count = 0;
-
-                if( idx_out >= bin_size )
-                {
-                    return 0;  // output array full.
-                }
-            }
-        }
-        else
-        {
-            if( input[idx_in] >= 'a' && input[idx_in] <= 'f' )
-            {
-                if( byte_count == 0 )
-                {
-                    upper4bits = input[idx_in] - 0x57;
-                    byte_count++;
-                }
-                else
-                {
-                    lower4bits = input[idx_in] - 0x57;
-                    output_bin[idx_out++] = ( upper4bits << 4 ) | ( lower4bits );
-                    byte_count = 0;
-
-                    if( idx_out >= bin_size )
-                    {
-                        return 0;  // output array full.
-                    }
-                }
-            }
-        }
-        idx_in++;  // next byte in the input string
-    }
-    return 0;
-}
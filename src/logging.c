@@ -38,6 +38,8 @@
 #include "logging.h"
 #include "create_pdf.h"
 #include "miscellaneous.h"
+#include "badmap.h"
+#include "events.h"
 
 /* Global array to hold log values to print when logging to STDOUT */
 char** log_lines;
@@ -46,6 +48,74 @@ int log_elements_allocated = 0;
 int log_elements_displayed = 0;
 pthread_mutex_t mutex1 = PTHREAD_MUTEX_INITIALIZER;
 
+/* The buffer the messages of this thread are collected in, NULL if they are logged directly. */
+static __thread nwipe_log_buffer_t* nwipe_log_deferred = NULL;
+
+static void nwipe_log_defer_message( nwipe_log_t level, const char* format, va_list ap )
+{
+    /* Appends a message to the buffer of the thread, it is logged directly if it can't be kept. */
+    nwipe_log_buffer_t* buffer = nwipe_log_deferred;
+    char message_buffer[MAX_LOG_LINE_CHARS];
+    nwipe_log_t* levels;
+    char** messages;
+    char* message;
+
+    vsnprintf( message_buffer, sizeof( message_buffer ), format, ap );
+
+    levels = realloc( buffer->level, ( buffer->count + 1 ) * sizeof( nwipe_log_t ) );
+
+    if( levels != NULL )
+    {
+        buffer->level = levels;
+    }
+
+    messages = realloc( buffer->message, ( buffer->count + 1 ) * sizeof( char* ) );
+
+    if( messages != NULL )
+    {
+        buffer->message = messages;
+    }
+
+    message = strdup( message_buffer );
+
+    if( levels == NULL || messages == NULL || message == NULL )
+    {
+        free( message );
+        nwipe_log_deferred = NULL;
+        nwipe_log( level, "%s", message_buffer );
+        nwipe_log_deferred = buffer;
+        return;
+    }
+
+    buffer->level[buffer->count] = level;
+    buffer->message[buffer->count++] = message;
+
+} /* nwipe_log_defer_message */
+
+void nwipe_log_defer( nwipe_log_buffer_t* buffer )
+{
+    nwipe_log_deferred = buffer;
+
+} /* nwipe_log_defer */
+
+void nwipe_log_flush( nwipe_log_buffer_t* buffer )
+{
+    int i;
+
+    for( i = 0; i < buffer->count; i++ )
+    {
+        nwipe_log( buffer->level[i], "%s", buffer->message[i] );
+        free( buffer->message[i] );
+    }
+
+    free( buffer->level );
+    free( buffer->message );
+    buffer->level = NULL;
+    buffer->message = NULL;
+    buffer->count = 0;
+
+} /* nwipe_log_flush */
+
 void nwipe_log( nwipe_log_t level, const char* format, ... )
 {
     /**
@@ -69,6 +139,18 @@ void nwipe_log( nwipe_log_t level, const char* format, ... )
 
     /* A pointer to the system time struct. */
     struct tm* p;
+
+    /* A thread that defers its messages, see nwipe_log_defer(). */
+    if( nwipe_log_deferred != NULL )
+    {
+        va_list deferred;
+
+        va_start( deferred, format );
+        nwipe_log_defer_message( level, format, deferred );
+        va_end( deferred );
+        return;
+    }
+
     r = pthread_mutex_lock( &mutex1 );
     if( r != 0 )
     {
@@ -335,8 +417,12 @@ void nwipe_log( nwipe_log_t level, const char* format, ... )
     {
         if( nwipe_options.nogui )
         {
-            printf( "%s\n", log_lines[log_current_element] );
-            log_elements_displayed++;
+            /* Lines logged before the options were parsed have not been displayed yet. */
+            while( log_elements_displayed <= log_current_element )
+            {
+                printf( "%s\n", log_lines[log_elements_displayed] );
+                log_elements_displayed++;
+            }
         }
     }
     else
@@ -401,6 +487,7 @@ void nwipe_log( nwipe_log_t level, const char* format, ... )
             }
             user_abort = 1;
             terminate_signal = 1;
+            nwipe_events_shutdown();
         }
     }
 
@@ -750,6 +837,46 @@ void nwipe_log_summary( nwipe_context_t** ptr, int nwipe_selected )
     nwipe_log( NWIPE_LOG_NOTIMESTAMP,
                "********************************************************************************" );
 
+    /* Print the regions that failed to be written or verified, if there are any. */
+    for( i = 0; i < nwipe_selected; i++ )
+    {
+        if( c[i]->badmap != NULL )
+        {
+            break;
+        }
+    }
+
+    if( i < nwipe_selected )
+    {
+        nwipe_log( NWIPE_LOG_NOTIMESTAMP, "" );
+        nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                   "********************************* Bad Regions **********************************" );
+        nwipe_log( NWIPE_LOG_NOTIMESTAMP, "!   Device | Regions | Write Sectors | Read Sectors | Verify Sectors" );
+        nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                   "--------------------------------------------------------------------------------" );
+
+        for( i = 0; i < nwipe_selected; i++ )
+        {
+            if( c[i]->badmap == NULL )
+            {
+                continue;
+            }
+
+            nwipe_strip_path( device, c[i]->device_name );
+
+            nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                       "! %s | %7i | %13llu | %12llu | %14llu",
+                       device,
+                       c[i]->badmap->count,
+                       nwipe_badmap_sectors( c[i], NWIPE_BADMAP_WRITE ),
+                       nwipe_badmap_sectors( c[i], NWIPE_BADMAP_READ ),
+                       nwipe_badmap_sectors( c[i], NWIPE_BADMAP_VERIFY ) );
+        }
+
+        nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                   "********************************************************************************" );
+    }
+
     /* Print the main summary table */
 
     /* initialise */
@@ -808,7 +935,7 @@ void nwipe_log_summary( nwipe_context_t** ptr, int nwipe_selected )
             }
             else
             {
-                if( c[i]->wipe_status == 1 && user_abort == 1 )
+                if( ( c[i]->wipe_status == 1 || c[i]->wipe_queued ) && user_abort == 1 )
                 {
                     strncpy( exclamation_flag, "!", 1 );
                     exclamation_flag[1] = 0;
@@ -891,6 +1018,9 @@ void nwipe_log_summary( nwipe_context_t** ptr, int nwipe_selected )
                    model,
                    serial_no );
 
+        /* Save the map of the failed regions, which the PDF report refers to */
+        nwipe_badmap_save( c[i] );
+
         /* Create the PDF report/certificate */
         if( nwipe_options.PDF_enable == 1 )
         // if( strcmp( nwipe_options.PDFreportpath, "noPDF" ) != 0 )
@@ -956,4 +1086,15 @@ void nwipe_log_summary( nwipe_context_t** ptr, int nwipe_selected )
     {
         nwipe_log( NWIPE_LOG_NOTIMESTAMP, "Creating PDF report in %s\n", nwipe_options.PDFreportpath );
     }
+
+    for( i = 0; i < nwipe_selected; i++ )
+    {
+        if( c[i]->badmap_filename[0] != 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                       "Map of the bad regions of %s saved to %s",
+                       c[i]->device_name,
+                       c[i]->badmap_filename );
+        }
+    }
 }
@@ -57,6 +57,27 @@ typedef enum nwipe_log_t_ {
  */
 void nwipe_log( nwipe_log_t level, const char* format, ... );
 
+/* The messages a thread has deferred, see nwipe_log_defer(). */
+typedef struct nwipe_log_buffer_t_
+{
+    nwipe_log_t* level;  // The level of each message.
+    char** message;  // The messages, without the timestamp.
+    int count;  // The number of messages.
+} nwipe_log_buffer_t;
+
+/**
+ * Collects the messages the calling thread logs in a buffer instead of writing them, until it is
+ * called again with NULL, so that threads that run at the same time don't mix their messages.
+ * @param buffer the buffer, zeroed before the first call, or NULL to log directly again
+ */
+void nwipe_log_defer( nwipe_log_buffer_t* buffer );
+
+/**
+ * Logs the messages collected in a buffer, in the order they were logged, and empties it.
+ * @param buffer the buffer
+ */
+void nwipe_log_flush( nwipe_log_buffer_t* buffer );
+
 void nwipe_perror( int nwipe_errno, const char* f, const char* s );
 void nwipe_log_OSinfo();
 int nwipe_log_sysinfo();
@@ -47,6 +47,8 @@
 #include "options.h"
 #include "pass.h"
 #include "logging.h"
+#include "checkpoint.h"
+#include "smart.h"
 
 /*
  * Comment Legend
@@ -799,7 +801,7 @@ void* nwipe_bruce7( void* ptr )
     return NULL;
 }
 
-int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
+static int nwipe_runmethod_steps( nwipe_context_t* c, nwipe_pattern_t* patterns )
 {
     /**
      * Writes patterns to the device.
@@ -815,6 +817,9 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
     /* Variable to track if it is the last pass */
     int lastpass = 0;
 
+    /* Whether the pass that is written is verified, as it is written with --verify-inline. */
+    int verify;
+
     i = 0;
 
     /* The zero-fill pattern for the final pass of most methods. */
@@ -825,12 +830,12 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
 
     /* Create the PRNG state buffer. */
     c->prng_seed.length = NWIPE_KNOB_PRNG_STATE_LENGTH;
-    c->prng_seed.s = malloc( c->prng_seed.length );
+    c->prng_seed.s = calloc( 1, c->prng_seed.length );
 
     /* Check the memory allocation. */
     if( !c->prng_seed.s )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
         nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the prng seed buffer." );
         return -1;
     }
@@ -906,21 +911,30 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
             if( patterns[i].length > 0 )
             {
 
-                /* Write a static pass. */
-                c->pass_type = NWIPE_PASS_WRITE;
-                r = nwipe_static_pass( c, &patterns[i] );
-                c->pass_type = NWIPE_PASS_NONE;
-
-                /* Log number of bytes written to disk */
-                nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+                verify = ( nwipe_options.verify == NWIPE_VERIFY_ALL || lastpass == 1 );
 
-                /* Check for a fatal error. */
-                if( r < 0 )
+                /* A step that was completed before the wipe was interrupted is skipped. */
+                if( nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_WRITE ) == 0 )
                 {
-                    return r;
+                    /* Write a static pass. */
+                    c->pass_type = NWIPE_PASS_WRITE;
+                    c->verify_inline = verify && nwipe_options.verify_inline;
+                    r = nwipe_static_pass( c, &patterns[i] );
+                    c->verify_inline = 0;
+                    c->pass_type = NWIPE_PASS_NONE;
+
+                    /* Log number of bytes written to disk */
+                    nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+
+                    /* Check for a fatal error. */
+                    if( r < 0 )
+                    {
+                        return r;
+                    }
                 }
 
-                if( nwipe_options.verify == NWIPE_VERIFY_ALL || lastpass == 1 )
+                if( verify && !nwipe_options.verify_inline
+                    && nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_VERIFY ) == 0 )
                 {
 
                     nwipe_log( NWIPE_LOG_NOTICE,
@@ -979,23 +993,35 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
                     return -1;
                 }
 
-                /* Write the random pass. */
-                r = nwipe_random_pass( c );
-                c->pass_type = NWIPE_PASS_NONE;
-
-                /* Log number of bytes written to disk */
-                nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+                /* Make sure IS5 enhanced always verifies its PRNG pass regardless */
+                /* of the current combination of the --noblank (which influences   */
+                /* the lastpass variable) and --verify options.                    */
+                verify = ( nwipe_options.verify == NWIPE_VERIFY_ALL || lastpass == 1
+                           || nwipe_options.method == &nwipe_is5enh );
 
-                /* Check for a fatal error. */
-                if( r < 0 )
+                /* The seed of a step that is resumed is replaced by the seed it was written with. */
+                if( nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_WRITE ) == 0 )
                 {
-                    return r;
+                    /* Write the random pass. */
+                    c->verify_inline = verify && nwipe_options.verify_inline;
+                    r = nwipe_random_pass( c );
+                    c->verify_inline = 0;
+                    c->pass_type = NWIPE_PASS_NONE;
+
+                    /* Log number of bytes written to disk */
+                    nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+
+                    /* Check for a fatal error. */
+                    if( r < 0 )
+                    {
+                        return r;
+                    }
                 }
 
-                /* Make sure IS5 enhanced always verifies its PRNG pass regardless */
-                /* of the current combination of the --noblank (which influences   */
-                /* the lastpass variable) and --verify options.                    */
-                if( nwipe_options.verify == NWIPE_VERIFY_ALL || lastpass == 1 || nwipe_options.method == &nwipe_is5enh )
+                c->pass_type = NWIPE_PASS_NONE;
+
+                if( verify && !nwipe_options.verify_inline
+                    && nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_VERIFY ) == 0 )
                 {
                     nwipe_log( NWIPE_LOG_NOTICE,
                                "Verifying pass %i of %i, round %i of %i, on %s",
@@ -1081,20 +1107,27 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
             return -1;
         }
 
-        nwipe_log( NWIPE_LOG_NOTICE, "Writing final random pattern to '%s'.", c->device_name );
+        verify = ( nwipe_options.verify == NWIPE_VERIFY_LAST || nwipe_options.verify == NWIPE_VERIFY_ALL );
 
-        /* The final ops2 pass. */
-        r = nwipe_random_pass( c );
+        if( nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_FINAL_WRITE ) == 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTICE, "Writing final random pattern to '%s'.", c->device_name );
 
-        nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+            /* The final ops2 pass. */
+            c->verify_inline = verify && nwipe_options.verify_inline;
+            r = nwipe_random_pass( c );
+            c->verify_inline = 0;
 
-        /* Check for a fatal error. */
-        if( r < 0 )
-        {
-            return r;
+            nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+
+            /* Check for a fatal error. */
+            if( r < 0 )
+            {
+                return r;
+            }
         }
 
-        if( nwipe_options.verify == NWIPE_VERIFY_LAST || nwipe_options.verify == NWIPE_VERIFY_ALL )
+        if( verify && !nwipe_options.verify_inline && nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_FINAL_VERIFY ) == 0 )
         {
             nwipe_log( NWIPE_LOG_NOTICE, "Verifying final random pattern FRP on %s", c->device_name );
 
@@ -1118,6 +1151,9 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
     {
         nwipe_log( NWIPE_LOG_NOTICE, "Verifying that %s is zeroed", c->device_name );
 
+        /* The only step, which is never skipped. */
+        nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_FINAL_VERIFY );
+
         /* Verify the final zero pass. */
         c->pass_type = NWIPE_PASS_VERIFY;
         r = nwipe_static_verify( c, &pattern_zero );
@@ -1143,6 +1179,9 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
     {
         nwipe_log( NWIPE_LOG_NOTICE, "Verifying that %s is Ones (0xFF)", c->device_name );
 
+        /* The only step, which is never skipped. */
+        nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_FINAL_VERIFY );
+
         /* Verify the final ones pass. */
         c->pass_type = NWIPE_PASS_VERIFY;
         r = nwipe_static_verify( c, &pattern_one );
@@ -1169,21 +1208,28 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
         /* Tell the user that we are on the final pass. */
         c->pass_type = NWIPE_PASS_FINAL_BLANK;
 
-        nwipe_log( NWIPE_LOG_NOTICE, "Blanking device %s", c->device_name );
+        verify = ( nwipe_options.verify == NWIPE_VERIFY_LAST || nwipe_options.verify == NWIPE_VERIFY_ALL );
 
-        /* The final zero pass. */
-        r = nwipe_static_pass( c, &pattern_zero );
+        if( nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_FINAL_WRITE ) == 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTICE, "Blanking device %s", c->device_name );
 
-        /* Log number of bytes written to disk */
-        nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+            /* The final zero pass. */
+            c->verify_inline = verify && nwipe_options.verify_inline;
+            r = nwipe_static_pass( c, &pattern_zero );
+            c->verify_inline = 0;
 
-        /* Check for a fatal error. */
-        if( r < 0 )
-        {
-            return r;
+            /* Log number of bytes written to disk */
+            nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+
+            /* Check for a fatal error. */
+            if( r < 0 )
+            {
+                return r;
+            }
         }
 
-        if( nwipe_options.verify == NWIPE_VERIFY_LAST || nwipe_options.verify == NWIPE_VERIFY_ALL )
+        if( verify && !nwipe_options.verify_inline && nwipe_checkpoint_step( c, NWIPE_CHECKPOINT_FINAL_VERIFY ) == 0 )
         {
             nwipe_log( NWIPE_LOG_NOTICE, "Verifying that %s is empty.", c->device_name );
 
@@ -1232,7 +1278,11 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
     if( c->verify_errors > 0 )
     {
         /* We finished, but with non-fatal verification errors. */
-        nwipe_log( NWIPE_LOG_ERROR, "%llu verification errors on '%s'.", c->verify_errors, c->device_name );
+        nwipe_log( NWIPE_LOG_ERROR,
+                   "%llu verification errors on '%s', %llu bytes differ.",
+                   c->verify_errors,
+                   c->device_name,
+                   c->verify_mismatch_bytes );
     }
 
     if( c->pass_errors > 0 )
@@ -1252,6 +1302,32 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
     /* We finished successfully. */
     return 0;
 
+} /* nwipe_runmethod_steps */
+
+int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
+{
+    /**
+     * Writes patterns to the device, with checkpoints from which an interrupted wipe can
+     * be resumed.
+     *
+     */
+
+    /* The result holder. */
+    int r;
+
+    /* The SMART data is read around the wipe for the report, so that it shows both states. */
+    nwipe_smart_read( c->device_name, &c->smart_before );
+
+    r = nwipe_runmethod_steps( c, nwipe_checkpoint_begin( c, patterns ) );
+
+    /* Keep the checkpoint after a fatal error. */
+    nwipe_checkpoint_end( c, r );
+
+    nwipe_smart_read( c->device_name, &c->smart_after );
+    nwipe_smart_compare( c->device_name, &c->smart_before, &c->smart_after );
+
+    return r;
+
 } /* nwipe_runmethod */
 
 void calculate_round_size( nwipe_context_t* c )
@@ -46,6 +46,9 @@
 */
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
 #include "mt19937ar-cok.h"
 
 /* initializes state[MT_STATE_SIZE] with a seed */
@@ -153,3 +156,48 @@ unsigned long twister_genrand_int32( twister_state_t* state )
 
     return y;
 }
+
+/* generates words random numbers on [0,0xffffffff]-interval into buf, little-endian */
+void twister_genrand_to_buf( twister_state_t* state, unsigned char* buf, size_t words )
+{
+    unsigned long y;
+    uint32_t w;
+    size_t n;
+    size_t i;
+
+    while( words > 0 )
+    {
+        // Advance internal state if necessary, twister_genrand_int32() does so when left drops to 0
+        if( state->left <= 1 )
+        {
+            next_state( state );
+            state->left = MT_STATE_SIZE + 1;
+        }
+
+        // Temper the words of the current state in one go
+        n = (size_t) state->left - 1;
+        if( n > words )
+        {
+            n = words;
+        }
+
+        for( i = 0; i < n; i++ )
+        {
+            y = state->next[i];
+
+            // Tempering
+            y ^= ( y >> 11 );
+            y ^= ( y << 7 ) & 0x9d2c5680UL;
+            y ^= ( y << 15 ) & 0xefc60000UL;
+            y ^= ( y >> 18 );
+
+            w = htole32( (uint32_t) y );
+            memcpy( buf, &w, sizeof( w ) );
+            buf += sizeof( w );
+        }
+
+        state->next += n;
+        state->left -= (int) n;
+        words -= n;
+    }
+}
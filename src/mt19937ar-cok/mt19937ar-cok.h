@@ -5,6 +5,8 @@
 #ifndef MT19937AR_H_
 #define MT19937AR_H_
 
+#include <stddef.h>
+
 /* Period parameters */
 #define MT_STATE_SIZE 624
 #define MT_MIDDLE_WORD 397
@@ -28,4 +30,8 @@ void twister_init( twister_state_t* state, unsigned long init_key[], unsigned lo
 /* Generate a random integer on the [0,0xffffffff] interval. */
 unsigned long twister_genrand_int32( twister_state_t* state );
 
+/* Generate words random integers into buf as little-endian 32-bit words, the same
+ * stream as calling twister_genrand_int32() words times. */
+void twister_genrand_to_buf( twister_state_t* state, unsigned char* buf, size_t words );
+
 #endif /* MT19937AR_H_ */
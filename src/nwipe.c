@@ -23,6 +23,11 @@
 #define _DEFAULT_SOURCE
 #endif
 
+/* Required for O_DIRECT. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #ifndef _POSIX_SOURCE
 #define _POSIX_SOURCE
 #endif
@@ -41,6 +46,7 @@
 #include "context.h"
 #include "method.h"
 #include "prng.h"
+#include "pass.h"
 #include "options.h"
 #include "device.h"
 #include "logging.h"
@@ -57,6 +63,13 @@
 #include "conf.h"
 #include "version.h"
 #include "hpa_dco.h"
+#include "benchmark.h"
+#include "checkpoint.h"
+#include "scheduler.h"
+#include "bufpool.h"
+#include "badmap.h"
+#include "station.h"
+#include "events.h"
 #include "conf.h"
 #include <libconfig.h>
 
@@ -79,6 +92,432 @@ int devnamecmp( const void* a, const void* b )
     return ( ret );
 }
 
+static int nwipe_prepare( nwipe_context_t* c )
+{
+    /**
+     * Opens a selected device, checks its size and works out its I/O size, then queues its
+     * wipe. A device that can't be opened is disabled.
+     *
+     * @returns  The number of errors, the wipe is queued only when it is ready.
+     */
+
+    int errors = 0;
+    int r;
+
+    /* A result buffer for the BLKGETSIZE64 ioctl. */
+    u64 size64;
+
+    /* Initialise the spinner character index */
+    c->spinner_idx = 0;
+
+    /* Initialise the start and end time of the wipe */
+    c->start_time = 0;
+    c->end_time = 0;
+
+    /* Initialise the wipe_status flag, -1 = wipe not yet started */
+    c->wipe_status = -1;
+
+    /* Open the file for reads and writes, bypassing the page cache if requested. The blocks
+     * that are read back as they are written must come from the device, not the cache. */
+    c->device_direct = 0;
+
+    if( nwipe_options.direct || nwipe_options.verify_inline )
+    {
+        c->device_fd = open( c->device_name, O_RDWR | O_DIRECT );
+
+        if( c->device_fd >= 0 )
+        {
+            c->device_direct = 1;
+        }
+        else if( errno == EINVAL )
+        {
+            nwipe_log( NWIPE_LOG_WARNING,
+                       "Device '%s' does not support O_DIRECT, using the page cache.",
+                       c->device_name );
+            c->device_fd = open( c->device_name, O_RDWR );
+        }
+    }
+    else
+    {
+        c->device_fd = open( c->device_name, O_RDWR );
+    }
+
+    /* Check the open() result. */
+    if( c->device_fd < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "open" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to open device '%s'.", c->device_name );
+        c->select = NWIPE_SELECT_DISABLED;
+        return 0;
+    }
+
+    /* Stat the file. */
+    if( fstat( c->device_fd, &c->device_stat ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fstat" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to stat file '%s'.", c->device_name );
+        errors++;
+        return errors;
+    }
+
+    /* Check that the file is a block device. */
+    if( !S_ISBLK( c->device_stat.st_mode ) )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "'%s' is not a block device.", c->device_name );
+        errors++;
+        return errors;
+    }
+
+    /* TODO: Lock the file for exclusive access. */
+    /*
+    if( flock( c->device_fd, LOCK_EX | LOCK_NB ) != 0 )
+    {
+            nwipe_perror( errno, __FUNCTION__, "flock" );
+            nwipe_log( NWIPE_LOG_ERROR, "Unable to lock the '%s' file.", c->device_name );
+            errors++;
+            return errors;
+    }
+    */
+
+    /* Print serial number of device if it exists. */
+    if( strlen( (const char*) c->device_serial_no ) )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "%s has serial number %s", c->device_name, c->device_serial_no );
+    }
+
+    /* Do sector size and block size checking. I don't think this does anything useful as logical/Physical
+     * sector sizes are obtained by libparted in check.c */
+    if( ioctl( c->device_fd, BLKSSZGET, &c->device_sector_size ) == 0 )
+    {
+
+        if( ioctl( c->device_fd, BLKBSZGET, &c->device_block_size ) != 0 )
+        {
+            nwipe_log( NWIPE_LOG_WARNING, "Device '%s' failed BLKBSZGET ioctl.", c->device_name );
+            c->device_block_size = 0;
+        }
+    }
+    else
+    {
+        nwipe_log( NWIPE_LOG_WARNING, "Device '%s' failed BLKSSZGET ioctl.", c->device_name );
+        c->device_sector_size = 0;
+        c->device_block_size = 0;
+    }
+
+    /* The st_size field is zero for block devices. */
+    /* ioctl( c->device_fd, BLKGETSIZE64, &c->device_size ); */
+
+    /* Seek to the end of the device to determine its size. */
+    c->device_size = lseek( c->device_fd, 0, SEEK_END );
+
+    /* Also ask the driver for the device size. */
+    /* if( ioctl( c->device_fd, BLKGETSIZE64, &size64 ) ) */
+    if( ioctl( c->device_fd, _IOR( 0x12, 114, size_t ), &size64 ) )
+    {
+        /* The ioctl failed. */
+        fprintf( stderr, "Error: BLKGETSIZE64 failed  on '%s'.\n", c->device_name );
+        nwipe_log( NWIPE_LOG_ERROR, "BLKGETSIZE64 failed  on '%s'.\n", c->device_name );
+        errors++;
+    }
+    c->device_size = size64;
+
+    /* Check whether the two size values agree. */
+    if( c->device_size != size64 )
+    {
+        /* This could be caused by the linux last-odd-block problem. */
+        fprintf( stderr, "Error: Last-odd-block detected on '%s'.\n", c->device_name );
+        nwipe_log( NWIPE_LOG_ERROR, "Last-odd-block detected on '%s'.", c->device_name );
+        errors++;
+    }
+
+    if( c->device_size == (long long) -1 )
+    {
+        /* We cannot determine the size of this device. */
+        nwipe_perror( errno, __FUNCTION__, "lseek" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to determine the size of '%s'.", c->device_name );
+        errors++;
+    }
+    else
+    {
+        /* Reset the file pointer. */
+        r = lseek( c->device_fd, 0, SEEK_SET );
+
+        if( r == (off64_t) -1 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "lseek" );
+            nwipe_log( NWIPE_LOG_ERROR, "Unable to reset the '%s' file offset.", c->device_name );
+            errors++;
+        }
+    }
+
+    if( c->device_size == 0 )
+    {
+        nwipe_log( NWIPE_LOG_ERROR,
+                   "%s, sect/blk/dev %i/%i/%llu",
+                   c->device_name,
+                   c->device_sector_size,
+                   c->device_block_size,
+                   c->device_size );
+        errors++;
+        return errors;
+    }
+    else
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "%s, sect/blk/dev %i/%i/%llu",
+                   c->device_name,
+                   c->device_sector_size,
+                   c->device_block_size,
+                   c->device_size );
+    }
+
+    /* Determine the alignment of direct I/O, then the size of the reads and writes issued by the passes. */
+    c->device_io_align = nwipe_device_io_align( c );
+    c->device_io_size = nwipe_device_io_size( c );
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "%s, I/O size %zu bytes%s",
+               c->device_name,
+               c->device_io_size,
+               c->device_direct ? ", direct I/O" : "" );
+
+    /* Continue an interrupted wipe from its checkpoint. */
+    if( nwipe_options.resume )
+    {
+        nwipe_checkpoint_load( c );
+    }
+
+    /* Queue the wipe, it starts when there is a free slot. */
+    c->wipe_queued = 1;
+
+    return errors;
+
+} /* nwipe_prepare */
+
+static void nwipe_station_report( nwipe_context_t* c )
+{
+    /**
+     * Reports a wipe of a station as soon as its thread has stopped, with the same summary
+     * and PDF that are written at exit for the others.
+     */
+
+    /* A wipe that was stopped, because the drive was pulled, has failed. */
+    if( c->wipe_status != 0 && c->result == 0 )
+    {
+        c->result = -1;
+    }
+
+    /* As at exit, a failure shows as a pass error in the summary. */
+    if( c->result != 0 && c->pass_errors == 0 )
+    {
+        c->pass_errors = 1;
+    }
+
+    if( c->pass_errors != 0 || c->verify_errors != 0 || c->fsyncdata_errors != 0 )
+    {
+        nwipe_log( NWIPE_LOG_FATAL, "The wipe of %s failed, see the log for the specific error.", c->device_name );
+    }
+
+    nwipe_log_summary( &c, 1 );
+    c->station_reported = time( NULL );
+
+} /* nwipe_station_report */
+
+static int nwipe_station_drop( nwipe_context_t** c, int count, int i, nwipe_misc_thread_data_t* misc )
+{
+    /**
+     * Removes a context from the array of a station and frees it, with the device libparted
+     * keeps for it. The wipe thread of the device must have stopped.
+     *
+     * @returns  The number of contexts left in the array.
+     */
+
+    nwipe_context_t* drop = c[i];
+    char device[FILENAME_MAX];
+
+    pthread_mutex_lock( &nwipe_station_mutex );
+    memmove( &c[i], &c[i + 1], ( count - i - 1 ) * sizeof( nwipe_context_t* ) );
+    misc->nwipe_selected = --count;
+    pthread_mutex_unlock( &nwipe_station_mutex );
+
+    if( drop->device_fd >= 0 )
+    {
+        close( drop->device_fd );
+    }
+
+    nwipe_events_remove_wipe( drop );
+    nwipe_scheduler_remove( drop );
+    nwipe_badmap_free( drop );
+    free( drop->prng_state );
+
+    /* The name belongs to the libparted device. */
+    snprintf( device, sizeof( device ), "%s", drop->device_name );
+    free( drop );
+    nwipe_station_release( device );
+
+    return count;
+
+} /* nwipe_station_drop */
+
+static int nwipe_station_update( nwipe_context_t** c,
+                                 int count,
+                                 int capacity,
+                                 nwipe_misc_thread_data_t* misc,
+                                 int entropy )
+{
+    /**
+     * Brings the array of contexts of a station up to date with the drives that have been
+     * pulled and plugged in. The finished wipes are reported straight away and their drives
+     * are removed NWIPE_KNOB_STATION_LINGER seconds later, so the operator sees the result.
+     * The drives that are added wait, unless --autonuke is given, until the operator asks
+     * for them to be wiped. Only the main thread changes the array.
+     *
+     * @returns  The number of contexts in the array.
+     */
+
+    nwipe_context_t* added;
+    char device[FILENAME_MAX];
+    time_t now = time( NULL );
+    int i;
+
+    /* A pulled drive that is being wiped has its wipe stopped, and reported as failed. */
+    while( nwipe_station_next_removed( device, sizeof( device ) ) )
+    {
+        for( i = 0; i < count && strcmp( c[i]->device_name, device ) != 0; i++ )
+            ;
+
+        if( i == count )
+        {
+            /* Found at startup but not wiped, or already removed. */
+            nwipe_station_release( device );
+            continue;
+        }
+
+        if( c[i]->thread )
+        {
+            pthread_cancel( c[i]->thread );
+            pthread_join( c[i]->thread, NULL );
+            c[i]->thread = 0;
+            nwipe_station_report( c[i] );
+        }
+
+        nwipe_log( NWIPE_LOG_NOTICE, "%s has been removed from the station.", device );
+        count = nwipe_station_drop( c, count, i, misc );
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( c[i]->thread && c[i]->wipe_status == 0 )
+        {
+            /* The wipe has finished. */
+            pthread_join( c[i]->thread, NULL );
+            c[i]->thread = 0;
+            close( c[i]->device_fd );
+            c[i]->device_fd = -1;
+            nwipe_station_report( c[i] );
+        }
+        else if( c[i]->select == NWIPE_SELECT_DISABLED && c[i]->station_reported == 0 )
+        {
+            /* The drive couldn't be opened, the log tells why. */
+            c[i]->station_reported = now;
+        }
+    }
+
+    i = 0;
+
+    while( i < count )
+    {
+        if( c[i]->station_reported != 0 && now >= c[i]->station_reported + NWIPE_KNOB_STATION_LINGER )
+        {
+            count = nwipe_station_drop( c, count, i, misc );
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    while( ( added = nwipe_station_next_added() ) != NULL )
+    {
+        for( i = 0; i < count && strcmp( c[i]->device_name, added->device_name ) != 0; i++ )
+            ;
+
+        if( i < count )
+        {
+            /* Both contexts have the same libparted device, which is kept. */
+            free( added );
+            continue;
+        }
+
+        if( count == capacity )
+        {
+            nwipe_log( NWIPE_LOG_WARNING,
+                       "The station holds %i drives at most, %s is not added.",
+                       capacity,
+                       added->device_name );
+            snprintf( device, sizeof( device ), "%s", added->device_name );
+            free( added );
+            nwipe_station_release( device );
+            continue;
+        }
+
+        /* As for the drives found at startup. */
+        added->entropy_fd = entropy;
+        added->select = NWIPE_SELECT_FALSE;
+        added->prng = nwipe_options.prng;
+        added->prng_seed.length = 0;
+        added->prng_seed.s = 0;
+        added->prng_state = 0;
+        added->result = 0;
+        added->bytes_erased = 0;
+        added->wipe_status = -1;
+        added->device_fd = -1;
+
+        nwipe_init_temperature( added );
+        nwipe_log_drives_temperature_limits( added );
+
+        pthread_mutex_lock( &nwipe_station_mutex );
+        c[count] = added;
+        misc->nwipe_selected = ++count;
+        pthread_mutex_unlock( &nwipe_station_mutex );
+
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "%s has been added to the station, %s %s",
+                   added->device_name,
+                   added->device_model,
+                   added->device_serial_no );
+    }
+
+    /* The waiting drives are opened and queued, the scheduler starts their wipes. */
+    if( nwipe_options.autonuke || nwipe_station_wipe_requested )
+    {
+        nwipe_station_wipe_requested = 0;
+
+        for( i = 0; i < count; i++ )
+        {
+            if( c[i]->select != NWIPE_SELECT_FALSE )
+            {
+                continue;
+            }
+
+            nwipe_prepare( c[i] );
+
+            if( c[i]->wipe_queued )
+            {
+                c[i]->select = NWIPE_SELECT_TRUE;
+                nwipe_scheduler_add( c[i] );
+            }
+            else
+            {
+                c[i]->select = NWIPE_SELECT_DISABLED;
+                c[i]->result = -1;
+                c[i]->station_reported = now;
+            }
+        }
+    }
+
+    return count;
+
+} /* nwipe_station_update */
+
 int main( int argc, char** argv )
 {
     int nwipe_optind;  // The result of nwipe_options().
@@ -87,6 +526,7 @@ int main( int argc, char** argv )
     int nwipe_selected = 0;  // The number of contexts that have been selected.
     int any_threads_still_running;  // used in wipe thread cancellation wait loop
     int thread_timeout_counter;  // timeout thread cancellation after THREAD_CANCELLATION_TIMEOUT seconds
+    int busy;  // Whether the main loop needs its timer, see events.c.
     pthread_t nwipe_gui_thread = 0;  // The thread ID of the GUI thread.
     pthread_t nwipe_temperature_thread = 0;  // The thread ID of the temperature update thread
     pthread_t nwipe_sigint_thread;  // The thread ID of the sigint handler.
@@ -161,27 +601,12 @@ int main( int argc, char** argv )
     /* Log OS info */
     nwipe_log_OSinfo();
 
-    /* Check that hdparm exists, we use hdparm for some HPA/DCO detection etc, if not
-     * exit nwipe. These checks are required if the PATH environment is not setup !
-     * Example: Debian sid 'su' as opposed to 'su -'
-     */
-    if( system( "which hdparm > /dev/null 2>&1" ) )
+    /* Measure instead of wiping, the device names are the files or devices to measure. */
+    if( nwipe_options.benchmark )
     {
-        if( system( "which /sbin/hdparm > /dev/null 2>&1" ) )
-        {
-            if( system( "which /usr/bin/hdparm > /dev/null 2>&1" ) )
-            {
-                if( system( "which /usr/sbin/hdparm > /dev/null 2>&1" ) )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "hdparm command not found." );
-                    nwipe_log( NWIPE_LOG_WARNING,
-                               "Required by nwipe for HPA/DCO detection & correction and ATA secure erase." );
-                    nwipe_log( NWIPE_LOG_WARNING, "** Please install hdparm **\n" );
-                    cleanup();
-                    exit( 1 );
-                }
-            }
-        }
+        return_status = nwipe_benchmark( argc - nwipe_optind, &argv[nwipe_optind] );
+        cleanup();
+        exit( return_status == 0 ? 0 : 1 );
     }
 
     /* Check if the given path for PDF reports is a writeable directory */
@@ -206,7 +631,7 @@ int main( int argc, char** argv )
             exit( 1 );
         }
 
-        if( nwipe_enumerated == 0 )
+        if( nwipe_enumerated == 0 && !nwipe_options.station )
         {
             nwipe_log( NWIPE_LOG_INFO,
                        "Storage devices not found. Nwipe should be run as root or sudo/su, i.e sudo nwipe etc" );
@@ -224,7 +649,7 @@ int main( int argc, char** argv )
         argc -= nwipe_optind;
 
         nwipe_enumerated = nwipe_device_get( &c1, argv, argc );
-        if( nwipe_enumerated == 0 )
+        if( nwipe_enumerated == 0 && !nwipe_options.station )
         {
             nwipe_log( NWIPE_LOG_ERROR, "Devices not found. Check you're not excluding drives unnecessarily," );
             nwipe_log( NWIPE_LOG_ERROR, "and you are running nwipe as sudo or as root." );
@@ -247,8 +672,15 @@ int main( int argc, char** argv )
     /* Log the System information */
     nwipe_log_sysinfo();
 
-    /* The array of pointers to contexts that will actually be wiped. */
-    nwipe_context_t** c2 = (nwipe_context_t**) malloc( nwipe_enumerated * sizeof( nwipe_context_t* ) );
+    /* The array of pointers to contexts that will actually be wiped, a station adds to it. */
+    int nwipe_capacity = nwipe_enumerated;
+
+    if( nwipe_options.station && nwipe_capacity < NWIPE_KNOB_STATION_DEVICES )
+    {
+        nwipe_capacity = NWIPE_KNOB_STATION_DEVICES;
+    }
+
+    nwipe_context_t** c2 = (nwipe_context_t**) malloc( nwipe_capacity * sizeof( nwipe_context_t* ) );
     if( c2 == NULL )
     {
         nwipe_log( NWIPE_LOG_ERROR, "memory allocation for c2 failed" );
@@ -298,6 +730,9 @@ int main( int argc, char** argv )
         nwipe_misc_thread_data.gui_thread = &nwipe_gui_thread;
     nwipe_thread_data_ptr.nwipe_misc_thread_data = &nwipe_misc_thread_data;
 
+    /* The other threads wake the main thread up through the events, so they exist before them. */
+    nwipe_events_init();
+
     if( !nwipe_options.nosignals )
     {
         pthread_attr_t pthread_attr;
@@ -402,7 +837,7 @@ int main( int argc, char** argv )
 
     /* Set up the data structures to pass the temperature thread the data it needs */
     nwipe_thread_data_ptr_t nwipe_temperature_thread_data;
-    nwipe_temperature_thread_data.c = c1;
+    nwipe_temperature_thread_data.c = nwipe_options.station ? c2 : c1;
     nwipe_temperature_thread_data.nwipe_misc_thread_data = &nwipe_misc_thread_data;
 
     /* Fork the temperature thread */
@@ -430,12 +865,16 @@ int main( int argc, char** argv )
         }
         else
         {
-            if( nwipe_options.PDF_preview_details == 1 )
+            /* A station may start without drives, they are selected as they are plugged in. */
+            if( nwipe_enumerated > 0 )
             {
-                nwipe_gui_preview_org_customer( SHOWING_PRIOR_TO_DRIVE_SELECTION );
-            }
+                if( nwipe_options.PDF_preview_details == 1 )
+                {
+                    nwipe_gui_preview_org_customer( SHOWING_PRIOR_TO_DRIVE_SELECTION );
+                }
 
-            nwipe_gui_select( nwipe_enumerated, c1 );
+                nwipe_gui_select( nwipe_enumerated, c1 );
+            }
         }
     }
 
@@ -462,9 +901,6 @@ int main( int argc, char** argv )
         c1[i]->bytes_erased = 0;
     }
 
-    /* Pass the number selected to the struct for other threads */
-    nwipe_misc_thread_data.nwipe_selected = nwipe_selected;
-
     /* Populate the array of selected contexts. */
     for( i = 0, j = 0; i < nwipe_enumerated; i++ )
     {
@@ -475,6 +911,9 @@ int main( int argc, char** argv )
         }
     }
 
+    /* Pass the number selected to the struct for other threads, once the array is populated */
+    nwipe_misc_thread_data.nwipe_selected = nwipe_selected;
+
     /* TODO: free c1 and c2 memory. */
     if( user_abort == 0 )
     {
@@ -486,163 +925,32 @@ int main( int argc, char** argv )
 
         for( i = 0; i < nwipe_selected; i++ )
         {
-            /* A result buffer for the BLKGETSIZE64 ioctl. */
-            u64 size64;
-
-            /* Initialise the spinner character index */
-            c2[i]->spinner_idx = 0;
-
-            /* Initialise the start and end time of the wipe */
-            c2[i]->start_time = 0;
-            c2[i]->end_time = 0;
-
-            /* Initialise the wipe_status flag, -1 = wipe not yet started */
-            c2[i]->wipe_status = -1;
-
-            /* Open the file for reads and writes. */
-            c2[i]->device_fd = open( c2[i]->device_name, O_RDWR );
-
-            /* Check the open() result. */
-            if( c2[i]->device_fd < 0 )
-            {
-                nwipe_perror( errno, __FUNCTION__, "open" );
-                nwipe_log( NWIPE_LOG_WARNING, "Unable to open device '%s'.", c2[i]->device_name );
-                c2[i]->select = NWIPE_SELECT_DISABLED;
-                continue;
-            }
-
-            /* Stat the file. */
-            if( fstat( c2[i]->device_fd, &c2[i]->device_stat ) != 0 )
-            {
-                nwipe_perror( errno, __FUNCTION__, "fstat" );
-                nwipe_log( NWIPE_LOG_ERROR, "Unable to stat file '%s'.", c2[i]->device_name );
-                nwipe_error++;
-                continue;
-            }
-
-            /* Check that the file is a block device. */
-            if( !S_ISBLK( c2[i]->device_stat.st_mode ) )
-            {
-                nwipe_log( NWIPE_LOG_ERROR, "'%s' is not a block device.", c2[i]->device_name );
-                nwipe_error++;
-                continue;
-            }
-
-            /* TODO: Lock the file for exclusive access. */
-            /*
-            if( flock( c2[i]->device_fd, LOCK_EX | LOCK_NB ) != 0 )
-            {
-                    nwipe_perror( errno, __FUNCTION__, "flock" );
-                    nwipe_log( NWIPE_LOG_ERROR, "Unable to lock the '%s' file.", c2[i]->device_name );
-                    nwipe_error++;
-                    continue;
-            }
-            */
-
-            /* Print serial number of device if it exists. */
-            if( strlen( (const char*) c2[i]->device_serial_no ) )
-            {
-                nwipe_log( NWIPE_LOG_NOTICE, "%s has serial number %s", c2[i]->device_name, c2[i]->device_serial_no );
-            }
-
-            /* Do sector size and block size checking. I don't think this does anything useful as logical/Physical
-             * sector sizes are obtained by libparted in check.c */
-            if( ioctl( c2[i]->device_fd, BLKSSZGET, &c2[i]->device_sector_size ) == 0 )
-            {
-
-                if( ioctl( c2[i]->device_fd, BLKBSZGET, &c2[i]->device_block_size ) != 0 )
-                {
-                    nwipe_log( NWIPE_LOG_WARNING, "Device '%s' failed BLKBSZGET ioctl.", c2[i]->device_name );
-                    c2[i]->device_block_size = 0;
-                }
-            }
-            else
-            {
-                nwipe_log( NWIPE_LOG_WARNING, "Device '%s' failed BLKSSZGET ioctl.", c2[i]->device_name );
-                c2[i]->device_sector_size = 0;
-                c2[i]->device_block_size = 0;
-            }
-
-            /* The st_size field is zero for block devices. */
-            /* ioctl( c2[i]->device_fd, BLKGETSIZE64, &c2[i]->device_size ); */
-
-            /* Seek to the end of the device to determine its size. */
-            c2[i]->device_size = lseek( c2[i]->device_fd, 0, SEEK_END );
+            nwipe_error += nwipe_prepare( c2[i] );
+        }
 
-            /* Also ask the driver for the device size. */
-            /* if( ioctl( c2[i]->device_fd, BLKGETSIZE64, &size64 ) ) */
-            if( ioctl( c2[i]->device_fd, _IOR( 0x12, 114, size_t ), &size64 ) )
-            {
-                /* The ioctl failed. */
-                fprintf( stderr, "Error: BLKGETSIZE64 failed  on '%s'.\n", c2[i]->device_name );
-                nwipe_log( NWIPE_LOG_ERROR, "BLKGETSIZE64 failed  on '%s'.\n", c2[i]->device_name );
-                nwipe_error++;
-            }
-            c2[i]->device_size = size64;
+        /* The passes that may run at once share --io-memory, one per stripe of each running wipe. */
+        int passes = nwipe_options.station ? nwipe_capacity : nwipe_selected;
 
-            /* Check whether the two size values agree. */
-            if( c2[i]->device_size != size64 )
-            {
-                /* This could be caused by the linux last-odd-block problem. */
-                fprintf( stderr, "Error: Last-odd-block detected on '%s'.\n", c2[i]->device_name );
-                nwipe_log( NWIPE_LOG_ERROR, "Last-odd-block detected on '%s'.", c2[i]->device_name );
-                nwipe_error++;
-            }
+        if( nwipe_options.max_wipes > 0 && nwipe_options.max_wipes < passes )
+        {
+            passes = nwipe_options.max_wipes;
+        }
 
-            if( c2[i]->device_size == (long long) -1 )
-            {
-                /* We cannot determine the size of this device. */
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log( NWIPE_LOG_ERROR, "Unable to determine the size of '%s'.", c2[i]->device_name );
-                nwipe_error++;
-            }
-            else
-            {
-                /* Reset the file pointer. */
-                r = lseek( c2[i]->device_fd, 0, SEEK_SET );
+        passes *= nwipe_options.write_threads > nwipe_options.verify_threads ? nwipe_options.write_threads
+                                                                              : nwipe_options.verify_threads;
+        nwipe_bufpool_init( passes );
 
-                if( r == (off64_t) -1 )
-                {
-                    nwipe_perror( errno, __FUNCTION__, "lseek" );
-                    nwipe_log( NWIPE_LOG_ERROR, "Unable to reset the '%s' file offset.", c2[i]->device_name );
-                    nwipe_error++;
-                }
-            }
+        /* Start the wipes that --max-wipes and --max-wipes-per-controller allow, the rest are queued. */
+        nwipe_scheduler_init( c2, nwipe_selected );
 
-            if( c2[i]->device_size == 0 )
-            {
-                nwipe_log( NWIPE_LOG_ERROR,
-                           "%s, sect/blk/dev %i/%i/%llu",
-                           c2[i]->device_name,
-                           c2[i]->device_sector_size,
-                           c2[i]->device_block_size,
-                           c2[i]->device_size );
-                nwipe_error++;
-                continue;
-            }
-            else
-            {
-                nwipe_log( NWIPE_LOG_NOTICE,
-                           "%s, sect/blk/dev %i/%i/%llu",
-                           c2[i]->device_name,
-                           c2[i]->device_sector_size,
-                           c2[i]->device_block_size,
-                           c2[i]->device_size );
-            }
+        if( nwipe_scheduler_poll( c2, nwipe_selected ) > 0 )
+        {
+            wipe_threads_started = 1;
+        }
 
-            /* Fork a child process. */
-            errno = pthread_create( &c2[i]->thread, NULL, nwipe_options.method, (void*) c2[i] );
-            if( errno )
-            {
-                nwipe_perror( errno, __FUNCTION__, "pthread_create" );
-                if( !nwipe_options.nogui )
-                    nwipe_gui_free();
-                return errno;
-            }
-            else
-            {
-                wipe_threads_started = 1;
-            }
+        if( nwipe_options.station && nwipe_station_start() != 0 )
+        {
+            nwipe_log( NWIPE_LOG_ERROR, "Unable to watch for drives, the drives plugged in are not added." );
         }
     }
 
@@ -667,35 +975,59 @@ int main( int argc, char** argv )
     /* set getch delay to 2/10th second. */
     halfdelay( 10 );
 
-    i = 0;
-    while( i < nwipe_selected && terminate_signal == 0 )
+    /* Wait for all the wipes to finish, or for a station to be quit, but don't wait if we receive the
+     * terminate signal. The wipe threads, the station and the signal and GUI threads wake this thread
+     * up when there is something to do, see events.c. */
+    while( terminate_signal == 0 )
     {
-        if( i == nwipe_selected )
+        /* A station wipes the drives as they are plugged in, until it is quit. */
+        if( nwipe_options.station )
         {
-            break;
+            nwipe_selected = nwipe_station_update(
+                c2, nwipe_selected, nwipe_capacity, &nwipe_misc_thread_data, nwipe_entropy );
         }
 
-        if( c2[i]->wipe_status != 0 )
+        /* Start the next queued wipes when others have finished. */
+        if( nwipe_scheduler_poll( c2, nwipe_selected ) > 0 )
         {
-            i = 0;
+            wipe_threads_started = 1;
         }
-        else
+
+        if( !nwipe_options.station )
         {
-            i++;
-            continue;
+            for( i = 0; i < nwipe_selected && c2[i]->wipe_status == 0; i++ )
+                ;
+
+            if( i == nwipe_selected )
+            {
+                break;
+            }
         }
-        sleep( 1 ); /* DO NOT REMOVE ! Stops the routine hogging CPU cycles */
+
+        /* The throughput of the links is sampled while wipes run, and the finished drives of a
+         * station are removed once they have lingered, so the timer is only needed until then. */
+        busy = nwipe_scheduler_pending( c2, nwipe_selected );
+
+        for( i = 0; i < nwipe_selected && busy == 0; i++ )
+        {
+            busy = c2[i]->station_reported != 0;
+        }
+
+        nwipe_events_timer( busy ? 1 : 0 );
+        nwipe_events_wait();
+    }
+
+    if( nwipe_options.station )
+    {
+        nwipe_station_stop();
     }
 
     if( terminate_signal != 1 )
     {
         if( !nwipe_options.nowait && !nwipe_options.autopoweroff )
         {
-            do
-            {
-                sleep( 1 );
-
-            } while( terminate_signal != 1 );
+            while( !nwipe_events_sleep( -1 ) )
+                ;
         }
     }
     if( nwipe_options.verbose )
@@ -815,7 +1147,11 @@ int main( int argc, char** argv )
             }
         }
         thread_timeout_counter--;
-        sleep( 1 );
+
+        if( any_threads_still_running )
+        {
+            sleep( 1 );
+        }
     }
 
     /* Now all the wipe threads have finished, we can issue a terminate_signal = 1
@@ -826,6 +1162,7 @@ int main( int argc, char** argv )
      * specifically for a completed wipes/s just for non gui mode.
      */
     terminate_signal = 1;
+    nwipe_events_shutdown();
 
     /* Kill the temperature update thread */
     if( nwipe_temperature_thread )
@@ -853,6 +1190,26 @@ int main( int argc, char** argv )
         }
     }
 
+    nwipe_events_free();
+
+    /* The station has reported the wipes it finished, and the drives it didn't wipe aren't reported. */
+    if( nwipe_options.station )
+    {
+        pthread_mutex_lock( &nwipe_station_mutex );
+
+        for( i = 0, j = 0; i < nwipe_selected; i++ )
+        {
+            if( c2[i]->station_reported == 0 && c2[i]->device_fd >= 0 )
+            {
+                c2[j++] = c2[i];
+            }
+        }
+
+        nwipe_selected = j;
+        nwipe_misc_thread_data.nwipe_selected = nwipe_selected;
+        pthread_mutex_unlock( &nwipe_station_mutex );
+    }
+
     if( nwipe_options.verbose )
     {
         for( i = 0; i < nwipe_selected; i++ )
@@ -994,6 +1351,8 @@ void* signal_hand( void* ptr )
 
             // Log current status. All values are automatically updated by the GUI
             case SIGUSR1:
+                /* The array of a station changes as drives are plugged in and pulled. */
+                pthread_mutex_lock( &nwipe_station_mutex );
                 compute_stats( ptr );
 
                 for( i = 0; i < nwipe_misc_thread_data->nwipe_selected; i++ )
@@ -1062,6 +1421,8 @@ void* signal_hand( void* ptr )
                     }
                 }
 
+                pthread_mutex_unlock( &nwipe_station_mutex );
+
                 break;
 
             case SIGHUP:
@@ -1070,6 +1431,7 @@ void* signal_hand( void* ptr )
             case SIGTERM:
                 /* Set termination flag for main() which will do housekeeping prior to exit */
                 terminate_signal = 1;
+                nwipe_events_shutdown();
 
                 /* Set the user abort flag */
                 user_abort = 1;
@@ -1113,6 +1475,15 @@ int cleanup()
     /* Deallocate libconfig resources */
     config_destroy( &nwipe_cfg );
 
+    /* Deallocate the static pattern buffers */
+    nwipe_pattern_cache_free();
+
+    /* Deallocate the links shared by the devices */
+    nwipe_scheduler_free();
+
+    /* Deallocate the I/O buffers kept for the passes */
+    nwipe_bufpool_free();
+
     /* TODO: Any other cleanup required ? */
 
     return 0;
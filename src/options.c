@@ -20,6 +20,8 @@
  *
  */
 
+#include <limits.h>
+#include <stdint.h>
 #include "nwipe.h"
 #include "context.h"
 #include "method.h"
@@ -32,6 +34,76 @@
 /* The global options struct. */
 nwipe_options_t nwipe_options;
 
+int nwipe_options_parse_size( const char* str, size_t* size )
+{
+    /**
+     * Converts a size argument such as "65536", "512K", "4M" or "1G" into bytes.
+     * The suffixes are binary multiples and are not case sensitive.
+     *
+     * @parameter str   The option argument.
+     * @parameter size  Set to the size in bytes on success.
+     * @returns         0 on success, -1 if the argument is not a valid size.
+     */
+
+    unsigned long long value;
+    char* end;
+
+    errno = 0;
+    value = strtoull( str, &end, 10 );
+
+    if( errno != 0 || end == str )
+    {
+        return -1;
+    }
+
+    switch( *end )
+    {
+        case 'g':
+        case 'G':
+            if( value > ULLONG_MAX / 1024 )
+            {
+                return -1;
+            }
+
+            value *= 1024;
+            /* fall through */
+        case 'm':
+        case 'M':
+            if( value > ULLONG_MAX / 1024 )
+            {
+                return -1;
+            }
+
+            value *= 1024;
+            /* fall through */
+        case 'k':
+        case 'K':
+            if( value > ULLONG_MAX / 1024 )
+            {
+                return -1;
+            }
+
+            value *= 1024;
+            end++;
+            break;
+
+        case 0:
+            break;
+
+        default:
+            return -1;
+    }
+
+    /* A size that doesn't fit is rejected, truncated it would pass the range checks as another size. */
+    if( *end != 0 || value > SIZE_MAX )
+    {
+        return -1;
+    }
+
+    *size = (size_t) value;
+    return 0;
+}
+
 int nwipe_options_parse( int argc, char** argv )
 {
     extern char* optarg;  // The working getopt option argument.
@@ -44,6 +116,8 @@ int nwipe_options_parse( int argc, char** argv )
     extern nwipe_prng_t nwipe_isaac64;
     extern nwipe_prng_t nwipe_add_lagg_fibonacci_prng;
     extern nwipe_prng_t nwipe_xoroshiro256_prng;
+    extern nwipe_prng_t nwipe_aes_ctr_prng;
+    extern nwipe_prng_t nwipe_philox_prng;
 
     /* The getopt() result holder. */
     int nwipe_opt;
@@ -117,6 +191,62 @@ int nwipe_options_parse( int argc, char** argv )
         /* Verify that wipe patterns are being written to the device. */
         { "verify", required_argument, 0, 0 },
 
+        /* The size of each read and write. */
+        { "io-size", required_argument, 0, 0 },
+
+        /* How reads and writes are issued. */
+        { "io-engine", required_argument, 0, 0 },
+
+        /* The number of reads or writes in flight per device. */
+        { "io-depth", required_argument, 0, 0 },
+
+        /* The memory budget of the I/O buffers, and whether they use huge pages. */
+        { "io-memory", required_argument, 0, 0 },
+        { "io-hugepages", no_argument, 0, 0 },
+
+        /* Whether to bypass the page cache. */
+        { "direct", no_argument, 0, 0 },
+
+        /* Whether the device zeroes itself for passes of zeros. */
+        { "zero-offload", no_argument, 0, 0 },
+
+        /* Whether to skip bad sectors instead of failing the device. */
+        { "skip-bad-sectors", no_argument, 0, 0 },
+
+        /* Whether to resume interrupted wipes. */
+        { "resume", no_argument, 0, 0 },
+
+        /* The directory of the checkpoints. */
+        { "state-dir", required_argument, 0, 0 },
+
+        /* The number of blocks the PRNG runs ahead of the I/O. */
+        { "prng-ahead", required_argument, 0, 0 },
+
+        /* The number of regions of a device verified in parallel. */
+        { "verify-threads", required_argument, 0, 0 },
+
+        /* The number of stripes of a device written in parallel. */
+        { "write-threads", required_argument, 0, 0 },
+
+        /* The most devices wiped at once, in all and on each controller. */
+        { "max-wipes", required_argument, 0, 0 },
+        { "max-wipes-per-controller", required_argument, 0, 0 },
+
+        /* The bandwidth of the links shared by devices. */
+        { "link-bandwidth", required_argument, 0, 0 },
+
+        /* Place the wipes on the NUMA nodes of their controllers. */
+        { "numa", no_argument, 0, 0 },
+
+        /* Keep running and wipe the drives as they are plugged in. */
+        { "station", no_argument, 0, 0 },
+
+        /* Whether to read back each block as soon as it is written. */
+        { "verify-inline", no_argument, 0, 0 },
+
+        /* Measure the PRNGs and passes instead of wiping. */
+        { "benchmark", no_argument, 0, 0 },
+
         /* Display program version. */
         { "verbose", no_argument, 0, 'v' },
 
@@ -140,6 +270,26 @@ int nwipe_options_parse( int argc, char** argv )
     nwipe_options.nogui = 0;
     nwipe_options.quiet = 0;
     nwipe_options.sync = DEFAULT_SYNC_RATE;
+    nwipe_options.io_size = 0;
+    nwipe_options.io_engine = NWIPE_IO_ENGINE_AUTO;
+    nwipe_options.io_depth = NWIPE_KNOB_IO_DEPTH;
+    nwipe_options.io_memory = 0;
+    nwipe_options.io_hugepages = 0;
+    nwipe_options.direct = 0;
+    nwipe_options.zero_offload = 0;
+    nwipe_options.skip_bad_sectors = 0;
+    nwipe_options.resume = 0;
+    snprintf( nwipe_options.state_dir, sizeof( nwipe_options.state_dir ), "%s", NWIPE_KNOB_STATE_DIR );
+    nwipe_options.prng_ahead = NWIPE_KNOB_PRNG_AHEAD;
+    nwipe_options.verify_threads = 1;
+    nwipe_options.verify_inline = 0;
+    nwipe_options.write_threads = 1;
+    nwipe_options.max_wipes = 0;
+    nwipe_options.max_wipes_per_controller = 0;
+    nwipe_options.link_bandwidth = 0;
+    nwipe_options.numa = 0;
+    nwipe_options.station = 0;
+    nwipe_options.benchmark = 0;
     nwipe_options.verbose = 0;
     nwipe_options.verify = NWIPE_VERIFY_LAST;
     memset( nwipe_options.logfile, '\0', sizeof( nwipe_options.logfile ) );
@@ -279,6 +429,141 @@ int nwipe_options_parse( int argc, char** argv )
                     break;
                 }
 
+                if( strcmp( nwipe_options_long[i].name, "direct" ) == 0 )
+                {
+                    nwipe_options.direct = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "zero-offload" ) == 0 )
+                {
+                    nwipe_options.zero_offload = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "skip-bad-sectors" ) == 0 )
+                {
+                    nwipe_options.skip_bad_sectors = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "resume" ) == 0 )
+                {
+                    nwipe_options.resume = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "state-dir" ) == 0 )
+                {
+                    if( optarg[0] == 0 || strlen( optarg ) >= sizeof( nwipe_options.state_dir ) )
+                    {
+                        fprintf( stderr, "Error: The state-dir argument must be a directory.\n" );
+                        exit( EINVAL );
+                    }
+
+                    snprintf( nwipe_options.state_dir, sizeof( nwipe_options.state_dir ), "%s", optarg );
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "benchmark" ) == 0 )
+                {
+                    /* The results are logged to the console as they are measured. */
+                    nwipe_options.benchmark = 1;
+                    nwipe_options.nogui = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "prng-ahead" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.prng_ahead ) != 1 || nwipe_options.prng_ahead < 0
+                        || nwipe_options.prng_ahead > NWIPE_KNOB_PRNG_AHEAD_MAX )
+                    {
+                        fprintf( stderr,
+                                 "Error: The prng-ahead argument must be an integer between 0 and %i.\n",
+                                 NWIPE_KNOB_PRNG_AHEAD_MAX );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "verify-threads" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.verify_threads ) != 1
+                        || nwipe_options.verify_threads < 1
+                        || nwipe_options.verify_threads > NWIPE_KNOB_VERIFY_THREADS_MAX )
+                    {
+                        fprintf( stderr,
+                                 "Error: The verify-threads argument must be an integer between 1 and %i.\n",
+                                 NWIPE_KNOB_VERIFY_THREADS_MAX );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "write-threads" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.write_threads ) != 1 || nwipe_options.write_threads < 1
+                        || nwipe_options.write_threads > NWIPE_KNOB_WRITE_THREADS_MAX )
+                    {
+                        fprintf( stderr,
+                                 "Error: The write-threads argument must be an integer between 1 and %i.\n",
+                                 NWIPE_KNOB_WRITE_THREADS_MAX );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "max-wipes" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.max_wipes ) != 1 || nwipe_options.max_wipes < 0 )
+                    {
+                        fprintf( stderr, "Error: The max-wipes argument must be a positive integer or 0.\n" );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "max-wipes-per-controller" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.max_wipes_per_controller ) != 1
+                        || nwipe_options.max_wipes_per_controller < 0 )
+                    {
+                        fprintf( stderr,
+                                 "Error: The max-wipes-per-controller argument must be a positive integer or 0.\n" );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "link-bandwidth" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.link_bandwidth ) != 1
+                        || nwipe_options.link_bandwidth < 0 )
+                    {
+                        fprintf( stderr, "Error: The link-bandwidth argument must be a positive integer or 0.\n" );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "numa" ) == 0 )
+                {
+                    nwipe_options.numa = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "station" ) == 0 )
+                {
+                    nwipe_options.station = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "verify-inline" ) == 0 )
+                {
+                    nwipe_options.verify_inline = 1;
+                    break;
+                }
+
                 if( strcmp( nwipe_options_long[i].name, "verbose" ) == 0 )
                 {
                     nwipe_options.verbose = 1;
@@ -295,6 +580,79 @@ int nwipe_options_parse( int argc, char** argv )
                     break;
                 }
 
+                if( strcmp( nwipe_options_long[i].name, "io-size" ) == 0 )
+                {
+                    if( strcmp( optarg, "auto" ) == 0 )
+                    {
+                        nwipe_options.io_size = 0;
+                        break;
+                    }
+
+                    if( nwipe_options_parse_size( optarg, &nwipe_options.io_size ) != 0
+                        || nwipe_options.io_size < NWIPE_KNOB_IO_SIZE_MIN
+                        || nwipe_options.io_size > NWIPE_KNOB_IO_SIZE_MAX || nwipe_options.io_size % 512 != 0 )
+                    {
+                        fprintf( stderr,
+                                 "Error: The io-size argument must be 'auto' or a multiple of 512 bytes between "
+                                 "4K and 64M.\n" );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "io-engine" ) == 0 )
+                {
+                    if( strcmp( optarg, "auto" ) == 0 )
+                    {
+                        nwipe_options.io_engine = NWIPE_IO_ENGINE_AUTO;
+                        break;
+                    }
+
+                    if( strcmp( optarg, "sync" ) == 0 )
+                    {
+                        nwipe_options.io_engine = NWIPE_IO_ENGINE_SYNC;
+                        break;
+                    }
+
+                    if( strcmp( optarg, "uring" ) == 0 || strcmp( optarg, "io_uring" ) == 0 )
+                    {
+                        nwipe_options.io_engine = NWIPE_IO_ENGINE_URING;
+                        break;
+                    }
+
+                    fprintf( stderr, "Error: Unknown I/O engine '%s'.\n", optarg );
+                    exit( EINVAL );
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "io-depth" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.io_depth ) != 1 || nwipe_options.io_depth < 1
+                        || nwipe_options.io_depth > NWIPE_KNOB_IO_DEPTH_MAX )
+                    {
+                        fprintf( stderr,
+                                 "Error: The io-depth argument must be an integer between 1 and %i.\n",
+                                 NWIPE_KNOB_IO_DEPTH_MAX );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "io-memory" ) == 0 )
+                {
+                    if( nwipe_options_parse_size( optarg, &nwipe_options.io_memory ) != 0 )
+                    {
+                        fprintf( stderr, "Error: The io-memory argument must be a size such as 512M or 4G, or 0.\n" );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "io-hugepages" ) == 0 )
+                {
+                    nwipe_options.io_hugepages = 1;
+                    break;
+                }
+
                 if( strcmp( nwipe_options_long[i].name, "verify" ) == 0 )
                 {
 
@@ -508,6 +866,16 @@ int nwipe_options_parse( int argc, char** argv )
                     nwipe_options.prng = &nwipe_xoroshiro256_prng;
                     break;
                 }
+                if( strcmp( optarg, "aes_ctr_prng" ) == 0 )
+                {
+                    nwipe_options.prng = &nwipe_aes_ctr_prng;
+                    break;
+                }
+                if( strcmp( optarg, "philox_prng" ) == 0 )
+                {
+                    nwipe_options.prng = &nwipe_philox_prng;
+                    break;
+                }
 
                 /* Else we do not know this PRNG. */
                 fprintf( stderr, "Error: Unknown prng '%s'.\n", optarg );
@@ -559,6 +927,8 @@ void nwipe_options_log( void )
     extern nwipe_prng_t nwipe_isaac64;
     extern nwipe_prng_t nwipe_add_lagg_fibonacci_prng;
     extern nwipe_prng_t nwipe_xoroshiro256_prng;
+    extern nwipe_prng_t nwipe_aes_ctr_prng;
+    extern nwipe_prng_t nwipe_philox_prng;
 
     /**
      *  Prints a manifest of options to the log.
@@ -604,6 +974,77 @@ void nwipe_options_log( void )
         nwipe_log( NWIPE_LOG_NOTICE, "  do not show GUI interface" );
     }
 
+    if( nwipe_options.direct )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  bypass the page cache (O_DIRECT)" );
+    }
+
+    if( nwipe_options.zero_offload )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  offload passes of zeros to the device" );
+    }
+
+    if( nwipe_options.skip_bad_sectors )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  skip bad sectors" );
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE, "  state-dir = %s", nwipe_options.state_dir );
+
+    if( nwipe_options.resume )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  resume interrupted wipes" );
+    }
+
+    if( nwipe_options.prng_ahead > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  prng-ahead = %i blocks", nwipe_options.prng_ahead );
+    }
+    else
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  prng-ahead = 0 (no PRNG thread)" );
+    }
+
+    if( nwipe_options.verify_threads > 1 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  verify-threads = %i", nwipe_options.verify_threads );
+    }
+
+    if( nwipe_options.write_threads > 1 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  write-threads = %i", nwipe_options.write_threads );
+    }
+
+    if( nwipe_options.verify_inline )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  verify each block as it is written" );
+    }
+
+    if( nwipe_options.max_wipes > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  max-wipes = %i", nwipe_options.max_wipes );
+    }
+
+    if( nwipe_options.max_wipes_per_controller > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  max-wipes-per-controller = %i", nwipe_options.max_wipes_per_controller );
+    }
+
+    if( nwipe_options.link_bandwidth > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  link-bandwidth = %i MB/s", nwipe_options.link_bandwidth );
+    }
+
+    if( nwipe_options.numa )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  wipe on the NUMA nodes of the controllers" );
+    }
+
+    if( nwipe_options.station )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  station, drives are added as they are plugged in" );
+    }
+
     nwipe_log( NWIPE_LOG_NOTICE, "  banner   = %s", banner );
 
     if( nwipe_options.prng == &nwipe_twister )
@@ -618,6 +1059,14 @@ void nwipe_options_log( void )
     {
         nwipe_log( NWIPE_LOG_NOTICE, "  prng     = XORoshiro-256 (EXPERIMENTAL!)" );
     }
+    else if( nwipe_options.prng == &nwipe_aes_ctr_prng )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  prng     = AES-256-CTR" );
+    }
+    else if( nwipe_options.prng == &nwipe_philox_prng )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  prng     = Philox4x64-10" );
+    }
     else if( nwipe_options.prng == &nwipe_isaac )
     {
         nwipe_log( NWIPE_LOG_NOTICE, "  prng     = Isaac" );
@@ -636,6 +1085,40 @@ void nwipe_options_log( void )
     nwipe_log( NWIPE_LOG_NOTICE, "  rounds   = %i", nwipe_options.rounds );
     nwipe_log( NWIPE_LOG_NOTICE, "  sync     = %i", nwipe_options.sync );
 
+    if( nwipe_options.io_size )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  io-size  = %zu", nwipe_options.io_size );
+    }
+    else
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  io-size  = auto" );
+    }
+
+    switch( nwipe_options.io_engine )
+    {
+        case NWIPE_IO_ENGINE_SYNC:
+            nwipe_log( NWIPE_LOG_NOTICE, "  io-engine = sync" );
+            break;
+
+        case NWIPE_IO_ENGINE_URING:
+            nwipe_log( NWIPE_LOG_NOTICE, "  io-engine = io_uring, depth %i", nwipe_options.io_depth );
+            break;
+
+        default:
+            nwipe_log( NWIPE_LOG_NOTICE, "  io-engine = auto, depth %i", nwipe_options.io_depth );
+            break;
+    }
+
+    if( nwipe_options.io_memory > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  io-memory = %zu", nwipe_options.io_memory );
+    }
+
+    if( nwipe_options.io_hugepages )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  io-hugepages = on" );
+    }
+
     switch( nwipe_options.verify )
     {
         case NWIPE_VERIFY_NONE:
@@ -683,7 +1166,75 @@ void display_help()
     puts( "                                 nwipe to appear to hang" );
     puts( "                          1    - fdatasync after every write" );
     puts( "                                 Warning: Lower values will reduce wipe speeds." );
-    puts( "                          1000 - fdatasync after 1000 writes etc.\n" );
+    puts( "                          1000 - fdatasync after 1000 writes etc." );
+    puts( "                          Writes are counted in units of the device block size" );
+    puts( "                          irrespective of --io-size.\n" );
+    puts( "      --io-size=SIZE      The size of each read and write, e.g. 256K, 1M, 16M" );
+    puts( "                          Accepts 4K to 64M (default: auto)" );
+    puts( "                          auto - Tune to the optimal I/O size and maximum" );
+    puts( "                                 request size reported by each device.\n" );
+    puts( "      --io-engine=ENGINE  How reads and writes are issued (default: auto)" );
+    puts( "                          auto  - io_uring if the kernel supports it, else sync" );
+    puts( "                          uring - Keep io-depth reads/writes in flight" );
+    puts( "                          sync  - One read/write at a time\n" );
+    printf( "      --io-depth=NUM      Reads/writes in flight per device with io_uring\n" );
+    printf( "                          (default: %d)\n\n", NWIPE_KNOB_IO_DEPTH );
+    puts( "      --io-memory=SIZE    Keep the I/O buffers of all the devices within SIZE" );
+    puts( "                          bytes, e.g. 4G, shared fairly; queues are made" );
+    puts( "                          shallower to fit (default: 0, no limit)\n" );
+    puts( "      --io-hugepages      Back the I/O buffers with huge pages\n" );
+    puts( "      --direct            Open the devices with O_DIRECT, bypassing the page" );
+    puts( "                          cache. Reduces memory pressure and sync stalls when" );
+    puts( "                          wiping many drives at once\n" );
+    puts( "      --zero-offload      Let devices that support it zero themselves for the" );
+    puts( "                          blanking pass and other passes of zeros (BLKZEROOUT," );
+    puts( "                          WRITE ZEROES). The verification still reads them\n" );
+    puts( "      --skip-bad-sectors  Retry a failed write or read in smaller pieces down" );
+    puts( "                          to single sectors, then skip and record the sectors" );
+    puts( "                          that still fail instead of failing the device\n" );
+    puts( "      --resume            Resume the interrupted wipes of the selected devices" );
+    puts( "                          from their last checkpoint. The serial number, size," );
+    puts( "                          method, PRNG, rounds and verification must match\n" );
+    puts( "      --state-dir=DIR     Directory the checkpoints of each wipe are written to" );
+    printf( "                          every %d seconds (default: %s)\n\n",
+            NWIPE_KNOB_CHECKPOINT_INTERVAL,
+            NWIPE_KNOB_STATE_DIR );
+    puts( "      --benchmark         Measure the speed of each PRNG and of the static" );
+    puts( "                          patterns on one core, then of the passes on any" );
+    puts( "                          files or loop devices given, which are overwritten." );
+    puts( "                          Other devices given are only read. Nothing is wiped\n" );
+    puts( "      --prng-ahead=NUM    Blocks a separate PRNG thread generates ahead of the" );
+    puts( "                          writes and verification reads of each device, so" );
+    puts( "                          generation overlaps I/O. 0 - no PRNG thread" );
+    printf( "                          (default: %d)\n\n", NWIPE_KNOB_PRNG_AHEAD );
+    puts( "      --verify-threads=NUM" );
+    puts( "                          Verify NUM regions of each device in parallel when" );
+    puts( "                          the PRNG can start at any offset (aes_ctr_prng," );
+    puts( "                          philox_prng) and for static patterns. Best left at" );
+    puts( "                          1 for spinning disks (default: 1)\n" );
+    puts( "      --write-threads=NUM" );
+    puts( "                          Write NUM stripes of each device in parallel, for" );
+    puts( "                          devices that need several streams to reach their" );
+    puts( "                          bandwidth, e.g. NVMe (default: 1)\n" );
+    puts( "      --max-wipes=NUM     Wipe at most NUM devices at once, the others wait in" );
+    puts( "                          a queue and start as wipes finish (default: 0, no" );
+    puts( "                          limit)\n" );
+    puts( "      --max-wipes-per-controller=NUM" );
+    puts( "                          Wipe at most NUM devices at once on each controller" );
+    puts( "                          or SAS expander, found in sysfs (default: 0, no" );
+    puts( "                          limit)\n" );
+    puts( "      --link-bandwidth=MB Share MB megabytes per second between the devices" );
+    puts( "                          behind each USB hub, SAS expander or SATA port" );
+    puts( "                          multiplier, in turn (default: 0, no limit)\n" );
+    puts( "      --numa              Run each wipe on the CPUs of the NUMA node of its" );
+    puts( "                          controller, with buffers from that node's memory\n" );
+    puts( "      --station           Keep running and add drives as they are plugged in," );
+    puts( "                          with --autonuke they are wiped at once, otherwise" );
+    puts( "                          when S is pressed. Finished and pulled drives are" );
+    puts( "                          reported and removed from the status window\n" );
+    puts( "      --verify-inline     Read back each block of a verified pass as soon as" );
+    puts( "                          it is written and compare it with the data still in" );
+    puts( "                          memory, instead of a separate verification pass.\n" );
     puts( "      --verify=TYPE       Whether to perform verification of erasure" );
     puts( "                          (default: last)" );
     puts( "                          off   - Do not verify" );
@@ -708,8 +1259,9 @@ void display_help()
     puts( "  -l, --logfile=FILE      Filename to log to. Default is STDOUT\n" );
     puts( "  -P, --PDFreportpath=PATH Path to write PDF reports to. Default is \".\"" );
     puts( "                           If set to \"noPDF\" no PDF reports are written.\n" );
-    puts( "  -p, --prng=METHOD       PRNG option "
-          "(mersenne|twister|isaac|isaac64|add_lagg_fibonacci_prng|xoroshiro256_prng)\n" );
+    puts( "  -p, --prng=METHOD       PRNG option (mersenne|twister|isaac|isaac64|" );
+    puts( "                          add_lagg_fibonacci_prng|xoroshiro256_prng|" );
+    puts( "                          aes_ctr_prng|philox_prng)\n" );
     puts( "  -q, --quiet             Anonymize logs and the GUI by removing unique data, i.e." );
     puts( "                          serial numbers, LU WWN Device ID, and SMBIOS/DMI data" );
     puts( "                          XXXXXX = S/N exists, ????? = S/N not obtainable\n" );
@@ -38,15 +38,44 @@
 #define MAX_NUMBER_EXCLUDED_DRIVES 32
 #define MAX_DRIVE_PATH_LENGTH 200  // e.g. /dev/sda is only 8 characters long, so 200 should be plenty.
 #define DEFAULT_SYNC_RATE 100000
+#define NWIPE_KNOB_IO_SIZE ( 1024 * 1024 )  // The default read/write size when it can't be tuned to the device.
+#define NWIPE_KNOB_IO_SIZE_MIN 4096  // The smallest read/write size accepted by --io-size.
+#define NWIPE_KNOB_IO_SIZE_MAX ( 64 * 1024 * 1024 )  // The largest read/write size.
+#define NWIPE_KNOB_IO_DEPTH 4  // The default number of reads/writes kept in flight per device by io_uring.
+#define NWIPE_KNOB_IO_DEPTH_MAX 256
+#define NWIPE_KNOB_PRNG_AHEAD 4  // The default number of blocks the PRNG generator thread runs ahead of the I/O.
+#define NWIPE_KNOB_PRNG_AHEAD_MAX 64
+#define NWIPE_KNOB_ZERO_OFFLOAD_SIZE ( 256 * 1024 * 1024 )  // The bytes zeroed by each request of --zero-offload.
+#define NWIPE_KNOB_PATTERN_CACHE ( 64 * 1024 * 1024 )  // Memory kept for static pattern buffers between passes.
+#define NWIPE_KNOB_PROBE_TIMEOUT 60  // The seconds a device may take to be probed before it is left out.
+#define NWIPE_KNOB_STATION_DEVICES 64  // The most drives --station holds at once.
+#define NWIPE_KNOB_STATION_SETTLE 2  // The seconds --station waits for more drives before probing those plugged in.
+#define NWIPE_KNOB_STATION_LINGER 60  // The seconds a finished drive stays in the status window of --station.
+#define NWIPE_KNOB_VERIFY_THREADS_MAX 64  // The most regions of a device verified in parallel by --verify-threads.
+#define NWIPE_KNOB_WRITE_THREADS_MAX 64  // The most stripes of a device written in parallel by --write-threads.
+#define NWIPE_KNOB_VERIFY_LOG_MISMATCHES 16  // The verification mismatches of a pass that are logged with their offset.
+#define NWIPE_KNOB_BADMAP_EXTENTS 65536  // The most failed regions recorded in the bad region map of a device.
+#define NWIPE_KNOB_BAD_RUN_MAX ( 8 * 1024 * 1024 )  // The bytes in a row --skip-bad-sectors skips before failing.
+#define NWIPE_KNOB_STATE_DIR "/var/lib/nwipe"  // The default directory of the checkpoints of the wipes.
+#define NWIPE_KNOB_CHECKPOINT_INTERVAL 60  // The seconds between the checkpoints of a wipe.
+#define NWIPE_KNOB_BENCHMARK_SECONDS 2  // How long each PRNG and the pattern copy are timed by --benchmark.
+#define NWIPE_KNOB_BENCHMARK_SIZE ( 1024 * 1024 * 1024 )  // The number of bytes of a file or device --benchmark uses.
 #define PATHNAME_MAX 2048
 
 /* Function prototypes for loading options from the environment and command line. */
 int nwipe_options_parse( int argc, char** argv );
 void nwipe_options_log( void );
+int nwipe_options_parse_size( const char* str, size_t* size );
 
 /* Function to display help text */
 void display_help();
 
+typedef enum nwipe_io_engine_t_ {
+    NWIPE_IO_ENGINE_AUTO = 0,  // Use io_uring when the kernel supports it, otherwise synchronous I/O.
+    NWIPE_IO_ENGINE_SYNC,  // One synchronous read or write at a time.
+    NWIPE_IO_ENGINE_URING  // Keep io_depth reads or writes in flight with io_uring.
+} nwipe_io_engine_t;
+
 typedef struct
 {
     int autonuke;  // Do not prompt the user for confirmation when set.
@@ -65,6 +94,26 @@ typedef struct
     int quiet;  // Anonymize serial numbers
     int rounds;  // The number of times that the wipe method should be called.
     int sync;  // A flag to indicate whether and how often writes should be sync'd.
+    size_t io_size;  // The size in bytes of each read and write, 0 = tune to each device.
+    nwipe_io_engine_t io_engine;  // How reads and writes are issued to the devices.
+    int io_depth;  // The number of reads or writes kept in flight per device by io_uring.
+    size_t io_memory;  // The memory all the I/O buffers are kept within, 0 = no limit.
+    int io_hugepages;  // Back the I/O buffers with huge pages.
+    int direct;  // Open the devices with O_DIRECT, bypassing the page cache.
+    int zero_offload;  // Let the device zero itself, BLKZEROOUT or FALLOC_FL_ZERO_RANGE, for passes of zeros.
+    int skip_bad_sectors;  // Skip the sectors that can't be written or read instead of failing the device.
+    int resume;  // Resume the interrupted wipes recorded in the state directory.
+    char state_dir[PATHNAME_MAX];  // The directory the checkpoints of the wipes are written to.
+    int prng_ahead;  // The number of blocks generated ahead of the I/O by a PRNG thread, 0 = no PRNG thread.
+    int verify_threads;  // The number of regions of each device verified in parallel when the PRNG can seek.
+    int write_threads;  // The number of stripes of each device written in parallel.
+    int max_wipes;  // The most devices wiped at once, 0 = no limit.
+    int max_wipes_per_controller;  // The most devices wiped at once on each controller or SAS expander, 0 = no limit.
+    int link_bandwidth;  // The bandwidth shared by the devices on a link in MB/s, 0 = not limited.
+    int numa;  // Run each wipe on the CPUs and memory of the NUMA node of its controller.
+    int station;  // Keep running and add the drives that are plugged in, from the kernel uevents.
+    int verify_inline;  // Read back each block of a verified pass as soon as it is written, with O_DIRECT.
+    int benchmark;  // Measure the PRNGs and passes instead of wiping.
     int verbose;  // Make log more verbose
     int PDF_enable;  // 0=PDF creation disabled, 1=PDF creation enabled
     int PDF_preview_details;  // 0=Disable preview Org/Cust/date/time before drive selection, 1=Enable Preview
@@ -22,6 +22,11 @@
 
 #define _POSIX_C_SOURCE 200809L
 
+/* Required for O_DIRECT. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdint.h>
 #include "nwipe.h"
 #include "context.h"
@@ -31,518 +36,611 @@
 #include "pass.h"
 #include "logging.h"
 #include "gui.h"
-
-int nwipe_random_verify( nwipe_context_t* c )
+#include "uring.h"
+#include "compare.h"
+#include "badmap.h"
+#include "checkpoint.h"
+#include "scheduler.h"
+#include "bufpool.h"
+
+/* A block of a pass that is queued or in flight. */
+typedef struct nwipe_pass_slot_t_
+{
+    char* buffer;  // The I/O buffer of this slot, device_io_size bytes.
+    char* data;  // The data that is written, the slot buffer or a window into the pattern buffer.
+    u64 offset;  // The device offset of the block.
+    size_t length;  // The length of the block.
+    int result;  // The io_uring completion result, bytes transferred or -errno.
+    int complete;  // Set when the io_uring request has completed.
+    int queued;  // Set when the block was issued through io_uring.
+    int data_index;  // The index of the registered io_uring buffer that holds the data.
+} nwipe_pass_slot_t;
+
+/* The PRNG thread of a random pass, which generates the stream into a ring of blocks ahead of the I/O. */
+typedef struct nwipe_pass_generator_t_
+{
+    char** buffer;  // The ring of generated blocks, NULL when the stream is generated in the wipe thread.
+    int count;  // The number of blocks in the ring.
+    int index;  // The index of the first registered io_uring buffer of the ring.
+    u64 blocks;  // The number of blocks in the pass.
+    u64 generated;  // The number of blocks that have been generated.
+    u64 consumed;  // The number of blocks that have been taken by the wipe thread.
+    u64 released;  // The number of blocks the wipe thread has finished with.
+    int running;  // Set while the thread exists.
+    int stop;  // Set to make the thread exit.
+    pthread_t thread;  // The thread.
+    pthread_mutex_t lock;  // Protects the counters.
+    pthread_cond_t ready;  // Signalled when a block has been generated.
+    pthread_cond_t space;  // Signalled when a block has been released.
+    double prng_wait;  // Seconds the wipe thread waited for the PRNG, i.e. generator-bound time.
+    double device_wait;  // Seconds the PRNG waited for the wipe thread, i.e. device-bound time.
+} nwipe_pass_generator_t;
+
+/* A buffer that repeats a static pattern, shared by the passes of all the devices. */
+typedef struct nwipe_pattern_cache_t_
+{
+    struct nwipe_pattern_cache_t_* next;  // The next buffer in the cache.
+    char* pattern;  // A copy of the pattern.
+    int length;  // The length of the pattern.
+    size_t align;  // The alignment of the buffer.
+    size_t io_size;  // The largest block that is written from or compared with the buffer.
+    size_t period;  // The least common multiple of the pattern length and the alignment.
+    size_t size;  // The size of the buffer, period + io_size bytes.
+    char* buffer;  // The pattern repeated over the whole buffer.
+    int users;  // The number of passes that are using the buffer.
+    u64 used;  // When the buffer was last released, for the eviction of the least recently used.
+} nwipe_pattern_cache_t;
+
+/* The state of one pass over a device. */
+typedef struct nwipe_pass_job_t_
+{
+    nwipe_context_t* c;  // The device.
+    u64 start;  // The offset of the first byte of the pass, a multiple of device_io_size.
+    u64 end;  // The offset after the last byte of the pass, 0 for the end of the device.
+    int verify;  // 0 = write the pass, 1 = read the pass back and compare it.
+    nwipe_pattern_t* pattern;  // The static pattern, NULL for the PRNG stream.
+    int uniform;  // Set when a verified pattern repeats one byte, it is compared without the pattern buffer.
+    nwipe_pattern_cache_t* pattern_cache;  // The buffer of the static pattern.
+    char* pattern_buffer;  // The pattern repeated over the pattern cache buffer.
+    char* expected;  // The expected data when verifying the PRNG stream.
+    int readback;  // Set when each block is read back and compared as soon as it is written, --verify-inline.
+    char* readback_buffer;  // The buffer that the written blocks are read back into.
+    nwipe_pass_slot_t* slot;  // The ring of blocks, the oldest block is always completed first.
+    int depth;  // The number of slots.
+    int ahead;  // The number of blocks generated ahead by the PRNG thread, 0 = no PRNG thread.
+    int reserved;  // The number of buffers reserved in the buffer pool.
+    int inflight;  // The number of io_uring requests that have not completed.
+    int use_uring;  // Set when the blocks are issued through io_uring.
+    nwipe_uring_t ring;  // The io_uring instance.
+    nwipe_pass_generator_t gen;  // The PRNG thread.
+    u64 mismatches;  // The number of sub-blocks of the pass that failed the verification.
+    u64 skipped;  // The number of bytes skipped by --skip-bad-sectors.
+    u64 bad_run;  // The number of bytes in a row that have been skipped.
+    u64 bad_end;  // The offset after the last skipped byte.
+    int checkpoint;  // Set when the progress of the pass is recorded in the checkpoint of the wipe.
+} nwipe_pass_job_t;
+
+struct nwipe_pass_regions_t_;
+
+/* A region of a device that is passed over by its own thread. */
+typedef struct nwipe_pass_region_t_
+{
+    struct nwipe_pass_regions_t_* set;  // The regions of the device.
+    nwipe_context_t c;  // A copy of the device context with its own PRNG state and counters.
+    nwipe_pass_job_t job;  // The pass over the region.
+    u8* seed;  // The seed of the stream of the region when the PRNG can't seek, NULL otherwise.
+    pthread_t thread;  // The thread.
+    int running;  // Set while the thread has not been joined.
+    int result;  // The result of the pass over the region.
+} nwipe_pass_region_t;
+
+/* The regions of a device that are passed over in parallel. */
+typedef struct nwipe_pass_regions_t_
+{
+    nwipe_context_t* c;  // The device.
+    nwipe_pass_region_t* region;  // The regions, in device order.
+    int count;  // The number of regions.
+    int active;  // The number of threads that have not finished.
+    u64 round_done;  // The progress of the round before the pass.
+    pthread_mutex_t lock;  // Protects active.
+    pthread_cond_t finished;  // Signalled when a thread finishes.
+} nwipe_pass_regions_t;
+
+static void nwipe_verify_mismatch( nwipe_pass_job_t* job, u64 offset, u64 end, size_t bytes )
 {
     /**
-     * Verifies that a random pass was correctly written to the device.
-     *
+     * Accounts for a sub-block that failed the verification, from the offset of its
+     * first byte that differs to the end of the sub-block, and records it in the bad
+     * region map. The first mismatches of a pass are logged with their offsets.
      */
 
-    /* The result holder. */
-    int r;
-
-    /* The IO size. */
-    size_t blocksize;
-
-    /* The result buffer for calls to lseek. */
-    off64_t offset;
-
-    /* The input buffer. */
-    char* b;
-
-    /* The pattern buffer that is used to check the input buffer. */
-    char* d;
-
-    /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
-
-    if( c->prng_seed.s == NULL )
-    {
-        nwipe_log( NWIPE_LOG_SANITY, "Null seed pointer." );
-        return -1;
-    }
-
-    if( c->prng_seed.length <= 0 )
-    {
-        nwipe_log( NWIPE_LOG_SANITY, "The entropy length member is %i.", c->prng_seed.length );
-        return -1;
-    }
+    nwipe_context_t* c = job->c;
 
-    /* Create the input buffer. */
-    b = malloc( c->device_stat.st_blksize );
+    c->verify_errors++;
+    c->verify_mismatch_bytes += bytes;
+    job->mismatches++;
 
-    /* Check the memory allocation. */
-    if( !b )
+    if( c->verify_quiet )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
-        return -1;
+        return;
     }
 
-    /* Create the pattern buffer */
-    d = malloc( c->device_stat.st_blksize );
+    nwipe_badmap_add( c, offset, end - offset, NWIPE_BADMAP_VERIFY );
 
-    /* Check the memory allocation. */
-    if( !d )
+    if( job->mismatches <= NWIPE_KNOB_VERIFY_LOG_MISMATCHES )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
-        free( b );
-        return -1;
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "Verification mismatch on '%s' at offset %llu, %zu bytes differ up to offset %llu.",
+                   c->device_name,
+                   offset,
+                   bytes,
+                   end );
     }
 
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
-
-    /* Reset the pass byte counter. */
-    c->pass_done = 0;
-
-    if( offset == (off64_t) -1 )
+    if( job->mismatches == NWIPE_KNOB_VERIFY_LOG_MISMATCHES )
     {
-        nwipe_perror( errno, __FUNCTION__, "lseek" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        free( b );
-        free( d );
-        return -1;
+        nwipe_log( NWIPE_LOG_WARNING, "Further verification mismatches on '%s' are not logged.", c->device_name );
     }
 
-    if( offset != 0 )
-    {
-        /* This is system insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "lseek() returned a bogus offset on '%s'.", c->device_name );
-        free( b );
-        free( d );
-        return -1;
-    }
+} /* nwipe_verify_mismatch */
 
-    /* Tell our parent that we are syncing the device. */
-    c->sync_status = 1;
+static void nwipe_verify_compare( nwipe_pass_job_t* job, const char* b, const char* d, u64 offset, size_t length )
+{
+    /**
+     * Compares data read from the device at the given offset with the expected data
+     * in d, or with the byte of a uniform pattern when d is NULL. A mismatch counts as
+     * one verification error per st_blksize sub-block, so that the error count does
+     * not depend on the I/O size, and the bytes that differ are counted exactly.
+     */
 
-    /* Sync the device. */
-    r = fdatasync( c->device_fd );
+    nwipe_context_t* c = job->c;
+    size_t subblock = c->device_stat.st_blksize;
 
-    /* Tell our parent that we have finished syncing the device. */
-    c->sync_status = 0;
+    /* The byte of a uniform pattern. */
+    unsigned char x = job->uniform ? (unsigned char) job->pattern->s[0] : 0;
 
-    if( r != 0 )
-    {
-        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
-        nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
-        c->fsyncdata_errors++;
-    }
+    /* The position of the first byte that differs, and the end of its sub-block. */
+    size_t pos = 0;
+    size_t end;
 
-    /* Reseed the PRNG. */
-    c->prng->init( &c->prng_state, &c->prng_seed );
+    /* The number of bytes of the sub-block that differ. */
+    size_t bytes;
 
-    while( z > 0 )
+    while( pos < length )
     {
-        if( c->device_stat.st_blksize <= z )
+        if( d == NULL )
         {
-            blocksize = c->device_stat.st_blksize;
+            pos += nwipe_compare_find_byte( b + pos, x, length - pos );
         }
         else
         {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
+            pos += nwipe_compare_find( b + pos, d + pos, length - pos );
         }
 
-        /* Fill the output buffer with the random pattern. */
-        c->prng->read( &c->prng_state, d, blocksize );
+        if( pos == length )
+        {
+            break;
+        }
 
-        /* Read the buffer in from the device. */
-        r = read( c->device_fd, b, blocksize );
+        end = pos + subblock - ( offset + pos ) % subblock;
 
-        /* Check the result. */
-        if( r < 0 )
+        if( end > length )
         {
-            nwipe_perror( errno, __FUNCTION__, "read" );
-            nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
-            return -1;
+            end = length;
         }
 
-        /* Check for a partial read. */
-        if( r != blocksize )
+        if( d == NULL )
+        {
+            bytes = nwipe_compare_count_byte( b + pos, x, end - pos );
+        }
+        else
         {
-            /* TODO: Handle a partial read. */
+            bytes = nwipe_compare_count( b + pos, d + pos, end - pos );
+        }
 
-            /* The number of bytes that were not read. */
-            int s = blocksize - r;
+        nwipe_verify_mismatch( job, offset + pos, offset + end, bytes );
 
-            nwipe_log(
-                NWIPE_LOG_WARNING, "%s: Partial read from '%s', %i bytes short.", __FUNCTION__, c->device_name, s );
+        pos = end;
+    }
+
+} /* nwipe_verify_compare */
 
-            /* Increment the error count. */
-            c->verify_errors += 1;
+static int nwipe_skip_sectors( nwipe_pass_job_t* job, u64 offset, size_t length, nwipe_badmap_kind_t kind )
+{
+    /**
+     * Skips sectors that still could not be written or read after the retries of
+     * --skip-bad-sectors. They are counted as errors, bytes for writes as with partial
+     * writes and one per st_blksize sub-block for reads as with partial reads, and
+     * recorded in the bad region map.
+     *
+     * @returns  0 to carry on, -1 when more than NWIPE_KNOB_BAD_RUN_MAX bytes in a row
+     *           have been skipped, e.g. because the device has gone away.
+     */
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+    nwipe_context_t* c = job->c;
+    u64 subblock = c->device_stat.st_blksize;
 
-            if( offset == (off64_t) -1 )
-            {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial read.", c->device_name );
-                return -1;
-            }
+    /* The first and last sub-blocks of the sectors. */
+    u64 first = offset / subblock;
+    u64 last = ( offset + length - 1 ) / subblock;
 
-        } /* partial read */
+    nwipe_badmap_add( c, offset, length, kind );
 
-        /* Compare buffer contents. */
-        if( memcmp( b, d, blocksize ) != 0 )
+    if( kind == NWIPE_BADMAP_WRITE )
+    {
+        c->pass_errors += length;
+    }
+    else
+    {
+        /* The sub-block may already have been counted for the sectors before. */
+        if( job->bad_end == offset && offset % subblock != 0 )
         {
-            c->verify_errors += 1;
+            first++;
         }
 
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
-
-        /* Increment the total progress counters. */
-        c->pass_done += r;
-        c->round_done += r;
+        if( last >= first )
+        {
+            c->verify_errors += last - first + 1;
+        }
+    }
 
-        pthread_testcancel();
+    if( offset != job->bad_end )
+    {
+        job->bad_run = 0;
+    }
 
-    } /* while bytes remaining */
+    job->skipped += length;
+    job->bad_run += length;
+    job->bad_end = offset + length;
 
-    /* Release the buffers. */
-    free( b );
-    free( d );
+    if( job->bad_run > NWIPE_KNOB_BAD_RUN_MAX )
+    {
+        nwipe_log( NWIPE_LOG_FATAL,
+                   "More than %i bytes in a row of '%s' could not be %s, giving up.",
+                   NWIPE_KNOB_BAD_RUN_MAX,
+                   c->device_name,
+                   kind == NWIPE_BADMAP_WRITE ? "written" : "read" );
+        return -1;
+    }
 
-    /* We're done. */
     return 0;
 
-} /* nwipe_random_verify */
+} /* nwipe_skip_sectors */
 
-int nwipe_random_pass( NWIPE_METHOD_SIGNATURE )
+static int nwipe_write_recover( nwipe_pass_job_t* job, const char* b, size_t length, u64 offset )
 {
     /**
-     * Writes a random pattern to the device.
+     * Writes a range that could not be written in one piece by splitting it in halves,
+     * down to single physical sectors, which are skipped if they still fail. A few bad
+     * sectors only cost a few small writes, the rest of the block is still written.
      *
+     * @returns  0 if the range was dealt with, -1 on a fatal error.
      */
 
-    /* The result holder. */
-    int r;
-
-    /* The IO size. */
-    size_t blocksize;
-
-    /* The result buffer for calls to lseek. */
-    off64_t offset;
+    nwipe_context_t* c = job->c;
 
-    /* The output buffer. */
-    char* b;
+    /* The smallest piece that is written, which O_DIRECT also requires. */
+    size_t unit = c->device_io_align;
 
-    /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
+    /* The length of the first piece. */
+    size_t half;
 
-    /* Number of writes to do before a fdatasync. */
-    int syncRate = nwipe_options.sync;
+    /* The result holder. */
+    ssize_t r;
 
-    /* Counter to track when to do a fdatasync. */
-    int i = 0;
+    r = pwrite( c->device_fd, b, length, (off_t) offset );
 
-    /* general index counter */
-    int idx;
+    if( r == (ssize_t) length )
+    {
+        return 0;
+    }
 
-    if( c->prng_seed.s == NULL )
+    /* Carry on after the whole sectors a partial write did write. */
+    if( r > 0 && (size_t) r >= unit )
     {
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: Null seed pointer." );
-        return -1;
+        half = (size_t) r - (size_t) r % unit;
+        return nwipe_write_recover( job, b + half, length - half, offset + half );
     }
 
-    if( c->prng_seed.length <= 0 )
+    if( length <= unit )
     {
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: The entropy length member is %i.", c->prng_seed.length );
-        return -1;
+        return nwipe_skip_sectors( job, offset, length, NWIPE_BADMAP_WRITE );
     }
 
-    /* Create the initialised output buffer. Initialised because we don't want memory leaks
-     * to disk in the event of some future undetected bug in a prng or its implementation. */
-    b = calloc( c->device_stat.st_blksize, sizeof( char ) );
+    half = ( length + unit - 1 ) / unit / 2 * unit;
 
-    /* Check the memory allocation. */
-    if( !b )
+    if( nwipe_write_recover( job, b, half, offset ) != 0 )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the output buffer." );
         return -1;
     }
 
-    /* Seed the PRNG. */
-    c->prng->init( &c->prng_state, &c->prng_seed );
+    return nwipe_write_recover( job, b + half, length - half, offset + half );
 
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
+} /* nwipe_write_recover */
 
-    /* Reset the pass byte counter. */
-    c->pass_done = 0;
+static int nwipe_read_recover( nwipe_pass_job_t* job, char* b, const char* d, size_t length, u64 offset )
+{
+    /**
+     * Reads and compares a range that could not be read in one piece by splitting it
+     * in halves, down to single physical sectors, which are skipped if they still fail.
+     * The expected data d is NULL for a uniform pattern, see nwipe_verify_compare().
+     *
+     * @returns  0 if the range was dealt with, -1 on a fatal error.
+     */
+
+    nwipe_context_t* c = job->c;
+
+    /* The smallest piece that is read, which O_DIRECT also requires. */
+    size_t unit = c->device_io_align;
+
+    /* The length of the first piece. */
+    size_t half;
 
-    if( offset == (off64_t) -1 )
+    /* The result holder. */
+    ssize_t r;
+
+    r = pread( c->device_fd, b, length, (off_t) offset );
+
+    if( r == (ssize_t) length )
     {
-        nwipe_perror( errno, __FUNCTION__, "lseek" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        free( b );
-        return -1;
+        nwipe_verify_compare( job, b, d, offset, length );
+        return 0;
     }
 
-    if( offset != 0 )
+    /* Compare the whole sectors a partial read did read and carry on after them. */
+    if( r > 0 && (size_t) r >= unit )
     {
-        /* This is system insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: lseek() returned a bogus offset on '%s'.", c->device_name );
-        free( b );
-        return -1;
+        half = (size_t) r - (size_t) r % unit;
+        nwipe_verify_compare( job, b, d, offset, half );
+        return nwipe_read_recover( job, b + half, d != NULL ? d + half : NULL, length - half, offset + half );
     }
 
-    while( z > 0 )
+    if( length <= unit )
     {
-        if( c->device_stat.st_blksize <= z )
-        {
-            blocksize = c->device_stat.st_blksize;
-        }
-        else
-        {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
-        }
+        return nwipe_skip_sectors( job, offset, length, NWIPE_BADMAP_READ );
+    }
 
-        /* Fill the output buffer with the random pattern. */
-        c->prng->read( &c->prng_state, b, blocksize );
+    half = ( length + unit - 1 ) / unit / 2 * unit;
 
-        /* For the first block only, check the prng actually wrote something to the buffer */
-        if( z == c->device_size )
-        {
-            idx = c->device_stat.st_blksize - 1;
-            while( idx > 0 )
-            {
-                if( b[idx] != 0 )
-                {
-                    nwipe_log( NWIPE_LOG_NOTICE, "prng stream is active" );
-                    break;
-                }
-                idx--;
-            }
-            if( idx == 0 )
-            {
-                nwipe_log( NWIPE_LOG_FATAL, "ERROR, prng wrote nothing to the buffer" );
-                if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
-                {
-                    c->bytes_erased = c->device_size - z;
-                }
-                return -1;
-            }
-        }
+    if( nwipe_read_recover( job, b, d, half, offset ) != 0 )
+    {
+        return -1;
+    }
 
-        /* Write the next block out to the device. */
-        r = write( c->device_fd, b, blocksize );
+    return nwipe_read_recover( job, b + half, d != NULL ? d + half : NULL, length - half, offset + half );
 
-        /* Check the result for a fatal error. */
-        if( r < 0 )
-        {
-            nwipe_perror( errno, __FUNCTION__, "write" );
-            nwipe_log( NWIPE_LOG_FATAL, "Unable to read from '%s'.", c->device_name );
-            if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
-            {
-                c->bytes_erased = c->device_size - z;
-            }
-            return -1;
-        }
+} /* nwipe_read_recover */
 
-        /* Check for a partial write. */
-        if( r != blocksize )
-        {
-            /* TODO: Handle a partial write. */
+static void nwipe_recovered( nwipe_pass_job_t* job, u64 skipped, u64 offset, size_t length, const char* action )
+{
+    /**
+     * Logs the outcome of the retries of a block that failed, given the skipped bytes
+     * counter from before the retries.
+     */
 
-            /* The number of bytes that were not written. */
-            int s = blocksize - r;
+    nwipe_context_t* c = job->c;
 
-            /* Increment the error count by the number of bytes that were not written. */
-            c->pass_errors += s;
+    if( job->skipped > skipped )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "Skipped %llu bytes of '%s' that could not be %s, in the block at offset %llu.",
+                   job->skipped - skipped,
+                   c->device_name,
+                   action,
+                   offset );
+    }
+    else
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "The block at offset %llu of '%s', %zu bytes, was %s in smaller pieces.",
+                   offset,
+                   c->device_name,
+                   length,
+                   action );
+    }
 
-            nwipe_log( NWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
+} /* nwipe_recovered */
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+static int nwipe_write_block( nwipe_pass_job_t* job, const char* b, size_t blocksize, u64 offset )
+{
+    /**
+     * Writes one I/O block to the device at the given offset.
+     *
+     * A partial write only skips the remainder of the st_blksize sub-block at which
+     * the write stopped, the rest of the block is still written. The pass error count
+     * is incremented by the number of bytes that were skipped.
+     *
+     * A failed write is fatal, unless --skip-bad-sectors is given and the rest of the
+     * block is retried by nwipe_write_recover().
+     *
+     * @returns  0 if the whole block was dealt with, -1 on a fatal error.
+     */
 
-            if( offset == (off64_t) -1 )
-            {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial write.", c->device_name );
-                if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
-                {
-                    c->bytes_erased = c->device_size - z;
-                }
-                return -1;
-            }
+    nwipe_context_t* c = job->c;
 
-        } /* partial write */
+    /* The skipped bytes before the retries of a failed write. */
+    u64 skipped;
 
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
+    /* The result holder. */
+    ssize_t r;
 
-        /* Increment the total progress counters. */
-        c->pass_done += r;
-        c->round_done += r;
+    /* The number of bytes in this block that have been written or skipped. */
+    size_t done = 0;
 
-        /* Perodic Sync */
-        if( syncRate > 0 )
-        {
-            i++;
+    /* The number of bytes that were not written. */
+    size_t s;
 
-            if( i >= syncRate )
-            {
-                /* Tell our parent that we are syncing the device. */
-                c->sync_status = 1;
+    while( done < blocksize )
+    {
+        r = pwrite( c->device_fd, b + done, blocksize - done, (off_t) ( offset + done ) );
 
-                /* Sync the device. */
-                r = fdatasync( c->device_fd );
+        if( r < 0 && nwipe_options.skip_bad_sectors )
+        {
+            nwipe_perror( errno, __FUNCTION__, "write" );
+            skipped = job->skipped;
 
-                /* Tell our parent that we have finished syncing the device. */
-                c->sync_status = 0;
+            if( nwipe_write_recover( job, b + done, blocksize - done, offset + done ) != 0 )
+            {
+                return -1;
+            }
 
-                if( r != 0 )
-                {
-                    nwipe_perror( errno, __FUNCTION__, "fdatasync" );
-                    nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
-                    nwipe_log( NWIPE_LOG_WARNING, "Wrote %llu bytes on '%s'.", c->pass_done, c->device_name );
-                    c->fsyncdata_errors++;
-                    free( b );
-                    if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
-                    {
-                        c->bytes_erased = c->device_size - z;
-                    }
-                    return -1;
-                }
+            nwipe_recovered( job, skipped, offset, blocksize, "written" );
+            return 0;
+        }
 
-                i = 0;
-            }
+        /* Check the result for a fatal error. */
+        if( r < 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "write" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
+            nwipe_badmap_add( c, offset + done, blocksize - done, NWIPE_BADMAP_WRITE );
+            return -1;
         }
 
-        pthread_testcancel();
+        done += r;
 
-        /* If statement required so that it does not reset on subsequent passes */
-        if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
+        if( done == blocksize )
         {
-            c->bytes_erased = c->device_size - z;
+            break;
         }
 
-    } /* /remaining bytes */
-
-    /* Release the output buffer. */
-    free( b );
+        /* Partial write, skip to the end of the sub-block that could not be written. */
+        s = c->device_stat.st_blksize - done % c->device_stat.st_blksize;
 
-    /* Tell our parent that we are syncing the device. */
-    c->sync_status = 1;
+        if( s > blocksize - done )
+        {
+            s = blocksize - done;
+        }
 
-    /* Sync the device. */
-    r = fdatasync( c->device_fd );
+        /* Increment the error count by the number of bytes that were not written. */
+        c->pass_errors += s;
 
-    /* Tell our parent that we have finished syncing the device. */
-    c->sync_status = 0;
+        nwipe_log( NWIPE_LOG_WARNING, "Partial write on '%s', %zu bytes short.", c->device_name, s );
+        nwipe_badmap_add( c, offset + done, s, NWIPE_BADMAP_WRITE );
 
-    if( r != 0 )
-    {
-        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
-        nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
-        c->fsyncdata_errors++;
-        if( c->bytes_erased < ( c->device_size - z - blocksize ) )  // How much of the device has been erased?
-        {
-            c->bytes_erased = c->device_size - z - blocksize;
-        }
-        return -1;
+        done += s;
     }
 
-    /* We're done. */
     return 0;
 
-} /* nwipe_random_pass */
+} /* nwipe_write_block */
 
-int nwipe_static_verify( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+static int nwipe_read_verify_block( nwipe_pass_job_t* job, char* b, const char* d, size_t blocksize, u64 offset )
 {
     /**
-     * Verifies that a static pass was correctly written to the device.
+     * Reads one I/O block from the device at the given offset into b and
+     * compares it with the expected data in d, see nwipe_verify_compare().
+     *
+     * A partial read counts as one verification error for the st_blksize sub-block
+     * at which the read stopped, the remainder of that sub-block is skipped and the
+     * rest of the block is still read and compared.
+     *
+     * A failed read is fatal, unless --skip-bad-sectors is given and the rest of the
+     * block is retried by nwipe_read_recover().
+     *
+     * @returns  0 if the whole block was dealt with, -1 on a fatal error.
      */
 
-    /* The result holder. */
-    int r;
-
-    /* The IO size. */
-    size_t blocksize;
+    nwipe_context_t* c = job->c;
 
-    /* The result buffer for calls to lseek. */
-    off64_t offset;
+    /* The skipped bytes before the retries of a failed read. */
+    u64 skipped;
 
-    /* The input buffer. */
-    char* b;
+    /* The result holder. */
+    ssize_t r;
 
-    /* The pattern buffer that is used to check the input buffer. */
-    char* d;
+    /* The number of bytes in this block that have been read or skipped. */
+    size_t done = 0;
 
-    /* A pointer into the pattern buffer. */
-    char* q;
+    /* The number of bytes in this block that have been compared or skipped. */
+    size_t checked = 0;
 
-    /* The pattern buffer window offset. */
-    int w = 0;
+    /* The end of the data that can be compared. */
+    size_t end;
 
-    /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
+    /* The number of bytes that were not read. */
+    size_t s;
 
-    if( pattern == NULL )
+    while( done < blocksize )
     {
-        /* Caught insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: Null entropy pointer." );
-        return -1;
-    }
+        /* Read the buffer in from the device. */
+        r = pread( c->device_fd, b + done, blocksize - done, (off_t) ( offset + done ) );
 
-    if( pattern->length <= 0 )
-    {
-        /* Caught insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: The pattern length member is %i.", pattern->length );
-        return -1;
-    }
+        if( r < 0 && nwipe_options.skip_bad_sectors )
+        {
+            nwipe_perror( errno, __FUNCTION__, "read" );
+            skipped = job->skipped;
+
+            /* The part of a sub-block that has been read is read again to be compared. */
+            if( nwipe_read_recover(
+                    job, b + checked, d != NULL ? d + checked : NULL, blocksize - checked, offset + checked )
+                != 0 )
+            {
+                return -1;
+            }
 
-    /* Create the input buffer. */
-    b = malloc( c->device_stat.st_blksize );
+            nwipe_recovered( job, skipped, offset, blocksize, "read" );
+            return 0;
+        }
 
-    /* Check the memory allocation. */
-    if( !b )
-    {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
-        return -1;
-    }
+        /* Check the result. */
+        if( r < 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "read" );
+            nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
+            nwipe_badmap_add( c, offset + done, blocksize - done, NWIPE_BADMAP_READ );
+            return -1;
+        }
 
-    /* Create the pattern buffer */
-    d = malloc( c->device_stat.st_blksize + pattern->length * 2 );
+        done += r;
 
-    /* Check the memory allocation. */
-    if( !d )
-    {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
-        free( b );
-        return -1;
-    }
+        /* Compare the whole sub-blocks that have been read so far. */
+        end = ( done == blocksize ) ? done : done - done % c->device_stat.st_blksize;
 
-    for( q = d; q < d + c->device_stat.st_blksize + pattern->length; q += pattern->length )
-    {
-        /* Fill the pattern buffer with the pattern. */
-        memcpy( q, pattern->s, pattern->length );
+        if( end > checked )
+        {
+            nwipe_verify_compare( job, b + checked, d != NULL ? d + checked : NULL, offset + checked, end - checked );
+            checked = end;
+        }
+
+        if( done == blocksize )
+        {
+            break;
+        }
+
+        /* Partial read, skip to the end of the sub-block that could not be read. */
+        s = c->device_stat.st_blksize - done % c->device_stat.st_blksize;
+
+        if( s > blocksize - done )
+        {
+            s = blocksize - done;
+        }
+
+        nwipe_log( NWIPE_LOG_WARNING, "%s: Partial read from '%s', %zu bytes short.", __FUNCTION__, c->device_name, s );
+
+        /* Increment the error count. */
+        c->verify_errors += 1;
+        nwipe_badmap_add( c, offset + done, s, NWIPE_BADMAP_READ );
+
+        done += s;
+        checked = done;
     }
 
+    return 0;
+
+} /* nwipe_read_verify_block */
+
+static int nwipe_pass_sync( nwipe_context_t* c, const char* label )
+{
+    /**
+     * Flushes the device, telling the GUI that we are syncing.
+     *
+     * @returns  The fdatasync() result.
+     */
+
+    /* The result holder. */
+    int r;
+
     /* Tell our parent that we are syncing the device. */
     c->sync_status = 1;
 
@@ -554,358 +652,2106 @@ int nwipe_static_verify( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
 
     if( r != 0 )
     {
-        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
+        nwipe_perror( errno, label, "fdatasync" );
         nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
         c->fsyncdata_errors++;
     }
 
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
+    return r;
 
-    /* Reset the pass byte counter. */
-    c->pass_done = 0;
+} /* nwipe_pass_sync */
 
-    if( offset == (off64_t) -1 )
-    {
-        nwipe_perror( errno, __FUNCTION__, "lseek" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        free( b );
-        return -1;
-    }
+static char* nwipe_pass_buffer( nwipe_context_t* c, size_t size )
+{
+    /**
+     * Allocates a zeroed I/O buffer that is aligned to the physical sector size,
+     * as required when the device is opened with O_DIRECT.
+     *
+     * @returns  The buffer, which is released with free(), or NULL on failure.
+     */
 
-    if( offset != 0 )
-    {
-        /* This is system insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: lseek() returned a bogus offset on '%s'.", c->device_name );
-        free( b );
-        free( d );
-        return -1;
-    }
+    void* b = NULL;
+    size_t align = c->device_io_align;
+    int r;
 
-    while( z > 0 )
+    if( align < sizeof( void* ) )
     {
-        if( c->device_stat.st_blksize <= z )
-        {
-            blocksize = c->device_stat.st_blksize;
-        }
-        else
-        {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
-        }
+        align = 512;
+    }
 
-        /* Fill the output buffer with the random pattern. */
-        /* Read the buffer in from the device. */
-        r = read( c->device_fd, b, blocksize );
+    r = posix_memalign( &b, align, size );
 
-        /* Check the result. */
-        if( r < 0 )
-        {
-            nwipe_perror( errno, __FUNCTION__, "read" );
-            nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
-            return -1;
-        }
+    if( r != 0 )
+    {
+        nwipe_perror( r, __FUNCTION__, "posix_memalign" );
+        return NULL;
+    }
 
-        /* Check for a partial read. */
-        if( r == blocksize )
-        {
-            /* Check every byte in the buffer. */
-            if( memcmp( b, &d[w], r ) != 0 )
-            {
-                c->verify_errors += 1;
-            }
-        }
-        else
-        {
-            /* The number of bytes that were not read. */
-            int s = blocksize - r;
+    /* Initialised because we don't want memory leaks to disk in the event
+     * of some future undetected bug in a prng or its implementation. */
+    memset( b, 0, size );
 
-            /* TODO: Handle a partial read. */
+    return (char*) b;
 
-            /* Increment the error count. */
-            c->verify_errors += 1;
+} /* nwipe_pass_buffer */
 
-            nwipe_log( NWIPE_LOG_WARNING, "Partial read on '%s', %i bytes short.", c->device_name, s );
+static int nwipe_pass_set_direct( nwipe_context_t* c, int direct )
+{
+    /**
+     * Sets or clears O_DIRECT on the device file descriptor.
+     *
+     * @returns  0 on success, -1 on failure.
+     */
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+    int flags;
 
-            if( offset == (off64_t) -1 )
-            {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial read.", c->device_name );
-                return -1;
-            }
+    flags = fcntl( c->device_fd, F_GETFL );
 
-        } /* partial read */
+    if( flags < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fcntl" );
+        return -1;
+    }
 
-        /* Adjust the window. */
-        w = ( c->device_stat.st_blksize + w ) % pattern->length;
+    if( direct )
+    {
+        flags |= O_DIRECT;
+    }
+    else
+    {
+        flags &= ~O_DIRECT;
+    }
 
-        /* Intuition check:
-         *   If the pattern length evenly divides the block size
-         *   then ( w == 0 ) always.
-         */
+    if( fcntl( c->device_fd, F_SETFL, flags ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fcntl" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to %s O_DIRECT on '%s'.", direct ? "set" : "clear", c->device_name );
+        return -1;
+    }
 
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
+    return 0;
 
-        /* Increment the total progress counters. */
-        c->pass_done += r;
-        c->round_done += r;
+} /* nwipe_pass_set_direct */
 
-        pthread_testcancel();
+static double nwipe_pass_elapsed( const struct timespec* start )
+{
+    /**
+     * @returns  The number of seconds since start.
+     */
 
-    } /* while bytes remaining */
+    struct timespec now;
 
-    /* Release the buffers. */
-    free( b );
-    free( d );
+    clock_gettime( CLOCK_MONOTONIC, &now );
 
-    /* We're done. */
-    return 0;
+    return (double) ( now.tv_sec - start->tv_sec ) + (double) ( now.tv_nsec - start->tv_nsec ) / 1e9;
 
-} /* nwipe_static_verify */
+} /* nwipe_pass_elapsed */
 
-int nwipe_static_pass( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+static void* nwipe_pass_generator( void* ptr )
 {
     /**
-     * Writes a static pattern to the device.
+     * The PRNG thread. Generates the blocks of the PRNG stream in device order, as far
+     * ahead as the ring allows, then waits for the wipe thread to release a block.
      */
 
-    /* The result holder. */
-    int r;
-
-    /* The IO size. */
-    size_t blocksize;
+    nwipe_pass_job_t* job = (nwipe_pass_job_t*) ptr;
+    nwipe_context_t* c = job->c;
+    nwipe_pass_generator_t* g = &job->gen;
 
-    /* The result buffer for calls to lseek. */
-    off64_t offset;
+    /* The start of a wait for the wipe thread. */
+    struct timespec start;
 
-    /* The output buffer. */
+    /* The block that is generated. */
     char* b;
+    u64 offset;
+    size_t length;
 
-    /* A pointer into the output buffer. */
-    char* p;
+    pthread_mutex_lock( &g->lock );
 
-    /* The output buffer window offset. */
-    int w = 0;
+    while( !g->stop && g->generated < g->blocks )
+    {
+        if( g->generated - g->released >= (u64) g->count )
+        {
+            /* The ring is full, the device is the bottleneck. */
+            clock_gettime( CLOCK_MONOTONIC, &start );
+            pthread_cond_wait( &g->space, &g->lock );
+            g->device_wait += nwipe_pass_elapsed( &start );
+            continue;
+        }
 
-    /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
+        b = g->buffer[g->generated % g->count];
+        offset = job->start + g->generated * c->device_io_size;
+        length = job->end - offset < c->device_io_size ? job->end - offset : c->device_io_size;
 
-    /* Number of writes to do before a fdatasync. */
-    int syncRate = nwipe_options.sync;
+        pthread_mutex_unlock( &g->lock );
 
-    /* Counter to track when to do a fdatasync. */
-    int i = 0;
+        c->prng->read( &c->prng_state, b, length );
 
-    if( pattern == NULL )
-    {
-        /* Caught insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: Null pattern pointer." );
-        return -1;
+        pthread_mutex_lock( &g->lock );
+
+        g->generated++;
+        pthread_cond_signal( &g->ready );
     }
 
-    if( pattern->length <= 0 )
+    pthread_mutex_unlock( &g->lock );
+
+    return NULL;
+
+} /* nwipe_pass_generator */
+
+static void nwipe_pass_generator_stop( nwipe_pass_job_t* job )
+{
+    /**
+     * Stops the PRNG thread and releases its ring.
+     */
+
+    nwipe_pass_generator_t* g = &job->gen;
+    int i;
+
+    if( g->buffer == NULL )
     {
-        /* Caught insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: The pattern length member is %i.", pattern->length );
-        return -1;
+        return;
     }
 
-    /* Create the output buffer. */
-    b = malloc( c->device_stat.st_blksize + pattern->length * 2 );
-
-    /* Check the memory allocation. */
-    if( !b )
+    if( g->running )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
-        return -1;
+        pthread_mutex_lock( &g->lock );
+        g->stop = 1;
+        pthread_cond_broadcast( &g->space );
+        pthread_mutex_unlock( &g->lock );
+
+        pthread_join( g->thread, NULL );
+        g->running = 0;
     }
 
-    for( p = b; p < b + c->device_stat.st_blksize + pattern->length; p += pattern->length )
+    for( i = 0; i < g->count; i++ )
     {
-        /* Fill the output buffer with the pattern. */
-        memcpy( p, pattern->s, pattern->length );
+        nwipe_bufpool_put( g->buffer[i], job->c->device_io_size );
     }
-    ///
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
 
-    /* Reset the pass byte counter. */
-    c->pass_done = 0;
+    free( g->buffer );
+    g->buffer = NULL;
+
+    pthread_cond_destroy( &g->space );
+    pthread_cond_destroy( &g->ready );
+    pthread_mutex_destroy( &g->lock );
+
+} /* nwipe_pass_generator_stop */
+
+static int nwipe_pass_generator_start( nwipe_pass_job_t* job )
+{
+    /**
+     * Starts the PRNG thread of a random pass. The ring holds the blocks in flight plus
+     * the blocks generated ahead, a verification only compares one block at a time.
+     *
+     * @returns  0 on success, -1 if the ring could not be allocated.
+     */
+
+    nwipe_context_t* c = job->c;
+    nwipe_pass_generator_t* g = &job->gen;
+    int r;
+    int i;
 
-    if( offset == (off64_t) -1 )
+    if( job->pattern != NULL || job->ahead <= 0 )
     {
-        nwipe_perror( errno, __FUNCTION__, "lseek" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        return -1;
+        return 0;
     }
 
-    if( offset != 0 )
+    g->count = ( job->verify ? 1 : job->depth ) + job->ahead;
+    g->blocks = ( job->end - job->start + c->device_io_size - 1 ) / c->device_io_size;
+    g->buffer = calloc( g->count, sizeof( char* ) );
+
+    if( !g->buffer )
     {
-        /* This is system insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: lseek() returned a bogus offset on '%s'.", c->device_name );
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the PRNG buffers." );
         return -1;
     }
 
-    while( z > 0 )
-    {
-        if( c->device_stat.st_blksize <= z )
-        {
-            blocksize = c->device_stat.st_blksize;
-        }
-        else
-        {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
-        }
+    pthread_mutex_init( &g->lock, NULL );
+    pthread_cond_init( &g->ready, NULL );
+    pthread_cond_init( &g->space, NULL );
 
-        /* Fill the output buffer with the random pattern. */
-        /* Write the next block out to the device. */
-        r = write( c->device_fd, &b[w], blocksize );
+    for( i = 0; i < g->count; i++ )
+    {
+        g->buffer[i] = nwipe_bufpool_get( c->device_io_size );
 
-        /* Check the result for a fatal error. */
-        if( r < 0 )
+        if( !g->buffer[i] )
         {
-            nwipe_perror( errno, __FUNCTION__, "write" );
-            nwipe_log( NWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
-            if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
-            {
-                c->bytes_erased = c->device_size - z;
-            }
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the PRNG buffers." );
+            nwipe_pass_generator_stop( job );
             return -1;
         }
+    }
 
-        /* Check for a partial write. */
-        if( r != blocksize )
-        {
-            /* TODO: Handle a partial write. */
+    r = pthread_create( &g->thread, NULL, nwipe_pass_generator, job );
 
-            /* The number of bytes that were not written. */
-            int s = blocksize - r;
+    if( r != 0 )
+    {
+        /* Not fatal, the stream is generated in the wipe thread instead. */
+        nwipe_perror( r, __FUNCTION__, "pthread_create" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to start the PRNG thread for '%s'.", c->device_name );
+        nwipe_pass_generator_stop( job );
+        g->blocks = 0;
+        return 0;
+    }
 
-            /* Increment the error count. */
-            c->pass_errors += s;
+    g->running = 1;
 
-            nwipe_log( NWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
+    return 0;
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+} /* nwipe_pass_generator_start */
 
-            if( offset == (off64_t) -1 )
-            {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial write.", c->device_name );
-                if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
-                {
-                    c->bytes_erased = c->device_size - z;
-                }
-                return -1;
-            }
+static void nwipe_pass_unlock( void* ptr )
+{
+    pthread_mutex_unlock( (pthread_mutex_t*) ptr );
 
-        } /* partial write */
+} /* nwipe_pass_unlock */
 
-        /* Adjust the window. */
-        w = ( c->device_stat.st_blksize + w ) % pattern->length;
+static char* nwipe_pass_generated( nwipe_pass_job_t* job, int* index )
+{
+    /**
+     * Takes the next block of the PRNG stream, waiting for the PRNG thread if it has not
+     * been generated yet. Blocks are taken and released in device order.
+     *
+     * @returns  The block, index is set to its registered io_uring buffer index.
+     */
 
-        /* Intuition check:
-         *
-         *   If the pattern length evenly divides the block size
-         *   then ( w == 0 ) always.
-         */
+    nwipe_pass_generator_t* g = &job->gen;
 
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
+    /* The start of a wait for the PRNG thread. */
+    struct timespec start;
 
-        /* Increment the total progress counterr. */
-        c->pass_done += r;
-        c->round_done += r;
+    /* The position of the block in the ring. */
+    int i;
 
-        /* Perodic Sync */
-        if( syncRate > 0 )
-        {
-            i++;
+    /* The mutex must be released if the wipe thread is cancelled while it waits. */
+    pthread_mutex_lock( &g->lock );
+    pthread_cleanup_push( nwipe_pass_unlock, &g->lock );
 
-            if( i >= syncRate )
-            {
-                /* Tell our parent that we are syncing the device. */
-                c->sync_status = 1;
+    while( g->consumed >= g->generated )
+    {
+        /* The PRNG is the bottleneck. */
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        pthread_cond_wait( &g->ready, &g->lock );
+        g->prng_wait += nwipe_pass_elapsed( &start );
+    }
 
-                /* Sync the device. */
-                r = fdatasync( c->device_fd );
+    i = (int) ( g->consumed % g->count );
+    g->consumed++;
 
-                /* Tell our parent that we have finished syncing the device. */
-                c->sync_status = 0;
+    pthread_cleanup_pop( 1 );
 
-                if( r != 0 )
-                {
-                    nwipe_perror( errno, __FUNCTION__, "fdatasync" );
-                    nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
-                    nwipe_log( NWIPE_LOG_WARNING, "Wrote %llu bytes on '%s'.", c->pass_done, c->device_name );
-                    c->fsyncdata_errors++;
-                    free( b );
-                    if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
-                    {
-                        c->bytes_erased = c->device_size - z;
-                    }
-                    return -1;
-                }
+    *index = g->index < 0 ? -1 : g->index + i;
 
-                i = 0;
-            }
+    return g->buffer[i];
+
+} /* nwipe_pass_generated */
+
+static void nwipe_pass_release( nwipe_pass_job_t* job )
+{
+    /**
+     * Returns the oldest block taken from the PRNG thread to the ring.
+     */
+
+    nwipe_pass_generator_t* g = &job->gen;
+
+    pthread_mutex_lock( &g->lock );
+    g->released++;
+    pthread_cond_signal( &g->space );
+    pthread_mutex_unlock( &g->lock );
+
+} /* nwipe_pass_release */
+
+static void nwipe_pass_job_free( void* ptr )
+{
+    /**
+     * Releases the slots and the io_uring instance of a pass. Any io_uring requests
+     * that are still in flight are waited for, so the kernel no longer references the
+     * buffers, which go back to the buffer pool. This is also the thread cancellation
+     * handler of a pass.
+     */
+
+    nwipe_pass_job_t* job = (nwipe_pass_job_t*) ptr;
+    unsigned long long user_data;
+    int result;
+    int i;
+
+    if( job->use_uring )
+    {
+        while( job->inflight > 0 && nwipe_uring_wait( &job->ring, &user_data, &result ) == 0 )
+        {
+            job->inflight--;
         }
 
-        pthread_testcancel();
+        nwipe_uring_exit( &job->ring );
+        job->use_uring = 0;
+    }
 
-        if( c->bytes_erased < ( c->device_size - z ) )  // How much of the device has been erased?
+    nwipe_pass_generator_stop( job );
+
+    if( job->slot != NULL )
+    {
+        for( i = 0; i < job->depth; i++ )
         {
-            c->bytes_erased = c->device_size - z;
+            nwipe_bufpool_put( job->slot[i].buffer, job->c->device_io_size );
         }
 
-    } /* /remaining bytes */
+        free( job->slot );
+        job->slot = NULL;
+    }
 
-    /* Tell our parent that we are syncing the device. */
-    c->sync_status = 1;
+    nwipe_bufpool_put( job->expected, job->c->device_io_size );
+    job->expected = NULL;
 
-    /* Sync the device. */
-    r = fdatasync( c->device_fd );
+    nwipe_bufpool_put( job->readback_buffer, job->c->device_io_size );
+    job->readback_buffer = NULL;
 
-    /* Tell our parent that we have finished syncing the device. */
-    c->sync_status = 0;
+    nwipe_bufpool_release( job->c->device_io_size, job->reserved );
+    job->reserved = 0;
 
-    if( r != 0 )
+} /* nwipe_pass_job_free */
+
+static int nwipe_pass_job_init( nwipe_pass_job_t* job )
+{
+    /**
+     * Allocates the slots of a pass and sets up io_uring if it is enabled. The buffers
+     * come from the buffer pool, and the queue is made shallower and fewer blocks are
+     * generated ahead when they don't all fit in the share of the pass of --io-memory.
+     *
+     * @returns  0 on success, -1 if the buffers could not be allocated.
+     */
+
+    nwipe_context_t* c = job->c;
+    struct iovec* iov;
+    int count;
+    int i;
+
+    /* The buffers the pass needs, and those it would like. */
+    int needed;
+    int wanted;
+
+    /* The buffers reserved beyond those needed, and the blocks in the ring of the PRNG thread. */
+    int spare;
+    int ring;
+
+    if( job->end == 0 )
     {
-        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
-        nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
-        c->fsyncdata_errors++;
-        if( c->bytes_erased < ( c->device_size - z - blocksize ) )  // How much of the device has been erased?
-        {
-            c->bytes_erased = c->device_size - z - blocksize;
-        }
-        return -1;
+        job->end = c->device_size;
     }
 
-    /* Release the output buffer. */
-    free( b );
+    job->ring.fd = -1;
+    job->use_uring = 0;
+    job->inflight = 0;
+    job->depth = 1;
+    job->ahead = job->pattern == NULL && nwipe_options.prng_ahead > 0 ? nwipe_options.prng_ahead : 0;
+    job->reserved = 0;
 
-    /* We're done. */
-    return 0;
+    memset( &job->gen, 0, sizeof( nwipe_pass_generator_t ) );
+    job->gen.index = -1;
+
+    if( nwipe_options.io_engine != NWIPE_IO_ENGINE_SYNC && !c->io_uring_unavailable )
+    {
+        if( nwipe_uring_init( &job->ring, (unsigned) nwipe_options.io_depth ) == 0 )
+        {
+            job->use_uring = 1;
+            job->depth = nwipe_options.io_depth;
+        }
+        else
+        {
+            /* Don't try again on the following passes. */
+            c->io_uring_unavailable = 1;
+
+            nwipe_log( NWIPE_LOG_WARNING,
+                       "io_uring is not available for '%s' (%s), using synchronous I/O.",
+                       c->device_name,
+                       strerror( errno ) );
+        }
+    }
+
+    /* One slot, the expected PRNG stream and the read back block, then the rest of the queue
+     * and the ring of the PRNG thread. */
+    needed = 1 + ( job->verify && job->pattern == NULL ) + ( job->readback != 0 );
+    ring = job->ahead > 0 ? ( job->verify ? 1 : job->depth ) + job->ahead : 0;
+    wanted = needed + job->depth - 1 + ring;
+
+    job->reserved = nwipe_bufpool_reserve( c->device_io_size, wanted, needed );
+
+    if( job->reserved < 0 )
+    {
+        job->reserved = 0;
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to reserve memory for the I/O buffers of '%s'.", c->device_name );
+        nwipe_pass_job_free( job );
+        return -1;
+    }
+
+    if( job->reserved < wanted )
+    {
+        /* Keep as much of the queue as fits, then generate ahead with what is left. */
+        spare = job->reserved - needed;
+        job->depth = 1 + ( spare < job->depth - 1 ? spare : job->depth - 1 );
+        spare -= job->depth - 1;
+        ring = job->verify ? 1 : job->depth;
+        job->ahead = spare > ring ? ( spare - ring < job->ahead ? spare - ring : job->ahead ) : 0;
+        ring = job->ahead > 0 ? ring + job->ahead : 0;
+
+        if( nwipe_options.verbose )
+        {
+            nwipe_log( NWIPE_LOG_INFO,
+                       "%s: --io-memory allows a queue depth of %i and %i blocks generated ahead.",
+                       c->device_name,
+                       job->depth,
+                       job->ahead );
+        }
+
+        nwipe_bufpool_release( c->device_io_size, job->reserved - ( needed + job->depth - 1 + ring ) );
+        job->reserved = needed + job->depth - 1 + ring;
+    }
+
+    job->slot = calloc( job->depth, sizeof( nwipe_pass_slot_t ) );
+
+    if( !job->slot )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pass slots." );
+        nwipe_pass_job_free( job );
+        return -1;
+    }
+
+    for( i = 0; i < job->depth; i++ )
+    {
+        job->slot[i].buffer = nwipe_bufpool_get( c->device_io_size );
+
+        if( !job->slot[i].buffer )
+        {
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the I/O buffers." );
+            nwipe_pass_job_free( job );
+            return -1;
+        }
+    }
+
+    if( job->verify && job->pattern == NULL )
+    {
+        /* Create the buffer for the expected PRNG stream. */
+        job->expected = nwipe_bufpool_get( c->device_io_size );
+
+        if( !job->expected )
+        {
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+            nwipe_pass_job_free( job );
+            return -1;
+        }
+    }
+
+    if( job->readback )
+    {
+        /* Create the buffer that the written blocks are read back into. */
+        job->readback_buffer = nwipe_bufpool_get( c->device_io_size );
+
+        if( !job->readback_buffer )
+        {
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the read back buffer." );
+            nwipe_pass_job_free( job );
+            return -1;
+        }
+    }
+
+    if( nwipe_pass_generator_start( job ) != 0 )
+    {
+        nwipe_pass_job_free( job );
+        return -1;
+    }
+
+    /* Unregistered buffers work too, just a little slower, e.g. when RLIMIT_MEMLOCK is low. */
+    iov = job->use_uring ? calloc( job->depth + 1 + job->gen.count, sizeof( struct iovec ) ) : NULL;
+
+    if( iov != NULL )
+    {
+        /* Register the slot buffers, the pattern buffer that static passes write from
+         * and the ring of the PRNG thread. */
+        for( count = 0; count < job->depth; count++ )
+        {
+            iov[count].iov_base = job->slot[count].buffer;
+            iov[count].iov_len = c->device_io_size;
+        }
+
+        if( job->pattern_buffer != NULL )
+        {
+            iov[count].iov_base = job->pattern_buffer;
+            iov[count].iov_len = job->pattern_cache->size;
+            count++;
+        }
+
+        if( job->gen.buffer != NULL )
+        {
+            job->gen.index = count;
+
+            for( i = 0; i < job->gen.count; i++ )
+            {
+                iov[count].iov_base = job->gen.buffer[i];
+                iov[count].iov_len = c->device_io_size;
+                count++;
+            }
+        }
+
+        if( nwipe_uring_register_buffers( &job->ring, iov, count ) != 0 && nwipe_options.verbose )
+        {
+            nwipe_log(
+                NWIPE_LOG_INFO, "%s: Unable to register io_uring buffers, %s", c->device_name, strerror( errno ) );
+        }
+
+        free( iov );
+    }
+
+    if( job->use_uring )
+    {
+        if( nwipe_options.verbose )
+        {
+            nwipe_log( NWIPE_LOG_INFO, "%s: io_uring queue depth %i", c->device_name, job->depth );
+        }
+    }
+
+    return 0;
+
+} /* nwipe_pass_job_init */
+
+static char* nwipe_pattern_window( nwipe_pass_job_t* job, u64 offset )
+{
+    /**
+     * Finds where a block at the given device offset starts in the pattern buffer. The
+     * buffer repeats the pattern over a whole number of alignment units, so a block at
+     * an aligned offset is always written from an aligned window and O_DIRECT writes
+     * need no copy.
+     *
+     * @returns  The start of the block in the pattern buffer.
+     */
+
+    nwipe_pattern_cache_t* p = job->pattern_cache;
+
+    /* The position of the offset within the pattern. */
+    size_t phase = offset % p->length;
+
+    /* A candidate window. */
+    size_t w;
+
+    for( w = 0; w < p->period; w += p->align )
+    {
+        if( w % p->length == phase )
+        {
+            return p->buffer + w;
+        }
+    }
+
+    /* An unaligned offset, or a pattern too long for an aligned period. */
+    return p->buffer + phase;
+
+} /* nwipe_pattern_window */
+
+static int nwipe_pass_fill( nwipe_pass_job_t* job, nwipe_pass_slot_t* slot )
+{
+    /**
+     * Prepares the data that is written to a block.
+     *
+     * @returns  0 on success, -1 if the PRNG did not produce any data.
+     */
+
+    nwipe_context_t* c = job->c;
+
+    /* General index counter. */
+    size_t idx;
+
+    if( job->pattern != NULL )
+    {
+        /* Static patterns are written straight from the pattern buffer. */
+        slot->data = nwipe_pattern_window( job, slot->offset );
+        slot->data_index = job->depth;
+
+        /* O_DIRECT needs an aligned buffer, so a misaligned window is copied. */
+        if( c->device_direct && (uintptr_t) slot->data % c->device_io_align != 0 )
+        {
+            memcpy( slot->buffer, slot->data, slot->length );
+            slot->data = slot->buffer;
+            slot->data_index = (int) ( slot - job->slot );
+        }
+
+        return 0;
+    }
+
+    if( job->gen.buffer != NULL )
+    {
+        /* Written straight from the ring of the PRNG thread. */
+        slot->data = nwipe_pass_generated( job, &slot->data_index );
+    }
+    else
+    {
+        /* Fill the output buffer with the random pattern. */
+        c->prng->read( &c->prng_state, slot->buffer, slot->length );
+        slot->data = slot->buffer;
+        slot->data_index = (int) ( slot - job->slot );
+    }
+
+    /* For the first block only, check the prng actually wrote something to the buffer */
+    if( slot->offset == job->start )
+    {
+        idx = slot->length - 1;
+        while( idx > 0 )
+        {
+            if( slot->data[idx] != 0 )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE, "prng stream is active" );
+                break;
+            }
+            idx--;
+        }
+        if( idx == 0 )
+        {
+            nwipe_log( NWIPE_LOG_FATAL, "ERROR, prng wrote nothing to the buffer" );
+            return -1;
+        }
+    }
+
+    return 0;
+
+} /* nwipe_pass_fill */
+
+static int nwipe_pass_complete( nwipe_pass_job_t* job, nwipe_pass_slot_t* slot )
+{
+    /**
+     * Finishes the oldest block of the pass. Blocks that were not completely transferred
+     * by io_uring, or were not issued through io_uring at all, are written or read here
+     * synchronously, so short transfers and errors are always handled the same way.
+     *
+     * @returns  0 on success, -1 on a fatal error.
+     */
+
+    nwipe_context_t* c = job->c;
+
+    /* The expected data of a verification. */
+    const char* d = NULL;
+
+    /* The result holder. */
+    int r;
+
+    /* The registered buffer index of a generated block, unused by reads. */
+    int index;
+
+    if( job->verify )
+    {
+        if( job->uniform )
+        {
+            d = NULL;
+        }
+        else if( job->pattern != NULL )
+        {
+            d = nwipe_pattern_window( job, slot->offset );
+        }
+        else if( job->gen.buffer != NULL )
+        {
+            d = nwipe_pass_generated( job, &index );
+        }
+        else
+        {
+            /* The PRNG stream is generated in device order because the oldest block always completes first. */
+            c->prng->read( &c->prng_state, job->expected, slot->length );
+            d = job->expected;
+        }
+    }
+
+    if( slot->queued )
+    {
+        if( slot->result == (int) slot->length )
+        {
+            if( job->verify )
+            {
+                nwipe_verify_compare( job, slot->buffer, d, slot->offset, slot->length );
+            }
+            return 0;
+        }
+
+        /* The synchronous retry below reports the block if it fails again, so this is only noted once
+         * per device, else every bad sector of a failing drive would be logged twice. */
+        if( !c->io_uring_retried )
+        {
+            c->io_uring_retried = 1;
+            nwipe_log( NWIPE_LOG_NOTICE,
+                       "%s: io_uring %s of %zu bytes at offset %llu on '%s' returned %i, failed blocks are "
+                       "retried synchronously.",
+                       __FUNCTION__,
+                       job->verify ? "read" : "write",
+                       slot->length,
+                       slot->offset,
+                       c->device_name,
+                       slot->result );
+        }
+    }
+
+    /* A tail that is not a whole number of physical sectors can't be transferred with
+     * O_DIRECT, so it goes through the page cache. It is always the last block of the
+     * device, so nothing else is in flight while O_DIRECT is cleared. */
+    if( c->device_direct && slot->length % c->device_io_align != 0 )
+    {
+        if( nwipe_pass_set_direct( c, 0 ) != 0 )
+        {
+            return -1;
+        }
+
+        if( job->verify )
+        {
+            r = nwipe_read_verify_block( job, slot->buffer, d, slot->length, slot->offset );
+        }
+        else
+        {
+            r = nwipe_write_block( job, slot->data, slot->length, slot->offset );
+        }
+
+        if( nwipe_pass_set_direct( c, 1 ) != 0 )
+        {
+            return -1;
+        }
+
+        return r;
+    }
+
+    if( job->verify )
+    {
+        return nwipe_read_verify_block( job, slot->buffer, d, slot->length, slot->offset );
+    }
+
+    return nwipe_write_block( job, slot->data, slot->length, slot->offset );
+
+} /* nwipe_pass_complete */
+
+static int nwipe_pass_readback( nwipe_pass_job_t* job, nwipe_pass_slot_t* slot )
+{
+    /**
+     * Reads a block back as soon as it has been written and compares it with the data it
+     * was written from, which is still in memory, so a verified pass needs neither a second
+     * sweep of the device nor the PRNG stream generated again. A block that was not written
+     * with O_DIRECT is flushed and dropped from the page cache first, so that it is read
+     * from the device.
+     *
+     * @returns  0 on success, -1 on a fatal error.
+     */
+
+    nwipe_context_t* c = job->c;
+
+    /* The result holder. */
+    int r;
+
+    /* Whether the block is transferred with O_DIRECT, see nwipe_pass_complete(). */
+    int direct = c->device_direct && slot->length % c->device_io_align == 0;
+
+    if( !direct )
+    {
+        if( c->device_direct && nwipe_pass_set_direct( c, 0 ) != 0 )
+        {
+            return -1;
+        }
+
+        /* A failure is counted, the block is still read back. */
+        nwipe_pass_sync( c, __FUNCTION__ );
+        posix_fadvise( c->device_fd, (off_t) slot->offset, (off_t) slot->length, POSIX_FADV_DONTNEED );
+    }
+
+    r = nwipe_read_verify_block( job, job->readback_buffer, slot->data, slot->length, slot->offset );
+
+    if( !direct && c->device_direct && nwipe_pass_set_direct( c, 1 ) != 0 )
+    {
+        return -1;
+    }
+
+    return r;
+
+} /* nwipe_pass_readback */
+
+static int nwipe_pass_loop( nwipe_pass_job_t* job )
+{
+    /**
+     * Writes or verifies the blocks of a pass. Blocks of device_io_size bytes are issued
+     * in device order, up to the queue depth at a time when io_uring is used, and are
+     * always completed and accounted for in device order.
+     *
+     * @returns  0 on success, -1 on a fatal error.
+     */
+
+    nwipe_context_t* c = job->c;
+    nwipe_pass_slot_t* slot;
+
+    /* The result holder. */
+    int r = 0;
+
+    /* The offset of the next block to issue. */
+    u64 offset = job->start;
+
+    /* The slot of the oldest block and of the next block. */
+    int head = 0;
+    int tail = 0;
+
+    /* The number of blocks that have been issued and not completed. */
+    int queued = 0;
+
+    /* The io_uring completion. */
+    unsigned long long user_data;
+    int result;
+
+    /* Number of writes to do before a fdatasync. */
+    int syncRate = nwipe_options.sync;
+
+    /* Counter to track when to do a fdatasync. */
+    int i = 0;
+
+    /* The size of the block that was completed. */
+    size_t blocksize;
+
+    while( offset < job->end || queued > 0 )
+    {
+        /* Keep the queue full. */
+        while( queued < job->depth && offset < job->end )
+        {
+            slot = &job->slot[tail];
+            slot->offset = offset;
+            slot->complete = 0;
+            slot->queued = 0;
+
+            if( c->device_io_size <= job->end - offset )
+            {
+                slot->length = c->device_io_size;
+            }
+            else
+            {
+                /* The last block of the device may be shorter than the I/O size. */
+                slot->length = job->end - offset;
+
+                /* This is a seatbelt for buggy drivers and programming errors because */
+                /* the device size should always be an even multiple of its blocksize. */
+                if( slot->length % c->device_stat.st_blksize != 0 )
+                {
+                    nwipe_log( NWIPE_LOG_WARNING,
+                               "%s: The size of '%s' is not a multiple of its block size %i.",
+                               __FUNCTION__,
+                               c->device_name,
+                               c->device_stat.st_blksize );
+                }
+            }
+
+            /* Wait for the turn of the device on a shared link, a block that is read back crosses it twice. */
+            nwipe_scheduler_admit( c, job->readback ? 2 * slot->length : slot->length );
+
+            if( !job->verify && nwipe_pass_fill( job, slot ) != 0 )
+            {
+                r = -1;
+                break;
+            }
+
+            if( c->device_direct && slot->length % c->device_io_align != 0 )
+            {
+                /* The unaligned tail is transferred synchronously when it is completed. */
+                slot->complete = 1;
+            }
+            else if( job->use_uring )
+            {
+                if( job->verify )
+                {
+                    r = nwipe_uring_queue(
+                        &job->ring, NWIPE_URING_READ, c->device_fd, slot->buffer, slot->length, offset, tail, tail );
+                }
+                else
+                {
+                    /* The data is in a slot buffer, the pattern buffer or the ring of the PRNG thread. */
+                    r = nwipe_uring_queue( &job->ring,
+                                           NWIPE_URING_WRITE,
+                                           c->device_fd,
+                                           slot->data,
+                                           slot->length,
+                                           offset,
+                                           slot->data_index,
+                                           tail );
+                }
+
+                if( r != 0 )
+                {
+                    nwipe_perror( errno, __FUNCTION__, "io_uring" );
+                    nwipe_log( NWIPE_LOG_FATAL, "Unable to queue I/O on '%s'.", c->device_name );
+                    break;
+                }
+
+                job->inflight++;
+                slot->queued = 1;
+            }
+
+            offset += slot->length;
+            tail = ( tail + 1 ) % job->depth;
+            queued++;
+        }
+
+        if( r != 0 )
+        {
+            break;
+        }
+
+        slot = &job->slot[head];
+
+        /* Wait for the oldest block, later blocks may complete first. */
+        while( job->use_uring && !slot->complete )
+        {
+            if( nwipe_uring_wait( &job->ring, &user_data, &result ) != 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "io_uring_enter" );
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to wait for I/O on '%s'.", c->device_name );
+                r = -1;
+                break;
+            }
+
+            job->inflight--;
+            job->slot[user_data].result = result;
+            job->slot[user_data].complete = 1;
+        }
+
+        if( r != 0 || nwipe_pass_complete( job, slot ) != 0 )
+        {
+            r = -1;
+            break;
+        }
+
+        /* Read the block back while the data it was written from is still in memory. */
+        if( job->readback && nwipe_pass_readback( job, slot ) != 0 )
+        {
+            r = -1;
+            break;
+        }
+
+        /* The block of the PRNG stream is no longer needed. */
+        if( job->gen.buffer != NULL )
+        {
+            nwipe_pass_release( job );
+        }
+
+        blocksize = slot->length;
+        head = ( head + 1 ) % job->depth;
+        queued--;
+
+        /* Increment the total progress counters, a block that was read back was also verified. */
+        c->pass_done += blocksize;
+        c->round_done += job->readback ? 2 * blocksize : blocksize;
+
+        if( !job->verify )
+        {
+            /* Perodic Sync, the sync rate counts writes of st_blksize irrespective of the I/O size. */
+            if( syncRate > 0 )
+            {
+                i += ( blocksize + c->device_stat.st_blksize - 1 ) / c->device_stat.st_blksize;
+
+                if( i >= syncRate )
+                {
+                    if( nwipe_pass_sync( c, __FUNCTION__ ) != 0 )
+                    {
+                        nwipe_log( NWIPE_LOG_WARNING, "Wrote %llu bytes on '%s'.", c->pass_done, c->device_name );
+                        r = -1;
+                        break;
+                    }
+
+                    i = 0;
+                }
+            }
+
+            /* If statement required so that it does not reset on subsequent passes */
+            if( c->bytes_erased < slot->offset + blocksize )  // How much of the device has been erased?
+            {
+                c->bytes_erased = slot->offset + blocksize;
+            }
+        }
+
+        /* A checkpoint of a write is only recorded once the blocks before it are on the device. */
+        if( job->checkpoint && nwipe_checkpoint_due( c ) )
+        {
+            if( job->verify || nwipe_pass_sync( c, __FUNCTION__ ) == 0 )
+            {
+                nwipe_checkpoint_save( c, slot->offset + blocksize );
+                i = 0;
+            }
+        }
+
+        pthread_testcancel();
+
+    } /* /remaining bytes */
+
+    if( r != 0 && !job->verify && queued > 0 )
+    {
+        /* The oldest block that has not been accounted for is where the pass stopped. */
+        if( c->bytes_erased < job->slot[head].offset )  // How much of the device has been erased?
+        {
+            c->bytes_erased = job->slot[head].offset;
+        }
+    }
+
+    return r;
+
+} /* nwipe_pass_loop */
+
+static int nwipe_pass_run( nwipe_pass_job_t* job )
+{
+    /**
+     * Writes or verifies a whole pass and syncs the device after a write.
+     *
+     * @returns  0 on success, -1 on a fatal error.
+     */
+
+    nwipe_context_t* c = job->c;
+
+    /* The result holder. */
+    int r;
+
+    /* The size of the last block of the pass. */
+    u64 blocksize;
+
+    if( nwipe_pass_job_init( job ) != 0 )
+    {
+        return -1;
+    }
+
+    /* Reset the pass byte counter. */
+    c->pass_done = 0;
+
+    /* The buffers are released when the pass completes or the thread is cancelled,
+     * after waiting for any requests that are still in flight. */
+    pthread_cleanup_push( nwipe_pass_job_free, job );
+    r = nwipe_pass_loop( job );
+    pthread_cleanup_pop( 1 );
+
+    if( r == 0 && job->gen.blocks > 0 )
+    {
+        /* Whether the PRNG or the device limited the throughput of the pass. */
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "%s: %s waited %.1fs for the PRNG, the PRNG waited %.1fs for the device, %s bound.",
+                   c->device_name,
+                   job->verify ? "Verification" : "Pass",
+                   job->gen.prng_wait,
+                   job->gen.device_wait,
+                   job->gen.prng_wait > job->gen.device_wait ? "generator" : "device" );
+    }
+
+    if( r == 0 && !job->verify )
+    {
+        if( nwipe_pass_sync( c, __FUNCTION__ ) != 0 )
+        {
+            blocksize = ( job->end - job->start ) % c->device_io_size;
+
+            if( blocksize == 0 )
+            {
+                blocksize = c->device_io_size;
+            }
+
+            if( c->bytes_erased < ( job->end - blocksize ) )  // How much of the device has been erased?
+            {
+                c->bytes_erased = job->end - blocksize;
+            }
+            return -1;
+        }
+    }
+
+    return r;
+
+} /* nwipe_pass_run */
+
+static u64 nwipe_pass_zero_offload( nwipe_context_t* c, u64 start, u64 end )
+{
+    /**
+     * Lets the device zero itself from start up to end, in requests of about
+     * NWIPE_KNOB_ZERO_OFFLOAD_SIZE bytes so that the progress is updated and the thread
+     * can be cancelled between them. Block devices are zeroed with BLKZEROOUT, which the
+     * kernel issues as WRITE ZEROES or WRITE SAME without deallocating the blocks, and
+     * other files with FALLOC_FL_ZERO_RANGE.
+     *
+     * @returns  The offset the device was zeroed up to, start plus a multiple of device_io_size.
+     */
+
+    /* The range of a request, offset and length. */
+    u64 range[2];
+
+    /* The length of a request. */
+    u64 chunk = NWIPE_KNOB_ZERO_OFFLOAD_SIZE - NWIPE_KNOB_ZERO_OFFLOAD_SIZE % c->device_io_size;
+
+    /* The offset up to which the device has been zeroed. */
+    u64 offset = start;
+
+    /* The result holder. */
+    int r;
+
+    const char* method = S_ISBLK( c->device_stat.st_mode ) ? "BLKZEROOUT" : "FALLOC_FL_ZERO_RANGE";
+
+    if( chunk == 0 )
+    {
+        chunk = c->device_io_size;
+    }
+
+    while( offset < end )
+    {
+        range[0] = offset;
+        range[1] = end - offset < chunk ? end - offset : chunk;
+
+        if( S_ISBLK( c->device_stat.st_mode ) )
+        {
+            r = ioctl( c->device_fd, BLKZEROOUT, range );
+        }
+        else
+        {
+            r = fallocate(
+                c->device_fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE, (off_t) range[0], (off_t) range[1] );
+        }
+
+        if( r != 0 )
+        {
+            if( offset == start )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE,
+                           "%s is not available on '%s' (%s), writing zeros.",
+                           method,
+                           c->device_name,
+                           strerror( errno ) );
+            }
+            else
+            {
+                nwipe_log( NWIPE_LOG_WARNING,
+                           "%s failed at offset %llu on '%s' (%s), writing the remaining zeros.",
+                           method,
+                           offset,
+                           c->device_name,
+                           strerror( errno ) );
+            }
+            break;
+        }
+
+        offset += range[1];
+
+        /* Increment the total progress counters. */
+        c->pass_done += range[1];
+        c->round_done += range[1];
+
+        if( c->bytes_erased < offset )  // How much of the device has been erased?
+        {
+            c->bytes_erased = offset;
+        }
+
+        pthread_testcancel();
+    }
+
+    if( offset > start )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "Zeroed %llu bytes of '%s' with %s.", offset - start, c->device_name, method );
+    }
+
+    return offset;
+
+} /* nwipe_pass_zero_offload */
+
+static void* nwipe_pass_region_thread( void* ptr )
+{
+    /**
+     * The thread of one region of a parallel pass.
+     */
+
+    nwipe_pass_region_t* region = (nwipe_pass_region_t*) ptr;
+    nwipe_pass_regions_t* set = region->set;
+
+    region->result = nwipe_pass_run( &region->job );
+
+    pthread_mutex_lock( &set->lock );
+    set->active--;
+    pthread_cond_signal( &set->finished );
+    pthread_mutex_unlock( &set->lock );
+
+    return NULL;
+
+} /* nwipe_pass_region_thread */
+
+static void nwipe_pass_regions_progress( nwipe_pass_regions_t* set )
+{
+    /**
+     * Adds up the progress of the regions into the device context, which the GUI reads.
+     */
+
+    u64 pass_done = 0;
+    u64 round_done = 0;
+    int i;
+
+    for( i = 0; i < set->count; i++ )
+    {
+        pass_done += set->region[i].c.pass_done;
+        round_done += set->region[i].c.round_done;
+    }
+
+    set->c->pass_done = pass_done;
+    set->c->round_done = set->round_done + round_done;
+
+} /* nwipe_pass_regions_progress */
+
+static void nwipe_pass_regions_free( void* ptr )
+{
+    /**
+     * Stops any region threads that are still running and releases the regions. This is
+     * also the thread cancellation handler of a parallel pass.
+     */
+
+    nwipe_pass_regions_t* set = (nwipe_pass_regions_t*) ptr;
+    int i;
+
+    for( i = 0; i < set->count; i++ )
+    {
+        if( set->region[i].running )
+        {
+            pthread_cancel( set->region[i].thread );
+            pthread_join( set->region[i].thread, NULL );
+            set->region[i].running = 0;
+        }
+
+        free( set->region[i].c.prng_state );
+        free( set->region[i].seed );
+
+        /* Keep the failed regions that were found before a cancellation. */
+        nwipe_badmap_merge( set->c, &set->region[i].c );
+    }
+
+    free( set->region );
+    set->region = NULL;
+
+    pthread_cond_destroy( &set->finished );
+    pthread_mutex_destroy( &set->lock );
+
+} /* nwipe_pass_regions_free */
+
+static void nwipe_pass_regions_wait( nwipe_pass_regions_t* set )
+{
+    /**
+     * Waits for the threads of the regions to finish, updating the progress meanwhile.
+     */
+
+    /* The time to wait for the threads until the progress is updated. */
+    struct timespec deadline;
+
+    pthread_mutex_lock( &set->lock );
+    pthread_cleanup_push( nwipe_pass_unlock, &set->lock );
+
+    while( set->active > 0 )
+    {
+        clock_gettime( CLOCK_REALTIME, &deadline );
+        deadline.tv_nsec += 250000000;
+
+        if( deadline.tv_nsec >= 1000000000 )
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        pthread_cond_timedwait( &set->finished, &set->lock, &deadline );
+        nwipe_pass_regions_progress( set );
+    }
+
+    pthread_cleanup_pop( 1 );
+
+} /* nwipe_pass_regions_wait */
+
+static int nwipe_pass_regions_loop( nwipe_pass_regions_t* set, nwipe_pass_job_t* job, u64 per_region )
+{
+    /**
+     * Sets up the regions, passes over them in their own threads and adds up the results.
+     *
+     * @returns  0 on success, -1 if the pass over any region failed.
+     */
+
+    nwipe_context_t* c = job->c;
+    nwipe_pass_region_t* region;
+
+    /* The result holder. */
+    int r = 0;
+    int i;
+
+    /* A byte of a region seed. */
+    size_t k;
+
+    /* The number of bytes erased in the regions. */
+    u64 erased = 0;
+
+    for( i = 0; i < set->count; i++ )
+    {
+        region = &set->region[i];
+        region->set = set;
+
+        /* The counters of each region start from zero and are added up at the end. The
+         * device descriptor is shared, only the last region can have an unaligned tail
+         * that clears O_DIRECT for a moment, the blocks of the other regions then go
+         * through the page cache, which is slower but otherwise the same. */
+        region->c = *c;
+        region->c.prng_state = NULL;
+        region->c.pass_done = 0;
+        region->c.round_done = 0;
+        region->c.pass_errors = 0;
+        region->c.verify_errors = 0;
+        region->c.verify_mismatch_bytes = 0;
+        region->c.badmap = NULL;
+        region->c.fsyncdata_errors = 0;
+
+        region->job = *job;
+        region->job.c = &region->c;
+        region->job.checkpoint = 0;
+        region->job.start = (u64) i * per_region * c->device_io_size;
+        region->job.end = region->job.start + per_region * c->device_io_size;
+
+        if( region->job.end > c->device_size )
+        {
+            region->job.end = c->device_size;
+        }
+
+        /* The high-water mark of the bytes erased is kept for each region. */
+        region->c.bytes_erased = region->job.start;
+
+        if( job->pattern == NULL && c->prng->seek == NULL )
+        {
+            /* A PRNG that can't seek generates a stream of its own for each region, with the
+             * seed of the pass mixed with the number of the region. The first region has the
+             * stream of a single pass. */
+            region->seed = malloc( c->prng_seed.length );
+
+            if( !region->seed )
+            {
+                nwipe_perror( errno, __FUNCTION__, "malloc" );
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the seeds of the regions." );
+                return -1;
+            }
+
+            memcpy( region->seed, c->prng_seed.s, c->prng_seed.length );
+
+            for( k = 0; k < sizeof( i ) && k < c->prng_seed.length; k++ )
+            {
+                region->seed[k] ^= (u8) ( (unsigned) i >> ( 8 * k ) );
+            }
+
+            region->c.prng_seed.s = region->seed;
+            c->prng->init( &region->c.prng_state, &region->c.prng_seed );
+        }
+        else if( job->pattern == NULL )
+        {
+            c->prng->init( &region->c.prng_state, &c->prng_seed );
+
+            if( c->prng->seek( &region->c.prng_state, region->job.start ) != 0 )
+            {
+                nwipe_log( NWIPE_LOG_SANITY,
+                           "%s: Unable to start the PRNG stream at offset %llu.",
+                           __FUNCTION__,
+                           region->job.start );
+                return -1;
+            }
+        }
+    }
+
+    if( nwipe_options.verbose )
+    {
+        nwipe_log( NWIPE_LOG_INFO,
+                   "%s: %s in %i regions of %llu bytes.",
+                   c->device_name,
+                   job->verify ? "Verifying" : "Writing",
+                   set->count,
+                   per_region * c->device_io_size );
+    }
+
+    for( i = 0; i < set->count; i++ )
+    {
+        region = &set->region[i];
+
+        pthread_mutex_lock( &set->lock );
+        set->active++;
+        pthread_mutex_unlock( &set->lock );
+
+        if( pthread_create( &region->thread, NULL, nwipe_pass_region_thread, region ) == 0 )
+        {
+            region->running = 1;
+            continue;
+        }
+
+        /* Not fatal, the region is passed over in this thread instead. */
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to start a thread for a region of '%s'.", c->device_name );
+        nwipe_pass_region_thread( region );
+    }
+
+    nwipe_pass_regions_wait( set );
+
+    for( i = 0; i < set->count; i++ )
+    {
+        region = &set->region[i];
+
+        if( region->running )
+        {
+            pthread_join( region->thread, NULL );
+            region->running = 0;
+        }
+
+        if( region->result != 0 )
+        {
+            r = -1;
+        }
+
+        c->pass_errors += region->c.pass_errors;
+        c->verify_errors += region->c.verify_errors;
+        c->verify_mismatch_bytes += region->c.verify_mismatch_bytes;
+        nwipe_badmap_merge( c, &region->c );
+        c->fsyncdata_errors += region->c.fsyncdata_errors;
+        c->io_uring_unavailable |= region->c.io_uring_unavailable;
+        erased += region->c.bytes_erased - region->job.start;
+    }
+
+    if( !job->verify && c->bytes_erased < erased )  // How much of the device has been erased?
+    {
+        c->bytes_erased = erased;
+    }
+
+    nwipe_pass_regions_progress( set );
+
+    return r;
+
+} /* nwipe_pass_regions_loop */
+
+static int nwipe_pass_run_regions( nwipe_pass_job_t* job, int count )
+{
+    /**
+     * Splits a pass into regions of whole I/O blocks that are passed over by their own
+     * threads, each with a copy of the device context. A PRNG that can seek starts its
+     * stream at the offset of each region, any other PRNG starts a stream of its own, so
+     * such a pass must be verified in the same number of regions it was written in.
+     *
+     * @returns  0 on success, -1 if the pass over any region failed.
+     */
+
+    nwipe_context_t* c = job->c;
+    nwipe_pass_regions_t set;
+
+    /* The number of I/O blocks on the device and in each region. */
+    u64 blocks;
+    u64 per_region;
+
+    /* The result holder. */
+    int r;
+
+    blocks = ( c->device_size + c->device_io_size - 1 ) / c->device_io_size;
+    per_region = ( blocks + count - 1 ) / count;
+
+    if( per_region == 0 )
+    {
+        return nwipe_pass_run( job );
+    }
+
+    memset( &set, 0, sizeof( set ) );
+    set.c = c;
+    set.count = (int) ( ( blocks + per_region - 1 ) / per_region );
+    set.round_done = c->round_done;
+    set.region = calloc( set.count, sizeof( nwipe_pass_region_t ) );
+
+    if( !set.region )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the regions of '%s'.", c->device_name );
+        return -1;
+    }
+
+    pthread_mutex_init( &set.lock, NULL );
+    pthread_cond_init( &set.finished, NULL );
+
+    c->pass_done = 0;
+
+    /* The threads are stopped and the regions released when the pass completes or this
+     * thread is cancelled. */
+    pthread_cleanup_push( nwipe_pass_regions_free, &set );
+    r = nwipe_pass_regions_loop( &set, job, per_region );
+    pthread_cleanup_pop( 1 );
+
+    return r;
+
+} /* nwipe_pass_run_regions */
+
+static int nwipe_pass_run_stripes( nwipe_pass_job_t* job )
+{
+    /**
+     * Runs a pass over stripes of the device in parallel, or over the whole device in
+     * this thread. Writes are split into --write-threads stripes. A static pattern, or a
+     * stream that can start at any offset, is verified in --verify-threads stripes if
+     * more than one is given, and otherwise in the stripes it was written in. The stripes
+     * of a PRNG that can't seek each have their own stream, so they are always verified
+     * in the stripes they were written in.
+     *
+     * Only a pass that runs in this thread records its progress in checkpoints, so a pass
+     * that is resumed from an offset always runs in this thread.
+     *
+     * @returns  0 on success, -1 on a fatal error.
+     */
+
+    nwipe_context_t* c = job->c;
+
+    /* The number of stripes. */
+    int count = nwipe_options.write_threads;
+
+    /* The result holder. */
+    int r;
+
+    if( job->verify && ( job->pattern != NULL || c->prng->seek != NULL ) && nwipe_options.verify_threads > 1 )
+    {
+        count = nwipe_options.verify_threads;
+    }
+
+    if( count > 1 && job->start == 0 )
+    {
+        return nwipe_pass_run_regions( job, count );
+    }
+
+    r = nwipe_pass_run( job );
+
+    /* Count the bytes before the offset the pass was resumed from, or zeroed by the device. */
+    c->pass_done += job->start;
+
+    return r;
+
+} /* nwipe_pass_run_stripes */
+
+/* The static pattern buffers, most recently built first. */
+static nwipe_pattern_cache_t* nwipe_pattern_cache = NULL;
+
+/* The number of pattern buffers released so far, the clock of the least recently used eviction. */
+static u64 nwipe_pattern_cache_clock = 0;
+
+/* Protects the pattern buffer cache, which is shared by the wipe threads of all the devices. */
+static pthread_mutex_t nwipe_pattern_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void nwipe_pattern_cache_destroy( nwipe_pattern_cache_t* p )
+{
+    free( p->buffer );
+    free( p->pattern );
+    free( p );
+
+} /* nwipe_pattern_cache_destroy */
+
+static nwipe_pattern_cache_t* nwipe_pattern_cache_get( nwipe_context_t* c, nwipe_pattern_t* pattern )
+{
+    /**
+     * Finds or builds the buffer of a static pattern for a device. The buffer repeats the
+     * pattern over the least common multiple of the pattern length and the alignment of
+     * the device, plus the I/O size, and is built only once for all the passes, rounds
+     * and devices that write the same pattern with the same alignment.
+     *
+     * @returns  The buffer, which is given back with nwipe_pattern_cache_release(), or
+     *           NULL if it could not be allocated.
+     */
+
+    nwipe_pattern_cache_t* p;
+
+    /* The alignment the buffer is allocated with, see nwipe_pass_buffer(). */
+    size_t align = c->device_io_align < sizeof( void* ) ? 512 : c->device_io_align;
+
+    /* The greatest common divisor of the pattern length and the alignment. */
+    size_t a;
+    size_t b;
+    size_t t;
+
+    /* A pointer into the buffer and the number of bytes already filled. */
+    size_t filled;
+
+    pthread_mutex_lock( &nwipe_pattern_cache_lock );
+
+    for( p = nwipe_pattern_cache; p != NULL; p = p->next )
+    {
+        if( p->length == pattern->length && p->align == align && p->io_size >= c->device_io_size
+            && memcmp( p->pattern, pattern->s, pattern->length ) == 0 )
+        {
+            p->users++;
+            pthread_mutex_unlock( &nwipe_pattern_cache_lock );
+            return p;
+        }
+    }
+
+    p = calloc( 1, sizeof( nwipe_pattern_cache_t ) );
+
+    if( p != NULL )
+    {
+        p->pattern = malloc( pattern->length );
+    }
+
+    if( p == NULL || p->pattern == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+        free( p );
+        pthread_mutex_unlock( &nwipe_pattern_cache_lock );
+        return NULL;
+    }
+
+    memcpy( p->pattern, pattern->s, pattern->length );
+    p->length = pattern->length;
+    p->align = align;
+    p->io_size = c->device_io_size;
+
+    for( a = (size_t) pattern->length, b = align; b != 0; )
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+
+    p->period = (size_t) pattern->length / a * align;
+
+    if( p->period > NWIPE_KNOB_IO_SIZE_MAX )
+    {
+        /* Unaligned windows are copied when they are written with O_DIRECT. */
+        p->period = (size_t) pattern->length;
+    }
+
+    p->size = p->period + p->io_size;
+    p->buffer = nwipe_pass_buffer( c, p->size );
+
+    if( p->buffer == NULL )
+    {
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+        nwipe_pattern_cache_destroy( p );
+        pthread_mutex_unlock( &nwipe_pattern_cache_lock );
+        return NULL;
+    }
+
+    /* Fill the pattern buffer with the pattern, doubling the filled part each time. */
+    memcpy( p->buffer, pattern->s, pattern->length );
+
+    for( filled = (size_t) pattern->length; filled < p->size; filled *= 2 )
+    {
+        memcpy( p->buffer + filled, p->buffer, filled < p->size - filled ? filled : p->size - filled );
+    }
+
+    p->users = 1;
+    p->next = nwipe_pattern_cache;
+    nwipe_pattern_cache = p;
+
+    pthread_mutex_unlock( &nwipe_pattern_cache_lock );
+
+    return p;
+
+} /* nwipe_pattern_cache_get */
+
+static void nwipe_pattern_cache_release( void* ptr )
+{
+    /**
+     * Gives back a pattern buffer. Buffers that are no longer in use are kept for the
+     * following passes and rounds, the least recently used are freed when they take up
+     * more than NWIPE_KNOB_PATTERN_CACHE bytes. This is also the thread cancellation
+     * handler of a static pass.
+     */
+
+    nwipe_pattern_cache_t* p = (nwipe_pattern_cache_t*) ptr;
+    nwipe_pattern_cache_t** pp;
+    nwipe_pattern_cache_t** lru;
+
+    /* The size of the buffers that are not in use. */
+    size_t unused;
+
+    /* A verification of a uniform pattern has no buffer. */
+    if( p == NULL )
+    {
+        return;
+    }
+
+    pthread_mutex_lock( &nwipe_pattern_cache_lock );
+
+    p->users--;
+    p->used = ++nwipe_pattern_cache_clock;
+
+    for( ;; )
+    {
+        unused = 0;
+        lru = NULL;
+
+        for( pp = &nwipe_pattern_cache; *pp != NULL; pp = &( *pp )->next )
+        {
+            if( ( *pp )->users == 0 )
+            {
+                unused += ( *pp )->size;
+
+                if( lru == NULL || ( *pp )->used < ( *lru )->used )
+                {
+                    lru = pp;
+                }
+            }
+        }
+
+        if( unused <= NWIPE_KNOB_PATTERN_CACHE )
+        {
+            break;
+        }
+
+        p = *lru;
+        *lru = p->next;
+        nwipe_pattern_cache_destroy( p );
+    }
+
+    pthread_mutex_unlock( &nwipe_pattern_cache_lock );
+
+} /* nwipe_pattern_cache_release */
+
+void nwipe_pattern_cache_free( void )
+{
+    /**
+     * Frees all the pattern buffers, once no pass is running any more.
+     */
+
+    nwipe_pattern_cache_t* p;
+
+    pthread_mutex_lock( &nwipe_pattern_cache_lock );
+
+    while( nwipe_pattern_cache != NULL )
+    {
+        p = nwipe_pattern_cache;
+        nwipe_pattern_cache = p->next;
+        nwipe_pattern_cache_destroy( p );
+    }
+
+    pthread_mutex_unlock( &nwipe_pattern_cache_lock );
+
+} /* nwipe_pattern_cache_free */
+
+static int nwipe_pattern_uniform( nwipe_pattern_t* pattern )
+{
+    /**
+     * Checks whether a static pattern repeats one byte, like the zeros and ones
+     * of the blanking and verification passes.
+     *
+     * @returns  1 if every byte of the pattern is the same, 0 otherwise.
+     */
+
+    int i;
+
+    for( i = 1; i < pattern->length; i++ )
+    {
+        if( pattern->s[i] != pattern->s[0] )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+
+} /* nwipe_pattern_uniform */
+
+static void nwipe_verify_summary( nwipe_context_t* c, u64 errors, u64 bytes )
+{
+    /**
+     * Logs how much of the device failed a verification pass, given the error and
+     * mismatch counters from before the pass.
+     */
+
+    if( c->verify_errors > errors && !c->verify_quiet )
+    {
+        nwipe_log( NWIPE_LOG_ERROR,
+                   "Verification of '%s' failed in %llu blocks of %i bytes, %llu bytes differ.",
+                   c->device_name,
+                   c->verify_errors - errors,
+                   c->device_stat.st_blksize,
+                   c->verify_mismatch_bytes - bytes );
+    }
+
+} /* nwipe_verify_summary */
+
+static int nwipe_pass_prng_start( nwipe_context_t* c, u64 offset )
+{
+    /**
+     * Seeds the PRNG and moves its stream to the offset a resumed pass starts at. A PRNG
+     * that can't seek generates and discards the stream up to the offset, in blocks of
+     * device_io_size like the pass, so that it continues with the same bytes.
+     *
+     * @returns  0 on success, -1 if the stream could not be moved.
+     */
+
+    /* The stream before the offset. */
+    char* discard;
+    u64 done;
+    size_t length;
+
+    c->prng->init( &c->prng_state, &c->prng_seed );
+
+    if( offset == 0 )
+    {
+        return 0;
+    }
+
+    if( c->prng->seek != NULL )
+    {
+        if( c->prng->seek( &c->prng_state, offset ) != 0 )
+        {
+            nwipe_log(
+                NWIPE_LOG_SANITY, "%s: Unable to start the PRNG stream at offset %llu.", __FUNCTION__, offset );
+            return -1;
+        }
+
+        return 0;
+    }
+
+    discard = malloc( c->device_io_size );
+
+    if( !discard )
+    {
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory to resume the PRNG stream." );
+        return -1;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE, "Generating %llu bytes of the PRNG stream to resume '%s'.", offset, c->device_name );
+
+    pthread_cleanup_push( free, discard );
+
+    for( done = 0; done < offset; done += length )
+    {
+        length = offset - done < c->device_io_size ? offset - done : c->device_io_size;
+        c->prng->read( &c->prng_state, discard, length );
+        pthread_testcancel();
+    }
+
+    pthread_cleanup_pop( 1 );
+
+    return 0;
+
+} /* nwipe_pass_prng_start */
+
+int nwipe_random_verify( nwipe_context_t* c )
+{
+    /**
+     * Verifies that a random pass was correctly written to the device.
+     *
+     */
+
+    /* The result holder. */
+    int r;
+
+    /* The pass state. */
+    nwipe_pass_job_t job;
+
+    /* The verification counters before the pass. */
+    u64 errors = c->verify_errors;
+    u64 bytes = c->verify_mismatch_bytes;
+
+    if( c->prng_seed.s == NULL )
+    {
+        nwipe_log( NWIPE_LOG_SANITY, "Null seed pointer." );
+        return -1;
+    }
+
+    if( c->prng_seed.length <= 0 )
+    {
+        nwipe_log( NWIPE_LOG_SANITY, "The entropy length member is %i.", c->prng_seed.length );
+        return -1;
+    }
+
+    /* Sync the device, a failure is counted but does not stop the verification. */
+    nwipe_pass_sync( c, __FUNCTION__ );
+
+    memset( &job, 0, sizeof( job ) );
+    job.c = c;
+    job.verify = 1;
+    job.start = nwipe_checkpoint_resume_offset( c );
+
+    /* Reseed the PRNG. */
+    if( nwipe_pass_prng_start( c, job.start ) != 0 )
+    {
+        return -1;
+    }
+
+    job.checkpoint = 1;
+    r = nwipe_pass_run_stripes( &job );
+
+    nwipe_verify_summary( c, errors, bytes );
+
+    /* We're done. */
+    return r;
+
+} /* nwipe_random_verify */
+
+int nwipe_random_pass( NWIPE_METHOD_SIGNATURE )
+{
+    /**
+     * Writes a random pattern to the device.
+     *
+     */
+
+    /* The pass state. */
+    nwipe_pass_job_t job;
+
+    /* The verification counters before the pass. */
+    u64 errors = c->verify_errors;
+    u64 bytes = c->verify_mismatch_bytes;
+
+    if( c->prng_seed.s == NULL )
+    {
+        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: Null seed pointer." );
+        return -1;
+    }
+
+    if( c->prng_seed.length <= 0 )
+    {
+        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: The entropy length member is %i.", c->prng_seed.length );
+        return -1;
+    }
+
+    /* The result holder. */
+    int r;
+
+    memset( &job, 0, sizeof( job ) );
+    job.c = c;
+    job.verify = 0;
+    job.readback = c->verify_inline;
+    job.start = nwipe_checkpoint_resume_offset( c );
+    job.checkpoint = 1;
+
+    /* Seed the PRNG. */
+    if( nwipe_pass_prng_start( c, job.start ) != 0 )
+    {
+        return -1;
+    }
+
+    r = nwipe_pass_run_stripes( &job );
+
+    if( job.readback )
+    {
+        nwipe_verify_summary( c, errors, bytes );
+    }
+
+    /* We're done. */
+    return r;
+
+} /* nwipe_random_pass */
+
+int nwipe_static_verify( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+{
+    /**
+     * Verifies that a static pass was correctly written to the device.
+     */
+
+    /* The result holder. */
+    int r;
+
+    /* The pass state. */
+    nwipe_pass_job_t job;
+
+    /* The verification counters before the pass. */
+    u64 errors = c->verify_errors;
+    u64 bytes = c->verify_mismatch_bytes;
+
+    if( pattern == NULL )
+    {
+        /* Caught insanity. */
+        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: Null entropy pointer." );
+        return -1;
+    }
+
+    if( pattern->length <= 0 )
+    {
+        /* Caught insanity. */
+        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: The pattern length member is %i.", pattern->length );
+        return -1;
+    }
+
+    memset( &job, 0, sizeof( job ) );
+    job.c = c;
+    job.verify = 1;
+    job.pattern = pattern;
+    job.uniform = nwipe_pattern_uniform( pattern );
+    job.start = nwipe_checkpoint_resume_offset( c );
+    job.checkpoint = 1;
+
+    /* Get the pattern buffer that is used to check the input, a uniform pattern needs none. */
+    if( !job.uniform )
+    {
+        job.pattern_cache = nwipe_pattern_cache_get( c, pattern );
+
+        if( job.pattern_cache == NULL )
+        {
+            return -1;
+        }
+
+        job.pattern_buffer = job.pattern_cache->buffer;
+    }
+
+    /* Sync the device, a failure is counted but does not stop the verification. */
+    nwipe_pass_sync( c, __FUNCTION__ );
+
+    /* Give back the pattern buffer when the pass completes or the thread is cancelled. */
+    pthread_cleanup_push( nwipe_pattern_cache_release, job.pattern_cache );
+    r = nwipe_pass_run_stripes( &job );
+    pthread_cleanup_pop( 1 );
+
+    nwipe_verify_summary( c, errors, bytes );
+
+    /* We're done. */
+    return r;
+
+} /* nwipe_static_verify */
+
+int nwipe_static_pass( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+{
+    /**
+     * Writes a static pattern to the device.
+     */
+
+    /* The result holder. */
+    int r;
+
+    /* The pass state. */
+    nwipe_pass_job_t job;
+
+    /* The verification counters before the pass. */
+    u64 errors = c->verify_errors;
+    u64 bytes = c->verify_mismatch_bytes;
+
+    if( pattern == NULL )
+    {
+        /* Caught insanity. */
+        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: Null pattern pointer." );
+        return -1;
+    }
+
+    if( pattern->length <= 0 )
+    {
+        /* Caught insanity. */
+        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: The pattern length member is %i.", pattern->length );
+        return -1;
+    }
+
+    memset( &job, 0, sizeof( job ) );
+    job.c = c;
+    job.verify = 0;
+    job.pattern = pattern;
+    job.readback = c->verify_inline;
+    job.start = nwipe_checkpoint_resume_offset( c );
+    job.checkpoint = 1;
+
+    /* Get the output buffer. */
+    job.pattern_cache = nwipe_pattern_cache_get( c, pattern );
+
+    if( job.pattern_cache == NULL )
+    {
+        return -1;
+    }
+
+    job.pattern_buffer = job.pattern_cache->buffer;
+
+    /* Only a pattern of zeros can be offloaded. Whole I/O blocks are zeroed by the device,
+     * anything it did not zero is written, followed by the usual sync. A pass that is read
+     * back as it is written is not offloaded, as there would be nothing to compare with. */
+    if( nwipe_options.zero_offload && !job.readback && pattern->s[0] == 0 && nwipe_pattern_uniform( pattern ) )
+    {
+        c->pass_done = 0;
+        job.start = nwipe_pass_zero_offload( c, job.start, c->device_size - c->device_size % c->device_io_size );
+    }
+
+    /* Give back the output buffer when the pass completes or the thread is cancelled. */
+    pthread_cleanup_push( nwipe_pattern_cache_release, job.pattern_cache );
+    r = nwipe_pass_run_stripes( &job );
+    pthread_cleanup_pop( 1 );
+
+    if( job.readback )
+    {
+        nwipe_verify_summary( c, errors, bytes );
+    }
+
+    /* We're done. */
+    return r;
 
 } /* nwipe_static_pass */
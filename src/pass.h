@@ -27,6 +27,7 @@ int nwipe_random_pass( nwipe_context_t* c );
 int nwipe_random_verify( nwipe_context_t* c );
 int nwipe_static_pass( nwipe_context_t* c, nwipe_pattern_t* pattern );
 int nwipe_static_verify( nwipe_context_t* c, nwipe_pattern_t* pattern );
+void nwipe_pattern_cache_free( void );  // Free the static pattern buffers kept between passes.
 
 void test_functionn( int count, nwipe_context_t** c );
 
@@ -0,0 +1,110 @@
+/*
+ *  philox_prng.c: The Philox4x64-10 counter-based pseudo random number generator.
+ *
+ *  Philox was published by Salmon, Moraes, Dror and Shaw in "Parallel Random
+ *  Numbers: As Easy as 1, 2, 3" (SC11). Each block of output is a keyed bijection
+ *  of a 256 bit counter, ten rounds of two 64x64 to 128 bit multiplications, so
+ *  the block at any position of the stream is computed directly from its index.
+ *  The output passes BigCrush, but Philox is not a cryptographic generator.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "philox_prng.h"
+#include <stdint.h>
+#include <string.h>
+
+// The multipliers and the Weyl sequence key increments of Philox4x64
+#define PHILOX_M0 0xD2E7470EE14C6C93ULL
+#define PHILOX_M1 0xCA5A826395121157ULL
+#define PHILOX_W0 0x9E3779B97F4A7C15ULL
+#define PHILOX_W1 0xBB67AE8584CAA73BULL
+
+#define PHILOX_ROUNDS 10
+
+static inline uint64_t mulhilo64( uint64_t a, uint64_t b, uint64_t* hi )
+{
+    unsigned __int128 p = (unsigned __int128) a * b;
+
+    *hi = (uint64_t) ( p >> 64 );
+    return (uint64_t) p;
+}
+
+static inline void store_le64( unsigned char* p, uint64_t v )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        p[i] = (unsigned char) ( v >> ( 8 * i ) );
+    }
+}
+
+void philox_prng_init( philox_prng_state_t* state, const unsigned char* seed, size_t seed_length )
+{
+    // The seed is folded as little-endian words into the key and counter words 1 to 3
+    uint64_t w[5] = { 0, 0, 0, 0, 0 };
+
+    for( size_t k = 0; k < seed_length; k++ )
+    {
+        w[( k / 8 ) % 5] ^= (uint64_t) seed[k] << ( 8 * ( k % 8 ) );
+    }
+
+    state->key[0] = w[0];
+    state->key[1] = w[1];
+    state->counter[0] = 0;
+    state->counter[1] = w[2];
+    state->counter[2] = w[3];
+    state->counter[3] = w[4];
+}
+
+void philox_prng_seek( philox_prng_state_t* state, uint64_t block )
+{
+    state->counter[0] = block;
+}
+
+void philox_prng_genrand_to_buf( philox_prng_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    uint64_t x0, x1, x2, x3, k0, k1, lo0, lo1, hi0, hi1;
+
+    while( blocks-- > 0 )
+    {
+        x0 = state->counter[0];
+        x1 = state->counter[1];
+        x2 = state->counter[2];
+        x3 = state->counter[3];
+        k0 = state->key[0];
+        k1 = state->key[1];
+
+        for( int round = 0; round < PHILOX_ROUNDS; round++ )
+        {
+            lo0 = mulhilo64( PHILOX_M0, x0, &hi0 );
+            lo1 = mulhilo64( PHILOX_M1, x2, &hi1 );
+            x0 = hi1 ^ x1 ^ k0;
+            x1 = lo1;
+            x2 = hi0 ^ x3 ^ k1;
+            x3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        store_le64( bufpos, x0 );
+        store_le64( bufpos + 8, x1 );
+        store_le64( bufpos + 16, x2 );
+        store_le64( bufpos + 24, x3 );
+        bufpos += PHILOX_PRNG_BLOCK_SIZE;
+
+        // Only the block number is incremented, the stream is 2^64 blocks long
+        state->counter[0]++;
+    }
+}
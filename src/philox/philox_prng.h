@@ -0,0 +1,45 @@
+/*
+ *  philox_prng.h: The Philox4x64-10 counter-based pseudo random number generator.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PHILOX_PRNG_H
+#define PHILOX_PRNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size in bytes of one block of output, four 64 bit words
+#define PHILOX_PRNG_BLOCK_SIZE 32
+
+typedef struct philox_prng_state_s
+{
+    uint64_t key[2];  // The 128 bit key.
+    uint64_t counter[4];  // The 256 bit counter, word 0 is the block number and the others are fixed by the seed.
+} philox_prng_state_t;
+
+// Folds every byte of the seed into the key and the fixed counter words, and starts at block zero.
+void philox_prng_init( philox_prng_state_t* state, const unsigned char* seed, size_t seed_length );
+
+// Positions the stream at the given block, so that the next block generated is the one at byte
+// offset block * PHILOX_PRNG_BLOCK_SIZE.
+void philox_prng_seek( philox_prng_state_t* state, uint64_t block );
+
+// Generates blocks of PHILOX_PRNG_BLOCK_SIZE bytes into the output buffer, as little-endian 64 bit words.
+// Every block only depends on the key and its own counter, so no block has to be generated to reach another.
+void philox_prng_genrand_to_buf( philox_prng_state_t* state, unsigned char* bufpos, size_t blocks );
+
+#endif  // PHILOX_PRNG_H
@@ -27,18 +27,38 @@
 #include "isaac_rand/isaac64.h"
 #include "alfg/add_lagg_fibonacci_prng.h"  //Lagged Fibonacci generator prototype
 #include "xor/xoroshiro256_prng.h"  //XORoshiro-256 prototype
+#include "aes/aes_ctr_prng.h"  //AES-CTR prototype
+#include "philox/philox_prng.h"  //Philox prototype
 
-nwipe_prng_t nwipe_twister = { "Mersenne Twister (mt19937ar-cok)", nwipe_twister_init, nwipe_twister_read };
+nwipe_prng_t nwipe_twister = { "Mersenne Twister (mt19937ar-cok)", nwipe_twister_init, nwipe_twister_read, NULL };
 
-nwipe_prng_t nwipe_isaac = { "ISAAC (rand.c 20010626)", nwipe_isaac_init, nwipe_isaac_read };
-nwipe_prng_t nwipe_isaac64 = { "ISAAC-64 (isaac64.c)", nwipe_isaac64_init, nwipe_isaac64_read };
+nwipe_prng_t nwipe_isaac = { "ISAAC (rand.c 20010626)", nwipe_isaac_init, nwipe_isaac_read, NULL };
+nwipe_prng_t nwipe_isaac64 = { "ISAAC-64 (isaac64.c)", nwipe_isaac64_init, nwipe_isaac64_read, NULL };
 
 /* ALFG PRNG Structure */
 nwipe_prng_t nwipe_add_lagg_fibonacci_prng = { "Lagged Fibonacci generator",
                                                nwipe_add_lagg_fibonacci_prng_init,
-                                               nwipe_add_lagg_fibonacci_prng_read };
+                                               nwipe_add_lagg_fibonacci_prng_read,
+                                               NULL };
 /* XOROSHIRO-256 PRNG Structure */
-nwipe_prng_t nwipe_xoroshiro256_prng = { "XORoshiro-256", nwipe_xoroshiro256_prng_init, nwipe_xoroshiro256_prng_read };
+nwipe_prng_t nwipe_xoroshiro256_prng = { "XORoshiro-256",
+                                         nwipe_xoroshiro256_prng_init,
+                                         nwipe_xoroshiro256_prng_read,
+                                         NULL };
+/* AES-CTR PRNG Structure */
+nwipe_prng_t nwipe_aes_ctr_prng = { "AES-256-CTR",
+                                    nwipe_aes_ctr_prng_init,
+                                    nwipe_aes_ctr_prng_read,
+                                    nwipe_aes_ctr_prng_seek };
+/* Philox PRNG Structure */
+nwipe_prng_t nwipe_philox_prng = { "Philox4x64-10",
+                                   nwipe_philox_prng_init,
+                                   nwipe_philox_prng_read,
+                                   nwipe_philox_prng_seek };
+
+/* The PRNG streams are defined as little-endian words whatever the byte order of the host, so that a
+ * verification reproduces exactly what was written. Whole words are stored in bulk, only a remainder
+ * at the end of a read is shifted out a byte at a time. */
 
 /* Print given number of bytes from unsigned integer number to a byte stream buffer starting with low-endian. */
 static inline void u32_to_buffer( u8* restrict buffer, u32 val, const int len )
@@ -57,6 +77,16 @@ static inline void u64_to_buffer( u8* restrict buffer, u64 val, const int len )
         val >>= 8;
     }
 }
+static inline void u32_store( u8* restrict buffer, u32 val )
+{
+    val = htole32( val );
+    memcpy( buffer, &val, sizeof( val ) );
+}
+static inline void u64_store( u8* restrict buffer, u64 val )
+{
+    val = htole64( val );
+    memcpy( buffer, &val, sizeof( val ) );
+}
 static inline u32 isaac_nextval( randctx* restrict ctx )
 {
     if( ctx->randcnt == 0 )
@@ -96,12 +126,9 @@ int nwipe_twister_read( NWIPE_PRNG_READ_SIGNATURE )
     u8* restrict bufpos = buffer;
     size_t words = count / SIZE_OF_TWISTER;  // the values of twister_genrand_int32 is strictly 4 bytes
 
-    /* Twister returns 4-bytes per call, so progress by 4 bytes. */
-    for( size_t ii = 0; ii < words; ++ii )
-    {
-        u32_to_buffer( bufpos, twister_genrand_int32( (twister_state_t*) *state ), SIZE_OF_TWISTER );
-        bufpos += SIZE_OF_TWISTER;
-    }
+    /* Temper the whole 4-byte words straight from the twister state. */
+    twister_genrand_to_buf( (twister_state_t*) *state, bufpos, words );
+    bufpos += words * SIZE_OF_TWISTER;
 
     /* If there is some remainder copy only relevant number of bytes to not
      * overflow the buffer. */
@@ -169,13 +196,27 @@ int nwipe_isaac_read( NWIPE_PRNG_READ_SIGNATURE )
     randctx* isaac_state = *state;
     u8* restrict bufpos = buffer;
     size_t words = count / SIZE_OF_ISAAC;  // the values of isaac is strictly 4 bytes
+    size_t n;
 
-    /* Isaac returns 4-bytes per call, so progress by 4 bytes. */
-    for( size_t ii = 0; ii < words; ++ii )
+    /* Isaac returns its results from the end of randrsl, so copy runs of 4-byte words from there. */
+    while( words > 0 )
     {
-        /* get the next 32bit random number */
-        u32_to_buffer( bufpos, isaac_nextval( isaac_state ), SIZE_OF_ISAAC );
-        bufpos += SIZE_OF_ISAAC;
+        if( isaac_state->randcnt == 0 )
+        {
+            isaac( isaac_state );
+            isaac_state->randcnt = RANDSIZ;
+        }
+
+        n = isaac_state->randcnt < words ? isaac_state->randcnt : words;
+
+        for( size_t ii = 0; ii < n; ++ii )
+        {
+            u32_store( bufpos, (u32) isaac_state->randrsl[isaac_state->randcnt - 1 - ii] );
+            bufpos += SIZE_OF_ISAAC;
+        }
+
+        isaac_state->randcnt -= n;
+        words -= n;
     }
 
     /* If there is some remainder copy only relevant number of bytes to not overflow the buffer. */
@@ -243,11 +284,27 @@ int nwipe_isaac64_read( NWIPE_PRNG_READ_SIGNATURE )
     rand64ctx* isaac_state = *state;
     u8* restrict bufpos = buffer;
     size_t words = count / SIZE_OF_ISAAC64;  // the values of ISAAC-64 is strictly 8 bytes
+    size_t n;
 
-    for( size_t ii = 0; ii < words; ++ii )
+    /* ISAAC-64 returns its results from the end of randrsl, so copy runs of 8-byte words from there. */
+    while( words > 0 )
     {
-        u64_to_buffer( bufpos, isaac64_nextval( isaac_state ), SIZE_OF_ISAAC64 );
-        bufpos += SIZE_OF_ISAAC64;
+        if( isaac_state->randcnt == 0 )
+        {
+            isaac64( isaac_state );
+            isaac_state->randcnt = RANDSIZ;
+        }
+
+        n = isaac_state->randcnt < words ? isaac_state->randcnt : words;
+
+        for( size_t ii = 0; ii < n; ++ii )
+        {
+            u64_store( bufpos, isaac_state->randrsl[isaac_state->randcnt - 1 - ii] );
+            bufpos += SIZE_OF_ISAAC64;
+        }
+
+        isaac_state->randcnt -= n;
+        words -= n;
     }
 
     /* If there is some remainder copy only relevant number of bytes to not overflow the buffer. */
@@ -294,19 +351,16 @@ int nwipe_add_lagg_fibonacci_prng_read( NWIPE_PRNG_READ_SIGNATURE )
     u8* restrict bufpos = buffer;
     size_t words = count / SIZE_OF_ADD_LAGG_FIBONACCI_PRNG;
 
-    /* Loop to fill the buffer with blocks directly from the Fibonacci algorithm */
-    for( size_t ii = 0; ii < words; ++ii )
-    {
-        add_lagg_fibonacci_genrand_uint256_to_buf( (add_lagg_fibonacci_state_t*) *state, bufpos );
-        bufpos += SIZE_OF_ADD_LAGG_FIBONACCI_PRNG;  // Move to the next block
-    }
+    /* Fill the buffer with blocks directly from the Fibonacci algorithm */
+    add_lagg_fibonacci_genrand_to_buf( (add_lagg_fibonacci_state_t*) *state, bufpos, words );
+    bufpos += words * SIZE_OF_ADD_LAGG_FIBONACCI_PRNG;
 
     /* Handle remaining bytes if count is not a multiple of SIZE_OF_ADD_LAGG_FIBONACCI_PRNG */
     const size_t remain = count % SIZE_OF_ADD_LAGG_FIBONACCI_PRNG;
     if( remain > 0 )
     {
-        unsigned char temp_output[16];  // Temporary buffer for the last block
-        add_lagg_fibonacci_genrand_uint256_to_buf( (add_lagg_fibonacci_state_t*) *state, temp_output );
+        unsigned char temp_output[SIZE_OF_ADD_LAGG_FIBONACCI_PRNG];  // Temporary buffer for the last block
+        add_lagg_fibonacci_genrand_to_buf( (add_lagg_fibonacci_state_t*) *state, temp_output, 1 );
 
         // Copy the remaining bytes
         memcpy( bufpos, temp_output, remain );
@@ -320,19 +374,16 @@ int nwipe_xoroshiro256_prng_read( NWIPE_PRNG_READ_SIGNATURE )
     u8* restrict bufpos = buffer;
     size_t words = count / SIZE_OF_XOROSHIRO256_PRNG;
 
-    /* Loop to fill the buffer with blocks directly from the XORoroshiro256 algorithm */
-    for( size_t ii = 0; ii < words; ++ii )
-    {
-        xoroshiro256_genrand_uint256_to_buf( (xoroshiro256_state_t*) *state, bufpos );
-        bufpos += SIZE_OF_XOROSHIRO256_PRNG;  // Move to the next block
-    }
+    /* Fill the buffer with blocks directly from the XORoroshiro256 lanes */
+    xoroshiro256_genrand_to_buf( (xoroshiro256_state_t*) *state, bufpos, words );
+    bufpos += words * SIZE_OF_XOROSHIRO256_PRNG;
 
     /* Handle remaining bytes if count is not a multiple of SIZE_OF_XOROSHIRO256_PRNG */
     const size_t remain = count % SIZE_OF_XOROSHIRO256_PRNG;
     if( remain > 0 )
     {
-        unsigned char temp_output[16];  // Temporary buffer for the last block
-        xoroshiro256_genrand_uint256_to_buf( (xoroshiro256_state_t*) *state, temp_output );
+        unsigned char temp_output[SIZE_OF_XOROSHIRO256_PRNG];  // Temporary buffer for the last block
+        xoroshiro256_genrand_to_buf( (xoroshiro256_state_t*) *state, temp_output, 1 );
 
         // Copy the remaining bytes
         memcpy( bufpos, temp_output, remain );
@@ -340,3 +391,108 @@ int nwipe_xoroshiro256_prng_read( NWIPE_PRNG_READ_SIGNATURE )
 
     return 0;  // Success
 }
+
+/* AES-256 in counter mode, a cryptographically strong stream that runs on the AES instructions of the CPU */
+int nwipe_aes_ctr_prng_init( NWIPE_PRNG_INIT_SIGNATURE )
+{
+    nwipe_log( NWIPE_LOG_NOTICE, "Initialising AES-256-CTR PRNG" );
+
+    if( *state == NULL )
+    {
+        /* This is the first time that we have been called. */
+        *state = malloc( sizeof( aes_ctr_prng_state_t ) );
+    }
+    aes_ctr_prng_init( (aes_ctr_prng_state_t*) *state, seed->s, seed->length );
+
+    return 0;
+}
+
+int nwipe_aes_ctr_prng_read( NWIPE_PRNG_READ_SIGNATURE )
+{
+    u8* restrict bufpos = buffer;
+    size_t words = count / SIZE_OF_AES_CTR_PRNG;
+
+    /* Fill the buffer with encrypted counter blocks */
+    aes_ctr_prng_genrand_to_buf( (aes_ctr_prng_state_t*) *state, bufpos, words );
+    bufpos += words * SIZE_OF_AES_CTR_PRNG;
+
+    /* Handle remaining bytes if count is not a multiple of SIZE_OF_AES_CTR_PRNG */
+    const size_t remain = count % SIZE_OF_AES_CTR_PRNG;
+    if( remain > 0 )
+    {
+        unsigned char temp_output[SIZE_OF_AES_CTR_PRNG];  // Temporary buffer for the last block
+        aes_ctr_prng_genrand_to_buf( (aes_ctr_prng_state_t*) *state, temp_output, 1 );
+
+        // Copy the remaining bytes
+        memcpy( bufpos, temp_output, remain );
+    }
+
+    return 0;  // Success
+}
+
+int nwipe_aes_ctr_prng_seek( NWIPE_PRNG_SEEK_SIGNATURE )
+{
+    aes_ctr_prng_state_t* aes_state = (aes_ctr_prng_state_t*) *state;
+
+    /* Reads only continue the stream on a block boundary. */
+    if( offset % SIZE_OF_AES_CTR_PRNG != 0 )
+    {
+        return -1;
+    }
+
+    aes_state->counter[0] = offset / SIZE_OF_AES_CTR_PRNG;
+    aes_state->counter[1] = 0;
+
+    return 0;
+}
+
+/* Philox4x64-10, a counter-based generator that can start the stream at any offset */
+int nwipe_philox_prng_init( NWIPE_PRNG_INIT_SIGNATURE )
+{
+    nwipe_log( NWIPE_LOG_NOTICE, "Initialising Philox4x64-10 PRNG" );
+
+    if( *state == NULL )
+    {
+        /* This is the first time that we have been called. */
+        *state = malloc( sizeof( philox_prng_state_t ) );
+    }
+    philox_prng_init( (philox_prng_state_t*) *state, seed->s, seed->length );
+
+    return 0;
+}
+
+int nwipe_philox_prng_read( NWIPE_PRNG_READ_SIGNATURE )
+{
+    u8* restrict bufpos = buffer;
+    size_t words = count / SIZE_OF_PHILOX_PRNG;
+
+    /* Fill the buffer with blocks directly from the counter */
+    philox_prng_genrand_to_buf( (philox_prng_state_t*) *state, bufpos, words );
+    bufpos += words * SIZE_OF_PHILOX_PRNG;
+
+    /* Handle remaining bytes if count is not a multiple of SIZE_OF_PHILOX_PRNG */
+    const size_t remain = count % SIZE_OF_PHILOX_PRNG;
+    if( remain > 0 )
+    {
+        unsigned char temp_output[SIZE_OF_PHILOX_PRNG];  // Temporary buffer for the last block
+        philox_prng_genrand_to_buf( (philox_prng_state_t*) *state, temp_output, 1 );
+
+        // Copy the remaining bytes
+        memcpy( bufpos, temp_output, remain );
+    }
+
+    return 0;  // Success
+}
+
+int nwipe_philox_prng_seek( NWIPE_PRNG_SEEK_SIGNATURE )
+{
+    /* Reads only continue the stream on a block boundary. */
+    if( offset % SIZE_OF_PHILOX_PRNG != 0 )
+    {
+        return -1;
+    }
+
+    philox_prng_seek( (philox_prng_state_t*) *state, offset / SIZE_OF_PHILOX_PRNG );
+
+    return 0;
+}
@@ -32,10 +32,12 @@ typedef struct
 
 #define NWIPE_PRNG_INIT_SIGNATURE void **state, nwipe_entropy_t *seed
 #define NWIPE_PRNG_READ_SIGNATURE void **state, void *buffer, size_t count
+#define NWIPE_PRNG_SEEK_SIGNATURE void **state, u64 offset
 
 /* Function pointers for PRNG actions. */
 typedef int ( *nwipe_prng_init_t )( NWIPE_PRNG_INIT_SIGNATURE );
 typedef int ( *nwipe_prng_read_t )( NWIPE_PRNG_READ_SIGNATURE );
+typedef int ( *nwipe_prng_seek_t )( NWIPE_PRNG_SEEK_SIGNATURE );
 
 /* The generic PRNG definition. */
 typedef struct
@@ -43,6 +45,7 @@ typedef struct
     const char* label;  // The name of the pseudo random number generator.
     nwipe_prng_init_t init;  // Inialize the prng state with the seed.
     nwipe_prng_read_t read;  // Read data from the prng.
+    nwipe_prng_seek_t seek;  // Move the stream to a byte offset, NULL if the prng can only be read in sequence.
 } nwipe_prng_t;
 
 /* Mersenne Twister prototypes. */
@@ -63,6 +66,16 @@ int nwipe_add_lagg_fibonacci_prng_read( NWIPE_PRNG_READ_SIGNATURE );
 int nwipe_xoroshiro256_prng_init( NWIPE_PRNG_INIT_SIGNATURE );
 int nwipe_xoroshiro256_prng_read( NWIPE_PRNG_READ_SIGNATURE );
 
+/* AES-CTR prototypes. */
+int nwipe_aes_ctr_prng_init( NWIPE_PRNG_INIT_SIGNATURE );
+int nwipe_aes_ctr_prng_read( NWIPE_PRNG_READ_SIGNATURE );
+int nwipe_aes_ctr_prng_seek( NWIPE_PRNG_SEEK_SIGNATURE );
+
+/* Philox prototypes. */
+int nwipe_philox_prng_init( NWIPE_PRNG_INIT_SIGNATURE );
+int nwipe_philox_prng_read( NWIPE_PRNG_READ_SIGNATURE );
+int nwipe_philox_prng_seek( NWIPE_PRNG_SEEK_SIGNATURE );
+
 /* Size of the twister is not derived from the architecture, but it is strictly 4 bytes */
 #define SIZE_OF_TWISTER 4
 
@@ -73,7 +86,14 @@ int nwipe_xoroshiro256_prng_read( NWIPE_PRNG_READ_SIGNATURE );
 /* Size of the Lagged Fibonacci generator is not derived from the architecture, but it is strictly 32 bytes */
 #define SIZE_OF_ADD_LAGG_FIBONACCI_PRNG 32
 
-/* Size of the XOROSHIRO-256 is not derived from the architecture, but it is strictly 32 bytes */
-#define SIZE_OF_XOROSHIRO256_PRNG 32
+/* Size of the XOROSHIRO-256 output is not derived from the architecture, it is strictly 32 bytes
+ * for each of the four interleaved lanes, see XOROSHIRO256_BLOCK_SIZE */
+#define SIZE_OF_XOROSHIRO256_PRNG 128
+
+/* Size of the AES-CTR output is the AES block, strictly 16 bytes */
+#define SIZE_OF_AES_CTR_PRNG 16
+
+/* Size of the Philox output is four 64 bit words, strictly 32 bytes */
+#define SIZE_OF_PHILOX_PRNG 32
 
 #endif /* PRNG_H_ */
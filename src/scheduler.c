@@ -0,0 +1,816 @@
+/*
+ *  scheduler.c: The queue of the wipes, which limits how many of them run at once,
+ *  and the admission of their I/O to the links the devices share.
+ *
+ *  A station with dozens of drives behind one HBA or SAS expander saturates it
+ *  when every wipe runs at once, and the drives slow each other down. The
+ *  wipes are queued in the order the devices were selected and are started as
+ *  slots become free, up to --max-wipes in all and --max-wipes-per-controller
+ *  on each controller or SAS expander, which is found from the sysfs path of
+ *  the device.
+ *
+ *  The drives behind a USB hub, SAS expander or SATA port multiplier also
+ *  share one link. With --link-bandwidth each link gets a token bucket that
+ *  is refilled at that rate, and the reads and writes of its drives are
+ *  admitted in turn, so that a fast drive can't starve a slow one while
+ *  whatever bandwidth a drive leaves unused goes to the others.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <ctype.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "options.h"
+#include "events.h"
+#include "logging.h"
+#include "scheduler.h"
+
+static int nwipe_scheduler_pci( const char* component, size_t length )
+{
+    /**
+     * Checks whether a component of a sysfs path is a PCI address, e.g. 0000:00:1f.2.
+     *
+     * @returns  1 for a PCI address, 0 otherwise.
+     */
+
+    const char* format = "hhhh:hh:hh.h";
+    size_t i;
+
+    if( length != strlen( format ) )
+    {
+        return 0;
+    }
+
+    for( i = 0; i < length; i++ )
+    {
+        if( format[i] == 'h' ? !isxdigit( (unsigned char) component[i] ) : component[i] != format[i] )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+
+} /* nwipe_scheduler_pci */
+
+static int nwipe_scheduler_usb( const char* component, size_t length )
+{
+    /**
+     * Checks whether a component of a sysfs path is a USB device or hub, e.g. 2-1.4, as
+     * opposed to the interface of one, e.g. 2-1.4:1.0.
+     *
+     * @returns  1 for a USB device, 0 otherwise.
+     */
+
+    size_t i = 0;
+
+    while( i < length && isdigit( (unsigned char) component[i] ) )
+    {
+        i++;
+    }
+
+    if( i == 0 || i == length || component[i] != '-' )
+    {
+        return 0;
+    }
+
+    for( i++; i < length; i++ )
+    {
+        if( !isdigit( (unsigned char) component[i] ) && component[i] != '.' )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+
+} /* nwipe_scheduler_usb */
+
+static int nwipe_scheduler_ata( const char* component, size_t length )
+{
+    /**
+     * Checks whether a component of a sysfs path is an ATA port, e.g. ata3, which the devices
+     * behind a SATA port multiplier share.
+     *
+     * @returns  1 for an ATA port, 0 otherwise.
+     */
+
+    size_t i;
+
+    if( length <= 3 || strncmp( component, "ata", 3 ) != 0 )
+    {
+        return 0;
+    }
+
+    for( i = 3; i < length; i++ )
+    {
+        if( !isdigit( (unsigned char) component[i] ) )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+
+} /* nwipe_scheduler_ata */
+
+static int nwipe_scheduler_upstream( nwipe_context_t* c, char* controller, size_t csize, char* link, size_t lsize )
+{
+    /**
+     * Finds the controller or SAS expander that a device is attached to, and the link it shares
+     * with other devices, from the sysfs path of the device, e.g.
+     * /sys/devices/pci0000:00/0000:00:1f.2/ata1/host0/... for a port of the SATA controller
+     * 0000:00:1f.2, or .../host6/port-6:0/expander-6:0/port-6:0:1/... for a disk behind a SAS
+     * expander.
+     *
+     * The controller is the last PCI device or expander in the path, an NVMe drive is its own
+     * controller. The link is the last of these, the ATA port, or the USB hub the device is
+     * plugged into, e.g. usb2/2-1 for the device 2-1/2-1.4. The NUMA node of the device is the
+     * one of the last PCI device, it is set in c->numa_node.
+     *
+     * @returns  0 with the sysfs paths of the controller and the link, -1 if they are not known,
+     *           e.g. for files and virtual devices.
+     */
+
+    /* The sysfs link of the device and the path it points to. */
+    char class[FILENAME_MAX];
+    char path[PATH_MAX];
+
+    /* The device name without /dev/. */
+    const char* name = strrchr( c->device_name, '/' );
+
+    /* The current component of the path, and the end of it. */
+    char* component;
+    char* end;
+
+    /* The lengths of the paths of the last PCI device, the controller and the link. */
+    size_t plength = 0;
+    size_t clength = 0;
+    size_t llength = 0;
+
+    /* The numa_node file of the PCI device. */
+    char node[PATH_MAX + 16];
+    FILE* fp;
+
+    snprintf( class, sizeof( class ), "/sys/class/block/%s", name != NULL ? name + 1 : c->device_name );
+
+    if( realpath( class, path ) == NULL )
+    {
+        return -1;
+    }
+
+    for( component = path; *component == '/'; component = end )
+    {
+        component++;
+        end = strchr( component, '/' );
+
+        if( end == NULL )
+        {
+            end = component + strlen( component );
+        }
+
+        if( nwipe_scheduler_pci( component, end - component ) )
+        {
+            plength = end - path;
+            clength = plength;
+            llength = plength;
+        }
+        else if( strncmp( component, "expander-", 9 ) == 0 )
+        {
+            clength = end - path;
+            llength = clength;
+        }
+        else if( nwipe_scheduler_ata( component, end - component ) )
+        {
+            llength = end - path;
+        }
+        else if( nwipe_scheduler_usb( component, end - component ) )
+        {
+            /* The hub the device is plugged into, without the slash before the device. */
+            llength = component - path - 1;
+        }
+    }
+
+    if( clength == 0 )
+    {
+        return -1;
+    }
+
+    snprintf( controller, csize, "%.*s", (int) clength, path );
+    snprintf( link, lsize, "%.*s", (int) llength, path );
+
+    /* The node is -1 on machines without NUMA. */
+    if( plength > 0 )
+    {
+        snprintf( node, sizeof( node ), "%.*s/numa_node", (int) plength, path );
+        fp = fopen( node, "r" );
+
+        if( fp != NULL )
+        {
+            if( fscanf( fp, "%i", &c->numa_node ) != 1 )
+            {
+                c->numa_node = -1;
+            }
+
+            fclose( fp );
+        }
+    }
+
+    return 0;
+
+} /* nwipe_scheduler_upstream */
+
+/* The sysfs paths of the controllers, indexed by wipe_group, and of the links. */
+static char** nwipe_groups = NULL;
+static int nwipe_group_count = 0;
+static char** nwipe_link_paths = NULL;
+
+/* The links that the devices share. They are allocated one by one as devices are added, so that
+ * the contexts keep pointing at them when the list grows. */
+static nwipe_link_t** nwipe_links = NULL;
+static int nwipe_link_count = 0;
+
+static int nwipe_scheduler_group( const char* path )
+{
+    /**
+     * Finds the sysfs path of a controller in the paths seen so far, and adds it if it is new.
+     *
+     * @returns  The index of the path in the list, -1 if it could not be added.
+     */
+
+    char** group;
+    int j = 0;
+
+    while( j < nwipe_group_count && strcmp( nwipe_groups[j], path ) != 0 )
+    {
+        j++;
+    }
+
+    if( j == nwipe_group_count )
+    {
+        group = realloc( nwipe_groups, ( nwipe_group_count + 1 ) * sizeof( char* ) );
+
+        if( !group )
+        {
+            nwipe_perror( errno, __FUNCTION__, "realloc" );
+            return -1;
+        }
+
+        nwipe_groups = group;
+        nwipe_groups[j] = strdup( path );
+
+        if( !nwipe_groups[j] )
+        {
+            nwipe_perror( errno, __FUNCTION__, "strdup" );
+            return -1;
+        }
+
+        nwipe_group_count++;
+    }
+
+    return j;
+
+} /* nwipe_scheduler_group */
+
+static nwipe_link_t* nwipe_scheduler_link( const char* path )
+{
+    /**
+     * Finds the link with a sysfs path, and allocates it if it is new.
+     *
+     * @returns  The link, NULL if it could not be allocated.
+     */
+
+    nwipe_link_t** links;
+    char** paths;
+    nwipe_link_t* link;
+    int j = 0;
+
+    while( j < nwipe_link_count && strcmp( nwipe_link_paths[j], path ) != 0 )
+    {
+        j++;
+    }
+
+    if( j < nwipe_link_count )
+    {
+        return nwipe_links[j];
+    }
+
+    links = realloc( nwipe_links, ( nwipe_link_count + 1 ) * sizeof( nwipe_link_t* ) );
+
+    if( links )
+    {
+        nwipe_links = links;
+    }
+
+    paths = realloc( nwipe_link_paths, ( nwipe_link_count + 1 ) * sizeof( char* ) );
+
+    if( paths )
+    {
+        nwipe_link_paths = paths;
+    }
+
+    link = calloc( 1, sizeof( nwipe_link_t ) );
+
+    if( !links || !paths || !link )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to allocate the link %s, --link-bandwidth is ignored on it.", path );
+        free( link );
+        return NULL;
+    }
+
+    nwipe_link_paths[j] = strdup( path );
+
+    if( !nwipe_link_paths[j] )
+    {
+        nwipe_perror( errno, __FUNCTION__, "strdup" );
+        free( link );
+        return NULL;
+    }
+
+    pthread_mutex_init( &link->mutex, NULL );
+    pthread_cond_init( &link->turn, NULL );
+    link->number = j + 1;
+
+    /* The bucket starts full, a tenth of a second of the link. */
+    link->rate = nwipe_options.link_bandwidth * 1000000.0;
+    link->tokens = link->rate / 10;
+    clock_gettime( CLOCK_MONOTONIC, &link->refill );
+    link->sample_time = link->refill;
+
+    nwipe_links[j] = link;
+    nwipe_link_count++;
+
+    return link;
+
+} /* nwipe_scheduler_link */
+
+void nwipe_scheduler_add( nwipe_context_t* c )
+{
+    /* The controller and the link of the device. */
+    char controller[PATH_MAX];
+    char path[PATH_MAX];
+
+    c->wipe_group = -1;
+    c->link = NULL;
+    c->numa_node = -1;
+
+    if( nwipe_scheduler_upstream( c, controller, sizeof( controller ), path, sizeof( path ) ) != 0 )
+    {
+        return;
+    }
+
+    c->wipe_group = nwipe_scheduler_group( controller );
+    c->link = nwipe_scheduler_link( path );
+
+    if( c->link != NULL )
+    {
+        c->link->devices++;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE, "%s is attached to %s over %s", c->device_name, controller, path );
+
+    if( nwipe_options.numa && c->numa_node >= 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "%s is wiped on NUMA node %i", c->device_name, c->numa_node );
+    }
+
+} /* nwipe_scheduler_add */
+
+void nwipe_scheduler_remove( nwipe_context_t* c )
+{
+    /* The link is kept, another device may be plugged into it later. */
+    if( c->link != NULL )
+    {
+        c->link->devices--;
+        c->link = NULL;
+    }
+
+    c->wipe_group = -1;
+
+} /* nwipe_scheduler_remove */
+
+void nwipe_scheduler_init( nwipe_context_t** c, int count )
+{
+    int i;
+    int j;
+
+    for( i = 0; i < count; i++ )
+    {
+        c[i]->wipe_group = -1;
+        c[i]->link = NULL;
+        c[i]->numa_node = -1;
+
+        if( c[i]->wipe_queued )
+        {
+            nwipe_scheduler_add( c[i] );
+        }
+    }
+
+    for( j = 0; j < nwipe_link_count; j++ )
+    {
+        if( nwipe_links[j]->devices > 1 || nwipe_options.link_bandwidth > 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTICE,
+                       "Link %i is %s, shared by %i devices.",
+                       nwipe_links[j]->number,
+                       nwipe_link_paths[j],
+                       nwipe_links[j]->devices );
+        }
+    }
+
+} /* nwipe_scheduler_init */
+
+int nwipe_scheduler_running( nwipe_context_t* c )
+{
+    /* The method sets wipe_status to 1 when it starts and to 0 when it has finished. */
+    return c->thread != 0 && c->wipe_status != 0;
+
+} /* nwipe_scheduler_running */
+
+int nwipe_scheduler_pending( nwipe_context_t** c, int count )
+{
+    int pending = 0;
+    int i;
+
+    for( i = 0; i < count; i++ )
+    {
+        pending += nwipe_scheduler_running( c[i] ) + c[i]->wipe_queued;
+    }
+
+    return pending;
+
+} /* nwipe_scheduler_pending */
+
+static void* nwipe_scheduler_thread( void* ptr )
+{
+    /**
+     * Runs the method on a device, then wakes the main thread up through the eventfd of the wipe,
+     * so that it starts the next queued wipe or finishes without waiting for its timer.
+     */
+
+    nwipe_context_t* c = (nwipe_context_t*) ptr;
+    void* ( *method )( void* ) = nwipe_options.method;
+
+    method( ptr );
+    nwipe_events_wipe_done( c );
+
+    return NULL;
+
+} /* nwipe_scheduler_thread */
+
+static int nwipe_scheduler_cpus( int node, cpu_set_t* cpus )
+{
+    /**
+     * Reads the CPUs of a NUMA node from sysfs, a list of ranges such as 0-13,28-41.
+     *
+     * @returns  0 on success, -1 if the CPUs are not known.
+     */
+
+    char filename[FILENAME_MAX];
+    FILE* fp;
+
+    /* The first and last CPU of a range. */
+    int first;
+    int last;
+
+    /* The character after a range. */
+    int next = ',';
+
+    CPU_ZERO( cpus );
+    snprintf( filename, sizeof( filename ), "/sys/devices/system/node/node%i/cpulist", node );
+
+    fp = fopen( filename, "r" );
+
+    if( fp == NULL )
+    {
+        return -1;
+    }
+
+    while( next == ',' && fscanf( fp, "%i", &first ) == 1 )
+    {
+        last = first;
+        next = fgetc( fp );
+
+        if( next == '-' && fscanf( fp, "%i", &last ) == 1 )
+        {
+            next = fgetc( fp );
+        }
+
+        for( ; first <= last && first < CPU_SETSIZE; first++ )
+        {
+            CPU_SET( first, cpus );
+        }
+    }
+
+    fclose( fp );
+
+    return CPU_COUNT( cpus ) > 0 ? 0 : -1;
+
+} /* nwipe_scheduler_cpus */
+
+static int nwipe_scheduler_start( nwipe_context_t* c )
+{
+    /**
+     * Creates the wipe thread of a device. With --numa it runs on the CPUs of the node of the
+     * device and prefers the memory of that node. The threads it creates in turn, the PRNG
+     * and region threads, inherit both, and the buffers they allocate are local to the node.
+     *
+     * @returns  0 on success, the error of pthread_create otherwise.
+     */
+
+    pthread_attr_t attr;
+    cpu_set_t cpus;
+
+    /* The mask of the preferred node, as for set_mempolicy(2). */
+    unsigned long nodes[16];
+
+    int placed = 0;
+    int r;
+
+    if( !nwipe_options.numa || c->numa_node < 0 || c->numa_node >= (int) ( 8 * sizeof( nodes ) )
+        || nwipe_scheduler_cpus( c->numa_node, &cpus ) != 0 )
+    {
+        return pthread_create( &c->thread, NULL, nwipe_scheduler_thread, (void*) c );
+    }
+
+    pthread_attr_init( &attr );
+
+    if( pthread_attr_setaffinity_np( &attr, sizeof( cpus ), &cpus ) == 0 )
+    {
+        placed = 1;
+    }
+
+    /* The new thread inherits the memory policy of this one, which is restored afterwards. */
+    memset( nodes, 0, sizeof( nodes ) );
+    nodes[c->numa_node / ( 8 * sizeof( unsigned long ) )] = 1UL << ( c->numa_node % ( 8 * sizeof( unsigned long ) ) );
+
+    if( syscall( SYS_set_mempolicy, MPOL_PREFERRED, nodes, 8 * sizeof( nodes ) ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "set_mempolicy" );
+        nwipe_log( NWIPE_LOG_WARNING, "The buffers of '%s' are not local to its NUMA node.", c->device_name );
+    }
+
+    r = pthread_create( &c->thread, &attr, nwipe_scheduler_thread, (void*) c );
+
+    syscall( SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0 );
+    pthread_attr_destroy( &attr );
+
+    if( r == 0 && placed && nwipe_options.verbose )
+    {
+        nwipe_log( NWIPE_LOG_INFO, "The wipe of '%s' runs on the CPUs of NUMA node %i.", c->device_name, c->numa_node );
+    }
+
+    return r;
+
+} /* nwipe_scheduler_start */
+
+int nwipe_scheduler_poll( nwipe_context_t** c, int count )
+{
+    /* The number of wipes running, in all and on the controller of a device. */
+    int running = 0;
+    int busy;
+
+    /* The number of wipes still queued. */
+    int queued = 0;
+
+    /* The number of wipes started. */
+    int started = 0;
+
+    /* The time the throughput of the links is sampled, and since the last sample. */
+    struct timespec now;
+    double elapsed;
+
+    int i;
+    int j;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    for( j = 0; j < nwipe_link_count; j++ )
+    {
+        elapsed = ( now.tv_sec - nwipe_links[j]->sample_time.tv_sec )
+            + ( now.tv_nsec - nwipe_links[j]->sample_time.tv_nsec ) / 1e9;
+
+        if( elapsed >= 1 )
+        {
+            pthread_mutex_lock( &nwipe_links[j]->mutex );
+            nwipe_links[j]->throughput = ( nwipe_links[j]->bytes - nwipe_links[j]->sample_bytes ) / elapsed;
+            nwipe_links[j]->sample_bytes = nwipe_links[j]->bytes;
+            nwipe_links[j]->sample_time = now;
+            pthread_mutex_unlock( &nwipe_links[j]->mutex );
+        }
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        running += nwipe_scheduler_running( c[i] );
+        queued += c[i]->wipe_queued;
+    }
+
+    for( i = 0; i < count && queued > 0; i++ )
+    {
+        if( !c[i]->wipe_queued )
+        {
+            continue;
+        }
+
+        if( nwipe_options.max_wipes > 0 && running >= nwipe_options.max_wipes )
+        {
+            break;
+        }
+
+        /* A wipe held back by its controller doesn't hold up the wipes on other controllers. */
+        if( nwipe_options.max_wipes_per_controller > 0 && c[i]->wipe_group >= 0 )
+        {
+            busy = 0;
+
+            for( j = 0; j < count; j++ )
+            {
+                if( c[j]->wipe_group == c[i]->wipe_group && nwipe_scheduler_running( c[j] ) )
+                {
+                    busy++;
+                }
+            }
+
+            if( busy >= nwipe_options.max_wipes_per_controller )
+            {
+                continue;
+            }
+        }
+
+        c[i]->wipe_queued = 0;
+        queued--;
+
+        /* Fork a child process, on the CPUs and memory of the node of the device with --numa. */
+        nwipe_events_add_wipe( c[i] );
+        errno = nwipe_scheduler_start( c[i] );
+
+        if( errno )
+        {
+            nwipe_events_remove_wipe( c[i] );
+            /* The other wipes carry on, this one is reported as failed. */
+            nwipe_perror( errno, __FUNCTION__, "pthread_create" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to start the wipe of '%s'.", c[i]->device_name );
+            c[i]->thread = 0;
+            c[i]->result = -1;
+            c[i]->wipe_status = 0;
+            continue;
+        }
+
+        running++;
+        started++;
+
+        if( nwipe_options.max_wipes > 0 || nwipe_options.max_wipes_per_controller > 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTICE,
+                       "Started the wipe of %s, %i running, %i queued.",
+                       c[i]->device_name,
+                       running,
+                       queued );
+        }
+    }
+
+    return started;
+
+} /* nwipe_scheduler_poll */
+
+static void nwipe_scheduler_refill( nwipe_link_t* link )
+{
+    /**
+     * Adds the tokens for the time since the last refill, up to a tenth of a second of the link.
+     * The caller holds the mutex of the link.
+     */
+
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    link->tokens += link->rate
+        * ( ( now.tv_sec - link->refill.tv_sec ) + ( now.tv_nsec - link->refill.tv_nsec ) / 1e9 );
+    link->refill = now;
+
+    if( link->tokens > link->rate / 10 )
+    {
+        link->tokens = link->rate / 10;
+    }
+
+} /* nwipe_scheduler_refill */
+
+void nwipe_scheduler_admit( nwipe_context_t* c, size_t bytes )
+{
+    nwipe_link_t* link = c->link;
+
+    /* The turn of this request. */
+    unsigned long ticket;
+
+    /* The tokens needed before the request is admitted, and the time to wait for them. */
+    double needed;
+    struct timespec wait;
+    double seconds;
+
+    /* The cancel state of the thread. */
+    int state;
+
+    if( link == NULL )
+    {
+        return;
+    }
+
+    pthread_mutex_lock( &link->mutex );
+    link->bytes += bytes;
+
+    if( link->rate <= 0 )
+    {
+        pthread_mutex_unlock( &link->mutex );
+        return;
+    }
+
+    /* A wipe cancelled while it waits would never give up its turn, the wipe threads test for
+     * cancellation after each block anyway. */
+    pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, &state );
+
+    /* Each thread has at most one request waiting, so the devices on the link take turns. */
+    ticket = link->ticket++;
+
+    while( link->serving != ticket )
+    {
+        pthread_cond_wait( &link->turn, &link->mutex );
+    }
+
+    nwipe_scheduler_refill( link );
+
+    /* A request larger than the bucket is admitted once it is full, and the tokens go negative. */
+    needed = bytes < link->rate / 10 ? bytes : link->rate / 10;
+
+    while( link->tokens < needed )
+    {
+        seconds = ( needed - link->tokens ) / link->rate;
+        wait.tv_sec = (time_t) seconds;
+        wait.tv_nsec = (long) ( ( seconds - wait.tv_sec ) * 1e9 );
+
+        pthread_mutex_unlock( &link->mutex );
+        nanosleep( &wait, NULL );
+        pthread_mutex_lock( &link->mutex );
+
+        nwipe_scheduler_refill( link );
+    }
+
+    link->tokens -= bytes;
+    link->serving++;
+
+    pthread_cond_broadcast( &link->turn );
+    pthread_mutex_unlock( &link->mutex );
+
+    pthread_setcancelstate( state, NULL );
+
+} /* nwipe_scheduler_admit */
+
+void nwipe_scheduler_free( void )
+{
+    int j;
+
+    for( j = 0; j < nwipe_link_count; j++ )
+    {
+        pthread_mutex_destroy( &nwipe_links[j]->mutex );
+        pthread_cond_destroy( &nwipe_links[j]->turn );
+        free( nwipe_links[j] );
+        free( nwipe_link_paths[j] );
+    }
+
+    for( j = 0; j < nwipe_group_count; j++ )
+    {
+        free( nwipe_groups[j] );
+    }
+
+    free( nwipe_links );
+    free( nwipe_link_paths );
+    free( nwipe_groups );
+    nwipe_links = NULL;
+    nwipe_link_paths = NULL;
+    nwipe_groups = NULL;
+    nwipe_link_count = 0;
+    nwipe_group_count = 0;
+
+} /* nwipe_scheduler_free */
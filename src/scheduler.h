@@ -0,0 +1,93 @@
+/*
+ *  scheduler.h: The queue of the wipes, which limits how many of them run at once.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <pthread.h>
+#include <time.h>
+
+/* A link that the devices behind it share, e.g. a USB hub, SAS expander or SATA port multiplier. */
+typedef struct nwipe_link_t_
+{
+    pthread_mutex_t mutex;  // Serializes the admission of I/O to the link.
+    pthread_cond_t turn;  // Signalled when the next request may be admitted.
+    int number;  // The number of the link shown in the GUI, from 1.
+    int devices;  // The number of devices behind the link.
+    double rate;  // The bandwidth of the link in bytes per second, 0 = not limited.
+    double tokens;  // The bytes that may be transferred now, negative while a large request is paid off.
+    struct timespec refill;  // When the tokens were last added.
+    unsigned long ticket;  // The next ticket handed to a request.
+    unsigned long serving;  // The ticket of the request being admitted.
+    u64 bytes;  // The bytes admitted over the link.
+    u64 sample_bytes;  // The bytes admitted when the throughput was last sampled.
+    struct timespec sample_time;  // When the throughput was last sampled.
+    double throughput;  // The throughput of the link in bytes per second.
+} nwipe_link_t;
+
+/**
+ * Finds the controller or SAS expander of each queued device, which --max-wipes-per-controller
+ * applies to, and the link it shares with other devices, which --link-bandwidth applies to.
+ * The devices are queued by setting wipe_queued once they are ready to be wiped.
+ */
+void nwipe_scheduler_init( nwipe_context_t** c, int count );
+
+/**
+ * Finds the controller, the link and the NUMA node of a device that is added once the wipes
+ * have started, as nwipe_scheduler_init() does for the devices found at startup.
+ */
+void nwipe_scheduler_add( nwipe_context_t* c );
+
+/**
+ * Takes a device off its link, once its wipe thread has stopped and before it is freed.
+ */
+void nwipe_scheduler_remove( nwipe_context_t* c );
+
+/**
+ * Starts the queued wipes that fit within --max-wipes and --max-wipes-per-controller, in the
+ * order of the queue, and samples the throughput of the links. It is called once the devices
+ * are queued, then every second while the wipes run, so that the next wipe starts as soon as
+ * one finishes.
+ *
+ * @returns  The number of wipes that were started.
+ */
+int nwipe_scheduler_poll( nwipe_context_t** c, int count );
+
+/**
+ * @returns  1 if the wipe thread of the device has been started and has not finished, 0 otherwise.
+ */
+int nwipe_scheduler_running( nwipe_context_t* c );
+
+/**
+ * @returns  The number of wipes that are running or still queued.
+ */
+int nwipe_scheduler_pending( nwipe_context_t** c, int count );
+
+/**
+ * Waits until a read or write of the given number of bytes may be issued on the link of the
+ * device. The requests of the devices on a link are admitted in turn, so a fast device doesn't
+ * starve a slow one, and the link is kept busy whenever any device has a request for it.
+ */
+void nwipe_scheduler_admit( nwipe_context_t* c, size_t bytes );
+
+/**
+ * Frees the links, once the wipe threads have stopped.
+ */
+void nwipe_scheduler_free( void );
+
+#endif /* SCHEDULER_H_ */
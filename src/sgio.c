@@ -0,0 +1,370 @@
+/*
+ *  sgio.c: SCSI and ATA commands issued through the SG_IO ioctl.
+ *
+ *  The drive information used to be read by running hdparm, smartctl and
+ *  readlink, which is slow with many drives and needs the programs to be
+ *  installed. These routines issue the few commands that are needed
+ *  directly: SCSI INQUIRY, and ATA commands wrapped in ATA PASS-THROUGH (16),
+ *  which SATA drives on SAS HBAs and most USB bridges understand.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <scsi/sg.h>
+#include "sgio.h"
+
+/* The SCSI status and sense key values that are checked. */
+#define NWIPE_SG_CHECK_CONDITION 0x02
+#define NWIPE_SG_RECOVERED_ERROR 0x01
+#define NWIPE_SG_DRIVER_SENSE 0x08
+
+/* The ATA PASS-THROUGH protocols. */
+#define NWIPE_SG_ATA_NON_DATA 3
+#define NWIPE_SG_ATA_PIO_IN 4
+#define NWIPE_SG_ATA_PIO_OUT 5
+
+/* The ATA status register error bit. */
+#define NWIPE_SG_ATA_ERR 0x01
+
+int nwipe_sg_command( int fd,
+                      const unsigned char* cdb,
+                      int cdb_length,
+                      nwipe_sg_dir_t dir,
+                      void* data,
+                      int length,
+                      unsigned char* sense,
+                      int sense_length,
+                      unsigned timeout )
+{
+    sg_io_hdr_t io_hdr;
+
+    memset( &io_hdr, 0, sizeof( sg_io_hdr_t ) );
+    io_hdr.interface_id = 'S';
+    io_hdr.cmd_len = cdb_length;
+    io_hdr.cmdp = (unsigned char*) cdb;
+    io_hdr.mx_sb_len = sense_length;
+    io_hdr.sbp = sense;
+    io_hdr.dxferp = data;
+    io_hdr.dxfer_len = length;
+    io_hdr.timeout = timeout;
+
+    switch( dir )
+    {
+        case NWIPE_SG_IN:
+            io_hdr.dxfer_direction = SG_DXFER_FROM_DEV;
+            break;
+
+        case NWIPE_SG_OUT:
+            io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
+            break;
+
+        default:
+            io_hdr.dxfer_direction = SG_DXFER_NONE;
+            break;
+    }
+
+    if( sense != NULL )
+    {
+        memset( sense, 0, sense_length );
+    }
+
+    if( ioctl( fd, SG_IO, &io_hdr ) < 0 )
+    {
+        return -1;
+    }
+
+    if( io_hdr.host_status != 0 )
+    {
+        return -1;
+    }
+
+    /* The sense data is returned with CHECK CONDITION, the driver flags it with DRIVER_SENSE. */
+    if( io_hdr.status == NWIPE_SG_CHECK_CONDITION || ( io_hdr.driver_status & NWIPE_SG_DRIVER_SENSE )
+        || io_hdr.sb_len_wr > 0 )
+    {
+        return 1;
+    }
+
+    return io_hdr.status == 0 && ( io_hdr.driver_status & 0x0f ) == 0 ? 0 : -1;
+
+} /* nwipe_sg_command */
+
+int nwipe_sg_inquiry( int fd, int page, unsigned char* data, int length )
+{
+    unsigned char cdb[6] = { 0x12, 0, 0, 0, 0, 0 };
+    unsigned char sense[32];
+
+    if( page >= 0 )
+    {
+        cdb[1] = 0x01;  // EVPD
+        cdb[2] = (unsigned char) page;
+    }
+
+    cdb[3] = (unsigned char) ( length >> 8 );
+    cdb[4] = (unsigned char) length;
+
+    memset( data, 0, length );
+
+    if( nwipe_sg_command( fd, cdb, sizeof( cdb ), NWIPE_SG_IN, data, length, sense, sizeof( sense ), NWIPE_SG_TIMEOUT )
+        != 0 )
+    {
+        return -1;
+    }
+
+    /* The page code is echoed in the second byte of a vital product data page. */
+    if( page >= 0 && data[1] != page )
+    {
+        return -1;
+    }
+
+    return 0;
+
+} /* nwipe_sg_inquiry */
+
+static int nwipe_sg_ata_registers( const unsigned char* sense, nwipe_sg_ata_t* ata )
+{
+    /**
+     * Extracts the ATA registers returned with CK_COND from the sense data, in descriptor
+     * format (ATA Status Return descriptor) or fixed format.
+     *
+     * @returns  0 when the registers were found, -1 otherwise.
+     */
+
+    const unsigned char* d;
+    int length;
+    int i;
+
+    if( ( sense[0] & 0x7f ) == 0x72 )
+    {
+        length = sense[7];
+
+        for( i = 8; i + 1 < 8 + length && i + 14 <= 32; i += 2 + sense[i + 1] )
+        {
+            d = &sense[i];
+
+            if( d[0] == 0x09 )
+            {
+                ata->error = d[3];
+                ata->count = ( d[4] << 8 ) | d[5];
+                ata->lba = (unsigned long long) d[11] << 16 | (unsigned long long) d[9] << 8 | d[7];
+
+                if( d[2] & 0x01 )
+                {
+                    /* The upper bytes of a 48-bit command. */
+                    ata->lba |= (unsigned long long) d[10] << 40 | (unsigned long long) d[8] << 32
+                        | (unsigned long long) d[6] << 24;
+                }
+                else
+                {
+                    ata->lba |= (unsigned long long) ( d[12] & 0x0f ) << 24;
+                }
+
+                ata->device = d[12];
+                ata->status = d[13];
+                return 0;
+            }
+        }
+
+        return -1;
+    }
+
+    if( ( sense[0] & 0x7f ) == 0x70 && ( sense[2] & 0x0f ) == NWIPE_SG_RECOVERED_ERROR && sense[12] == 0x00
+        && sense[13] == 0x1d )
+    {
+        /* The fixed format only has room for the registers of a 28-bit command. */
+        ata->error = sense[3];
+        ata->status = sense[4];
+        ata->device = sense[5];
+        ata->count = sense[6];
+        ata->lba = (unsigned long long) ( sense[5] & 0x0f ) << 24 | (unsigned long long) sense[11] << 16
+            | (unsigned long long) sense[10] << 8 | sense[9];
+        return 0;
+    }
+
+    return -1;
+
+} /* nwipe_sg_ata_registers */
+
+int nwipe_sg_ata( int fd, nwipe_sg_ata_t* ata, nwipe_sg_dir_t dir, void* data, int sectors, int extend )
+{
+    unsigned char cdb[16];
+    unsigned char sense[32];
+    int r;
+
+    memset( cdb, 0, sizeof( cdb ) );
+    cdb[0] = 0x85;
+
+    switch( dir )
+    {
+        case NWIPE_SG_IN:
+            /* T_DIR from the device, BYT_BLOK, T_LENGTH in the sector count. */
+            cdb[1] = NWIPE_SG_ATA_PIO_IN << 1;
+            cdb[2] = 0x0e;
+            break;
+
+        case NWIPE_SG_OUT:
+            cdb[1] = NWIPE_SG_ATA_PIO_OUT << 1;
+            cdb[2] = 0x06;
+            break;
+
+        default:
+            /* CK_COND, so that the registers are returned in the sense data. */
+            cdb[1] = NWIPE_SG_ATA_NON_DATA << 1;
+            cdb[2] = 0x20;
+            break;
+    }
+
+    if( extend )
+    {
+        cdb[1] |= 0x01;
+        cdb[3] = (unsigned char) ( ata->features >> 8 );
+        cdb[5] = (unsigned char) ( ata->count >> 8 );
+        cdb[7] = (unsigned char) ( ata->lba >> 24 );
+        cdb[9] = (unsigned char) ( ata->lba >> 32 );
+        cdb[11] = (unsigned char) ( ata->lba >> 40 );
+    }
+    else
+    {
+        /* The top four bits of a 28-bit LBA are in the device register. */
+        ata->device = ( ata->device & 0xf0 ) | (unsigned char) ( ( ata->lba >> 24 ) & 0x0f );
+    }
+
+    cdb[4] = (unsigned char) ata->features;
+    cdb[6] = (unsigned char) ata->count;
+    cdb[8] = (unsigned char) ata->lba;
+    cdb[10] = (unsigned char) ( ata->lba >> 8 );
+    cdb[12] = (unsigned char) ( ata->lba >> 16 );
+    cdb[13] = ata->device;
+    cdb[14] = ata->command;
+
+    r = nwipe_sg_command(
+        fd, cdb, sizeof( cdb ), dir, data, sectors * NWIPE_SG_SECTOR, sense, sizeof( sense ), NWIPE_SG_TIMEOUT );
+
+    if( r < 0 )
+    {
+        return -1;
+    }
+
+    if( dir == NWIPE_SG_NONE )
+    {
+        /* The registers always come back with CK_COND, the status tells whether the command failed. */
+        if( r != 1 || nwipe_sg_ata_registers( sense, ata ) != 0 )
+        {
+            return -1;
+        }
+
+        return ( ata->status & NWIPE_SG_ATA_ERR ) ? -1 : 0;
+    }
+
+    if( r == 1 )
+    {
+        /* Some drives return the registers on success too. */
+        if( nwipe_sg_ata_registers( sense, ata ) == 0 && !( ata->status & NWIPE_SG_ATA_ERR ) )
+        {
+            return 0;
+        }
+
+        return -1;
+    }
+
+    return 0;
+
+} /* nwipe_sg_ata */
+
+int nwipe_sg_ata_identify( int fd, unsigned char* identify )
+{
+    nwipe_sg_ata_t ata;
+    unsigned char sum = 0;
+    int i;
+
+    memset( &ata, 0, sizeof( ata ) );
+    ata.command = 0xec;  // IDENTIFY DEVICE
+    ata.count = 1;
+
+    memset( identify, 0, NWIPE_SG_SECTOR );
+
+    if( nwipe_sg_ata( fd, &ata, NWIPE_SG_IN, identify, 1, 0 ) != 0 )
+    {
+        return -1;
+    }
+
+    /* A bridge that ignores the command returns nothing, check the integrity word when it is set. */
+    for( i = 0; i < NWIPE_SG_SECTOR && identify[i] == 0; i++ )
+    {
+    }
+
+    if( i == NWIPE_SG_SECTOR )
+    {
+        return -1;
+    }
+
+    if( identify[510] == 0xa5 )
+    {
+        for( i = 0; i < NWIPE_SG_SECTOR; i++ )
+        {
+            sum += identify[i];
+        }
+
+        if( sum != 0 )
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+
+} /* nwipe_sg_ata_identify */
+
+void nwipe_sg_ata_string( const unsigned char* identify, int word, int words, char* str )
+{
+    int i;
+    int length = 0;
+    char* start;
+
+    for( i = 0; i < words * 2; i++ )
+    {
+        /* The first character of each word is in its high byte. */
+        str[i] = (char) identify[word * 2 + ( i ^ 1 )];
+
+        if( str[i] < ' ' || str[i] > '~' )
+        {
+            str[i] = ' ';
+        }
+    }
+
+    str[i] = 0;
+
+    /* Trim the spaces. */
+    for( start = str; *start == ' '; start++ )
+    {
+    }
+
+    while( start[length] != 0 )
+    {
+        length++;
+    }
+
+    while( length > 0 && start[length - 1] == ' ' )
+    {
+        length--;
+    }
+
+    memmove( str, start, length );
+    str[length] = 0;
+
+} /* nwipe_sg_ata_string */
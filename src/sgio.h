@@ -0,0 +1,88 @@
+/*
+ *  sgio.h: SCSI and ATA commands issued through the SG_IO ioctl.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SGIO_H_
+#define SGIO_H_
+
+#define NWIPE_SG_SECTOR 512  // The size of the data of an ATA IDENTIFY and of most ATA data commands.
+#define NWIPE_SG_TIMEOUT 5000  // The milliseconds a command may take before it is aborted.
+
+/* The direction of the data of a command. */
+typedef enum nwipe_sg_dir_t_ {
+    NWIPE_SG_NONE = 0,  // No data.
+    NWIPE_SG_IN,  // From the device.
+    NWIPE_SG_OUT  // To the device.
+} nwipe_sg_dir_t;
+
+/* The ATA registers of a command issued with ATA PASS-THROUGH, and those returned by it. */
+typedef struct nwipe_sg_ata_t_
+{
+    unsigned char command;
+    unsigned short features;
+    unsigned short count;
+    unsigned long long lba;  // 48 bits.
+    unsigned char device;
+    unsigned char status;  // Returned.
+    unsigned char error;  // Returned.
+} nwipe_sg_ata_t;
+
+/**
+ * Issues a SCSI command.
+ *
+ * @returns  0 on success, 1 if the device returned CHECK CONDITION, which is in the sense data,
+ *           -1 if the command could not be issued or failed otherwise.
+ */
+int nwipe_sg_command( int fd,
+                      const unsigned char* cdb,
+                      int cdb_length,
+                      nwipe_sg_dir_t dir,
+                      void* data,
+                      int length,
+                      unsigned char* sense,
+                      int sense_length,
+                      unsigned timeout );
+
+/**
+ * Reads the standard INQUIRY data, with page < 0, or a vital product data page.
+ *
+ * @returns  0 on success, -1 on failure.
+ */
+int nwipe_sg_inquiry( int fd, int page, unsigned char* data, int length );
+
+/**
+ * Issues a 28-bit or 48-bit ATA command with ATA PASS-THROUGH (16), which SATA drives and most
+ * USB bridges translate. The status and error registers are returned in ata.
+ *
+ * @returns  0 on success, -1 if the command was not accepted or the drive reported an error.
+ */
+int nwipe_sg_ata( int fd, nwipe_sg_ata_t* ata, nwipe_sg_dir_t dir, void* data, int sectors, int extend );
+
+/**
+ * Reads the IDENTIFY DEVICE data of an ATA drive, 512 bytes.
+ *
+ * @returns  0 on success, -1 on failure, e.g. when the device is not an ATA drive.
+ */
+int nwipe_sg_ata_identify( int fd, unsigned char* identify );
+
+/**
+ * Copies a string of the IDENTIFY DEVICE data, which is stored with the bytes of each word
+ * swapped, e.g. the serial number in words 10-19, and trims the spaces around it.
+ */
+void nwipe_sg_ata_string( const unsigned char* identify, int word, int words, char* str );
+
+#endif /* SGIO_H_ */
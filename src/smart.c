@@ -0,0 +1,586 @@
+/*
+ *  smart.c: The SMART and health data of the drives, read without smartctl.
+ *
+ *  The PDF report used to run smartctl -a for every drive when the report was
+ *  created, which takes minutes on a large batch and only showed the state of
+ *  the drive after the wipe. The data the report needs is now read directly:
+ *  the SMART attributes and status of ATA drives through ATA PASS-THROUGH, the
+ *  log pages of SCSI drives with LOG SENSE, and the SMART / Health Information
+ *  log page of NVMe drives. It is read before and after each wipe and kept in
+ *  the context for the report.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/nvme_ioctl.h>
+#include "nwipe.h"
+#include "context.h"
+#include "logging.h"
+#include "sgio.h"
+#include "smart.h"
+
+/* The names of the common ATA SMART attributes. */
+static const struct
+{
+    int id;
+    const char* name;
+} nwipe_smart_names[] = { { 1, "Raw_Read_Error_Rate" },
+                          { 2, "Throughput_Performance" },
+                          { 3, "Spin_Up_Time" },
+                          { 4, "Start_Stop_Count" },
+                          { 5, "Reallocated_Sector_Ct" },
+                          { 7, "Seek_Error_Rate" },
+                          { 8, "Seek_Time_Performance" },
+                          { 9, "Power_On_Hours" },
+                          { 10, "Spin_Retry_Count" },
+                          { 11, "Calibration_Retry_Count" },
+                          { 12, "Power_Cycle_Count" },
+                          { 170, "Available_Reservd_Space" },
+                          { 171, "Program_Fail_Count" },
+                          { 172, "Erase_Fail_Count" },
+                          { 173, "Wear_Leveling_Count" },
+                          { 174, "Unexpect_Power_Loss_Ct" },
+                          { 177, "Wear_Leveling_Count" },
+                          { 179, "Used_Rsvd_Blk_Cnt_Tot" },
+                          { 181, "Program_Fail_Cnt_Total" },
+                          { 182, "Erase_Fail_Count_Total" },
+                          { 183, "Runtime_Bad_Block" },
+                          { 184, "End-to-End_Error" },
+                          { 187, "Reported_Uncorrect" },
+                          { 188, "Command_Timeout" },
+                          { 189, "High_Fly_Writes" },
+                          { 190, "Airflow_Temperature_Cel" },
+                          { 191, "G-Sense_Error_Rate" },
+                          { 192, "Power-Off_Retract_Count" },
+                          { 193, "Load_Cycle_Count" },
+                          { 194, "Temperature_Celsius" },
+                          { 195, "Hardware_ECC_Recovered" },
+                          { 196, "Reallocated_Event_Count" },
+                          { 197, "Current_Pending_Sector" },
+                          { 198, "Offline_Uncorrectable" },
+                          { 199, "UDMA_CRC_Error_Count" },
+                          { 200, "Multi_Zone_Error_Rate" },
+                          { 231, "SSD_Life_Left" },
+                          { 232, "Available_Reservd_Space" },
+                          { 233, "Media_Wearout_Indicator" },
+                          { 240, "Head_Flying_Hours" },
+                          { 241, "Total_LBAs_Written" },
+                          { 242, "Total_LBAs_Read" },
+                          { 0, NULL } };
+
+const char* nwipe_smart_attribute_name( int id )
+{
+    int i;
+
+    for( i = 0; nwipe_smart_names[i].name != NULL; i++ )
+    {
+        if( nwipe_smart_names[i].id == id )
+        {
+            return nwipe_smart_names[i].name;
+        }
+    }
+
+    return "Unknown_Attribute";
+
+} /* nwipe_smart_attribute_name */
+
+static unsigned long long nwipe_smart_le( const unsigned char* data, int length )
+{
+    /* A little endian number, e.g. an ATA raw value or an NVMe counter. */
+    unsigned long long value = 0;
+
+    while( length-- > 0 )
+    {
+        value = ( value << 8 ) | data[length];
+    }
+
+    return value;
+
+} /* nwipe_smart_le */
+
+static unsigned long long nwipe_smart_be( const unsigned char* data, int length )
+{
+    /* A big endian number, e.g. a SCSI log parameter. */
+    unsigned long long value = 0;
+    int i;
+
+    for( i = 0; i < length; i++ )
+    {
+        value = ( value << 8 ) | data[i];
+    }
+
+    return value;
+
+} /* nwipe_smart_be */
+
+static int nwipe_smart_nvme( int fd, const char* device, nwipe_smart_t* smart )
+{
+    /**
+     * Reads the SMART / Health Information log page of an NVMe drive.
+     */
+
+    struct nvme_admin_cmd cmd;
+    unsigned char log[512];
+    char filename[FILENAME_MAX];
+    const char* name;
+    FILE* fp;
+
+    memset( &cmd, 0, sizeof( cmd ) );
+    memset( log, 0, sizeof( log ) );
+
+    cmd.opcode = 0x02;  // Get Log Page
+    cmd.nsid = 0xffffffff;  // The controller as a whole.
+    cmd.addr = (unsigned long) log;
+    cmd.data_len = sizeof( log );
+    cmd.cdw10 = ( ( sizeof( log ) / 4 - 1 ) << 16 ) | 0x02;
+    cmd.timeout_ms = NWIPE_SG_TIMEOUT;
+
+    if( ioctl( fd, NVME_IOCTL_ADMIN_CMD, &cmd ) != 0 )
+    {
+        return -1;
+    }
+
+    smart->source = NWIPE_SMART_NVME;
+    smart->critical_warning = log[0];
+    smart->health = log[0] == 0;
+    smart->temperature = (int) nwipe_smart_le( &log[1], 2 ) - 273;
+    smart->percentage_used = log[5];
+
+    /* The data units are thousands of 512 byte units, the counters are 128 bits but 64 are plenty. */
+    smart->written = nwipe_smart_le( &log[48], 8 ) * 512000;
+    smart->power_cycles = nwipe_smart_le( &log[112], 8 );
+    smart->power_on_hours = nwipe_smart_le( &log[128], 8 );
+    smart->uncorrectable = nwipe_smart_le( &log[160], 8 );
+
+    /* The firmware revision of the controller, from sysfs rather than another admin command. */
+    name = strrchr( device, '/' );
+    name = name != NULL ? name + 1 : device;
+    snprintf( filename, sizeof( filename ), "/sys/block/%s/device/firmware_rev", name );
+
+    if( ( fp = fopen( filename, "r" ) ) != NULL )
+    {
+        if( fgets( smart->firmware, sizeof( smart->firmware ), fp ) == NULL )
+        {
+            smart->firmware[0] = 0;
+        }
+
+        smart->firmware[strcspn( smart->firmware, " \n" )] = 0;
+        fclose( fp );
+    }
+
+    return 0;
+
+} /* nwipe_smart_nvme */
+
+static int nwipe_smart_ata( int fd, nwipe_smart_t* smart )
+{
+    /**
+     * Reads the SMART attributes, thresholds and status of an ATA drive.
+     */
+
+    nwipe_sg_ata_t ata;
+    unsigned char identify[NWIPE_SG_SECTOR];
+    unsigned char data[NWIPE_SG_SECTOR];
+    unsigned char thresholds[NWIPE_SG_SECTOR];
+    nwipe_smart_attribute_t* a;
+    const unsigned char* entry;
+    int i;
+    int j;
+
+    if( nwipe_sg_ata_identify( fd, identify ) != 0 )
+    {
+        return -1;
+    }
+
+    smart->source = NWIPE_SMART_ATA;
+    nwipe_sg_ata_string( identify, 23, 4, smart->firmware );
+
+    /* SMART is supported when bit 0 of word 82 is set, and enabled when bit 0 of word 85 is set. */
+    if( !( identify[164] & 0x01 ) || !( identify[170] & 0x01 ) )
+    {
+        return 0;
+    }
+
+    memset( &ata, 0, sizeof( ata ) );
+    ata.command = 0xb0;  // SMART
+    ata.features = 0xd0;  // READ DATA
+    ata.count = 1;
+    ata.lba = 0xc24f00;
+
+    if( nwipe_sg_ata( fd, &ata, NWIPE_SG_IN, data, 1, 0 ) != 0 )
+    {
+        return 0;
+    }
+
+    memset( &ata, 0, sizeof( ata ) );
+    ata.command = 0xb0;
+    ata.features = 0xd1;  // READ THRESHOLDS, obsolete but still widely supported
+    ata.count = 1;
+    ata.lba = 0xc24f00;
+
+    if( nwipe_sg_ata( fd, &ata, NWIPE_SG_IN, thresholds, 1, 0 ) != 0 )
+    {
+        memset( thresholds, 0, sizeof( thresholds ) );
+    }
+
+    /* The attributes are 12 bytes each from byte 2, the thresholds are at the same place. */
+    for( i = 0; i < NWIPE_SMART_ATTRIBUTES; i++ )
+    {
+        entry = &data[2 + i * 12];
+
+        if( entry[0] == 0 )
+        {
+            continue;
+        }
+
+        a = &smart->attribute[smart->attributes++];
+        a->id = entry[0];
+        a->flags = entry[1] | ( entry[2] << 8 );
+        a->value = entry[3];
+        a->worst = entry[4];
+        a->raw = nwipe_smart_le( &entry[5], 6 );
+
+        for( j = 0; j < NWIPE_SMART_ATTRIBUTES; j++ )
+        {
+            if( thresholds[2 + j * 12] == a->id )
+            {
+                a->threshold = thresholds[2 + j * 12 + 1];
+                break;
+            }
+        }
+
+        switch( a->id )
+        {
+            case 5:
+                smart->reallocated = a->raw & 0xffffffff;
+                break;
+
+            case 9:
+                smart->power_on_hours = a->raw & 0xffffffff;
+                break;
+
+            case 12:
+                smart->power_cycles = a->raw & 0xffffffff;
+                break;
+
+            case 190:
+                if( smart->temperature == -1 )
+                {
+                    smart->temperature = a->raw & 0xff;
+                }
+                break;
+
+            case 194:
+                smart->temperature = a->raw & 0xff;
+                break;
+
+            case 197:
+                smart->pending = a->raw & 0xffffffff;
+                break;
+
+            case 187:
+                if( smart->uncorrectable == -1 )
+                {
+                    smart->uncorrectable = a->raw & 0xffffffff;
+                }
+                break;
+
+            case 198:
+                smart->uncorrectable = a->raw & 0xffffffff;
+                break;
+        }
+    }
+
+    /* The status is returned in the LBA registers, 0xc24f when the drive is fine, 0x2cf4 when it's failing. */
+    memset( &ata, 0, sizeof( ata ) );
+    ata.command = 0xb0;
+    ata.features = 0xda;  // RETURN STATUS
+    ata.lba = 0xc24f00;
+
+    if( nwipe_sg_ata( fd, &ata, NWIPE_SG_NONE, NULL, 0, 0 ) == 0 )
+    {
+        if( ( ( ata.lba >> 8 ) & 0xffff ) == 0xc24f )
+        {
+            smart->health = 1;
+        }
+        else if( ( ( ata.lba >> 8 ) & 0xffff ) == 0x2cf4 )
+        {
+            smart->health = 0;
+        }
+    }
+
+    return 0;
+
+} /* nwipe_smart_ata */
+
+static int nwipe_smart_log_sense( int fd, int page, unsigned char* data, int length )
+{
+    /**
+     * Reads the cumulative values of a SCSI log page.
+     *
+     * @returns  The length of the page data, from byte 4, or -1 if the page isn't supported.
+     */
+
+    unsigned char cdb[10] = { 0x4d, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    unsigned char sense[32];
+    int available;
+
+    cdb[2] = 0x40 | page;
+    cdb[7] = (unsigned char) ( length >> 8 );
+    cdb[8] = (unsigned char) length;
+
+    memset( data, 0, length );
+
+    if( nwipe_sg_command( fd, cdb, sizeof( cdb ), NWIPE_SG_IN, data, length, sense, sizeof( sense ), NWIPE_SG_TIMEOUT )
+        != 0 )
+    {
+        return -1;
+    }
+
+    if( ( data[0] & 0x3f ) != page )
+    {
+        return -1;
+    }
+
+    available = ( data[2] << 8 ) | data[3];
+
+    return available < length - 4 ? available : length - 4;
+
+} /* nwipe_smart_log_sense */
+
+static const unsigned char* nwipe_smart_log_parameter( const unsigned char* data, int length, int code, int* size )
+{
+    /**
+     * Finds a parameter of a log page read by nwipe_smart_log_sense().
+     *
+     * @returns  The value of the parameter, NULL if the page doesn't have it.
+     */
+
+    int i;
+
+    for( i = 4; i + 4 <= length + 4; i += 4 + data[i + 3] )
+    {
+        if( ( ( data[i] << 8 ) | data[i + 1] ) == code && i + 4 + data[i + 3] <= length + 4 )
+        {
+            *size = data[i + 3];
+            return &data[i + 4];
+        }
+    }
+
+    return NULL;
+
+} /* nwipe_smart_log_parameter */
+
+static int nwipe_smart_scsi( int fd, nwipe_smart_t* smart )
+{
+    /**
+     * Reads the health, temperature and error counters of a SCSI drive from its log pages.
+     */
+
+    unsigned char data[1024];
+    unsigned char cdb[10] = { 0x37, 0, 0x0d, 0, 0, 0, 0, 0, 4, 0 };  // READ DEFECT DATA, the grown list
+    unsigned char sense[32];
+    const unsigned char* p;
+    int length;
+    int size;
+    int page;
+
+    if( nwipe_sg_inquiry( fd, -1, data, 36 ) != 0 )
+    {
+        return -1;
+    }
+
+    /* The product revision, bytes 32-35 of the standard INQUIRY data. */
+    memcpy( smart->firmware, &data[32], 4 );
+    smart->firmware[4] = 0;
+    smart->firmware[strcspn( smart->firmware, " " )] = 0;
+
+    /* The informational exceptions page gives the health, an additional sense code of 0 is fine. */
+    if( ( length = nwipe_smart_log_sense( fd, 0x2f, data, sizeof( data ) ) ) > 0 )
+    {
+        smart->source = NWIPE_SMART_SCSI;
+
+        if( ( p = nwipe_smart_log_parameter( data, length, 0x0000, &size ) ) != NULL && size >= 3 )
+        {
+            smart->health = p[0] == 0;
+
+            if( p[2] != 0xff )
+            {
+                smart->temperature = p[2];
+            }
+        }
+    }
+
+    if( ( length = nwipe_smart_log_sense( fd, 0x0d, data, sizeof( data ) ) ) > 0 )
+    {
+        smart->source = NWIPE_SMART_SCSI;
+
+        if( ( p = nwipe_smart_log_parameter( data, length, 0x0000, &size ) ) != NULL && size >= 2 && p[1] != 0xff )
+        {
+            smart->temperature = p[1];
+        }
+    }
+
+    /* The accumulated start-stop cycles. */
+    if( ( length = nwipe_smart_log_sense( fd, 0x0e, data, sizeof( data ) ) ) > 0 )
+    {
+        if( ( p = nwipe_smart_log_parameter( data, length, 0x0004, &size ) ) != NULL && size >= 4 )
+        {
+            smart->power_cycles = nwipe_smart_be( p, 4 );
+        }
+    }
+
+    /* The accumulated power on minutes, from the background scan results page. */
+    if( ( length = nwipe_smart_log_sense( fd, 0x15, data, sizeof( data ) ) ) > 0 )
+    {
+        if( ( p = nwipe_smart_log_parameter( data, length, 0x0000, &size ) ) != NULL && size >= 4 )
+        {
+            smart->power_on_hours = nwipe_smart_be( p, 4 ) / 60;
+        }
+    }
+
+    /* The total uncorrected errors of the write and read error counter pages. */
+    for( page = 0x02; page <= 0x03; page++ )
+    {
+        if( ( length = nwipe_smart_log_sense( fd, page, data, sizeof( data ) ) ) > 0 )
+        {
+            if( ( p = nwipe_smart_log_parameter( data, length, 0x0006, &size ) ) != NULL && size > 0 && size <= 8 )
+            {
+                if( smart->uncorrectable < 0 )
+                {
+                    smart->uncorrectable = 0;
+                }
+
+                smart->uncorrectable += nwipe_smart_be( p, size );
+            }
+        }
+    }
+
+    /* The length of the grown defect list in the physical sector format, 8 bytes a defect. A drive
+     * that doesn't support the format returns the list in another one with RECOVERED ERROR. */
+    if( nwipe_sg_command( fd, cdb, sizeof( cdb ), NWIPE_SG_IN, data, 4, sense, sizeof( sense ), NWIPE_SG_TIMEOUT ) >= 0
+        && ( data[1] & 0x08 ) )
+    {
+        smart->reallocated = ( ( data[2] << 8 ) | data[3] ) / ( ( data[1] & 0x07 ) == 0 ? 4 : 8 );
+    }
+
+    return smart->source == NWIPE_SMART_SCSI ? 0 : -1;
+
+} /* nwipe_smart_scsi */
+
+int nwipe_smart_read( const char* device, nwipe_smart_t* smart )
+{
+    int fd;
+    int r;
+
+    memset( smart, 0, sizeof( nwipe_smart_t ) );
+    smart->health = -1;
+    smart->temperature = -1;
+    smart->power_on_hours = -1;
+    smart->power_cycles = -1;
+    smart->reallocated = -1;
+    smart->pending = -1;
+    smart->uncorrectable = -1;
+    smart->percentage_used = -1;
+    smart->written = -1;
+    time( &smart->time );
+
+    /* Opened read/write as some kernels only pass ATA commands through on a writable descriptor. */
+    if( ( fd = open( device, O_RDWR | O_NONBLOCK ) ) < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "open" );
+        return -1;
+    }
+
+    if( strstr( device, "nvme" ) != NULL )
+    {
+        r = nwipe_smart_nvme( fd, device, smart );
+    }
+    else
+    {
+        r = nwipe_smart_ata( fd, smart );
+
+        if( r != 0 )
+        {
+            /* Not an ATA drive, or a bridge that doesn't translate ATA commands. */
+            r = nwipe_smart_scsi( fd, smart );
+        }
+    }
+
+    close( fd );
+
+    if( r != 0 )
+    {
+        smart->source = NWIPE_SMART_NONE;
+        nwipe_log( NWIPE_LOG_INFO, "SMART data is not available on %s", device );
+        return -1;
+    }
+
+    nwipe_log( NWIPE_LOG_INFO,
+               "SMART %s: health %s, %iC, %lli hours, %lli reallocated, %lli pending, %lli uncorrectable",
+               device,
+               smart->health == 1 ? "PASSED" : smart->health == 0 ? "FAILING" : "unknown",
+               smart->temperature,
+               smart->power_on_hours,
+               smart->reallocated,
+               smart->pending,
+               smart->uncorrectable );
+
+    return 0;
+
+} /* nwipe_smart_read */
+
+void nwipe_smart_compare( const char* device, const nwipe_smart_t* before, const nwipe_smart_t* after )
+{
+    if( before->source == NWIPE_SMART_NONE || after->source == NWIPE_SMART_NONE )
+    {
+        return;
+    }
+
+    if( before->health == 1 && after->health == 0 )
+    {
+        nwipe_log( NWIPE_LOG_WARNING, "SMART %s: the drive reports it is failing since the wipe", device );
+    }
+
+    if( after->reallocated > before->reallocated && before->reallocated >= 0 )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "SMART %s: %lli sectors were reallocated during the wipe",
+                   device,
+                   after->reallocated - before->reallocated );
+    }
+
+    if( after->pending > before->pending && before->pending >= 0 )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "SMART %s: %lli sectors became pending reallocation during the wipe",
+                   device,
+                   after->pending - before->pending );
+    }
+
+    if( after->uncorrectable > before->uncorrectable && before->uncorrectable >= 0 )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "SMART %s: %lli uncorrectable errors occurred during the wipe",
+                   device,
+                   after->uncorrectable - before->uncorrectable );
+    }
+
+} /* nwipe_smart_compare */
@@ -0,0 +1,84 @@
+/*
+ *  smart.h: The SMART and health data of the drives, read without smartctl.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SMART_H_
+#define SMART_H_
+
+#include <time.h>
+
+#define NWIPE_SMART_ATTRIBUTES 30  // The number of attributes in the ATA SMART data.
+
+/* Where the data came from. */
+typedef enum nwipe_smart_source_t_ {
+    NWIPE_SMART_NONE = 0,  // Not read, or the drive doesn't report any.
+    NWIPE_SMART_ATA,  // ATA SMART READ DATA, through ATA PASS-THROUGH.
+    NWIPE_SMART_SCSI,  // SCSI LOG SENSE.
+    NWIPE_SMART_NVME  // The NVMe SMART / Health Information log page.
+} nwipe_smart_source_t;
+
+/* An attribute of the ATA SMART data. */
+typedef struct nwipe_smart_attribute_t_
+{
+    unsigned char id;
+    unsigned short flags;
+    unsigned char value;  // The normalized value.
+    unsigned char worst;
+    unsigned char threshold;  // 0 if the thresholds can't be read.
+    unsigned long long raw;  // 48 bits.
+} nwipe_smart_attribute_t;
+
+/* The SMART data of a drive at a point in time. The counters are -1 when the drive doesn't report them. */
+typedef struct nwipe_smart_t_
+{
+    nwipe_smart_source_t source;
+    time_t time;  // When the data was read.
+    int health;  // 1 = passed, 0 = failing, -1 = unknown.
+    char firmware[17];  // The firmware revision.
+    int temperature;  // Celsius.
+    long long power_on_hours;
+    long long power_cycles;
+    long long reallocated;  // Reallocated sectors, or the grown defects of a SCSI drive.
+    long long pending;  // Sectors pending reallocation.
+    long long uncorrectable;  // Uncorrectable sectors or errors.
+    long long percentage_used;  // The estimated wear of an NVMe drive.
+    long long written;  // The bytes written over the life of an NVMe drive.
+    int critical_warning;  // The critical warning bits of an NVMe drive.
+    int attributes;  // The number of ATA attributes.
+    nwipe_smart_attribute_t attribute[NWIPE_SMART_ATTRIBUTES];
+} nwipe_smart_t;
+
+/**
+ * Reads the SMART data of a device, NVMe drives through the admin command ioctl, other drives
+ * with ATA commands through ATA PASS-THROUGH and, when those aren't translated, SCSI LOG SENSE.
+ * A summary is logged.
+ *
+ * @returns  0 on success, -1 if the device doesn't report any SMART data.
+ */
+int nwipe_smart_read( const char* device, nwipe_smart_t* smart );
+
+/**
+ * Logs the counters that got worse between two reads, e.g. sectors reallocated during the wipe.
+ */
+void nwipe_smart_compare( const char* device, const nwipe_smart_t* before, const nwipe_smart_t* after );
+
+/**
+ * Returns the usual name of an ATA SMART attribute, as smartctl shows it.
+ */
+const char* nwipe_smart_attribute_name( int id );
+
+#endif /* SMART_H_ */
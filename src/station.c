@@ -0,0 +1,478 @@
+/*
+ *  station.c: The drives plugged in and pulled while nwipe runs as a station.
+ *
+ *  With --station nwipe doesn't stop once the drives found at startup are
+ *  wiped. A thread listens to the uevents the kernel broadcasts over netlink,
+ *  the same that udev receives, and waits for the disks that are added to
+ *  settle before probing them. The main thread picks up the probed drives and
+ *  the names of the pulled ones with nwipe_station_next_added() and
+ *  nwipe_station_next_removed(), and is the only one to change the array of
+ *  contexts, under nwipe_station_mutex.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <parted/parted.h>
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "options.h"
+#include "device.h"
+#include "logging.h"
+#include "station.h"
+#include "events.h"
+
+#define NWIPE_STATION_UEVENT_SIZE 8192  // The largest uevent, the kernel limits them to 2048 bytes of variables.
+#define NWIPE_STATION_RCVBUF ( 1024 * 1024 )  // The socket buffer, uevents come in bursts when a hub is plugged in.
+
+extern int terminate_signal;
+
+pthread_mutex_t nwipe_station_mutex = PTHREAD_MUTEX_INITIALIZER;
+int nwipe_station_wipe_requested = 0;
+
+/* The netlink socket and the thread that reads it. */
+static int nwipe_station_socket = -1;
+static pthread_t nwipe_station_thread_id;
+
+/* The drives that have been probed and the names of those pulled, until the main thread takes them. */
+static pthread_mutex_t nwipe_station_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static nwipe_context_t** nwipe_station_added = NULL;
+static int nwipe_station_added_count = 0;
+static char** nwipe_station_removed = NULL;
+static int nwipe_station_removed_count = 0;
+
+/* libparted isn't thread safe, the probes of the thread and the releases of the main thread take turns. */
+static pthread_mutex_t nwipe_station_parted_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* nwipe_station_value( const char* buffer, size_t length, const char* key )
+{
+    /**
+     * Finds a variable of a uevent, which is a header such as add@/devices/... followed by
+     * KEY=value strings, each terminated by a null.
+     *
+     * @returns  The value, NULL if the uevent doesn't have the variable.
+     */
+
+    size_t klength = strlen( key );
+    size_t i;
+
+    for( i = strlen( buffer ) + 1; i < length; i += strlen( buffer + i ) + 1 )
+    {
+        if( strncmp( buffer + i, key, klength ) == 0 && buffer[i + klength] == '=' )
+        {
+            return buffer + i + klength + 1;
+        }
+    }
+
+    return NULL;
+
+} /* nwipe_station_value */
+
+static int nwipe_station_empty( const char* name )
+{
+    /**
+     * @returns  1 if a disk has no sectors, e.g. a card reader without a card or an unused
+     *           loop device, 0 otherwise.
+     */
+
+    char path[FILENAME_MAX];
+    unsigned long long sectors = 0;
+    FILE* fp;
+
+    snprintf( path, sizeof( path ), "/sys/class/block/%s/size", name );
+    fp = fopen( path, "r" );
+
+    if( fp == NULL )
+    {
+        return 0;
+    }
+
+    if( fscanf( fp, "%llu", &sectors ) != 1 )
+    {
+        sectors = 1;
+    }
+
+    fclose( fp );
+
+    return sectors == 0;
+
+} /* nwipe_station_empty */
+
+static void nwipe_station_probe( char** names, int count )
+{
+    /**
+     * Probes the drives that have been plugged in and queues their contexts for the main thread.
+     */
+
+    nwipe_context_t** c = NULL;
+    nwipe_context_t** added;
+    int dcount;
+    int i;
+
+    pthread_mutex_lock( &nwipe_station_parted_mutex );
+    dcount = nwipe_device_get( &c, names, count );
+    pthread_mutex_unlock( &nwipe_station_parted_mutex );
+
+    pthread_mutex_lock( &nwipe_station_queue_mutex );
+
+    for( i = 0; i < dcount; i++ )
+    {
+        added = realloc( nwipe_station_added, ( nwipe_station_added_count + 1 ) * sizeof( nwipe_context_t* ) );
+
+        if( !added )
+        {
+            nwipe_perror( errno, __FUNCTION__, "realloc" );
+            nwipe_log( NWIPE_LOG_ERROR, "Unable to add %s to the station.", c[i]->device_name );
+            free( c[i] );
+            continue;
+        }
+
+        nwipe_station_added = added;
+        nwipe_station_added[nwipe_station_added_count++] = c[i];
+    }
+
+    pthread_mutex_unlock( &nwipe_station_queue_mutex );
+
+    nwipe_events_wake();
+
+    free( c );
+
+} /* nwipe_station_probe */
+
+static void nwipe_station_pulled( const char* device )
+{
+    /**
+     * Queues the name of a drive that has been pulled for the main thread.
+     */
+
+    char** removed;
+
+    pthread_mutex_lock( &nwipe_station_queue_mutex );
+
+    removed = realloc( nwipe_station_removed, ( nwipe_station_removed_count + 1 ) * sizeof( char* ) );
+
+    if( removed )
+    {
+        nwipe_station_removed = removed;
+        nwipe_station_removed[nwipe_station_removed_count] = strdup( device );
+
+        if( nwipe_station_removed[nwipe_station_removed_count] )
+        {
+            nwipe_station_removed_count++;
+        }
+    }
+
+    pthread_mutex_unlock( &nwipe_station_queue_mutex );
+
+    nwipe_events_wake();
+
+} /* nwipe_station_pulled */
+
+static void* nwipe_station_thread( void* ptr )
+{
+    /**
+     * Reads the uevents of the disks until terminate_signal is set. The disks that are added
+     * are probed together once no other disk has been added for NWIPE_KNOB_STATION_SETTLE
+     * seconds, so that a hub full of drives is probed at once, in parallel. Until then, the
+     * thread waits for the next uevent, or for nwipe to shut down.
+     */
+
+    char buffer[NWIPE_STATION_UEVENT_SIZE];
+    struct sockaddr_nl sender;
+    struct iovec iov;
+    struct msghdr msg;
+    ssize_t length;
+
+    /* The variables of a uevent. */
+    const char* action;
+    const char* subsystem;
+    const char* devtype;
+    const char* devname;
+
+    /* The disks waiting to be probed, and when the last one was added. */
+    char* pending[NWIPE_KNOB_STATION_DEVICES];
+    int count = 0;
+    time_t added = 0;
+
+    char device[FILENAME_MAX];
+    int timeout;
+    int i;
+    int r;
+
+    (void) ptr;
+
+    while( terminate_signal != 1 )
+    {
+        if( count > 0 && time( NULL ) >= added + NWIPE_KNOB_STATION_SETTLE )
+        {
+            nwipe_station_probe( pending, count );
+
+            for( i = 0; i < count; i++ )
+            {
+                free( pending[i] );
+            }
+
+            count = 0;
+        }
+
+        /* Wait for the next uevent, until the disks waiting to be probed have settled. */
+        timeout = -1;
+
+        if( count > 0 )
+        {
+            timeout = ( added + NWIPE_KNOB_STATION_SETTLE - time( NULL ) ) * 1000;
+
+            if( timeout < 0 )
+            {
+                timeout = 0;
+            }
+        }
+
+        r = nwipe_events_input( nwipe_station_socket, timeout );
+
+        if( r < 0 )
+        {
+            nwipe_log( NWIPE_LOG_ERROR, "The station stopped watching for drives." );
+            break;
+        }
+
+        if( r == 0 )
+        {
+            continue;
+        }
+
+        iov.iov_base = buffer;
+        iov.iov_len = sizeof( buffer ) - 1;
+        memset( &msg, 0, sizeof( msg ) );
+        msg.msg_name = &sender;
+        msg.msg_namelen = sizeof( sender );
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        length = recvmsg( nwipe_station_socket, &msg, 0 );
+
+        /* Only the kernel sends on this group, the rest is forged. */
+        if( length <= 0 || sender.nl_pid != 0 )
+        {
+            continue;
+        }
+
+        buffer[length] = 0;
+
+        action = nwipe_station_value( buffer, length, "ACTION" );
+        subsystem = nwipe_station_value( buffer, length, "SUBSYSTEM" );
+        devtype = nwipe_station_value( buffer, length, "DEVTYPE" );
+        devname = nwipe_station_value( buffer, length, "DEVNAME" );
+
+        if( action == NULL || subsystem == NULL || devtype == NULL || devname == NULL
+            || strcmp( subsystem, "block" ) != 0 || strcmp( devtype, "disk" ) != 0 )
+        {
+            continue;
+        }
+
+        /* The kernel names the device relative to /dev. */
+        snprintf( device, sizeof( device ), "/dev/%s", devname );
+
+        /* A disk pulled before it was probed is forgotten. */
+        for( i = 0; i < count && strcmp( pending[i], device ) != 0; i++ )
+            ;
+
+        if( strcmp( action, "add" ) == 0 )
+        {
+            if( i < count || count == NWIPE_KNOB_STATION_DEVICES || nwipe_station_empty( devname ) )
+            {
+                continue;
+            }
+
+            pending[count] = strdup( device );
+
+            if( pending[count] )
+            {
+                nwipe_log( NWIPE_LOG_INFO, "%s has been plugged in.", device );
+                count++;
+                added = time( NULL );
+            }
+        }
+        else if( strcmp( action, "remove" ) == 0 )
+        {
+            nwipe_log( NWIPE_LOG_INFO, "%s has been pulled.", device );
+
+            if( i < count )
+            {
+                free( pending[i] );
+                pending[i] = pending[--count];
+            }
+
+            nwipe_station_pulled( device );
+        }
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        free( pending[i] );
+    }
+
+    return NULL;
+
+} /* nwipe_station_thread */
+
+int nwipe_station_start( void )
+{
+    struct sockaddr_nl address;
+    int size = NWIPE_STATION_RCVBUF;
+    int r;
+
+    nwipe_station_socket = socket( AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT );
+
+    if( nwipe_station_socket < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "socket" );
+        return -1;
+    }
+
+    /* The group of the kernel uevents, udev rebroadcasts them on the second. */
+    memset( &address, 0, sizeof( address ) );
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1;
+
+    if( bind( nwipe_station_socket, (struct sockaddr*) &address, sizeof( address ) ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "bind" );
+        close( nwipe_station_socket );
+        nwipe_station_socket = -1;
+        return -1;
+    }
+
+    /* SO_RCVBUFFORCE goes past rmem_max as root, the default buffer is kept if it fails. */
+    if( setsockopt( nwipe_station_socket, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof( size ) ) != 0 )
+    {
+        setsockopt( nwipe_station_socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof( size ) );
+    }
+
+    r = pthread_create( &nwipe_station_thread_id, NULL, nwipe_station_thread, NULL );
+
+    if( r != 0 )
+    {
+        nwipe_perror( r, __FUNCTION__, "pthread_create" );
+        close( nwipe_station_socket );
+        nwipe_station_socket = -1;
+        return -1;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE, "The station is watching for drives to be plugged in." );
+
+    return 0;
+
+} /* nwipe_station_start */
+
+void nwipe_station_stop( void )
+{
+    int i;
+
+    if( nwipe_station_socket < 0 )
+    {
+        return;
+    }
+
+    pthread_join( nwipe_station_thread_id, NULL );
+    close( nwipe_station_socket );
+    nwipe_station_socket = -1;
+
+    for( i = 0; i < nwipe_station_added_count; i++ )
+    {
+        free( nwipe_station_added[i] );
+    }
+
+    for( i = 0; i < nwipe_station_removed_count; i++ )
+    {
+        free( nwipe_station_removed[i] );
+    }
+
+    free( nwipe_station_added );
+    free( nwipe_station_removed );
+    nwipe_station_added = NULL;
+    nwipe_station_removed = NULL;
+    nwipe_station_added_count = 0;
+    nwipe_station_removed_count = 0;
+
+} /* nwipe_station_stop */
+
+nwipe_context_t* nwipe_station_next_added( void )
+{
+    nwipe_context_t* c = NULL;
+
+    pthread_mutex_lock( &nwipe_station_queue_mutex );
+
+    if( nwipe_station_added_count > 0 )
+    {
+        c = nwipe_station_added[0];
+        nwipe_station_added_count--;
+        memmove( nwipe_station_added,
+                 nwipe_station_added + 1,
+                 nwipe_station_added_count * sizeof( nwipe_context_t* ) );
+    }
+
+    pthread_mutex_unlock( &nwipe_station_queue_mutex );
+
+    return c;
+
+} /* nwipe_station_next_added */
+
+int nwipe_station_next_removed( char* device, size_t size )
+{
+    int found = 0;
+
+    pthread_mutex_lock( &nwipe_station_queue_mutex );
+
+    if( nwipe_station_removed_count > 0 )
+    {
+        snprintf( device, size, "%s", nwipe_station_removed[0] );
+        free( nwipe_station_removed[0] );
+        nwipe_station_removed_count--;
+        memmove( nwipe_station_removed, nwipe_station_removed + 1, nwipe_station_removed_count * sizeof( char* ) );
+        found = 1;
+    }
+
+    pthread_mutex_unlock( &nwipe_station_queue_mutex );
+
+    return found;
+
+} /* nwipe_station_next_removed */
+
+void nwipe_station_release( const char* device )
+{
+    PedDevice* dev = NULL;
+
+    pthread_mutex_lock( &nwipe_station_parted_mutex );
+
+    while( ( dev = ped_device_get_next( dev ) ) )
+    {
+        if( strcmp( dev->path, device ) == 0 )
+        {
+            ped_device_destroy( dev );
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &nwipe_station_parted_mutex );
+
+} /* nwipe_station_release */
@@ -0,0 +1,64 @@
+/*
+ *  station.h: The drives plugged in and pulled while nwipe runs as a station.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef STATION_H_
+#define STATION_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* Held while the array of the contexts being wiped is changed by the main thread, and while the
+ * GUI, temperature and signal threads read it. */
+extern pthread_mutex_t nwipe_station_mutex;
+
+/* Set by the GUI when the operator asks for the waiting drives to be wiped. */
+extern int nwipe_station_wipe_requested;
+
+/**
+ * Starts watching the kernel uevents for the drives that are plugged in and pulled. The drives
+ * that are plugged in are probed in the background, as nwipe_device_get() does at startup.
+ *
+ * @returns  0 on success, -1 if the uevents can't be received.
+ */
+int nwipe_station_start( void );
+
+/**
+ * Stops watching the uevents, once terminate_signal is set, and frees the drives that are
+ * still queued.
+ */
+void nwipe_station_stop( void );
+
+/**
+ * @returns  The context of the next drive that has been plugged in and probed, NULL if there is none.
+ */
+nwipe_context_t* nwipe_station_next_added( void );
+
+/**
+ * Copies the name of the next drive that has been pulled, e.g. /dev/sdb.
+ *
+ * @returns  1 if a name was copied, 0 if no drive has been pulled.
+ */
+int nwipe_station_next_removed( char* device, size_t size );
+
+/**
+ * Drops a device from the devices libparted keeps, once its context has been freed, so that
+ * the next drive plugged in under the same name is probed afresh.
+ */
+void nwipe_station_release( const char* device );
+
+#endif /* STATION_H_ */
@@ -38,6 +38,8 @@
 #include "logging.h"
 #include "temperature.h"
 #include "miscellaneous.h"
+#include "station.h"
+#include "events.h"
 
 extern int terminate_signal;
 
@@ -228,6 +230,7 @@ float timedifference_msec( struct timeval tv_start, struct timeval tv_end )
 void* nwipe_update_temperature_thread( void* ptr )
 {
     int i;
+    int count;
 
     /* Set up the structs we will use for the data required. */
     nwipe_thread_data_ptr_t* nwipe_thread_data_ptr;
@@ -239,37 +242,25 @@ void* nwipe_update_temperature_thread( void* ptr )
     c = nwipe_thread_data_ptr->c;
     nwipe_misc_thread_data = nwipe_thread_data_ptr->nwipe_misc_thread_data;
 
-    /* mark start second of update */
-    time_t nwipe_timemark = time( NULL );
-
-    /* update immediately on entry to thread */
-    for( i = 0; i < nwipe_misc_thread_data->nwipe_enumerated; i++ )
+    /* Update all drive/s immediately on entry to the thread, then every 2 seconds until nwipe shuts down,
+     * which wakes the thread up straight away, see events.c */
+    do
     {
-        nwipe_update_temperature( c[i] );
-        if( terminate_signal == 1 )
-        {
-            break;
-        }
-    }
+        /* A station is given the drives being wiped, which change as drives are plugged in and pulled. */
+        pthread_mutex_lock( &nwipe_station_mutex );
 
-    while( terminate_signal != 1 )
-    {
-        /* Update all drive/s but never repeat checking the
-         * set of drive/s faster than once every 2 seconds */
-        if( time( NULL ) > ( nwipe_timemark + 1 ) )
-        {
-            nwipe_timemark = time( NULL );
+        count = nwipe_options.station ? nwipe_misc_thread_data->nwipe_selected
+                                      : nwipe_misc_thread_data->nwipe_enumerated;
 
-            for( i = 0; i < nwipe_misc_thread_data->nwipe_enumerated; i++ )
-            {
-                nwipe_update_temperature( c[i] );
-            }
-        }
-        else
+        for( i = 0; i < count && terminate_signal != 1; i++ )
         {
-            sleep( 1 );
+            nwipe_update_temperature( c[i] );
         }
-    }
+
+        pthread_mutex_unlock( &nwipe_station_mutex );
+
+    } while( !nwipe_events_sleep( 2 ) );
+
     return NULL;
 }
 
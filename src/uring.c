@@ -0,0 +1,292 @@
+/*
+ *  uring.c: A minimal io_uring interface for the pass routines.
+ *
+ *  The interface uses the io_uring system calls directly, so nwipe does not
+ *  depend on liburing. If the kernel does not support io_uring, or it has been
+ *  disabled, nwipe_uring_init() fails and the caller uses synchronous I/O.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "uring.h"
+
+#ifdef __NR_io_uring_setup
+
+static int nwipe_uring_setup_syscall( unsigned entries, struct io_uring_params* p )
+{
+    return (int) syscall( __NR_io_uring_setup, entries, p );
+}
+
+static int nwipe_uring_enter_syscall( int fd, unsigned to_submit, unsigned min_complete, unsigned flags )
+{
+    return (int) syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0 );
+}
+
+static int nwipe_uring_register_syscall( int fd, unsigned opcode, const void* arg, unsigned nr_args )
+{
+    return (int) syscall( __NR_io_uring_register, fd, opcode, arg, nr_args );
+}
+
+#else
+
+/* The C library headers are too old to know about io_uring, so it is never used. */
+
+static int nwipe_uring_setup_syscall( unsigned entries, struct io_uring_params* p )
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+static int nwipe_uring_enter_syscall( int fd, unsigned to_submit, unsigned min_complete, unsigned flags )
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+static int nwipe_uring_register_syscall( int fd, unsigned opcode, const void* arg, unsigned nr_args )
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif /* __NR_io_uring_setup */
+
+int nwipe_uring_init( nwipe_uring_t* ring, unsigned entries )
+{
+    struct io_uring_params p;
+
+    memset( ring, 0, sizeof( nwipe_uring_t ) );
+    memset( &p, 0, sizeof( p ) );
+
+    ring->fd = nwipe_uring_setup_syscall( entries, &p );
+
+    if( ring->fd < 0 )
+    {
+        ring->fd = -1;
+        return -1;
+    }
+
+    /* Map the submission queue ring, the completion queue ring and the submission queue entries. */
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof( unsigned );
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof( struct io_uring_cqe );
+    ring->sqes_size = p.sq_entries * sizeof( struct io_uring_sqe );
+
+    ring->sq_ptr = mmap( NULL,
+                         ring->sq_size,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         ring->fd,
+                         IORING_OFF_SQ_RING );
+    ring->cq_ptr = mmap( NULL,
+                         ring->cq_size,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         ring->fd,
+                         IORING_OFF_CQ_RING );
+    ring->sqes = mmap( NULL,
+                       ring->sqes_size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE,
+                       ring->fd,
+                       IORING_OFF_SQES );
+
+    if( ring->sq_ptr == MAP_FAILED || ring->cq_ptr == MAP_FAILED || ring->sqes == MAP_FAILED )
+    {
+        int saved_errno = errno;
+
+        nwipe_uring_exit( ring );
+        errno = saved_errno;
+        return -1;
+    }
+
+    ring->sq_head = (unsigned*) ( (char*) ring->sq_ptr + p.sq_off.head );
+    ring->sq_tail = (unsigned*) ( (char*) ring->sq_ptr + p.sq_off.tail );
+    ring->sq_mask = (unsigned*) ( (char*) ring->sq_ptr + p.sq_off.ring_mask );
+    ring->sq_array = (unsigned*) ( (char*) ring->sq_ptr + p.sq_off.array );
+
+    ring->cq_head = (unsigned*) ( (char*) ring->cq_ptr + p.cq_off.head );
+    ring->cq_tail = (unsigned*) ( (char*) ring->cq_ptr + p.cq_off.tail );
+    ring->cq_mask = (unsigned*) ( (char*) ring->cq_ptr + p.cq_off.ring_mask );
+    ring->cqes = (struct io_uring_cqe*) ( (char*) ring->cq_ptr + p.cq_off.cqes );
+
+    ring->entries = p.sq_entries;
+
+    return 0;
+}
+
+int nwipe_uring_register_buffers( nwipe_uring_t* ring, const struct iovec* iov, unsigned count )
+{
+    if( nwipe_uring_register_syscall( ring->fd, IORING_REGISTER_BUFFERS, iov, count ) != 0 )
+    {
+        return -1;
+    }
+
+    ring->fixed_buffers = 1;
+    return 0;
+}
+
+int nwipe_uring_queue( nwipe_uring_t* ring,
+                       nwipe_uring_op_t op,
+                       int fd,
+                       void* buf,
+                       size_t length,
+                       unsigned long long offset,
+                       int buf_index,
+                       unsigned long long user_data )
+{
+    struct io_uring_sqe* sqe;
+    unsigned tail;
+    unsigned head;
+    unsigned idx;
+
+    /* Only this thread writes the tail, the kernel moves the head as it consumes entries. */
+    tail = *ring->sq_tail;
+    head = __atomic_load_n( ring->sq_head, __ATOMIC_ACQUIRE );
+
+    if( tail - head >= ring->entries )
+    {
+        errno = EBUSY;
+        return -1;
+    }
+
+    idx = tail & *ring->sq_mask;
+    sqe = &ring->sqes[idx];
+    memset( sqe, 0, sizeof( struct io_uring_sqe ) );
+
+    if( buf_index >= 0 && ring->fixed_buffers )
+    {
+        sqe->opcode = ( op == NWIPE_URING_WRITE ) ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = (unsigned short) buf_index;
+    }
+    else
+    {
+        sqe->opcode = ( op == NWIPE_URING_WRITE ) ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long) (uintptr_t) buf;
+    sqe->len = (unsigned) length;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+
+    ring->sq_array[idx] = idx;
+
+    /* Make the entry visible to the kernel before the new tail. */
+    __atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+    ring->to_submit++;
+
+    return 0;
+}
+
+int nwipe_uring_submit( nwipe_uring_t* ring )
+{
+    int r;
+
+    while( ring->to_submit > 0 )
+    {
+        r = nwipe_uring_enter_syscall( ring->fd, ring->to_submit, 0, 0 );
+
+        if( r < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        ring->to_submit -= (unsigned) r;
+    }
+
+    return 0;
+}
+
+int nwipe_uring_wait( nwipe_uring_t* ring, unsigned long long* user_data, int* result )
+{
+    struct io_uring_cqe* cqe;
+    unsigned head;
+    unsigned tail;
+    int r;
+
+    while( 1 )
+    {
+        head = *ring->cq_head;
+        tail = __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE );
+
+        if( head != tail )
+        {
+            cqe = &ring->cqes[head & *ring->cq_mask];
+            *user_data = cqe->user_data;
+            *result = cqe->res;
+
+            /* Hand the entry back to the kernel. */
+            __atomic_store_n( ring->cq_head, head + 1, __ATOMIC_RELEASE );
+            return 0;
+        }
+
+        /* Nothing has completed yet, submit anything queued and sleep until a completion arrives. */
+        r = nwipe_uring_enter_syscall( ring->fd, ring->to_submit, 1, IORING_ENTER_GETEVENTS );
+
+        if( r < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        ring->to_submit -= (unsigned) r;
+    }
+}
+
+void nwipe_uring_exit( nwipe_uring_t* ring )
+{
+    if( ring->sqes != NULL && ring->sqes != MAP_FAILED )
+    {
+        munmap( ring->sqes, ring->sqes_size );
+    }
+
+    if( ring->cq_ptr != NULL && ring->cq_ptr != MAP_FAILED )
+    {
+        munmap( ring->cq_ptr, ring->cq_size );
+    }
+
+    if( ring->sq_ptr != NULL && ring->sq_ptr != MAP_FAILED )
+    {
+        munmap( ring->sq_ptr, ring->sq_size );
+    }
+
+    if( ring->fd >= 0 )
+    {
+        close( ring->fd );
+    }
+
+    memset( ring, 0, sizeof( nwipe_uring_t ) );
+    ring->fd = -1;
+}
@@ -0,0 +1,113 @@
+/*
+ *  uring.h: A minimal io_uring interface for the pass routines.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef URING_H_
+#define URING_H_
+
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+typedef enum nwipe_uring_op_t_ {
+    NWIPE_URING_READ = 0,  // Read from the device into the buffer.
+    NWIPE_URING_WRITE  // Write the buffer to the device.
+} nwipe_uring_op_t;
+
+typedef struct nwipe_uring_t_
+{
+    int fd;  // The io_uring file descriptor, -1 when not set up.
+    unsigned entries;  // The number of submission queue entries.
+    unsigned to_submit;  // The number of queued entries that have not been passed to the kernel yet.
+    int fixed_buffers;  // Set when buffers have been registered with the ring.
+
+    /* Submission queue. */
+    void* sq_ptr;
+    size_t sq_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    /* Completion queue. */
+    void* cq_ptr;
+    size_t cq_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+} nwipe_uring_t;
+
+/**
+ * Creates an io_uring instance.
+ *
+ * @parameter ring     The ring to initialise.
+ * @parameter entries  The queue depth.
+ * @returns            0 on success, -1 with errno set if io_uring is not available.
+ */
+int nwipe_uring_init( nwipe_uring_t* ring, unsigned entries );
+
+/**
+ * Registers I/O buffers with the ring, so the kernel does not have to map them on every request.
+ * The buffers are referred to by their index in iov when queueing requests.
+ *
+ * @returns  0 on success, -1 with errno set on failure. Requests may still use unregistered buffers.
+ */
+int nwipe_uring_register_buffers( nwipe_uring_t* ring, const struct iovec* iov, unsigned count );
+
+/**
+ * Queues a read or write request, it is passed to the kernel by the next nwipe_uring_submit() or
+ * nwipe_uring_wait() call.
+ *
+ * @parameter buf_index  The index of the registered buffer that contains buf, or -1.
+ * @parameter user_data  Returned with the completion of this request.
+ * @returns              0 on success, -1 if the submission queue is full.
+ */
+int nwipe_uring_queue( nwipe_uring_t* ring,
+                       nwipe_uring_op_t op,
+                       int fd,
+                       void* buf,
+                       size_t length,
+                       unsigned long long offset,
+                       int buf_index,
+                       unsigned long long user_data );
+
+/**
+ * Passes all queued requests to the kernel.
+ *
+ * @returns  0 on success, -1 with errno set on failure.
+ */
+int nwipe_uring_submit( nwipe_uring_t* ring );
+
+/**
+ * Waits for the next completion, submitting any queued requests first.
+ *
+ * @parameter user_data  Set to the user_data of the completed request.
+ * @parameter result     Set to the number of bytes transferred, or a negative errno value.
+ * @returns              0 on success, -1 with errno set on failure.
+ */
+int nwipe_uring_wait( nwipe_uring_t* ring, unsigned long long* user_data, int* result );
+
+/**
+ * Releases the ring. Any requests still in flight are waited for by the kernel.
+ */
+void nwipe_uring_exit( nwipe_uring_t* ring );
+
+#endif /* URING_H_ */
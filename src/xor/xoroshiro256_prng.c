@@ -27,22 +27,38 @@
  */
 
 #include "xoroshiro256_prng.h"
+#include <endian.h>
 #include <stdint.h>
 #include <string.h>
 
+// Define XOROSHIRO256_NO_SIMD to build the portable code only
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && !defined( XOROSHIRO256_NO_SIMD )
+#include <immintrin.h>
+#define XOROSHIRO256_X86 1
+#endif
+
 void xoroshiro256_init( xoroshiro256_state_t* state, uint64_t init_key[], unsigned long key_length )
 {
-    // Initialization logic; ensure 256 bits are properly seeded
-    for( int i = 0; i < 4; i++ )
+    // Initialization logic; ensure 256 bits per lane are properly seeded, each lane takes the
+    // next four words of the key
+    uint64_t prev = 0;
+
+    for( int lane = 0; lane < XOROSHIRO256_LANES; lane++ )
     {
-        if( i < key_length )
+        for( int i = 0; i < 4; i++ )
         {
-            state->s[i] = init_key[i];
-        }
-        else
-        {
-            // Example fallback for insufficient seeds; consider better seeding strategies
-            state->s[i] = state->s[i - 1] * 6364136223846793005ULL + 1;
+            unsigned long k = (unsigned long) ( lane * 4 + i );
+
+            if( k < key_length )
+            {
+                state->s[i][lane] = init_key[k];
+            }
+            else
+            {
+                // Example fallback for insufficient seeds; consider better seeding strategies
+                state->s[i][lane] = prev * 6364136223846793005ULL + 1;
+            }
+            prev = state->s[i][lane];
         }
     }
 }
@@ -52,23 +68,142 @@ static inline uint64_t rotl( const uint64_t x, int k )
     return ( x << k ) | ( x >> ( 64 - k ) );
 }
 
-void xoroshiro256_genrand_uint256_to_buf( xoroshiro256_state_t* state, unsigned char* bufpos )
+#ifndef XOROSHIRO256_X86
+
+static void xoroshiro256_genrand_scalar( xoroshiro256_state_t* state, unsigned char* bufpos, size_t blocks )
 {
-    // This part of the code updates the state using xoroshiro256**'s algorithm.
-    const uint64_t result_starstar = rotl( state->s[1] * 5, 7 ) * 9;
-    const uint64_t t = state->s[1] << 17;
+    uint64_t w;
+
+    while( blocks-- > 0 )
+    {
+        for( int lane = 0; lane < XOROSHIRO256_LANES; lane++ )
+        {
+            // This part of the code updates the state using xoroshiro256**'s algorithm.
+            const uint64_t t = state->s[1][lane] << 17;
+
+            state->s[2][lane] ^= state->s[0][lane];
+            state->s[3][lane] ^= state->s[1][lane];
+            state->s[1][lane] ^= state->s[2][lane];
+            state->s[0][lane] ^= state->s[3][lane];
 
-    state->s[2] ^= state->s[0];
-    state->s[3] ^= state->s[1];
-    state->s[1] ^= state->s[2];
-    state->s[0] ^= state->s[3];
+            state->s[2][lane] ^= t;
+            state->s[3][lane] = rotl( state->s[3][lane], 45 );
+        }
+
+        // Here, we write the complete state into the buffer, as with the single lane generator.
+        for( int i = 0; i < 4; i++ )
+        {
+            for( int lane = 0; lane < XOROSHIRO256_LANES; lane++ )
+            {
+                w = htole64( state->s[i][lane] );
+                memcpy( bufpos, &w, sizeof( w ) );
+                bufpos += sizeof( w );
+            }
+        }
+    }
+}
+
+#else
 
-    state->s[2] ^= t;
-    state->s[3] = rotl( state->s[3], 45 );
+// SSE2 is part of x86-64, two lanes per register and two registers per word
+#define XOROSHIRO256_SSE2_STEP( s0, s1, s2, s3, t )                                   \
+    do                                                                                  \
+    {                                                                                   \
+        t = _mm_slli_epi64( s1, 17 );                                                   \
+        s2 = _mm_xor_si128( s2, s0 );                                                   \
+        s3 = _mm_xor_si128( s3, s1 );                                                   \
+        s1 = _mm_xor_si128( s1, s2 );                                                   \
+        s0 = _mm_xor_si128( s0, s3 );                                                   \
+        s2 = _mm_xor_si128( s2, t );                                                    \
+        s3 = _mm_or_si128( _mm_slli_epi64( s3, 45 ), _mm_srli_epi64( s3, 64 - 45 ) ); \
+    } while( 0 )
 
-    // Note: 'result_starstar' was only used for demonstration purposes and is not part of the
-    // original Xoroshiro256** specification. Here, we write the complete state into the buffer.
-    // Ensure that 'bufpos' has enough storage space (256 bits / 32 bytes).
+static void xoroshiro256_genrand_sse2( xoroshiro256_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    __m128i a0 = _mm_loadu_si128( (const __m128i*) &state->s[0][0] );
+    __m128i a1 = _mm_loadu_si128( (const __m128i*) &state->s[1][0] );
+    __m128i a2 = _mm_loadu_si128( (const __m128i*) &state->s[2][0] );
+    __m128i a3 = _mm_loadu_si128( (const __m128i*) &state->s[3][0] );
+    __m128i b0 = _mm_loadu_si128( (const __m128i*) &state->s[0][2] );
+    __m128i b1 = _mm_loadu_si128( (const __m128i*) &state->s[1][2] );
+    __m128i b2 = _mm_loadu_si128( (const __m128i*) &state->s[2][2] );
+    __m128i b3 = _mm_loadu_si128( (const __m128i*) &state->s[3][2] );
+    __m128i t;
+
+    for( size_t b = 0; b < blocks; b++ )
+    {
+        XOROSHIRO256_SSE2_STEP( a0, a1, a2, a3, t );
+        XOROSHIRO256_SSE2_STEP( b0, b1, b2, b3, t );
+
+        _mm_storeu_si128( (__m128i*) ( bufpos + 0 ), a0 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 16 ), b0 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 32 ), a1 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 48 ), b1 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 64 ), a2 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 80 ), b2 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 96 ), a3 );
+        _mm_storeu_si128( (__m128i*) ( bufpos + 112 ), b3 );
+        bufpos += XOROSHIRO256_BLOCK_SIZE;
+    }
+
+    _mm_storeu_si128( (__m128i*) &state->s[0][0], a0 );
+    _mm_storeu_si128( (__m128i*) &state->s[1][0], a1 );
+    _mm_storeu_si128( (__m128i*) &state->s[2][0], a2 );
+    _mm_storeu_si128( (__m128i*) &state->s[3][0], a3 );
+    _mm_storeu_si128( (__m128i*) &state->s[0][2], b0 );
+    _mm_storeu_si128( (__m128i*) &state->s[1][2], b1 );
+    _mm_storeu_si128( (__m128i*) &state->s[2][2], b2 );
+    _mm_storeu_si128( (__m128i*) &state->s[3][2], b3 );
+}
+
+// AVX2, all four lanes in one register
+__attribute__( ( target( "avx2" ) ) ) static void
+xoroshiro256_genrand_avx2( xoroshiro256_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+    __m256i s0 = _mm256_loadu_si256( (const __m256i*) state->s[0] );
+    __m256i s1 = _mm256_loadu_si256( (const __m256i*) state->s[1] );
+    __m256i s2 = _mm256_loadu_si256( (const __m256i*) state->s[2] );
+    __m256i s3 = _mm256_loadu_si256( (const __m256i*) state->s[3] );
+    __m256i t;
+
+    for( size_t b = 0; b < blocks; b++ )
+    {
+        t = _mm256_slli_epi64( s1, 17 );
+
+        s2 = _mm256_xor_si256( s2, s0 );
+        s3 = _mm256_xor_si256( s3, s1 );
+        s1 = _mm256_xor_si256( s1, s2 );
+        s0 = _mm256_xor_si256( s0, s3 );
+
+        s2 = _mm256_xor_si256( s2, t );
+        s3 = _mm256_or_si256( _mm256_slli_epi64( s3, 45 ), _mm256_srli_epi64( s3, 64 - 45 ) );
+
+        _mm256_storeu_si256( (__m256i*) ( bufpos + 0 ), s0 );
+        _mm256_storeu_si256( (__m256i*) ( bufpos + 32 ), s1 );
+        _mm256_storeu_si256( (__m256i*) ( bufpos + 64 ), s2 );
+        _mm256_storeu_si256( (__m256i*) ( bufpos + 96 ), s3 );
+        bufpos += XOROSHIRO256_BLOCK_SIZE;
+    }
+
+    _mm256_storeu_si256( (__m256i*) state->s[0], s0 );
+    _mm256_storeu_si256( (__m256i*) state->s[1], s1 );
+    _mm256_storeu_si256( (__m256i*) state->s[2], s2 );
+    _mm256_storeu_si256( (__m256i*) state->s[3], s3 );
+}
+
+#endif /* XOROSHIRO256_X86 */
+
+void xoroshiro256_genrand_to_buf( xoroshiro256_state_t* state, unsigned char* bufpos, size_t blocks )
+{
+#ifdef XOROSHIRO256_X86
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        xoroshiro256_genrand_avx2( state, bufpos, blocks );
+        return;
+    }
 
-    memcpy( bufpos, state->s, 32 );  // Copies the entire 256-bit (32 bytes) state into 'bufpos'
+    xoroshiro256_genrand_sse2( state, bufpos, blocks );
+#else
+    xoroshiro256_genrand_scalar( state, bufpos, blocks );
+#endif
 }
@@ -27,18 +27,27 @@
 #ifndef XOROSHIRO256_PRNG_H
 #define XOROSHIRO256_PRNG_H
 
+#include <stddef.h>
 #include <stdint.h>
 
-// Structure to store the state of the xoroshiro256** random number generator
+// Number of independent generators that are stepped together, so that SIMD units can run them in parallel
+#define XOROSHIRO256_LANES 4
+
+// Size in bytes of the output of one step of all the lanes
+#define XOROSHIRO256_BLOCK_SIZE ( 4 * 8 * XOROSHIRO256_LANES )
+
+// Structure to store the state of the xoroshiro256** random number generators, s[word][lane]
 typedef struct xoroshiro256_state_s
 {
-    uint64_t s[4];
+    uint64_t s[4][XOROSHIRO256_LANES];
 } xoroshiro256_state_t;
 
-// Initializes the xoroshiro256** random number generator with a seed
+// Initializes the xoroshiro256** random number generators with a seed
 void xoroshiro256_init( xoroshiro256_state_t* state, uint64_t init_key[], unsigned long key_length );
 
-// Generates a 256-bit random number using xoroshiro256** and stores it directly in the output buffer
-void xoroshiro256_genrand_uint256_to_buf( xoroshiro256_state_t* state, unsigned char* bufpos );
+// Generates blocks of XOROSHIRO256_BLOCK_SIZE bytes and stores them directly in the output buffer.
+// Each block is the state after one step, word by word with the lanes interleaved, as little-endian
+// 64-bit words. The stream is the same whichever of the scalar, SSE2 or AVX2 code paths is used.
+void xoroshiro256_genrand_to_buf( xoroshiro256_state_t* state, unsigned char* bufpos, size_t blocks );
 
 #endif  // XOROSHIRO256_PRNG_H